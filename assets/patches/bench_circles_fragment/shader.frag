@@ -0,0 +1,32 @@
+// Benchmark reference for bench_circles_instanced: the same circles, every
+// one of them evaluated for every pixel.
+
+uniform vec2 u_resolution;
+uniform float u_time;
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+// Parameters
+uniform float u_count;
+uniform float u_radius;
+
+float hash(float n) {
+  return fract(sin(n * 12.9898) * 43758.5453);
+}
+
+vec2 circleCenter(float i, float t) {
+  vec2 drift = vec2(hash(i + 13.), hash(i + 29.)) - .5;
+  return fract(vec2(hash(i), hash(i + 71.)) + t * .01 * drift);
+}
+
+void main() {
+  float aspect = u_resolution.x / u_resolution.y;
+  vec3 color = vec3(0.);
+  for (float i = 0.; i < u_count; i++) {
+    vec2 st = (vTexCoord0 - circleCenter(i, u_time)) * vec2(aspect, 1.);
+    float d = length(st) / u_radius;
+    color += vec3(1. - smoothstep(.8, 1., d)) * .05;
+  }
+  oColor = vec4(color, 1.);
+}
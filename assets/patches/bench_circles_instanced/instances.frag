@@ -0,0 +1,7 @@
+in vec2  vCorner;
+out vec4 oColor;
+
+void main() {
+  float d = length(vCorner);
+  oColor = vec4(vec3(1. - smoothstep(.8, 1., d)) * .05, 1.);
+}
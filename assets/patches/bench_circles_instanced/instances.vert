@@ -0,0 +1,38 @@
+// One quad per circle, the same circles as bench_circles_fragment. The
+// pass is sized for the largest benchmark count, extra instances collapse
+// outside the viewport.
+#pragma couleurs instances 0 65536 main quads add
+
+uniform vec2 u_resolution;
+uniform float u_time;
+
+// Parameters
+uniform float u_count;
+uniform float u_radius;
+
+in vec2 a_corner;
+in vec4 a_random;
+
+out vec2 vCorner;
+
+float hash(float n) {
+  return fract(sin(n * 12.9898) * 43758.5453);
+}
+
+vec2 circleCenter(float i, float t) {
+  vec2 drift = vec2(hash(i + 13.), hash(i + 29.)) - .5;
+  return fract(vec2(hash(i), hash(i + 71.)) + t * .01 * drift);
+}
+
+void main() {
+  float i = float(gl_InstanceID);
+  if (i >= u_count) {
+    gl_Position = vec4(2., 2., 2., 1.);
+    return;
+  }
+
+  float aspect = u_resolution.x / u_resolution.y;
+  vec2 center = circleCenter(i, u_time) * 2. - 1.;
+  vCorner = a_corner;
+  gl_Position = vec4(center + a_corner * vec2(u_radius / aspect, u_radius) * 2., 0., 1.);
+}
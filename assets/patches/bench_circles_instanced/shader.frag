@@ -0,0 +1,8 @@
+// The circles are drawn by instances.vert over this pass
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+void main() {
+  oColor = vec4(0., 0., 0., 1.);
+}
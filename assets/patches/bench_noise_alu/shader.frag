@@ -0,0 +1,32 @@
+// Benchmark reference for bench_noise_tex: fbm and film grain evaluated
+// with snoise() and grain() for every pixel.
+
+#include "../../shaders/couleurs_lib/snoise.glsl"
+#include "../../shaders/couleurs_lib/grain.glsl"
+
+uniform vec2 u_resolution;
+uniform float u_time;
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+// Parameters
+uniform float u_octaves;
+
+float fbm(vec3 pos, int octaves) {
+  float value = 0.;
+  float amplitude = .5;
+  for (int i = 0; i < octaves; i++) {
+    value += amplitude * snoise(pos);
+    pos = pos * 2.01 + 17.3;
+    amplitude *= .5;
+  }
+  return value;
+}
+
+void main() {
+  vec2 st = vTexCoord0 * vec2(u_resolution.x / u_resolution.y, 1.) * 3.;
+  float n = fbm(vec3(st, u_time * .1), int(u_octaves)) * .5 + .5;
+  float g = grain(vTexCoord0, u_resolution, u_time, 10.);
+  oColor = vec4(vec3(n * mix(.9, 1.1, g)), 1.);
+}
@@ -0,0 +1,20 @@
+// Same image as bench_noise_alu with the precomputed noise textures:
+// fbmTex() and grainTex() from noiseTex.glsl.
+
+#include "../../shaders/couleurs_lib/noiseTex.glsl"
+
+uniform vec2 u_resolution;
+uniform float u_time;
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+// Parameters
+uniform float u_octaves;
+
+void main() {
+  vec2 st = vTexCoord0 * vec2(u_resolution.x / u_resolution.y, 1.) * 3.;
+  float n = fbmTex(vec3(st, u_time * .1), int(u_octaves)) * .5 + .5;
+  float g = grainTex(vTexCoord0, u_resolution, u_time, 10.);
+  oColor = vec4(vec3(n * mix(.9, 1.1, g)), 1.);
+}
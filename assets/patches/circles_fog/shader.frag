@@ -11,7 +11,7 @@
 #include "../../shaders/glslLib/filter/gaussianBlur/2D.glsl"
 #include "../../shaders/glslLib/space/rotate.glsl"
 #include "../../shaders/glslLib/space/ratio.glsl"
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 #include "../../shaders/couleurs_lib/grain.glsl"
 #include "../../shaders/couleurs_lib/sharpen.glsl"
 
@@ -30,8 +30,8 @@ out vec4 oColor;
 // Textures
 uniform sampler2D u_syphonTex;
 uniform sampler2D u_blueNoise;
-uniform sampler2D u_lut;
-uniform sampler2D u_lut_2;
+uniform sampler3D u_lut_3d;
+uniform sampler3D u_lut_2_3d;
 
 // Parameters
 uniform float u_speed;
@@ -168,7 +168,7 @@ void main() {
   float grain = grain(uv, u_resolution, u_time, 10.);
   float luma = rgb2luma(color);
   color += .05 * grain * (1. - smoothstep(0., .7, luma));
-  color = mix(color, lut(color, u_lut_2), u_lutMix);
+  color = mix(color, lut3d(color, u_lut_2_3d), u_lutMix);
   color = contrast(color, u_contrast * 2.);
   color = desaturate(color, u_saturation);
   color = mix(color, vec3(1.), u_whiteMix);
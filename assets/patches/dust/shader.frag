@@ -9,7 +9,7 @@
 #include "../../shaders/fb_lib/color/blend/multiply.glsl"
 
 #include "../../shaders/couleurs_lib/snoise.glsl"
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 
 #include "../../shaders/glslLib/generative/random.glsl"
 #include "../../shaders/glslLib/generative/gnoise.glsl"
@@ -21,7 +21,7 @@
 
 
 uniform sampler2D u_texRandom;
-uniform sampler2D u_lookup_couleurs_bw;
+uniform sampler3D u_lookup_couleurs_bw_3d;
 uniform sampler2D u_buffer0;
 uniform sampler2D u_buffer1;
 uniform sampler2D u_buffer2;
@@ -186,7 +186,7 @@ void main() {
   #elif defined( BUFFER_1 )
  
     vec3 color = chromaAB(u_buffer0, uv, vec2(1.), .0);
-    color = mix(color, lut(color, u_lookup_couleurs_bw), u_lutMix);
+    color = mix(color, lut3d(color, u_lookup_couleurs_bw_3d), u_lutMix);
     oColor = vec4(color, 1.);
 
   #elif defined( BUFFER_2 )
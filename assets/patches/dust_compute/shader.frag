@@ -0,0 +1,19 @@
+#define texture2D(A,B) texture(A,B)
+
+uniform vec2 u_resolution;
+uniform float u_time;
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+// Written by shader.comp
+uniform sampler2D u_trail;
+
+// Parameters
+uniform float u_brightness;
+
+void main() {
+  float d = texture(u_trail, vTexCoord0).r;
+  vec3 color = vec3(1. - exp(-d * u_brightness));
+  oColor = vec4(color, 1.);
+}
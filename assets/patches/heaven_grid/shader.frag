@@ -8,7 +8,7 @@
 #include "../../shaders/glslLib/generative/snoise.glsl"
 #include "../../shaders/glslLib/generative/gnoise.glsl"
 #include "../../shaders/glslLib/generative/random.glsl"
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 
 uniform float u_time;
 uniform float u_contrast;
@@ -16,7 +16,7 @@ uniform float u_saturation;
 uniform float u_whiteMix;
 uniform vec2 u_resolution;
 uniform sampler2D u_buffer0;
-uniform sampler2D u_lookup_couleurs_bw;
+uniform sampler3D u_lookup_couleurs_bw_3d;
 
 in vec2  vTexCoord0;
 out vec4 oColor;
@@ -64,7 +64,7 @@ void main() {
   float n_3 = gnoise(u_time * u_speed + r_3 * 10.);
   n_3 *= sin(fract(uv * size).x + u_time * u_speed + r_3 * 10.) * .5 + .5;
   color = mix(color, bg, clamp(10. * smoothstep(.0, .2, n_2) * smoothstep(.0, .3, n_3), 0., 1.));
-  color = mix(color, lut(color, u_lookup_couleurs_bw), u_lutMix);
+  color = mix(color, lut3d(color, u_lookup_couleurs_bw_3d), u_lutMix);
 
   vec2 uvt = floor((uv * size));
   float r_4 = random(uvt);
@@ -11,7 +11,7 @@
 #include "../../shaders/fb_lib/animation/easing/sine.glsl"
 #include "../../shaders/fb_lib/generative/random.glsl"
 
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 
 uniform vec2 u_resolution;
 uniform float u_time;
@@ -23,7 +23,7 @@ uniform sampler2D u_buffer0;
 uniform sampler2D u_buffer1;
 
 uniform sampler2D u_input;
-uniform sampler2D u_lookup;
+uniform sampler3D u_lookup_3d;
 
 // Parameters
 uniform float u_circleSize;
@@ -140,7 +140,7 @@ void main() {
 
   vec4 color = texture(u_buffer1, rotate(uv, 0. * -PI/4.));
   color = desaturate(color, -u_saturation);  
-  vec4 lut_color = lut(color, u_lookup);
+  vec4 lut_color = lut3d(color, u_lookup_3d);
   color = mix(color, lut_color, u_lutMix);
   color = contrast(color, u_contrast);
   oColor = color;  
@@ -1,6 +1,6 @@
 #include "../../shaders/couleurs_lib/snoise.glsl"
 #include "../../shaders/couleurs_lib/grain.glsl"
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 
 #include "../../shaders/fb_lib/math/within.glsl"
 #include "../../shaders/fb_lib/math/map.glsl"
@@ -20,9 +20,9 @@ out vec4 oColor;
 uniform sampler2D u_buffer0;
 uniform sampler2D u_buffer1;
 
-uniform sampler2D u_lookup_1;
-uniform sampler2D u_lookup_2;
-uniform sampler2D u_lookup_3;
+uniform sampler3D u_lookup_1_3d;
+uniform sampler3D u_lookup_2_3d;
+uniform sampler3D u_lookup_3_3d;
 
 // Parameters
 uniform float u_noiseAmplitude;
@@ -74,7 +74,7 @@ void main() {
   // color = vec3(a);
 
   // color = texture(u_buffer0, vTexCoord0).rgb;
-  color = mix(color, lut(color, u_lookup_1), u_lutMix);
+  color = mix(color, lut3d(color, u_lookup_1_3d), u_lutMix);
   oColor = vec4(color, 1.);
 
 #endif
@@ -8,7 +8,7 @@
 #include "../../shaders/fb_lib/color/space/hsv2rgb.glsl"
 #include "../../shaders/fb_lib/color/space/rgb2hsv.glsl"
 
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 
 uniform vec2 u_resolution;
 uniform float u_time;
@@ -18,7 +18,7 @@ out vec4 oColor;
 
 uniform sampler2D u_buffer0;
 uniform sampler2D u_buffer1;
-uniform sampler2D u_lookup;
+uniform sampler3D u_lookup_3d;
 
 // Parameters
 uniform float u_feedbackAmount;
@@ -61,7 +61,7 @@ void main() {
 
     vec3 color = texture(u_buffer1, uv).rgb;
     color = contrast(color, 1. + u_contrast);
-    color = mix(color, lut(color, u_lookup), u_lutMix);
+    color = mix(color, lut3d(color, u_lookup_3d), u_lutMix);
     oColor = vec4(color, 1.);
 
   #endif
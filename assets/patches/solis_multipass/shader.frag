@@ -19,7 +19,7 @@
 #include "../../shaders/fb_lib/fx/chromaAB.glsl"
 
 #include "../../shaders/couleurs_lib/snoise.glsl"
-#include "../../shaders/couleurs_lib/lut.glsl"
+#include "../../shaders/couleurs_lib/lut3d.glsl"
 #include "../../shaders/couleurs_lib/grain.glsl"
 
 uniform sampler2D u_buffer0;
@@ -29,8 +29,8 @@ uniform sampler2D u_buffer3;
 uniform sampler2D u_buffer4;
 uniform sampler2D u_buffer5;
 
-uniform sampler2D u_lookup_couleurs_bw;
-uniform sampler2D u_lookup_shed_2;
+uniform sampler3D u_lookup_couleurs_bw_3d;
+uniform sampler3D u_lookup_shed_2_3d;
 
 uniform vec2 u_resolution;
 uniform float u_time;
@@ -78,10 +78,10 @@ void main() {
 
   // Color palette
   vec4 newColor = color;
-  newColor = lut(color, u_lookup_shed_2);
+  newColor = lut3d(color, u_lookup_shed_2_3d);
 
   // LUT
-  newColor = lut(newColor, u_lookup_couleurs_bw);
+  newColor = lut3d(newColor, u_lookup_couleurs_bw_3d);
 	oColor = mix(color, newColor, u_lutMix);
 
   // Saturation
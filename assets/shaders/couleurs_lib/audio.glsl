@@ -0,0 +1,34 @@
+/*
+Function: audioBand, audioSpectrum, audioHistory
+Description: Audio analysis from the app. Levels are normalized dB [0-1],
+the spectrum is log-spaced from 30 Hz to Nyquist.
+Use: audioBand(0) for the lows, audioSpectrum(x), audioHistory(x, age) with
+age 0 for the newest hop and 1 for the oldest
+Dependencies: -
+*/
+
+#ifndef FNC_AUDIO
+#define FNC_AUDIO
+
+#ifndef AUDIO_BANDS
+#define AUDIO_BANDS 8
+#endif
+
+uniform float     u_audioBands[AUDIO_BANDS];
+uniform float     u_audioRms;
+uniform float     u_audioFlux;
+uniform sampler2D u_audioTex;
+
+float audioBand(int band) {
+    return u_audioBands[clamp(band, 0, AUDIO_BANDS - 1)];
+}
+
+float audioHistory(float x, float age) {
+    return texture(u_audioTex, vec2(x, age)).r;
+}
+
+float audioSpectrum(float x) {
+    return audioHistory(x, 0.0);
+}
+
+#endif
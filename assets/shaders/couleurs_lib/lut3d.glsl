@@ -0,0 +1,34 @@
+/*
+Function: lut3d, lut3dMix
+Description: Color grading through a 3D lookup table, one trilinear fetch.
+The app builds the tables from lookup*.png / lut*.png (as u_<name>_3d) and
+.cube files (as u_<name>).
+Use: lut3d(color, u_lookup_3d), lut3dMix(color, u_lookupA_3d, u_lookupB_3d, t)
+The vec4 versions return the table's alpha like lut(), the tables are
+opaque so it is always 1.
+Dependencies: -
+*/
+
+#ifndef FNC_LUT3D
+#define FNC_LUT3D
+
+vec3 lut3d(vec3 color, sampler3D table) {
+  // Texel centers span (0.5 / size) to (1 - 0.5 / size)
+  float size = float(textureSize(table, 0).x);
+  vec3 uvw = clamp(color, 0., 1.) * ((size - 1.) / size) + .5 / size;
+  return texture(table, uvw).rgb;
+}
+
+vec4 lut3d(vec4 color, sampler3D table) {
+  return vec4(lut3d(color.rgb, table), 1.);
+}
+
+vec3 lut3dMix(vec3 color, sampler3D a, sampler3D b, float t) {
+  return mix(lut3d(color, a), lut3d(color, b), t);
+}
+
+vec4 lut3dMix(vec4 color, sampler3D a, sampler3D b, float t) {
+  return vec4(lut3dMix(color.rgb, a, b, t), 1.);
+}
+
+#endif
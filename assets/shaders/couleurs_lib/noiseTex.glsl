@@ -0,0 +1,71 @@
+/*
+Function: snoiseTex, vnoiseTex, fbmTex, grainTex, blueNoise
+Description: Noise from the textures the app precomputes instead of ALU:
+u_noiseVolume holds tileable Perlin (r, b, a) and value noise (g),
+u_noiseBlueMask a blue noise rank mask. snoiseTex and grainTex are drop-in
+replacements for snoise and grain, with the same ranges but not the same
+values. The volume tiles every NOISE_TEX_PERIOD units.
+Use: snoiseTex(<vec2|vec3> pos), fbmTex(<vec3> pos, octaves), grainTex(texCoord, resolution, frame, multiplier), blueNoise(gl_FragCoord.xy)
+Dependencies: -
+*/
+
+#ifndef FNC_NOISETEX
+#define FNC_NOISETEX
+
+// NOISE_VOLUME_PERIOD in Constants.h
+#define NOISE_TEX_PERIOD 8.
+
+uniform sampler3D u_noiseVolume;
+uniform sampler2D u_noiseBlueMask;
+
+vec4 noiseTex4(vec3 pos) {
+  return texture(u_noiseVolume, pos / NOISE_TEX_PERIOD);
+}
+
+float snoiseTex(vec3 pos) {
+  return noiseTex4(pos).r;
+}
+
+float snoiseTex(vec2 pos) {
+  return noiseTex4(vec3(pos, 0.)).r;
+}
+
+float vnoiseTex(vec3 pos) {
+  return noiseTex4(pos).g;
+}
+
+float fbmTex(vec3 pos, int octaves) {
+  float value = 0.;
+  float amplitude = .5;
+  for (int i = 0; i < octaves; i++) {
+    value += amplitude * snoiseTex(pos);
+    // Offset so the octaves do not line up at the origin
+    pos = pos * 2.01 + 17.3;
+    amplitude *= .5;
+  }
+  return value;
+}
+
+// Ranks in (0, 1), one per pixel, for dithering and per-pixel thresholds
+float blueNoise(vec2 fragCoord) {
+  ivec2 size = textureSize(u_noiseBlueMask, 0);
+  return texelFetch(u_noiseBlueMask, ivec2(fragCoord) % size, 0).r;
+}
+
+float grainTex(vec2 texCoord, vec2 resolution, float frame, float multiplier) {
+  vec2 mult = texCoord * resolution;
+  float offset = snoiseTex(vec3(mult / multiplier, frame));
+  // Another Perlin channel, so the grain is not correlated with its offset
+  float n1 = noiseTex4(vec3(mult, offset)).b;
+  return n1 / 2. + .5;
+}
+
+float grainTex(vec2 texCoord, vec2 resolution, float frame) {
+  return grainTex(texCoord, resolution, frame, 2.5);
+}
+
+float grainTex(vec2 texCoord, vec2 resolution) {
+  return grainTex(texCoord, resolution, 0.);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+// Dual-Kawase downsample: center and 4 diagonal bilinear taps
+uniform sampler2D u_tex;
+uniform vec2      u_halfPixel;
+
+#ifdef RADIUS_UNIFORM
+uniform float RADIUS_UNIFORM;
+#define RADIUS RADIUS_UNIFORM
+#else
+#define RADIUS 1.0
+#endif
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+void main() {
+  vec2 uv = vTexCoord0;
+  vec2 o = u_halfPixel * RADIUS;
+  vec4 sum = texture(u_tex, uv) * 4.;
+  sum += texture(u_tex, uv - o);
+  sum += texture(u_tex, uv + o);
+  sum += texture(u_tex, uv + vec2(o.x, -o.y));
+  sum += texture(u_tex, uv - vec2(o.x, -o.y));
+  oColor = sum / 8.;
+}
@@ -0,0 +1,27 @@
+// Dual-Kawase upsample: 8 bilinear taps on a diamond
+uniform sampler2D u_tex;
+uniform vec2      u_halfPixel;
+
+#ifdef RADIUS_UNIFORM
+uniform float RADIUS_UNIFORM;
+#define RADIUS RADIUS_UNIFORM
+#else
+#define RADIUS 1.0
+#endif
+
+in vec2  vTexCoord0;
+out vec4 oColor;
+
+void main() {
+  vec2 uv = vTexCoord0;
+  vec2 o = u_halfPixel * RADIUS;
+  vec4 sum = texture(u_tex, uv + vec2(-o.x * 2., 0.));
+  sum += texture(u_tex, uv + vec2(-o.x, o.y)) * 2.;
+  sum += texture(u_tex, uv + vec2(0., o.y * 2.));
+  sum += texture(u_tex, uv + vec2(o.x, o.y)) * 2.;
+  sum += texture(u_tex, uv + vec2(o.x * 2., 0.));
+  sum += texture(u_tex, uv + vec2(o.x, -o.y)) * 2.;
+  sum += texture(u_tex, uv + vec2(0., -o.y * 2.));
+  sum += texture(u_tex, uv + vec2(-o.x, -o.y)) * 2.;
+  oColor = sum / 12.;
+}
@@ -0,0 +1,309 @@
+#include "benchmark/benchmark.h"
+#include "cinder/app/Platform.h"
+#include "Animation.h"
+#include "AsyncLog.h"
+#include "Constants.h"
+#include "LoopEncoder.h"
+#include "Metrics.h"
+#include "Modulator.h"
+#include "ParameterBlock.h"
+#include "ParameterSweep.h"
+#include "Parameters.h"
+#include "PassFusion.h"
+#include "TestAssets.h"
+#include "TextureUnits.h"
+#include "Utils.h"
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+// Hot paths of the core outside of GL: loading and saving params.json,
+// per-frame parameter ticks, MIDI / OSC routing, shader source scanning and
+// loop encoding. Sizes go well past real patches (tens of parameters) to
+// show the scaling.
+
+static string paramsFor( int count )
+{
+    auto name = "bench_params_" + to_string( count );
+    if ( !ci::fs::exists( testAssetFolder() / ( name + ".json" ) ) ) {
+        writeTestParams( name, count );
+    }
+    return name + ".json";
+}
+
+static void BM_ParametersLoad( benchmark::State &state )
+{
+    auto path = paramsFor( state.range( 0 ) );
+    for ( auto _ : state ) {
+        Parameters params( path );
+        benchmark::DoNotOptimize( params.get().data() );
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_ParametersLoad )->RangeMultiplier( 4 )->Range( 16, 4096 )->Unit( benchmark::kMicrosecond );
+
+static void BM_ParametersWrite( benchmark::State &state )
+{
+    Parameters params( paramsFor( state.range( 0 ) ) );
+    auto out = testAssetFolder() / "bench_written.json";
+    for ( auto _ : state ) {
+        params.writeTo( out );
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_ParametersWrite )->RangeMultiplier( 4 )->Range( 16, 4096 )->Unit( benchmark::kMicrosecond );
+
+static void BM_ParametersTick( benchmark::State &state )
+{
+    Parameters params( paramsFor( state.range( 0 ) ) );
+    double t = 0;
+    for ( auto _ : state ) {
+        for ( auto &param : params.get() ) {
+            param->tick( t );
+        }
+        t += 1. / 60.;
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_ParametersTick )->RangeMultiplier( 4 )->Range( 16, 4096 );
+
+static void BM_ModulatorTick( benchmark::State &state )
+{
+    auto type = (ModulatorType)state.range( 0 );
+    state.SetLabel( Modulator::typeToString( type ) );
+    Modulator modulator( type, 1.3f, 1.f );
+    double t = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( modulator.tick( t, 0x5eed ) );
+        t += 1. / 60.;
+    }
+}
+BENCHMARK( BM_ModulatorTick )->DenseRange( RANDOM, NOISE );
+
+static void BM_AnimationTick( benchmark::State &state )
+{
+    Animation animation;
+    animation.mDuration = 1e9f;
+    animation.mCurve = "cubic";
+    animation.trigger( 0 );
+    double t = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( animation.tick( t ) );
+        t += 1. / 60.;
+    }
+}
+BENCHMARK( BM_AnimationTick );
+
+static void BM_MidiRouting( benchmark::State &state )
+{
+    Parameters params( paramsFor( state.range( 0 ) ) );
+    int number = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( params.getParameterForMidiNumber( number ) );
+        benchmark::DoNotOptimize( params.getAnimationsForMidiNumber( 100 + number ) );
+        number = ( number + 1 ) & 7;
+    }
+}
+BENCHMARK( BM_MidiRouting )->RangeMultiplier( 4 )->Range( 16, 4096 );
+
+static void BM_OscRouting( benchmark::State &state )
+{
+    Parameters params( paramsFor( state.range( 0 ) ) );
+    int channel = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( params.getParametersForOSCChannel( channel ) );
+        channel = ( channel + 1 ) & 7;
+    }
+}
+BENCHMARK( BM_OscRouting )->RangeMultiplier( 4 )->Range( 16, 4096 );
+
+// A multipass shader with range(0) buffers, each block a few lines of work
+static string shaderWithBuffers( int buffers )
+{
+    string source;
+    for ( int i = 0; i < buffers; i++ ) {
+        source += "uniform sampler2D u_buffer" + to_string( i ) + ";\n";
+    }
+    source += "void main() {\n";
+    for ( int i = 0; i < buffers; i++ ) {
+        source += ( i == 0 ? "#ifdef BUFFER_0\n" : "#elif defined( BUFFER_" + to_string( i ) + " )\n" );
+        source += i == 0 ? "    oColor = vec4( vTexCoord0, 0., 1. );\n"
+                         : "    oColor = texture( u_buffer" + to_string( i - 1 ) + ", vTexCoord0 ) * .5;\n";
+        source += "    oColor.rgb = mix( oColor.rgb, vec3( .5 ), .1 );\n";
+    }
+    source += "#else\n    oColor = texture( u_buffer" + to_string( buffers - 1 ) + ", vTexCoord0 + .01 );\n#endif\n}\n";
+    return source;
+}
+
+static void BM_DefineBlockCount( benchmark::State &state )
+{
+    auto source = shaderWithBuffers( state.range( 0 ) );
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( getDefineBlockCount( source, "BUFFER_" ) );
+    }
+    state.SetBytesProcessed( state.iterations() * source.size() );
+}
+BENCHMARK( BM_DefineBlockCount )->RangeMultiplier( 2 )->Range( 2, 32 )->Unit( benchmark::kMicrosecond );
+
+static void BM_PassFusion( benchmark::State &state )
+{
+    int buffers = state.range( 0 );
+    auto source = shaderWithBuffers( buffers );
+    vector<bool> pinned( buffers, false );
+    for ( auto _ : state ) {
+        PassFusion fusion( source, buffers, pinned, {} );
+        benchmark::DoNotOptimize( fusion.fusedCount() );
+    }
+    state.SetBytesProcessed( state.iterations() * source.size() );
+}
+BENCHMARK( BM_PassFusion )->RangeMultiplier( 2 )->Range( 2, 16 )->Unit( benchmark::kMillisecond );
+
+// range(0) passes each sampling 8 of 24 textures, with 16 units: the plan
+// made at load time, and how many bindings it still changes every frame
+static void BM_TextureUnits( benchmark::State &state )
+{
+    vector<TextureUnits::Pass> passes;
+    for ( int i = 0; i < state.range( 0 ); i++ ) {
+        TextureUnits::Pass pass { "buffer" + to_string( i ), {} };
+        for ( int j = 0; j < 8; j++ ) {
+            pass.samplers.push_back( "u_texture" + to_string( ( i * 5 + j * 3 ) % 24 ) );
+        }
+        passes.push_back( pass );
+    }
+    int rebinds = 0;
+    for ( auto _ : state ) {
+        TextureUnits units( passes, 16, 16 );
+        rebinds = units.rebindsPerFrame();
+    }
+    state.counters[ "rebinds/frame" ] = rebinds;
+    state.counters[ "binds/frame unplanned" ] = 8 * state.range( 0 );
+}
+BENCHMARK( BM_TextureUnits )->RangeMultiplier( 2 )->Range( 2, 32 )->Unit( benchmark::kMicrosecond );
+
+// 640x360 frames of a scrolling gradient with a moving disc, every pixel changes
+static void BM_LoopEncoder( benchmark::State &state )
+{
+    auto format = (LoopEncoder::Format)state.range( 0 );
+    state.SetLabel( format == LoopEncoder::GIF ? "gif" : "apng" );
+    int width = 640, height = 360;
+    LoopEncoder encoder( testAssetFolder() / ( "bench_loop" + LoopEncoder::extension( format ) ), format, width, height, 50 );
+    ci::Surface8u surface( width, height, false );
+    int frame = 0;
+    for ( auto _ : state ) {
+        for ( int y = 0; y < height; y++ ) {
+            uint8_t *pixel = surface.getData() + y * surface.getRowBytes();
+            for ( int x = 0; x < width; x++, pixel += surface.getPixelInc() ) {
+                int dx = x - frame * 4 % width, dy = y - height / 2;
+                bool disc = dx * dx + dy * dy < 3600;
+                pixel[ surface.getRedOffset() ] = disc ? 240 : ( x + frame ) & 255;
+                pixel[ surface.getGreenOffset() ] = disc ? 60 : y;
+                pixel[ surface.getBlueOffset() ] = 128;
+            }
+        }
+        encoder.add( surface );
+        frame++;
+    }
+    encoder.finish();
+    auto stats = encoder.stats();
+    state.counters[ "KB/frame" ] = stats.bytesWritten / 1024. / std::max( stats.framesWritten, 1 );
+    state.counters[ "encoded frames/s" ] = stats.framesWritten / std::max( stats.encodeSeconds, 1e-6 );
+    state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_LoopEncoder )->DenseRange( LoopEncoder::GIF, LoopEncoder::APNG )->Unit( benchmark::kMillisecond )->UseRealTime();
+
+// Render thread side, must stay far under a microsecond
+static void BM_MetricsRecordFrame( benchmark::State &state )
+{
+    Metrics metrics;
+    int frame = 0;
+    for ( auto _ : state ) {
+        metrics.recordFrame( 5.f, false, 0 );
+        metrics.count( Metrics::OSC_EVENTS );
+        if ( ++frame % 1024 == 0 ) {
+            state.PauseTiming();
+            metrics.publish();
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_MetricsRecordFrame );
+
+// Render thread side, once per frame, with a controller writing one
+// parameter as fast as it can or not at all
+static void BM_ParameterBlockRead( benchmark::State &state )
+{
+    Parameters params( paramsFor( 64 ) );
+    ParameterBlock block;
+    auto name = "/couleurs-bench-" + to_string( getpid() );
+    block.open( name );
+    block.describe( params );
+
+    atomic<bool> running( state.range( 0 ) != 0 );
+    thread controller( [&] {
+        int fd = shm_open( name.c_str(), O_RDWR, 0 );
+        auto writer = static_cast<couleurs_params_block*>( mmap( nullptr, sizeof( couleurs_params_block ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) );
+        close( fd );
+        auto generation = couleurs_params_generation( writer );
+        for ( float v = 0; running; v += .001f ) {
+            couleurs_params_set( writer, generation, 3, &v );
+        }
+        munmap( writer, sizeof( couleurs_params_block ) );
+    } );
+    ParameterBlock::Values values;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize( block.read( values ) );
+    }
+    running = false;
+    controller.join();
+    shm_unlink( name.c_str() );
+    state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_ParameterBlockRead )->Arg( 0 )->Arg( 1 )->UseRealTime();
+
+// Table of a sweep render, random samples of every parameter
+static void BM_ParameterSweep( benchmark::State &state )
+{
+    Parameters params( paramsFor( 64 ) );
+    for ( auto _ : state ) {
+        ParameterSweep sweep( params, {}, state.range( 0 ), 0, ci::ivec2( SWEEP_TILE_WIDTH, SWEEP_TILE_HEIGHT ) );
+        benchmark::DoNotOptimize( sweep.values( 0 ).data() );
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_ParameterSweep )->Arg( 64 )->Arg( SWEEP_MAX_VARIANTS )->Unit( benchmark::kMicrosecond );
+
+// A log call: level off (0), over its site's burst (1), formatted into the
+// ring (2). Nothing drains the ring, so past its size messages are formatted
+// then dropped and nothing reaches the console.
+static void BM_AsyncLog( benchmark::State &state )
+{
+    AsyncLog::setLevel( AsyncLog::OSC, state.range( 0 ) == 0 ? AsyncLog::LEVEL_INFO : AsyncLog::LEVEL_DEBUG );
+    AsyncLog::Site site;
+    int channel = 3;
+    float value = .5f;
+    for ( auto _ : state ) {
+        if ( state.range( 0 ) < 2 ) {
+            LOG_D( OSC, "/jo_ann/" << channel << " " << value );
+        }
+        else {
+            AsyncLog::Message( AsyncLog::LEVEL_DEBUG, AsyncLog::OSC, site ).stream() << "/jo_ann/" << channel << " " << value;
+        }
+    }
+    AsyncLog::setLevel( AsyncLog::OSC, AsyncLog::LEVEL_INFO );
+    state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_AsyncLog )->Arg( 0 )->Arg( 1 )->Arg( 2 );
+
+int main( int argc, char **argv )
+{
+    ci::app::Platform::get()->addAssetDirectory( testAssetFolder() );
+    benchmark::Initialize( &argc, argv );
+    if ( benchmark::ReportUnrecognizedArguments( argc, argv ) ) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
\ No newline at end of file
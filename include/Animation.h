@@ -1,6 +1,6 @@
 #pragma once
 
-#include "cinder/Timer.h"
+#include <functional>
 #include <map>
 #include <string>
 
@@ -8,18 +8,21 @@ class Animation {
     public:
         Animation();        
         ~Animation();
-        void trigger();
-        float tick(); 
-        bool isActive();
+        // Times are on the same timeline as Parameter::tick(), so progress
+        // is a pure function of the trigger time and t
+        void trigger( const double t );
+        float tick( const double t );
+        bool isActive( const double t );
 
         int mMidiMapping;
         float mTargetValue, mDuration;
         std::string mCurve;
 
     private:        
-        bool hasCompleted();
+        bool hasCompleted( const double t );
 
-        ci::Timer mTimer;                            
+        bool   mTriggered = false;
+        double mStartTime = 0;
 
         static std::map<std::string, std::function<float ( float )>> easingFunctionsMap;
 };
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Log.h"
+#include "Constants.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Logging off the hot paths. A log call formats into a fixed buffer and
+// copies it into its thread's lock-free ring, only a message longer than
+// LOG_MESSAGE_SIZE (a shader's error list) allocates. A writer thread drains the
+// rings to the console and the log file, folds repeats, and keeps the last
+// LOG_HISTORY lines for the Log window. Each call site lets LOG_SITE_BURST
+// messages through per LOG_SITE_INTERVAL and counts the rest. A call whose
+// level and category are off costs one branch.
+//
+//   LOG_D( OSC, "/jo_ann/" << channel << " " << value );
+//   LOG_E( SHADER, message );
+class AsyncLog {
+    public:
+        enum Level { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARNING, LEVEL_ERROR, LEVEL_COUNT };
+        enum Category { GENERAL, SHADER, RENDER, OSC, MIDI, AUDIO, EXPORT, CATEGORY_COUNT };
+
+        // One per call site, constant-initialized, so no guard on first use
+        struct Site {
+            constexpr Site() {}
+            bool admit();
+
+            std::atomic<int64_t>  windowStart { INT64_MIN / 2 }; // milliseconds
+            std::atomic<uint32_t> count { 0 }, suppressed { 0 };
+        };
+
+        // What the Log window shows
+        struct Record {
+            double      time; // seconds since the log started
+            Level       level;
+            Category    category;
+            std::string text;
+            uint32_t    repeats; // identical messages from the same site folded into this one
+        };
+
+        // Formats one message, pushed to the thread's ring when destroyed
+        class Message {
+            public:
+                Message( Level level, Category category, Site &site );
+                ~Message();
+                std::ostream& stream();
+
+            private:
+                Level    mLevel;
+                Category mCategory;
+                Site     &mSite;
+        };
+
+        static AsyncLog& instance();
+
+        // path may be empty for the console only
+        void start( const ci::fs::path &path );
+        void stop();
+
+        static bool isEnabled( Level level, Category category )
+        {
+            return sEnabled.load( std::memory_order_relaxed ) & ( 1ull << ( category * LEVEL_COUNT + level ) );
+        }
+        // Messages below level are dropped at the call, LEVEL_COUNT turns the category off
+        static void setLevel( Category category, Level level );
+        static Level level( Category category );
+
+        // A copy of the history when it changed since version, which is updated
+        bool history( std::vector<Record> &records, uint64_t &version );
+        uint64_t dropped() const { return mDropped.load( std::memory_order_relaxed ); }
+        uint64_t suppressed() const { return mSuppressed.load( std::memory_order_relaxed ); }
+        // Rings allocated so far, a thread that exited hands its ring on
+        size_t rings();
+
+        // Writes whatever the rings hold, on the calling thread
+        void flush();
+
+        static const char* levelName( Level level );
+        static const char* categoryName( Category category );
+
+        // Routes CI_LOG_* through the rings, as GENERAL, rate limited per
+        // file and line
+        class CinderLogger : public ci::log::Logger {
+            public:
+                void write( const ci::log::Metadata &meta, const std::string &text ) override;
+
+            private:
+                std::mutex                                    mSitesMutex;
+                std::map<std::string, std::unique_ptr<Site>> mSites;
+        };
+
+    private:
+        // The last message of a site, and how many times it came again
+        struct Repeat {
+            std::string text;
+            uint32_t    count = 0;
+            double      time = 0; // of the last one
+            Level       level = LEVEL_INFO;
+            Category    category = GENERAL;
+            uint64_t    record = 0; // in the history, 0 for none
+        };
+
+        struct Entry {
+            double      time;
+            Level       level;
+            Category    category;
+            const Site  *site;
+            uint32_t    suppressed; // at this site since the last message let through
+            uint32_t    length;
+            char        text[ LOG_MESSAGE_SIZE ];
+            std::string *longText; // owned, instead of text when it did not fit
+        };
+
+        // Single producer (its thread), single consumer (the writer)
+        struct Ring {
+            Entry                 entries[ LOG_RING_SIZE ];
+            std::atomic<uint64_t> written { 0 }, read { 0 };
+            std::atomic<bool>     released { false }; // its thread exited
+        };
+
+        AsyncLog();
+        ~AsyncLog();
+        double now() const;
+        void push( Level level, Category category, const Site &site, uint32_t suppressed, const char *text, size_t length, std::string *longText );
+        Ring& ring();
+        void run();
+        void write( const Entry &entry );
+        void writeRepeats( Repeat &repeat );
+        void print( double time, Level level, Category category, const std::string &text );
+        uint64_t writeLine( double time, Level level, Category category, const std::string &text );
+
+        static std::atomic<uint64_t> sEnabled;
+        std::chrono::steady_clock::time_point mStart;
+        std::atomic<uint64_t>        mDropped { 0 }, mSuppressed { 0 };
+
+        std::mutex                   mRingsMutex;
+        std::vector<std::unique_ptr<Ring>> mRings;
+        std::vector<Ring*>           mFreeRings; // released and drained
+
+        // Writer
+        std::mutex                   mWriteMutex; // the writer thread, or flush()
+        std::ofstream                mFile;
+        std::map<const Site*, Repeat> mRepeats;
+        uint64_t                     mReportedDrops = 0;
+
+        std::mutex                   mHistoryMutex;
+        std::deque<Record>           mHistory;
+        uint64_t                     mHistoryFirst = 1, mHistoryVersion = 0; // records count from 1
+
+        std::thread                  mThread;
+        std::mutex                   mMutex;
+        std::condition_variable      mStopped;
+        bool                         mRunning = false;
+};
+
+#define COULEURS_LOG( level, category, message ) \
+    do { \
+        if ( AsyncLog::isEnabled( AsyncLog::level, AsyncLog::category ) ) { \
+            static AsyncLog::Site logSite; \
+            if ( logSite.admit() ) { \
+                AsyncLog::Message( AsyncLog::level, AsyncLog::category, logSite ).stream() << message; \
+            } \
+        } \
+    } while ( 0 )
+
+#define LOG_D( category, message ) COULEURS_LOG( LEVEL_DEBUG, category, message )
+#define LOG_I( category, message ) COULEURS_LOG( LEVEL_INFO, category, message )
+#define LOG_W( category, message ) COULEURS_LOG( LEVEL_WARNING, category, message )
+#define LOG_E( category, message ) COULEURS_LOG( LEVEL_ERROR, category, message )
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cinder/audio/Node.h"
+#include "cinder/gl/gl.h"
+#include "AudioFeatures.h"
+#include <memory>
+#include <vector>
+
+// Spectrum analysis of the live input, or of a looping WAV file standing in
+// for it. Runs inside the audio graph on the audio thread and publishes
+// AudioFeatures through a triple buffer: neither side ever waits.
+class AudioAnalyzer {
+    public:
+        AudioAnalyzer();
+        ~AudioAnalyzer();
+
+        void start( const ci::fs::path &file );
+        void stop();
+        bool isRunning() const { return mNode != nullptr; }
+
+        // Main thread, true when a new hop arrived since the last call
+        bool update();
+        const AudioFeatures& features() const;
+
+        float mLatencyMilliseconds = 0;  // hop analysed to picked up by update()
+        float blockMilliseconds() const;
+        float cpuPercent() const;        // of the audio thread's time budget
+
+    private:
+        class AnalysisNode;
+
+        std::shared_ptr<AnalysisNode> mNode;
+        ci::audio::NodeRef            mSource;
+        AudioFeatures                 mSilence;
+};
+
+// Spectrum history for shaders: AUDIO_SPECTRUM_SIZE x AUDIO_HISTORY, R32F,
+// row 0 is the newest hop. Render thread, one upload per new hop.
+class AudioTexture {
+    public:
+        AudioTexture();
+        ~AudioTexture();
+
+        void update( const AudioFeatures &features );
+        const ci::gl::Texture2dRef& texture() { return mTexture; }
+
+    private:
+        std::vector<float>   mHistory;
+        ci::gl::Texture2dRef mTexture;
+        uint64_t             mSequence = 0;
+};
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Constants.h"
+#include <cstdint>
+
+// One analysis hop, published by the audio thread. Levels are normalized
+// dB over AUDIO_DB_RANGE, spectrum bins are log-spaced.
+struct AudioFeatures {
+    float    bands[AUDIO_BANDS] = {};
+    float    spectrum[AUDIO_SPECTRUM_SIZE] = {};
+    float    rms = 0, flux = 0;
+    double   captureTime = 0; // steady clock seconds, when the window's last block arrived
+    uint64_t sequence = 0;
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "FboPool.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Dual-Kawase blur: a chain of half-size downsamples, then upsamples back
+// to full size. Every level costs a handful of bilinear taps on a quarter
+// of the pixels of the previous one, so the cost barely grows with the
+// reach (about 2^levels pixels). The radius scales the tap offsets within
+// a level for continuous control.
+class BlurPyramid {
+    public:
+        BlurPyramid( int levels, const std::string &radiusUniform );
+        ~BlurPyramid();
+
+        void setFboPool( FboPool *pool ) { mFboPool = pool; }
+        void resize( const ci::ivec2 &size );
+        void process( const ci::gl::TextureRef &source, const std::function<void ( ci::gl::GlslProgRef )> &setUniforms );
+        void release();
+        void clear();
+
+        const ci::gl::TextureRef texture();
+        int levels() const { return mLevelCount; }
+        size_t bytes() const;
+
+    private:
+        void pass( const ci::gl::GlslProgRef &shader, const ci::gl::TextureRef &texture, const ci::gl::FboRef &fbo, const std::function<void ( ci::gl::GlslProgRef )> &setUniforms );
+
+        ci::gl::GlslProgRef     mDownShader, mUpShader;
+        std::vector<ci::gl::FboRef> mLevels; // 1/2, 1/4, ... of the source
+        ci::gl::FboRef          mOutput;
+        FboPool                *mFboPool = nullptr;
+        int                     mLevelCount;
+        bool                    mHasRadius;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "FboPool.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Compute passes declared in a patch's shader.comp, one per COMPUTE_N
+// block like BUFFER_N in shader.frag. They run before the fragment passes
+// every frame on state that persists across frames, declared with:
+//   #pragma couleurs storage <name> <count> <stride>   SSBO, binding = declaration order
+//   #pragma couleurs image <name> [format] [w h]       image unit = declaration order,
+//                                                      u_<name> sampler in fragment passes
+//   #pragma couleurs dispatch <pass> <x> [y] [z]       invocations, numbers, width,
+//                                                      height or a storage name
+// Formats are rgba32f (default), rgba16f, r32f and r32ui, images default to
+// the render size. Needs a GL 4.3 context, compute is not available on macOS.
+class ComputePasses {
+    public:
+        ComputePasses();
+        ~ComputePasses();
+
+        void setFboPool( FboPool *pool ) { mFboPool = pool; }
+        void load( const ci::fs::path &compPath, bool loopMode );
+        void unload();
+        void resize( int width, int height );
+        void reset();
+
+        size_t passCount() const { return mPrograms.size(); }
+        const ci::gl::GlslProgRef& program( size_t i ) const { return mPrograms[i]; }
+        void dispatch( size_t i );
+        void finish();
+        size_t storageCount( const std::string &name ) const;
+        size_t bytes() const;
+
+        // Sampled as u_<name> by the other passes, nullptr for other names
+        ci::gl::Texture2dRef imageTexture( const std::string &name ) const;
+
+        static bool isSupported();
+
+    private:
+        struct Storage {
+            ci::gl::BufferObjRef buffer;
+            size_t               count = 0, stride = 0;
+        };
+
+        struct Image {
+            std::string          name;
+            GLenum               format = 0;
+            ci::ivec2            size;     // 0 = render size
+            ci::gl::Texture2dRef texture;
+        };
+
+        struct Dispatch {
+            std::string invocations[3] = { "width", "height", "1" };
+            GLint       localSize[3] = { 1, 1, 1 };
+        };
+
+        void parse( const std::string &source, size_t passCount );
+        void allocate( Image &image );
+        void release( Image &image );
+        GLuint invocations( const std::string &token );
+
+        std::vector<ci::gl::GlslProgRef>  mPrograms;
+        std::vector<Dispatch>             mDispatches;
+        std::vector<std::string>          mStorageNames;
+        std::map<std::string, Storage>    mStorage;
+        std::vector<Image>                mImages;
+        FboPool                           *mFboPool = nullptr;
+        int                               mWidth = 0, mHeight = 0;
+        int                               mFrame = 0;
+};
\ No newline at end of file
@@ -4,6 +4,13 @@
 
 // GIF
 #define GIF_LENGTH 600 // # of frames
+#define GIF_FPS 60 // exact time step of loop exports
+#define GIF_SAMPLES 1 // temporal supersampling, sub-frames per exported frame
+#define LOOP_EXPORT_FORMAT "gif" // png (a file per frame), gif or apng, the loop_format <format> argument overrides it
+#define GIF_PALETTE "global" // global (from the first frame) or local (per frame)
+#define LOOP_ENCODER_QUEUE 4 // frames waiting for the encoder, bounds memory
+#define LOOP_PALETTE_SAMPLES 262144 // pixels in the palette histogram
+#define LOOP_APNG_COMPRESSION 6 // zlib level
 
 // Dimensions
 #define SCENE_WIDTH 1280
@@ -12,15 +19,100 @@
 #define UI_HEIGHT 500
 #define WINDOW_PADDING 15
 
+// Render thread
+#define RENDER_THREAD 1
+#define RENDER_FRAME_RATE 60
+#define UI_FRAME_RATE 30
+
+// Audio analysis, the audio_file <path.wav> argument replaces the live input
+#define AUDIO_INPUT 1
+#define AUDIO_FFT_SIZE 2048
+#define AUDIO_HOP_SIZE 512
+#define AUDIO_BANDS 8
+#define AUDIO_SPECTRUM_SIZE 256
+#define AUDIO_HISTORY 64
+#define AUDIO_DB_RANGE 80.f
+
+// Blur pyramid, levels when #pragma couleurs blur does not set them
+#define BLUR_LEVELS 5
+
+// Inline buffers only sampled at the same texel into their reader, see PassFusion
+#define PASS_FUSION 1
+
+// Same-sized patch images sampled as layers of one texture array, see TexturePacking
+#define TEXTURE_PACKING 1
+
+// GPU memory for render targets and compute images, 0 = no limit
+#define GPU_MEMORY_BUDGET_MB 4096
+
+// Window resizes are applied once no new one came for this long
+#define RESIZE_SETTLE_SECONDS 0.25
+
+// Generated data (noise, patch catalog, thumbnails), relative to the home directory
+#define CACHE_FOLDER ".cache/couleurs"
+
+// Precomputed noise: volume texels per side, lattice cells per tile (the
+// NOISE_TEX_PERIOD of noiseTex.glsl), blue noise mask size
+#define NOISE_VOLUME_SIZE 64
+#define NOISE_VOLUME_PERIOD 8
+#define BLUE_NOISE_SIZE 64
+
+// Patch catalog: setlist read from assets/setlists/<name>.txt unless the
+// setlist <name> argument says otherwise, thumbnail size and time, and the
+// seconds between two thumbnails rendered in the background
+#define SETLIST_NAME "default"
+#define THUMBNAIL_WIDTH 160
+#define THUMBNAIL_HEIGHT 90
+#define THUMBNAIL_TIME 2.
+#define THUMBNAIL_INTERVAL .5
+
 // OSC
 #define OSC_PORT 7000
 
+// Live metrics, every METRICS_INTERVAL seconds: an OSC bundle to
+// METRICS_HOST:METRICS_PORT and a Prometheus text file in CACHE_FOLDER. Each
+// missed deadline goes to the frame-drop journal with the frames before it.
+#define METRICS 1
+#define METRICS_HOST "127.0.0.1"
+#define METRICS_PORT 7001
+#define METRICS_INTERVAL 1.
+#define METRICS_JOURNAL_FRAMES 120
+#define METRICS_JOURNAL_BYTES 8388608 // then moved to .1
+
+// Shared-memory parameter block for local controllers, see couleurs_params.h
+// and scripts/params_writer.c
+#define PARAMETER_BLOCK 1
+#define PARAMETER_BLOCK_NAME "/couleurs-params"
+
 // MIDI
 #define MIDI_CONTROLLER_PORT 1
 
 // Log
 #define CI_MIN_LOG_LEVEL 0
+// AsyncLog: messages per thread ring and the text they hold inline (longer
+// ones go to the heap), lines kept for the Log window, messages per call site
+// per interval, writer period, and the log file in CACHE_FOLDER
+#define LOG_RING_SIZE 256
+#define LOG_MESSAGE_SIZE 224
+#define LOG_HISTORY 2000
+#define LOG_SITE_BURST 5
+#define LOG_SITE_INTERVAL 1.
+#define LOG_FLUSH_INTERVAL .02
+#define LOG_FILE "couleurs.log"
 
 // Headless mode for high resolution exports
 #define HEADLESS_WIDTH 3000
-#define HEADLESS_HEIGHT 3000
\ No newline at end of file
+#define HEADLESS_HEIGHT 3000
+
+// Sweep renders: variants of a patch as the tiles of one atlas, see
+// ParameterSweep. Grid steps per parameter unless given, most tiles per atlas.
+#define SWEEP_TILE_WIDTH 256
+#define SWEEP_TILE_HEIGHT 256
+#define SWEEP_STEPS 4
+#define SWEEP_MAX_VARIANTS 4096
+
+// Render server
+// Socket in $XDG_RUNTIME_DIR, else /tmp/couleurs-render-<uid>.sock, see RenderSocket.h
+#define RENDER_SOCKET_NAME "couleurs-render"
+#define RENDER_CACHED_PATCHES 16
+#define RENDER_REQUEST_SIZE 65536 // bytes, a longer request line is refused
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Counter-based random numbers: a value depends only on (seed, stream,
+// counter), never on how many values were drawn before, so any frame can be
+// evaluated on its own.
+class CounterRandom {
+    public:
+        static uint64_t hash( uint64_t seed, uint64_t stream, uint64_t counter )
+        {
+            return mix( seed ^ mix( stream ^ mix( counter ) ) );
+        }
+
+        // [0, 1)
+        static float uniform( uint64_t seed, uint64_t stream, uint64_t counter )
+        {
+            return ( hash( seed, stream, counter ) >> 40 ) * ( 1.f / 16777216.f );
+        }
+
+        // Stable id for a name (FNV-1a), used as the stream of a parameter
+        static uint64_t hashString( const std::string &s )
+        {
+            uint64_t h = 14695981039346656037ull;
+            for ( unsigned char c : s ) {
+                h = ( h ^ c ) * 1099511628211ull;
+            }
+            return h;
+        }
+
+    private:
+        // SplitMix64 finalizer
+        static uint64_t mix( uint64_t x )
+        {
+            x += 0x9e3779b97f4a7c15ull;
+            x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+            x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+            return x ^ ( x >> 31 );
+        }
+};
\ No newline at end of file
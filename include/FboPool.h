@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// GPU memory of the render targets and compute images: released ones are
+// kept for reuse by (size, format), so switching patches or resolutions
+// does not reallocate them. Everything created here is counted against
+// a budget (0 = none), acquiring past it evicts unused entries first and
+// throws if that is not enough.
+class FboPool {
+    public:
+        FboPool();
+        ~FboPool();
+
+        // Single color attachment, no depth: passes never depth test
+        ci::gl::FboRef acquire( int width, int height, GLint internalFormat = GL_RGBA8 );
+        void release( const ci::gl::FboRef &fbo );
+        // Immutable storage, the caller sets filtering and wrapping
+        ci::gl::Texture2dRef acquireTexture( int width, int height, GLint internalFormat );
+        void release( const ci::gl::Texture2dRef &texture );
+        void clear();
+
+        void setBudget( size_t bytes ) { mBudget = bytes; }
+        size_t budget() const { return mBudget; }
+        size_t allocatedBytes();
+        size_t freeBytes() const;
+        size_t freeCount() const;
+
+        static size_t bytes( int width, int height, GLint internalFormat );
+        static size_t bytes( const ci::gl::FboRef &fbo );
+        static size_t bytes( const ci::gl::Texture2dRef &texture );
+
+    private:
+        typedef std::tuple<int, int, GLint> Key;
+
+        struct Allocation {
+            std::weak_ptr<void> resource;
+            size_t              bytes;
+        };
+
+        void reserve( size_t bytes );
+
+        std::map<Key, std::vector<ci::gl::FboRef>>       mFree;
+        std::map<Key, std::vector<ci::gl::Texture2dRef>> mFreeTextures;
+        std::vector<Allocation>                          mAllocations;
+        size_t                                           mBudget = 0;
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Predicts when the frame being prepared will actually be presented, from
+// measured present intervals and render durations. The main thread asks for
+// predictions and reports each frame once the scene window swapped it;
+// everything is atomics, so other threads can read the estimates.
+class FrameClock {
+    public:
+        FrameClock( double nominalInterval );
+        ~FrameClock();
+
+        double now() const;
+        double predictPresentTime() const;
+        void presented( double predictedTime, double renderSeconds );
+
+        // Offline renders: frame n is presented at exactly n * interval, and
+        // each present advances one frame whatever the wall time
+        void setFixedStep( double interval );
+        bool isFixedStep() const { return mFixedStep > 0; }
+        uint64_t fixedFrame() const { return mFixedFrame; }
+
+        double presentInterval() const { return mInterval; }
+        double predictionErrorMilliseconds() const { return mPredictionError * 1000.; }
+        double intervalJitterMilliseconds() const { return mIntervalJitter * 1000.; }
+        double maxPredictionErrorMilliseconds() const { return mMaxPredictionError * 1000.; }
+        void resetMaxPredictionError() { mMaxPredictionError = 0; }
+
+    private:
+        std::chrono::steady_clock::time_point mStart;
+        std::atomic<double> mLastPresent { -1 }, mInterval, mRenderSeconds { 0 };
+        std::atomic<double> mPredictionError { 0 }, mIntervalJitter { 0 }, mMaxPredictionError { 0 };
+        double              mFixedStep = 0;
+        std::atomic<uint64_t> mFixedFrame { 0 };
+};
\ No newline at end of file
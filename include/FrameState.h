@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "AudioFeatures.h"
+#include "Parameters.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Everything the render thread needs to draw one frame, captured on the
+// main thread once per update(). The render thread re-times it in place
+// for every frame it renders until the next snapshot arrives.
+struct FrameState {
+    float       time = 0, tick = 0, frameNumber = 0;
+    double      presentTime = 0; // predicted, on the FrameClock
+    double      presentLead = 0; // presentTime - FrameClock::now() at capture
+    double      beatTime = 0;    // on the beat timer, at presentTime
+    int         bpm = 100;
+    bool        timeStopped = false;
+    int         section = 0;
+    ci::vec2    mouse, resolution;
+    std::vector<std::pair<std::string, float>>    params;
+    std::vector<ParameterMotion>                  motions; // parallel to params
+    std::vector<std::pair<std::string, ci::vec3>> colors;
+    ci::gl::TextureRef syphonTexture, cameraTexture;
+    AudioFeatures      audio;
+
+    void captureParams( Parameters &parameters )
+    {
+        // Names are reassigned in place, so steady state does not allocate
+        auto &scalars = parameters.get();
+        params.resize( scalars.size() );
+        motions.resize( scalars.size() );
+        for ( size_t i = 0; i < scalars.size(); i++ ) {
+            params[i].first = scalars[i]->name;
+            params[i].second = scalars[i]->currentValue;
+            motions[i].capture( *scalars[i] );
+        }
+
+        auto &colorParams = parameters.getColors();
+        colors.resize( colorParams.size() );
+        for ( size_t i = 0; i < colorParams.size(); i++ ) {
+            auto &value = colorParams[i]->value;
+            colors[i].first = colorParams[i]->name;
+            colors[i].second = ci::vec3( value.r, value.g, value.b );
+        }
+    }
+
+    // Modulators and animations at t, as Parameter::tick() would
+    void tickParams( const double t )
+    {
+        for ( size_t i = 0; i < params.size(); i++ ) {
+            params[i].second = motions[i].tick( t, params[i].second );
+        }
+    }
+
+    // constNames: folded into shader as constants, see MultipassShader::constUniforms()
+    void bind( const ci::gl::GlslProgRef &shader, const std::map<std::string, float> *constNames = nullptr ) const
+    {
+        // Common Uniforms
+        shader->uniform( "u_resolution", resolution );
+        shader->uniform( "u_frameNumber", frameNumber );
+        shader->uniform( "u_time", time );
+        shader->uniform( "u_tick", tick );
+        shader->uniform( "u_section", section );
+        shader->uniform( "u_mouse", mouse );
+
+        // Audio analysis, the spectrum history is the u_audioTex sampler
+        shader->uniform( "u_audioBands", audio.bands, AUDIO_BANDS );
+        shader->uniform( "u_audioRms", audio.rms );
+        shader->uniform( "u_audioFlux", audio.flux );
+
+        // Scalar & Color Parameters
+        for ( auto it = params.begin(); it != params.end(); it++ ) {
+            if ( constNames && constNames->count( it->first ) ) continue;
+            shader->uniform( it->first, it->second );
+        }
+        for ( auto it = colors.begin(); it != colors.end(); it++ ) {
+            shader->uniform( it->first, it->second );
+        }
+    }
+};
\ No newline at end of file
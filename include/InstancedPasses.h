@@ -0,0 +1,53 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "ComputePasses.h"
+#include <string>
+#include <vector>
+
+// Instanced geometry declared in a patch's instances.vert/instances.frag,
+// one pass per INSTANCES_N block. A pass draws its instances over the
+// result of a fragment pass, so the cost follows the covered area instead
+// of pixels x shapes:
+//   #pragma couleurs instances <pass> <count> [target] [primitive] [blend]
+// count is a number or a compute storage name, target bufferN or main
+// (default), primitive quads (default) or points, blend add (default),
+// alpha or replace. The vertex shader gets a_corner (quad corner in -1..1)
+// and a_random (a stable vec4 per instance), gl_InstanceID indexes into
+// textures or compute storage. Positions are written in clip space.
+class InstancedPasses {
+    public:
+        InstancedPasses();
+        ~InstancedPasses();
+
+        void load( const ci::fs::path &vertPath, const ci::fs::path &fragPath, bool loopMode, const ComputePasses &compute );
+        void unload();
+
+        size_t passCount() const { return mPasses.size(); }
+        const ci::gl::GlslProgRef& program( size_t i ) const { return mPasses[i].program; }
+        int target( size_t i ) const { return mPasses[i].target; }
+        void draw( size_t i );
+
+    private:
+        enum Blend {
+            ADD,
+            ALPHA,
+            REPLACE
+        };
+
+        struct Pass {
+            ci::gl::GlslProgRef program;
+            ci::gl::VaoRef      vao;
+            ci::gl::VboRef      randoms;
+            GLsizei             count = 0;
+            int                 target = -1; // buffer index, -1 = final pass
+            bool                points = false;
+            Blend               blend = ADD;
+        };
+
+        void parse( const std::string &source, std::vector<Pass> &passes, const ComputePasses &compute );
+        void createGeometry( Pass &pass, size_t index );
+
+        std::vector<Pass> mPasses;
+        ci::gl::VboRef    mCorners;
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Surface.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Animated GIF or APNG written while the loop renders. Frames wait in a
+// short queue for the encoding thread, which splits each one in bands over
+// all cores: histogram, palette lookup and ordered dithering for GIFs, row
+// filters and deflate for APNGs. Only the rectangle that changed since the
+// previous frame is written, with its unchanged pixels transparent in GIFs.
+class LoopEncoder {
+    public:
+        enum Format {
+            GIF,
+            APNG
+        };
+
+        enum Palette {
+            GLOBAL, // one palette from the first frame, smallest files
+            LOCAL   // one per frame, for loops whose colors move
+        };
+
+        LoopEncoder( const ci::fs::path &path, Format format, int width, int height, float fps, Palette palette = GLOBAL );
+        ~LoopEncoder();
+
+        // Copies the frame, blocks while LOOP_ENCODER_QUEUE frames are waiting
+        void add( const ci::Surface8u &frame );
+        // Encodes the waiting frames and closes the file
+        void finish();
+
+        struct Stats {
+            int      framesAdded = 0, framesWritten = 0;
+            uint64_t bytesWritten = 0;
+            uint64_t pixels = 0, dirtyPixels = 0; // of the written frames
+            double   encodeSeconds = 0;           // busy time of the encoding thread
+        };
+        Stats stats();
+        int queuedFrames();
+
+        // gif or apng, throws on anything else
+        static Format stringToFormat( const std::string &formatStr );
+        static Palette stringToPalette( const std::string &paletteStr );
+        static std::string extension( Format format );
+
+    private:
+        struct Rect {
+            int x0, y0, x1, y1; // x1, y1 exclusive
+            bool empty() const { return x1 <= x0 || y1 <= y0; }
+        };
+
+        void run();
+        void encodeGif( const std::vector<uint8_t> &rgb, int frame );
+        void encodeApng( const std::vector<uint8_t> &rgb );
+        void buildPalette( const std::vector<uint8_t> &rgb );
+        void writeGifHeader();
+        void writeApngHeader();
+        void writeChunk( const char *type, const std::vector<uint8_t> &data );
+        void write( const std::vector<uint8_t> &bytes );
+
+        ci::fs::path         mPath;
+        std::ofstream        mFile;
+        Format               mFormat;
+        Palette              mPaletteMode;
+        int                  mWidth, mHeight;
+        float                mFps;
+
+        std::vector<uint8_t> mColors;   // rgb, at most 255 colors, index 255 is transparent
+        std::vector<uint8_t> mLookup;   // palette index of each 5-5-5 color
+        float                mDitherSpread = 0;
+        std::vector<uint8_t> mCanvas;   // rgb as currently displayed
+        bool                 mHasCanvas = false;
+        uint32_t             mSequence = 0;       // APNG chunk sequence
+        std::streampos       mFrameCountPosition; // patched into acTL by finish()
+
+        std::thread                       mThread;
+        std::mutex                        mMutex;
+        std::condition_variable           mQueueChanged;
+        std::deque<std::vector<uint8_t>>  mQueue;
+        bool                              mFinishing = false, mFinished = false;
+        Stats                             mStats;
+};
\ No newline at end of file
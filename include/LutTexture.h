@@ -0,0 +1,31 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include <string>
+#include <vector>
+
+// 3D lookup tables for color grading, sampled with lut3d() from
+// couleurs_lib/lut3d.glsl in a single trilinear fetch. 512x512 images of
+// 8x8 tiles (lookup*.png, lut*.png) are converted from the 2D layout that
+// lut.glsl unpacks, .cube files are read as is. Converted tables are
+// cached by path until the file changes.
+class LutTexture {
+    public:
+        static bool isLutName( const std::string &name );
+        static bool isLutSize( int width, int height );
+
+        static ci::gl::Texture3dRef fromImage( const ci::fs::path &path );
+        static ci::gl::Texture3dRef fromTiles( const uint8_t *rgba, bool bottomUp );
+        static ci::gl::Texture3dRef fromCube( const ci::fs::path &path );
+        static void clearCache();
+
+        // GPU milliseconds of one full screen grading pass through lut() and
+        // through lut3d(), on an identity table. Blocks until the GPU is done.
+        struct Timing {
+            double lut2d = 0, lut3d = 0;
+        };
+        static Timing measure( const ci::ivec2 &size );
+
+    private:
+        static ci::gl::Texture3dRef create( const std::vector<float> &rgb, int size );
+};
\ No newline at end of file
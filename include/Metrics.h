@@ -0,0 +1,112 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Live metrics, for watching the render box from another machine. The render
+// thread only writes a FrameSample into a lock-free ring and bumps atomics.
+// Every METRICS_INTERVAL seconds a publisher thread aggregates the samples,
+// hands a Snapshot to the sender (OSC in the app) and rewrites a Prometheus
+// text file. A frame that missed its deadline is journaled along with the
+// frames before it.
+class Metrics {
+    public:
+        enum Counter {
+            MIDI_EVENTS,
+            OSC_EVENTS,
+            SHADER_LOADS,
+            COUNTER_COUNT
+        };
+
+        enum Gauge {
+            SHADER_LOAD_SECONDS,    // last load or reload, compiles included
+            FREEZE_COMPILE_SECONDS, // last specialized programs, see MultipassShader::freeze()
+            EXPORT_QUEUE_FRAMES,    // loop export frames waiting for the encoder
+            GAUGE_COUNT
+        };
+
+        struct FrameSample {
+            uint64_t frame;
+            double   time;    // seconds since the Metrics were created
+            float    renderMilliseconds;
+            uint32_t dropped; // whole frame intervals missed
+            bool     late;    // missed its deadline
+        };
+
+        // One publishing interval, times in milliseconds
+        struct Snapshot {
+            double   time = 0, seconds = 0;
+            uint32_t frames = 0, late = 0, dropped = 0;
+            float    renderMean = 0, renderMax = 0, renderP99 = 0;
+            float    intervalMean = 0, intervalMax = 0;
+            uint64_t framesTotal = 0, lateTotal = 0, droppedTotal = 0, samplesLost = 0;
+            uint64_t counters[ COUNTER_COUNT ] = {};
+            float    rates[ COUNTER_COUNT ] = {}; // per second
+            double   gauges[ GAUGE_COUNT ] = {};
+            std::vector<std::pair<std::string, float>> passes; // GPU time
+        };
+
+        Metrics();
+        ~Metrics();
+
+        // Files may be empty to skip them, send runs on the publisher thread
+        void start( const ci::fs::path &prometheusPath, const ci::fs::path &journalPath, const std::function<void ( const Snapshot & )> &send = nullptr );
+        void stop();
+
+        // Render thread, once per frame
+        void recordFrame( float renderMilliseconds, bool late, uint32_t dropped );
+
+        // Any thread
+        void count( Counter counter, uint32_t n = 1 ) { mCounters[ counter ].fetch_add( n, std::memory_order_relaxed ); }
+        void set( Gauge gauge, double value ) { mGauges[ gauge ].store( value, std::memory_order_relaxed ); }
+        void setPassTimes( const std::vector<std::pair<std::string, float>> &passes );
+
+        // What the publisher thread does every interval
+        Snapshot publish();
+
+        static std::string prometheusText( const Snapshot &snapshot );
+        static const char* counterName( Counter counter );
+        static const char* gaugeName( Gauge gauge );
+
+    private:
+        enum { RING_SIZE = 4096 };
+
+        void run();
+        double now() const;
+        void journal( const FrameSample &sample );
+
+        // Single producer, single consumer
+        std::array<FrameSample, RING_SIZE> mRing;
+        std::atomic<uint64_t>              mWritten { 0 }, mRead { 0 }, mLost { 0 };
+        uint64_t                           mFrame = 0;
+        std::chrono::steady_clock::time_point mStart;
+
+        std::atomic<uint64_t>              mCounters[ COUNTER_COUNT ];
+        std::atomic<double>                mGauges[ GAUGE_COUNT ];
+        std::mutex                         mPassMutex;
+        std::vector<std::pair<std::string, float>> mPasses;
+
+        // Publisher
+        ci::fs::path                       mPrometheusPath, mJournalPath;
+        std::function<void ( const Snapshot & )> mSend;
+        std::deque<FrameSample>            mHistory; // the last METRICS_JOURNAL_FRAMES
+        uint64_t                           mJournaledFrame = 0; // first frame not yet journaled
+        Snapshot                           mTotals;
+        double                             mLastPublish = 0, mLastSampleTime = -1;
+
+        std::thread                        mThread;
+        std::mutex                         mMutex;
+        std::condition_variable            mStopped;
+        bool                               mRunning = false;
+};
\ No newline at end of file
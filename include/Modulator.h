@@ -1,7 +1,8 @@
 #pragma once
 
 #include "cinder/Perlin.h"
-#include "cinder/Rand.h"
+#include <cstdint>
+#include <string>
 
 enum ModulatorType {
     RANDOM,
@@ -15,7 +16,8 @@ class Modulator {
         Modulator( ModulatorType type = SINE, float frequency = 1.f, float amount = 0.f );
         ~Modulator();
 
-        float tick( const double t );
+        // Pure function of the parameter's seed and time
+        float tick( const double t, const uint64_t seed );
 
         static ModulatorType stringToType( const std::string typeStr );
         static std::string typeToString( const ModulatorType type );
@@ -24,12 +26,10 @@ class Modulator {
         ModulatorType mType;
 
     private:
-        float tickRandom( const double t );
+        float tickRandom( const double t, const uint64_t seed );
         float tickSine( const double t );
         float tickTriangle( const double t );
-        float tickNoise( const double t );        
+        float tickNoise( const double t, const uint64_t seed );
 
-        float mRandomValue;      
         ci::Perlin    mPerlin;
-        ci::Rand      mRand;
 };
\ No newline at end of file
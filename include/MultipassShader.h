@@ -2,6 +2,18 @@
 
 #include "cinder/app/App.h"
 #include "cinder/gl/gl.h"
+#include "cinder/gl/Query.h"
+#include "cinder/Surface.h"
+#include "BlurPyramid.h"
+#include "ComputePasses.h"
+#include "FboPool.h"
+#include "InstancedPasses.h"
+#include "PassFusion.h"
+#include "PatchBundle.h"
+#include "ShaderCompiler.h"
+#include "TexturePacking.h"
+#include "TextureUnits.h"
+#include <map>
 
 using namespace ci;
 
@@ -12,27 +24,168 @@ class MultipassShader {
         void init( int width, int height, const std::function<void ( gl::GlslProgRef )> &setUniforms, bool loopMode );
         void resize( int width, int height );
         void load( const fs::path &fragPath );
+        void load( const PatchBundleRef &bundle );
         void reload();
+        void setFboPool( FboPool *pool ) { mFboPool = pool; mCompute.setFboPool( pool ); }
+        // Bound as u_<name> in every pass of every patch that declares it
+        void setGlobalTexture( const std::string &name, const gl::TextureBaseRef &texture ) { mGlobalTextures[ name ] = texture; }
+        void releaseFbos();
+        void clearFbos();
+        bool hasFeedback();
+        // GPU memory held by the current patch
+        struct MemoryUse {
+            size_t buffers = 0, blurs = 0, compute = 0, textures = 0;
+            int    aliased = 0; // buffers sharing an FBO with another one
+            size_t total() const { return buffers + blurs + compute + textures; }
+        };
+        MemoryUse memoryUse() const;
+
+        // Parameters baked into the pass programs as constants. The frozen
+        // programs compile in the background and replace the generic ones
+        // when ready, unfreezing goes straight back to the generic ones.
+        void setShaderCompiler( ShaderCompiler *compiler ) { mCompiler = compiler; }
+        void freeze( const std::map<std::string, float> &values );
+        void unfreeze( const std::string &name );
+        void unfreezeAll();
+        bool isFrozen() const { return mFrozenMainShader != nullptr; }
+        bool isFreezing() const { return mFreezeJob != 0; }
+        const std::map<std::string, float>& frozenValues() const { return mFrozenValues; }
+        // Constants in shader when it is a frozen program, for setUniforms to
+        // skip: what it was compiled with, not what is being frozen now
+        const std::map<std::string, float>* constUniforms( const gl::GlslProgRef &shader ) const;
+        double                   mFreezeSeconds = 0; // last background compile
+
+        // Point-wise passes inlined into their reader, see PassFusion.
+        // Disabling it goes back to the programs compiled from the files.
+        void setFusion( bool enabled );
+        struct Fusion {
+            std::string passes;            // "buffer3 > buffer4, ..."
+            int         count = 0;
+            size_t      bytesPerFrame = 0; // FBO writes and reads avoided
+            std::string error;             // the fused programs failed, or why buffers were left unfused
+        };
+        Fusion fusion() const;
+
+        // Patch images sharing texture arrays, and the units every pass samples from
+        struct Textures {
+            std::string packed;      // "inputA, inputB > couleurs_layers0; ..."
+            int         arrays = 0;
+            int         units = 0, unitLimit = 0;
+            int         rebindsPerFrame = 0;
+        };
+        Textures textures() const;
+
+        // GPU time of each pass program, buffers then the final pass
+        struct PassTime {
+            std::string name;
+            double      generic = 0, frozen = 0; // ms, smoothed
+        };
+        std::vector<PassTime> passTimes() const;
+
+        void render( const Rectf &r, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture );
         void draw( const Rectf &r, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture );
 
+        static int getBufferCount( const std::string &source );
+
         bool                     mShaderCompilationFailed = false;
         std::string              mShaderCompileErrorMessage;
         gl::FboRef               mMainFbo;
 
     private:
-        int getBufferCount();
+        // #pragma couleurs blur <name> <bufferN> [levels] [radius uniform], sampled as u_<name>
+        struct Blur {
+            std::string                  name;
+            int                          source;
+            std::shared_ptr<BlurPyramid> pyramid;
+        };
+
         void updateBuffers();
+        void allocateBuffers();
+        void releaseBuffers();
+        bool buffersAllocated() const;
+        gl::FboRef createFbo();
+        void clearBuffers();
         void loadTextures();
+        void loadBundleTextures();
+        void uploadTextures();
+        gl::Texture2dRef createTexture( const BundleTexture &t ) const;
+        gl::Texture3dRef createArray( const std::vector<std::string> &names ) const;
+        void resolveSource();
+        gl::GlslProg::Format programFormat( const std::string &source );
+        void fusePasses();
+        void applyFusion();
+        bool isFused( int buffer ) const { return buffer < (int)mFused.size() && mFused[buffer]; }
+        void loadCompute();
+        void runCompute( const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture );
+        void loadInstances();
+        void loadBlurs();
+        void releaseBlurs();
+        void processBlurs( int index );
+        void drawInstances( int index, const gl::FboRef &fbo, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture );
+        void assignTextureUnits();
+        gl::TextureBaseRef samplerTexture( const std::string &uniform, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture ) const;
+        void bindTextures( const gl::GlslProgRef &shader, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture, int pass, const gl::FboRef &target );
         void drawShaderInFBO( const Rectf &r, const gl::GlslProgRef &shader, const gl::FboRef &fbo, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture, int index );
+        void drawPass( const Rectf &r, int index, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture );
+        void resetPassTimes();
+        void submitFrozen();
+        void pollFrozen();
+        void releaseFrozen();
+        std::string frozenSource( const std::string &source ) const;
         void shaderError( const char *msg );
 
         std::function<void ( gl::GlslProgRef )> mSetUniforms;        
         std::map<std::string, gl::Texture2dRef> mTextures;
-        std::vector<gl::FboRef> mFbos;         
+        std::map<std::string, gl::Texture3dRef> mLuts;
+        std::map<std::string, gl::Texture3dRef> mArrays; // packed images, by TexturePacking::arrayName()
+        std::string mPacked;
+
+        // Decoded or mapped, uploaded by uploadTextures() once the source says which can share an array
+        struct Image {
+            std::string         name;
+            int                 width, height, levels;
+            Surface8u           surface;           // patch folders
+            const BundleTexture *bundled = nullptr; // levels in the bundle
+        };
+        std::vector<Image> mImages;
+
+        // Passes: compute, buffers, the final pass, then instanced passes
+        TextureUnits mTextureUnits;
+        GLint mPassUnitLimit = 16, mUnitLimit = 48, mLayerLimit = 256;
+        std::map<std::string, gl::TextureBaseRef> mGlobalTextures;
+        std::vector<gl::FboRef> mFbos;         // one per buffer, aliased buffers share one
+        std::vector<gl::FboRef> mSlots;        // the distinct FBOs of mFbos
         std::vector<gl::GlslProgRef> mShaders;
         gl::GlslProgRef mMainShader, mFinalShader;        
         std::string mMainFragSource;
         fs::path mPatchPath, mFragPath;
+        PatchBundleRef mBundle;
+        ComputePasses mCompute;
+        InstancedPasses mInstances;
+        std::vector<Blur> mBlurs;
+
+        struct PassTiming {
+            PassTime                    time;
+            gl::QueryTimeSwappedRef     query;
+            bool                        queriedFrozen = false; // program of the frame being read back
+        };
+        std::vector<PassTiming> mPassTimings;
+
+        bool mFusionEnabled;
+        Fusion mFusion;
+        std::vector<bool> mFused;
+        std::vector<gl::GlslProgRef> mUnfusedShaders;
+        gl::GlslProgRef mUnfusedMainShader;
+        std::string mResolvedSource;
+        std::vector<std::string> mPassSources; // buffers then the final pass, fused
+
+        std::map<std::string, float> mFrozenValues, mFreezeJobValues, mFrozenProgramValues;
+        std::vector<gl::GlslProgRef> mFrozenShaders;
+        gl::GlslProgRef mFrozenMainShader;
+        ShaderCompiler *mCompiler = nullptr;
+        ShaderCompiler mInlineCompiler; // never started, compiles in submit()
+        uint64_t mFreezeJob = 0;
+        FboPool *mFboPool = nullptr;
         int mWidth, mHeight;
         bool mLoopMode;
 };
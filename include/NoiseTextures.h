@@ -0,0 +1,40 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MultipassShader;
+
+// Noise as texture fetches instead of ALU: a tileable RGBA volume holding
+// Perlin (r, b, a with different seeds) and value noise (g), and a
+// void-and-cluster blue noise mask. Both are bound in every pass as
+// u_noiseVolume and u_noiseBlueMask, sampled by couleurs_lib/noiseTex.glsl.
+// Generated on all cores the first time, then read from the disk cache,
+// keyed by size, period and seed.
+class NoiseTextures {
+    public:
+        // Needs a current GL context
+        void load( uint64_t seed = 0 );
+        void bind( MultipassShader &shader ) const;
+
+        const ci::gl::Texture3dRef& volume() const { return mVolume; }
+        const ci::gl::Texture2dRef& blueNoise() const { return mBlueNoise; }
+
+        // size^3 RGBA texels, tiling every period lattice cells
+        static std::vector<float> generateVolume( int size, int period, uint64_t seed );
+        // size^2 ranks in (0, 1), size a power of two
+        static std::vector<float> generateBlueNoise( int size, uint64_t seed );
+
+        double mLoadSeconds = 0;
+        bool   mFromCache = false;
+
+    private:
+        static ci::fs::path cachePath( const std::string &key );
+        static bool readCache( const std::string &key, size_t count, std::vector<float> &data );
+        static void writeCache( const std::string &key, const std::vector<float> &data );
+
+        ci::gl::Texture3dRef mVolume;
+        ci::gl::Texture2dRef mBlueNoise;
+};
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "AudioAnalyzer.h"
+#include "FboPool.h"
+#include "FrameState.h"
+#include "MultipassShader.h"
+#include "NoiseTextures.h"
+#include "Patch.h"
+#include "RenderJob.h"
+#include "TemporalAccumulator.h"
+#include <atomic>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Renders RenderJobs into an offscreen FBO as fast as the GL implementation
+// allows: no window, UI, MIDI, Syphon or camera. Needs a current GL context.
+// Compiled programs and decoded textures stay cached per patch between jobs,
+// render targets go back to a shared pool.
+class OfflineRenderer {
+    public:
+        OfflineRenderer();
+        ~OfflineRenderer();
+
+        // False if cancelled before the last frame, or the last variant of a sweep
+        bool render( const RenderJob &job, const std::atomic<bool> *cancelled = nullptr );
+
+        // "frame hash" manifests, see RenderJob::hashesPath
+        static std::map<int, uint64_t> readHashes( const ci::fs::path &path );
+        static void writeHashes( const ci::fs::path &path, const std::map<int, uint64_t> &hashes );
+
+        // Timings of the last job, variants for a sweep
+        double mLoadSeconds = 0, mRenderSeconds = 0, mWriteSeconds = 0;
+        int    mFramesRendered = 0;
+        bool   mWarm = false;
+
+    private:
+        struct CachedPatch {
+            std::unique_ptr<Patch>           patch;
+            std::unique_ptr<MultipassShader> shader;
+            decltype( ci::fs::last_write_time( "" ) ) shaderTime {};
+            uint64_t                         lastUsed = 0;
+        };
+
+        bool renderSweep( const RenderJob &job, const std::atomic<bool> *cancelled );
+        void checkCompiled( const RenderJob &job );
+        void loadPatch( const RenderJob &job );
+        void applyOverrides( const RenderJob &job );
+        void evictPatches();
+        void renderFrame( const RenderJob &job, int frame );
+        void renderPasses( const RenderJob &job, int frame, double offset );
+        void writeFrame( const ci::fs::path &path, uint64_t *hash );
+        void waitForWrites( size_t maxPending );
+
+        // Before mPatches, their shaders release into it when destroyed
+        FboPool                         mFboPool;
+        std::map<std::string, CachedPatch> mPatches;
+        CachedPatch                     *mCurrent = nullptr;
+        uint64_t                        mJobCount = 0;
+        FrameState                      mFrameState;
+        TemporalAccumulator             mAccumulator;
+        AudioTexture                    mAudioTexture; // silent, so audio patches still render
+        NoiseTextures                   mNoiseTextures;
+        std::deque<std::future<void>>   mWrites;
+        std::vector<uint64_t>           mFrameHashes;
+        bool                            mInitialized = false;
+};
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Query.h"
+#include <string>
+
+enum OutputType {
+    OFFSCREEN,
+    SYPHON,
+    WINDOW
+};
+
+enum OutputFit {
+    STRETCH,   // ignore aspect
+    LETTERBOX, // fit inside, bars on the sides
+    FILL       // fill the output, crop the source
+};
+
+enum OutputFilter {
+    NEAREST,
+    LINEAR,
+    MIPMAP     // trilinear, for large downscales
+};
+
+class Output {
+    public:
+        Output( const std::string &name, OutputType type, int width, int height );
+        ~Output();
+
+        void present( const ci::gl::FboRef &master );
+        const ci::gl::TextureRef& texture() { return mTexture; }
+
+        static OutputType stringToType( const std::string typeStr );
+        static OutputFit stringToFit( const std::string fitStr );
+        static OutputFilter stringToFilter( const std::string filterStr );
+
+        std::string     mName;
+        OutputType      mType;
+        OutputFit       mFit = FILL;
+        OutputFilter    mFilter = LINEAR;
+        ci::Rectf       mCrop = ci::Rectf( 0.f, 0.f, 1.f, 1.f ); // normalized, top-left origin
+        int             mWidth, mHeight;
+        double          mGpuMilliseconds = 0, mCpuMilliseconds = 0;
+
+    private:
+        void computeRects( const ci::ivec2 &masterSize, ci::Rectf &src, ci::Rectf &dst );
+
+        ci::gl::FboRef               mFbo;
+        ci::gl::TextureRef           mTexture;
+        ci::gl::QueryTimeSwappedRef  mQuery;
+};
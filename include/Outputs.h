@@ -0,0 +1,28 @@
+#pragma once
+
+#include "cinder/Json.h"
+#include "Output.h"
+#include <memory>
+
+// Extra outputs read from assets/outputs.json:
+// { "master": { "width", "height" },
+//   "outputs": [ { "name", "type": offscreen|syphon|window, "width", "height",
+//                  "fit": stretch|letterbox|fill, "filter": nearest|linear|mipmap,
+//                  "crop": { "x", "y", "width", "height" } } ] }
+class Outputs {
+    public:
+        Outputs();
+        ~Outputs();
+
+        void load( const ci::fs::path &path );
+        void present( const ci::gl::FboRef &master );
+
+        std::vector<std::shared_ptr<Output>>& get() { return mOutputs; }
+        bool hasMasterSize() { return mMasterSize.x > 0 && mMasterSize.y > 0; }
+        const ci::ivec2& masterSize() { return mMasterSize; }
+        double gpuMilliseconds();
+
+    private:
+        std::vector<std::shared_ptr<Output>> mOutputs;
+        ci::ivec2                            mMasterSize;
+};
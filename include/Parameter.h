@@ -2,7 +2,9 @@
 
 #include "Modulator.h"
 #include "Animation.h"
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 class Parameter {
     public:
@@ -15,10 +17,27 @@ class Parameter {
 
         float min, max, baseValue, currentValue;
         std::string name;
+        uint64_t seed = 0; // patch seed ^ hash of the name, see Parameters::setSeed()
         int midiNumber = -1;
         int oscChannel = -1;
+        bool frozen = false; // baked into the pass programs at frozenValue, see MultipassShader::freeze()
+        float frozenValue = 0;
         std::unique_ptr<Modulator> modulator = nullptr;
         std::vector<std::shared_ptr<Animation>> animations;
 
     private:                
+};
+
+// What Parameter::tick() reads, copied into each FrameState so the render
+// thread can keep moving the value between snapshots
+struct ParameterMotion {
+    float baseValue = 0;
+    uint64_t seed = 0;
+    bool modulated = false;
+    Modulator modulator;
+    std::vector<Animation> animations;
+
+    void capture( const Parameter &parameter );
+    // What Parameter::tick( t ) would set, value when nothing moves it
+    float tick( const double t, float value );
 };
\ No newline at end of file
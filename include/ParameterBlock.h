@@ -0,0 +1,54 @@
+#pragma once
+
+#include "cinder/Vector.h"
+#include "Parameters.h"
+#include "couleurs_params.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The current patch's parameters in a named POSIX shared-memory block, see
+// couleurs_params.h, so external controllers write values without going
+// through MIDI or OSC. Only values a controller wrote since the patch loaded
+// are read back, and each is applied once per write: in between it follows
+// the UI, MIDI and modulators like everything else.
+class ParameterBlock {
+    public:
+        // What controllers wrote, by uniform name
+        struct Values {
+            uint32_t generation = 0, sequence = 0;
+            std::vector<std::pair<std::string, float>>    params;
+            std::vector<std::pair<std::string, ci::vec3>> colors;
+            // Per entry above, written since the previous read
+            std::vector<uint8_t> paramsChanged, colorsChanged;
+            uint8_t writes[ COULEURS_PARAMS_MAX_ENTRIES ] = {}; // by slot, as last read
+        };
+
+        ParameterBlock() {}
+        ~ParameterBlock();
+
+        // Creates the block or takes over a stale one, throws on failure
+        void open( const std::string &name );
+        void close();
+        bool isOpen() const { return mBlock != nullptr; }
+        const std::string& name() const { return mName; }
+
+        // Main thread, when a patch loads: names, ranges and current values,
+        // nothing touched. Parameters past COULEURS_PARAMS_MAX_ENTRIES are left out.
+        void describe( Parameters &parameters );
+
+        // Once per frame, any thread. False when nothing changed since values
+        // was read, or when a writer held the lock too long (values kept).
+        // A writer that died holding it is taken over for the next read.
+        bool read( Values &values ) const;
+        // Main thread, the changed values onto currentValue and the colors
+        static void apply( const Values &values, Parameters &parameters );
+
+        uint32_t entryCount() const;
+        uint32_t touchedCount() const;
+
+    private:
+        couleurs_params_block *mBlock = nullptr;
+        std::string           mName;
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+#include "Parameters.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Variants of a patch's scalar parameters for sweep renders, one atlas tile
+// each: a grid over the swept ranges, or random samples within them. The
+// table of every tile's values, swept or not, is written next to the atlas,
+// and any tile can be rendered again on its own from it.
+class ParameterSweep {
+    public:
+        typedef std::vector<std::pair<std::string, float>> Values;
+
+        // What renders a tile again: its patch, time, seed and values
+        struct Variant {
+            std::string  patch;
+            ci::fs::path paramsPath; // the params.json the sweep replaced the patch's with, if any
+            double       time = 0;
+            uint64_t     seed = 0;
+            bool         rendered = true; // false when the sweep was cancelled first
+            Values       params;
+            std::vector<std::pair<std::string, ci::vec3>> colors;
+        };
+
+        // specs: "name", "name=min:max" or "name=min:max:steps", the range
+        // defaulting to the params.json one and steps to SWEEP_STEPS. With
+        // variants > 0, that many random samples instead of the grid. No spec
+        // sweeps every scalar parameter. Throws on unknown names, bad specs
+        // or more than SWEEP_MAX_VARIANTS tiles.
+        ParameterSweep( Parameters &params, const std::vector<std::string> &specs, int variants, uint64_t seed, const ci::ivec2 &tileSize );
+
+        int variantCount() const { return mVariants.size(); }
+        const Values& values( int variant ) const { return mVariants[variant]; }
+        // baseValue and currentValue, modulators and animations move from there
+        void apply( int variant, Parameters &params ) const;
+
+        // Row by row, as square as the tile size allows. Origins are top-left.
+        int columns() const { return mColumns; }
+        int rows() const { return mRows; }
+        ci::ivec2 atlasSize() const { return mTileSize * ci::ivec2( mColumns, mRows ); }
+        ci::ivec2 tileOrigin( int variant ) const { return mTileSize * ci::ivec2( variant % mColumns, variant / mColumns ); }
+
+        // Every scalar and color of params per tile, the swept ones at the
+        // tile's values. Tiles from rendered on were not drawn.
+        void write( const ci::fs::path &path, const std::string &patch, const ci::fs::path &paramsPath, double time, uint64_t seed,
+                    Parameters &params, int rendered ) const;
+        static Variant readVariant( const ci::fs::path &path, int index );
+
+    private:
+        struct Axis {
+            std::string name;
+            float       min, max;
+            int         steps;
+        };
+
+        std::vector<Values> mVariants;
+        ci::ivec2           mTileSize;
+        int                 mColumns = 1, mRows = 1;
+};
\ No newline at end of file
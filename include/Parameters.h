@@ -4,6 +4,7 @@
 #include "cinder/Color.h"
 #include "Animation.h"
 #include "Parameter.h"
+#include "PatchBundle.h"
 #include <memory>
 
 typedef struct {
@@ -14,11 +15,15 @@ typedef struct {
 class Parameters {
 public:
   Parameters( const ci::fs::path &path );
+  Parameters( const ci::fs::path &path, const PatchBundleRef &bundle );
   ~Parameters();
   void save();
   void reload();
   void writeTo( const ci::fs::path &path );
+  // What writeTo() writes, with the current values
+  ci::JsonTree toJson();
   void load( const ci::fs::path &path );
+  void setSeed( uint64_t seed );
   
   std::vector<std::shared_ptr<Parameter>>& get() { return mParameters; }
   std::vector<std::shared_ptr<ColorParameter>>& getColors() { return mColorParameters; }
@@ -31,7 +36,11 @@ private:
   std::vector<std::shared_ptr<ColorParameter>> mColorParameters;
   ci::JsonTree             mJson;
   ci::fs::path             mPath;
+  PatchBundleRef           mBundle;
+  uint64_t                 mSeed = 0;
   
   void init();
+  void initFromBundle();
+  void ensureJsonTree();
   void updateJsonTree( ci::JsonTree &oldTree );
 };
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <climits>
+#include <map>
+#include <string>
+#include <vector>
+
+// Point-wise pass fusion. A buffer whose only reader is one later pass,
+// sampling it at the same texel with texture( u_bufferN, vTexCoord0 ), is
+// turned into a function called from that pass. Its draw and its FBO
+// round trip go away. Works on the BUFFER_N chain inside main(), blocks
+// that return, discard, read buffers from the previous frame or read
+// main()'s own locals are left alone.
+class PassFusion {
+    public:
+        enum { NOT_FUSED = INT_MIN };
+
+        // pinned: buffers that must keep their FBO (blur sources, instanced targets, ...)
+        PassFusion( const std::string &source, int bufferCount, const std::vector<bool> &pinned, const std::vector<std::string> &blurNames );
+
+        // Pass buffer is inlined into, -1 for the final pass
+        int into( int buffer ) const { return mInto[buffer]; }
+        bool isFused( int buffer ) const { return mInto[buffer] != NOT_FUSED; }
+        // Runs inlined stages, its program must be rebuilt from source()
+        bool isConsumer( int pass ) const;
+        int fusedCount() const;
+        std::string describe() const;
+        // Why candidates were left unfused, empty when none were
+        const std::string& refused() const { return mRefused; }
+        const std::string& source() const { return mSource; }
+
+        struct Block {
+            size_t begin, end; // body, between the #if / #elif / #else lines
+        };
+        // Blocks of the BUFFER_N chain by buffer index, -1 for the #else block.
+        // Indices appearing more than once are left out.
+        static std::map<int, Block> findBlocks( const std::string &source );
+
+    private:
+        std::string      mSource, mRefused;
+        std::vector<int> mInto;
+};
\ No newline at end of file
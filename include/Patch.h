@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Parameters.h"
+#include "PatchBundle.h"
+#include <memory>
 #include <string>
 
 class Patch {
@@ -8,13 +10,18 @@ class Patch {
         Patch( std::string name );
         ~Patch();
 
+        // params.json is only parsed on first use
         Parameters& params();
-        const std::string& name() { return mName; };
+        const std::string& name() const { return mName; };
         const ci::fs::path& path() { return mFolderPath; };
         const ci::fs::path& shaderPath() { return mShaderPath; };
+        const PatchBundleRef& bundle() { return mBundle; };
 
     private:
-        std::string   mName;
-        ci::fs::path  mFolderPath, mShaderPath;
-        Parameters    mParams;
+        static PatchBundleRef openBundle( const std::string &name );
+
+        std::string    mName;
+        ci::fs::path   mFolderPath, mShaderPath;
+        PatchBundleRef mBundle;
+        std::shared_ptr<Parameters> mParams;
 };
\ No newline at end of file
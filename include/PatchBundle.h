@@ -0,0 +1,111 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compiled patch bundle (.couleurs): one file holding the per-pass shader
+// sources with includes resolved, a binary parameter table and decoded,
+// mipmapped RGBA8 textures. Every table and payload is 64-byte aligned so
+// the file can be mmapped and handed to GL as-is.
+
+#define PATCH_BUNDLE_MAGIC "CLRSPAK"
+#define PATCH_BUNDLE_VERSION 1
+#define PATCH_BUNDLE_EXTENSION ".couleurs"
+#define PATCH_BUNDLE_ALIGNMENT 64
+
+struct BundleHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t passCount;
+    uint32_t paramCount;
+    uint32_t animationCount;
+    uint32_t colorCount;
+    uint32_t textureCount;
+    uint64_t passTableOffset;
+    uint64_t paramTableOffset;
+    uint64_t animationTableOffset;
+    uint64_t colorTableOffset;
+    uint64_t textureTableOffset;
+    uint64_t stringsOffset;
+    uint64_t fileSize;
+};
+
+struct BundleString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct BundlePass {
+    int32_t      bufferIndex; // -1 for the final pass
+    BundleString source;      // #version and LOOP are prepended at load time
+    uint32_t     binaryFormat; // reserved for program binaries, 0 = none
+    uint64_t     binaryOffset;
+    uint64_t     binarySize;
+};
+
+struct BundleParam {
+    BundleString name;
+    float        value, min, max;
+    int32_t      midiNumber, oscChannel;
+    int32_t      modulatorType; // -1 = no modulator
+    float        modulatorFrequency, modulatorAmount;
+    uint32_t     firstAnimation, animationCount;
+};
+
+struct BundleAnimation {
+    float        target, duration;
+    int32_t      midiMapping;
+    BundleString curve;
+};
+
+struct BundleColor {
+    BundleString name;
+    float        r, g, b;
+};
+
+struct BundleTexture {
+    BundleString name;
+    uint32_t     width, height, levels;
+    uint32_t     reserved;
+    uint64_t     dataOffset; // level 0 first, rows bottom-up, each level aligned
+    uint64_t     dataSize;
+};
+
+class PatchBundle {
+    public:
+        PatchBundle( const ci::fs::path &path );
+        ~PatchBundle();
+
+        static ci::fs::path pathForPatch( const std::string &name );
+        static void write( const std::string &name, const ci::fs::path &outPath );
+
+        const BundleHeader& header() const { return *mHeader; }
+        const BundlePass& pass( size_t i ) const;
+        const BundleParam& param( size_t i ) const;
+        const BundleAnimation& animation( size_t i ) const;
+        const BundleColor& color( size_t i ) const;
+        const BundleTexture& texture( size_t i ) const;
+
+        std::string stringAt( const BundleString &s ) const;
+        const char* source( const BundlePass &pass ) const;
+        const uint8_t* textureLevel( const BundleTexture &texture, uint32_t level ) const;
+
+        static uint64_t levelOffset( uint32_t width, uint32_t height, uint32_t level );
+        static uint64_t alignedSize( uint64_t size );
+
+    private:
+        template<typename T> const T& entry( uint64_t tableOffset, uint32_t count, size_t i ) const;
+        // Throws unless [offset, offset + size) is inside the file
+        void checkRange( uint64_t offset, uint64_t size ) const;
+
+        const BundleHeader *mHeader = nullptr;
+        const uint8_t      *mData = nullptr;
+        size_t              mSize = 0;
+        int                 mFd = -1;
+        ci::fs::path        mPath;
+};
+
+typedef std::shared_ptr<PatchBundle> PatchBundleRef;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What is known about a patch folder without compiling it
+struct PatchInfo {
+    std::string              name;
+    uint64_t                 hash = 0;          // every file the patch reads, includes too
+    uint64_t                 stamp = 0;         // their names, sizes and modification times
+    int                      bufferCount = 0;
+    std::vector<std::string> uniforms;          // declared by shader.frag and its includes
+    std::vector<std::string> textures;          // images and .cube files
+    std::vector<std::string> includes;          // asset-relative
+    bool                     compute = false, instanced = false;
+    uint64_t                 thumbnailHash = 0; // hash the thumbnail was rendered from
+};
+
+// Every folder of assets/patches, scanned by one task per patch and cached
+// in the catalog.json of the cache folder. A patch whose files kept their
+// size and modification time is not read again, one whose hash matches its
+// cached entry is not parsed again, and its thumbnail is only rendered
+// again when the hash changes.
+class PatchCatalog {
+    public:
+        void scan();
+        void save() const;
+
+        const std::vector<PatchInfo>& patches() const { return mPatches; }
+        const PatchInfo* find( const std::string &name ) const;
+        std::vector<std::string> staleThumbnails() const;
+        void setThumbnailRendered( const std::string &name );
+
+        static ci::fs::path thumbnailPath( const std::string &name );
+
+        double mScanSeconds = 0;
+        int    mParsedCount = 0; // not found in the cache
+
+    private:
+        static ci::fs::path cachePath();
+        static PatchInfo scanPatch( const ci::fs::path &assets, const ci::fs::path &folder, const std::vector<PatchInfo> &cached, bool *parsed );
+
+        std::vector<PatchInfo> mPatches;
+};
\ No newline at end of file
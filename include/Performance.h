@@ -4,11 +4,22 @@
 #include <vector>
 #include <string>
 
+// The patches of a set, in order. Setlists are text files in
+// assets/setlists, one patch name per line, # starts a comment.
 class Performance {
     public:
-        Performance( std::initializer_list<std::string> initList );
+        Performance();
+        Performance( const std::vector<std::string> &names );
         ~Performance();
 
+        void load( const std::vector<std::string> &names );
+        void add( const std::string &name );
+        std::vector<std::string> names() const;
+
+        // PATCH_NAME alone if the setlist does not exist
+        static std::vector<std::string> readSetlist( const std::string &setlist );
+        void writeSetlist( const std::string &setlist ) const;
+
         Patch& currentPatch();
         int numPatches() { return mPatches.size(); }
         int currentPatchIndex() { return mCurrentPatchIndex; }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "Constants.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One offline render: which patch, at what size, which stretch of time and
+// where the frames go. Built from the command line by the headless renderer.
+struct RenderJob {
+    std::string  patch = PATCH_NAME;
+    ci::fs::path paramsPath;            // optional, replaces the patch's params.json
+    std::vector<std::pair<std::string, std::string>> overrides; // name=value or name=r,g,b
+    ci::fs::path output;                // .png file for a single frame, a folder otherwise
+    int          width = HEADLESS_WIDTH, height = HEADLESS_HEIGHT;
+    double       startTime = 0, endTime = 0; // seconds, end exclusive, equal = one frame
+    float        fps = 60;
+    int          bpm = 100;
+    bool         loop = false;              // LOOP define, time wraps over the range
+    int          samples = 1;               // temporal supersampling, sub-frames per frame
+    uint64_t     seed = 0;              // random modulators, see Parameters::setSeed()
+
+    // Sharded renders: this process renders [firstFrame(), lastFrame()) of
+    // shardCount contiguous slices. shards > 1 makes it spawn the workers.
+    int          shardIndex = 0, shardCount = 1, shards = 1;
+    ci::fs::path hashesPath;            // optional manifest of "frame hash" lines
+    ci::fs::path verifyPath;            // manifest the sharded render must match
+
+    // Sweep renders: one still per variant of the parameters, as the tiles of
+    // one atlas written to output, see ParameterSweep. Not sharded.
+    std::vector<std::string> sweep;     // name, name=min:max or name=min:max:steps
+    int          variants = 0;          // random samples instead of the grid
+    int          tileWidth = SWEEP_TILE_WIDTH, tileHeight = SWEEP_TILE_HEIGHT;
+    bool isSweep() const { return !sweep.empty() || variants > 0; }
+
+    int frameCount() const;
+    int firstFrame() const;
+    int lastFrame() const;
+    double frameTime( int frame, double offset = 0 ) const; // offset in frames
+    ci::fs::path framePath( int frame ) const;
+
+    static RenderJob fromArgs( const std::vector<std::string> &args );
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "cinder/Timer.h"
+#include "OfflineRenderer.h"
+#include "RenderJob.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Long-running render daemon. Requests arrive as one JSON line per connection
+// on a Unix domain socket; jobs run one at a time on the GL thread through a
+// single OfflineRenderer, so programs, textures and FBOs stay warm.
+//   {"cmd":"submit","priority":0,"wait":true,"args":["--patch","mountains",...]}
+//   {"cmd":"cancel","id":3}  {"cmd":"status"}  {"cmd":"shutdown"}
+// A submit answers {"id":N}, then a timing report once the job is over if it waits.
+class RenderServer {
+    public:
+        RenderServer( const std::string &socketPath );
+        ~RenderServer();
+
+        // Blocks until a shutdown request
+        void run( OfflineRenderer &renderer );
+
+    private:
+        struct Job {
+            uint64_t          id;
+            int               priority;
+            RenderJob         job;
+            std::atomic<bool> cancelled { false };
+            std::string       status = "queued", error;
+            ci::Timer         queueTimer;
+            double            queueSeconds = 0, loadSeconds = 0, renderSeconds = 0, writeSeconds = 0;
+            int               frames = 0;
+            bool              warm = false;
+        };
+        typedef std::shared_ptr<Job> JobRef;
+
+        void acceptConnections();
+        void handleConnection( int fd );
+        std::string submit( const std::vector<std::string> &args, int priority, JobRef &job );
+        std::string cancel( uint64_t id );
+        std::string status();
+        JobRef nextJob();
+        static std::string report( const Job &job );
+        static bool isFinished( const Job &job );
+
+        std::string              mSocketPath;
+        int                      mSocket = -1;
+        std::thread              mAcceptThread;
+        std::vector<int>         mConnections; // open client sockets, one detached thread each
+
+        std::mutex               mMutex;
+        std::condition_variable  mCondition;
+        std::vector<JobRef>      mQueue;
+        JobRef                   mRunning;
+        uint64_t                 mNextId = 1;
+        bool                     mShutdown = false;
+};
\ No newline at end of file
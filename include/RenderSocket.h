@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Constants.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+// Where the render server listens by default, private to the user: their
+// runtime directory, else a per-user name in /tmp. Header-only, the client
+// does not link the server.
+inline std::string defaultRenderSocketPath()
+{
+    const char *runtime = getenv( "XDG_RUNTIME_DIR" );
+    if ( runtime && *runtime ) {
+        return std::string( runtime ) + "/" RENDER_SOCKET_NAME ".sock";
+    }
+    return "/tmp/" RENDER_SOCKET_NAME "-" + std::to_string( getuid() ) + ".sock";
+}
+
+// A JSON string literal, for the requests and replies on the socket
+inline std::string quoteJson( const std::string &s )
+{
+    std::string quoted = "\"";
+    for ( unsigned char c : s ) {
+        if ( c == '"' || c == '\\' ) {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ( c == '\n' ) {
+            quoted += "\\n";
+        }
+        else if ( c < 0x20 ) {
+            char escaped[8];
+            snprintf( escaped, sizeof( escaped ), "\\u%04x", c );
+            quoted += escaped;
+        }
+        else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Context.h"
+#include "cinder/gl/Sync.h"
+#include "FrameState.h"
+#include "Metrics.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Renders the scene on its own thread and GL context (shared with the scene
+// window). The main thread publishes one FrameState per update() and picks
+// up finished frames for the preview; neither side waits on the other.
+// The callback gets the newest state and may re-time it in place, it is
+// handed the same state again until the next one is published.
+// When not started, commands run inline and the main thread renders itself.
+class RenderThread {
+    public:
+        RenderThread();
+        ~RenderThread();
+
+        void start( const std::function<ci::gl::FboRef ( FrameState & )> &renderFrame, float frameRate );
+        // Before start(), every rendered frame is recorded
+        void setMetrics( Metrics *metrics ) { mMetrics = metrics; }
+        void stop();
+        bool isRunning() { return mRunning; }
+
+        // Runs on the render thread before the next frame
+        void post( const std::function<void ()> &command );
+
+        // Main thread
+        TripleBuffer<FrameState>& frameStates() { return mFrameStates; }
+        ci::gl::TextureRef acquireFrame();
+        void releaseFrame();
+        // Of the acquired frame, false when it was already acquired before:
+        // the present time its state predicted and how long it took to render
+        bool newFrameTiming( double &presentTime, double &renderSeconds );
+
+        std::atomic<float>    mFrameMilliseconds { 0 };
+        std::atomic<uint32_t> mFramesRendered { 0 }, mLateFrames { 0 };
+
+    private:
+        struct Frame {
+            ci::gl::FboRef  fbo;
+            ci::gl::SyncRef renderedFence, consumedFence;
+            double          presentTime = 0, renderSeconds = 0;
+        };
+
+        void run( ci::gl::ContextRef context );
+        void runCommands();
+        void presentFrame( const ci::gl::FboRef &source, double presentTime, double renderSeconds );
+
+        std::function<ci::gl::FboRef ( FrameState & )> mRenderFrame;
+        std::thread                         mThread;
+        std::atomic<bool>                   mRunning { false };
+        float                               mFrameRate = 60;
+        Metrics                             *mMetrics = nullptr;
+
+        std::mutex                          mCommandMutex;
+        std::vector<std::function<void ()>> mCommands;
+
+        TripleBuffer<FrameState>            mFrameStates;
+        TripleBuffer<Frame>                 mFrames;
+        bool                                mAcquiredNew = false; // main thread
+};
\ No newline at end of file
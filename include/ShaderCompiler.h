@@ -0,0 +1,47 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Context.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compiles programs on its own thread and GL context, shared with the one
+// current at start(), so a slow driver compile never stalls a frame.
+// When not started, submit() compiles inline.
+class ShaderCompiler {
+    public:
+        struct Job {
+            uint64_t                              id = 0;
+            std::vector<ci::gl::GlslProg::Format> formats;
+            std::vector<ci::gl::GlslProgRef>      programs; // one per format, empty on error
+            std::string                           error;
+            double                                seconds = 0;
+        };
+
+        ShaderCompiler();
+        ~ShaderCompiler();
+
+        void start();
+        void stop();
+        bool isRunning() { return mRunning; }
+
+        uint64_t submit( const std::vector<ci::gl::GlslProg::Format> &formats );
+        // Next finished job, on the thread drawing with its programs
+        bool poll( Job &job );
+
+    private:
+        void run( ci::gl::ContextRef context );
+        static void compile( Job &job );
+
+        std::thread             mThread;
+        std::atomic<bool>       mRunning { false };
+        std::atomic<uint64_t>   mNextId { 1 };
+        std::mutex              mMutex;
+        std::condition_variable mCondition;
+        std::deque<Job>         mPending, mDone;
+};
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+
+// Temporal supersampling for offline renders: averages sub-frame renders in a
+// float target, then writes the result back into an 8-bit frame.
+class TemporalAccumulator {
+    public:
+        TemporalAccumulator();
+        ~TemporalAccumulator();
+
+        void begin( int width, int height );
+        void add( const ci::gl::TextureRef &texture, float weight );
+        void resolve( const ci::gl::FboRef &target );
+
+    private:
+        ci::gl::FboRef mFbo;
+};
\ No newline at end of file
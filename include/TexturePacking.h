@@ -0,0 +1,37 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Patch images of the same size packed as the layers of one sampler2DArray,
+// so a patch with many images takes a few texture units instead of one per
+// image. Only images the source reads directly with texture(), textureLod(),
+// texelFetch() or textureSize() are packed, and those calls are rewritten
+// to read their layer. Images passed to functions or renamed by macros keep
+// their own sampler2D.
+class TexturePacking {
+    public:
+        struct Image {
+            std::string name; // sampled as u_<name>
+            int         width, height, levels;
+        };
+
+        // excluded: also sampled by programs that are not rewritten (compute, instanced passes)
+        TexturePacking( const std::string &source, const std::vector<Image> &images, const std::set<std::string> &excluded, int maxLayers );
+
+        int arrayCount() const { return mArrays.size(); }
+        // Images of array i in layer order, sampled as u_<arrayName( i )>
+        const std::vector<std::string>& layers( int array ) const { return mArrays[array]; }
+        bool isPacked( const std::string &name ) const;
+        std::string describe() const;
+        const std::string& source() const { return mSource; }
+
+        static std::string arrayName( int array ) { return "couleurs_layers" + std::to_string( array ); }
+        // Declared once as a sampler2D and only read by the calls above
+        static bool isPackable( const std::string &source, const std::string &name );
+
+    private:
+        std::string                           mSource;
+        std::vector<std::vector<std::string>> mArrays;
+};
\ No newline at end of file
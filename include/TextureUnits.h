@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Texture units for every pass of a patch, checked against the GL limits
+// when the patch loads instead of sampling nothing in the middle of a show.
+// A texture keeps its unit from one pass to the next whenever the limit
+// allows, so after the first frame most bindings never change. Unit 0 is
+// left to what draws outside the passes (blurs, the final copy).
+class TextureUnits {
+    public:
+        struct Pass {
+            std::string              name;
+            std::vector<std::string> samplers; // uniform names
+        };
+        typedef std::vector<std::pair<std::string, int>> Bindings;
+
+        TextureUnits() {}
+        // Passes in drawing order. Throws when one samples more than perPass
+        // textures, or more than units - 1.
+        TextureUnits( const std::vector<Pass> &passes, int perPass, int units );
+
+        // Unit of each sampler of pass i
+        const Bindings& bindings( int pass ) const { return mBindings[pass]; }
+        int passCount() const { return mBindings.size(); }
+        int unitsUsed() const { return mUnitsUsed; } // highest unit + 1
+        int rebindsPerFrame() const { return mRebinds; }
+
+    private:
+        std::vector<Bindings> mBindings;
+        int                   mUnitsUsed = 0, mRebinds = 0;
+};
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Context.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Renders patch thumbnails one at a time on its own thread and GL context,
+// shared with the one current at start(), so compiling a patch never stalls
+// the render thread. THUMBNAIL_INTERVAL apart, the live scene keeps the GPU.
+class ThumbnailRenderer {
+    public:
+        ThumbnailRenderer();
+        ~ThumbnailRenderer();
+
+        // done runs on the worker thread after each patch, rendered or not
+        void start( const std::function<void ( const std::string & )> &done );
+        void stop();
+        bool isRunning() { return mRunning; }
+
+        void render( const std::string &patch );
+
+    private:
+        void run( ci::gl::ContextRef context );
+
+        std::function<void ( const std::string & )> mDone;
+        std::thread             mThread;
+        std::atomic<bool>       mRunning { false };
+        std::mutex              mMutex;
+        std::condition_variable mCondition;
+        std::deque<std::string> mPending;
+};
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// Single producer / single consumer triple buffer. The producer fills
+// writeBuffer() and publishes it, the consumer picks up the newest published
+// buffer with update(). Neither side ever blocks or waits on the other.
+template<typename T>
+class TripleBuffer {
+    public:
+        TripleBuffer() {}
+
+        // Producer
+        T& writeBuffer() { return mBuffers[ mWriteIndex ]; }
+        void publish()
+        {
+            int previous = mMiddle.exchange( mWriteIndex | DIRTY_BIT, std::memory_order_acq_rel );
+            mWriteIndex = previous & INDEX_MASK;
+        }
+
+        // Consumer, returns false if nothing new was published
+        bool update()
+        {
+            if ( !( mMiddle.load( std::memory_order_acquire ) & DIRTY_BIT ) ) {
+                return false;
+            }
+            int previous = mMiddle.exchange( mReadIndex, std::memory_order_acq_rel );
+            mReadIndex = previous & INDEX_MASK;
+            return true;
+        }
+        T& readBuffer() { return mBuffers[ mReadIndex ]; }
+
+    private:
+        static const int DIRTY_BIT = 4;
+        static const int INDEX_MASK = 3;
+
+        T                mBuffers[ 3 ];
+        std::atomic<int> mMiddle { 1 };
+        int              mWriteIndex = 0;
+        int              mReadIndex = 2;
+};
\ No newline at end of file
@@ -1,9 +1,25 @@
 #pragma once
 
+#include "cinder/Filesystem.h"
+#include <set>
 #include <string>
+#include <vector>
 
 namespace cinder {
   namespace gl {
     void printError(const std::string &method);      
   }
-}
\ No newline at end of file
+}
+
+// Number of distinct <prefix>N blocks (#ifdef / #if defined) in a source
+int getDefineBlockCount( const std::string &source, const std::string &prefix );
+
+// `#pragma couleurs <name> <args>` lines of a source, trailing // comments dropped
+struct PatchDirective {
+  std::string              name, line;
+  std::vector<std::string> args;
+};
+std::vector<PatchDirective> getPatchDirectives( const std::string &source );
+
+// Shader source with its #include "..." lines inlined, relative to the including file, each file once
+std::string resolveShaderIncludes( const ci::fs::path &path, std::set<ci::fs::path> &included );
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+ * Layout of the shared-memory parameter block (PARAMETER_BLOCK_NAME), for
+ * controllers written in C or anything that can call it. The app describes
+ * the patch's scalar and color parameters in the header when it loads, and
+ * trusted local processes write full-precision values into the slots at any
+ * rate, without a syscall. The render thread reads a consistent copy once
+ * per frame.
+ *
+ * Writers and the app take turns through a seqlock: the sequence is odd
+ * while someone is inside, and owner holds their pid. Readers retry when the
+ * sequence moved. Writers back off and give up after about 25 ms, so a
+ * writer that dies inside the lock only fails the others' writes until the
+ * app sees its pid is gone, on its next frame, and takes the lock over.
+ *
+ *   int fd = shm_open( "/couleurs-params", O_RDWR, 0 );
+ *   couleurs_params_block *block = mmap( NULL, sizeof( couleurs_params_block ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+ *   uint32_t generation = couleurs_params_generation( block );
+ *   int index = couleurs_params_find( block, "u_speed" );
+ *   float speed = 2.5f;
+ *   couleurs_params_set( block, generation, index, &speed );
+ *
+ * Builds with GCC and Clang, as C or C++.
+ */
+#ifndef COULEURS_PARAMS_H
+#define COULEURS_PARAMS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define COULEURS_PARAMS_MAGIC 0x50524c43u /* "CLRP" */
+#define COULEURS_PARAMS_VERSION 2
+#define COULEURS_PARAMS_MAX_ENTRIES 256
+#define COULEURS_PARAMS_NAME_SIZE 64
+#define COULEURS_PARAMS_WRITE_TRIES 256 /* spins, then sleeps doubling to about 100 us */
+
+enum {
+    COULEURS_PARAMS_SCALAR = 0, /* one value */
+    COULEURS_PARAMS_COLOR = 1   /* r, g, b */
+};
+
+typedef struct {
+    char     name[ COULEURS_PARAMS_NAME_SIZE ]; /* uniform name, NUL terminated */
+    uint32_t type;
+    float    min, max;                          /* 0 and 1 for colors */
+} couleurs_params_entry;
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t sequence;   /* odd while a writer or the app is inside */
+    uint32_t generation; /* bumped when the app describes another patch */
+    uint32_t count;      /* entries in use */
+    uint32_t owner;      /* pid inside the lock, 0 when none or not yet known */
+    couleurs_params_entry entries[ COULEURS_PARAMS_MAX_ENTRIES ];
+    float    values[ COULEURS_PARAMS_MAX_ENTRIES ][ 3 ];
+    uint8_t  touched[ COULEURS_PARAMS_MAX_ENTRIES ]; /* writes by controllers since the patch loaded, wrapping past 0 */
+} couleurs_params_block;
+
+/* 1 once inside the lock, 0 when it stayed held for about 25 ms */
+static inline int couleurs_params_write_begin( couleurs_params_block *block )
+{
+    uint32_t sequence;
+    struct timespec pause = { 0, 1000 };
+    int attempt;
+    for ( attempt = 0; attempt < COULEURS_PARAMS_WRITE_TRIES; attempt++ ) {
+        sequence = __atomic_load_n( &block->sequence, __ATOMIC_RELAXED );
+        if ( !( sequence & 1 ) ) {
+            if ( __atomic_compare_exchange_n( &block->sequence, &sequence, sequence + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+                __atomic_store_n( &block->owner, (uint32_t)getpid(), __ATOMIC_RELAXED );
+                /* The odd sequence is visible before anything written after it */
+                __atomic_thread_fence( __ATOMIC_RELEASE );
+                return 1;
+            }
+            continue;
+        }
+        if ( attempt >= 64 ) {
+            nanosleep( &pause, NULL );
+            if ( pause.tv_nsec < 100000 ) pause.tv_nsec *= 2;
+        }
+    }
+    return 0;
+}
+
+static inline void couleurs_params_write_end( couleurs_params_block *block )
+{
+    __atomic_store_n( &block->owner, 0, __ATOMIC_RELAXED );
+    __atomic_fetch_add( &block->sequence, 1, __ATOMIC_RELEASE );
+}
+
+static inline uint32_t couleurs_params_generation( const couleurs_params_block *block )
+{
+    return __atomic_load_n( &block->generation, __ATOMIC_ACQUIRE );
+}
+
+/* Index of the named entry, -1 when the patch has none */
+static inline int couleurs_params_find( const couleurs_params_block *block, const char *name )
+{
+    uint32_t i;
+    for ( i = 0; i < block->count && i < COULEURS_PARAMS_MAX_ENTRIES; i++ ) {
+        if ( strncmp( block->entries[i].name, name, COULEURS_PARAMS_NAME_SIZE ) == 0 ) return (int)i;
+    }
+    return -1;
+}
+
+/* One value for a scalar, three for a color. Returns 0 when the app moved
+ * to another patch since generation was read: find the index again. -1 when
+ * the lock stayed held: nothing written, try again later. */
+static inline int couleurs_params_set( couleurs_params_block *block, uint32_t generation, int index, const float *value )
+{
+    int written = 0;
+    if ( !couleurs_params_write_begin( block ) ) return -1;
+    if ( block->generation == generation && index >= 0 && (uint32_t)index < block->count ) {
+        memcpy( block->values[index], value, sizeof( float ) * ( block->entries[index].type == COULEURS_PARAMS_COLOR ? 3 : 1 ) );
+        /* Counted, so the app applies a value written again with the same value */
+        if ( ++block->touched[index] == 0 ) block->touched[index] = 1;
+        written = 1;
+    }
+    couleurs_params_write_end( block );
+    return written;
+}
+
+#endif
\ No newline at end of file
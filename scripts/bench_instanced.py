@@ -0,0 +1,43 @@
+# Fragment loop vs instanced quads: renders bench_circles_fragment and
+# bench_circles_instanced with the headless renderer at growing circle
+# counts and prints the ms/frame of each, time spent waiting on PNG
+# writes excluded. The fragment loop stops at FRAGMENT_MAX circles.
+#
+# python bench_instanced.py <CouleursRender> [WxH]
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+APP_FOLDER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+PATCHES = ['bench_circles_fragment', 'bench_circles_instanced']
+COUNTS = [16, 256, 1024, 4096, 16384, 65536]
+FRAGMENT_MAX = 4096
+FRAMES_RE = re.compile(r'(\d+) frames in ([\d.e-]+) s .* ([\d.e-]+) s waiting on writes')
+
+def render(renderer, patch, count, size, out):
+    if patch == 'bench_circles_fragment' and count > FRAGMENT_MAX:
+        return None
+    args = [renderer, '--patch', patch, '--size', size, '--from', '0', '--to', '1', '--fps', '30',
+            '--set', 'u_count=%d' % count, '--out', out]
+    output = subprocess.run(args, cwd=APP_FOLDER, capture_output=True, text=True).stdout
+    match = FRAMES_RE.search(output)
+    if not match:
+        return None
+    frames, seconds, waiting = int(match.group(1)), float(match.group(2)), float(match.group(3))
+    return (seconds - waiting) * 1000. / frames
+
+if len(sys.argv) < 2:
+    print('You need to specify the CouleursRender binary')
+    sys.exit(1)
+
+renderer = os.path.abspath(sys.argv[1])
+size = sys.argv[2] if len(sys.argv) > 2 else '1920x1080'
+
+print('%8s %12s %12s' % ('circles', 'fragment', 'instanced'))
+with tempfile.TemporaryDirectory() as out:
+    for count in COUNTS:
+        times = [render(renderer, patch, count, size, out) for patch in PATCHES]
+        print('%8d %12s %12s' % tuple([count] + ['%.2f ms' % t if t else '-' for t in times]))
@@ -0,0 +1,41 @@
+# ALU noise vs precomputed noise textures: renders bench_noise_alu and
+# bench_noise_tex with the headless renderer at growing fbm octave counts
+# and prints the ms/frame of each, time spent waiting on PNG writes
+# excluded.
+#
+# python bench_noise.py <CouleursRender> [WxH]
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+APP_FOLDER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+PATCHES = ['bench_noise_alu', 'bench_noise_tex']
+OCTAVES = [1, 2, 4, 8]
+FRAMES_RE = re.compile(r'(\d+) frames in ([\d.e-]+) s .* ([\d.e-]+) s waiting on writes')
+
+def render(renderer, patch, octaves, size, out):
+    args = [renderer, '--patch', patch, '--size', size, '--from', '0', '--to', '1', '--fps', '30',
+            '--set', 'u_octaves=%d' % octaves, '--out', out]
+    output = subprocess.run(args, cwd=APP_FOLDER, capture_output=True, text=True).stdout
+    match = FRAMES_RE.search(output)
+    if not match:
+        return None
+    frames, seconds, waiting = int(match.group(1)), float(match.group(2)), float(match.group(3))
+    return (seconds - waiting) * 1000. / frames
+
+if len(sys.argv) < 2:
+    print('You need to specify the CouleursRender binary')
+    sys.exit(1)
+
+renderer = os.path.abspath(sys.argv[1])
+size = sys.argv[2] if len(sys.argv) > 2 else '1920x1080'
+
+print('%8s %12s %12s %10s' % ('octaves', 'alu', 'texture', 'saved'))
+with tempfile.TemporaryDirectory() as out:
+    for octaves in OCTAVES:
+        alu, tex = [render(renderer, patch, octaves, size, out) for patch in PATCHES]
+        saved = '%.2f ms' % (alu - tex) if alu and tex else '-'
+        print('%8d %12s %12s %10s' % (octaves, '%.2f ms' % alu if alu else '-', '%.2f ms' % tex if tex else '-', saved))
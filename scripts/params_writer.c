@@ -0,0 +1,111 @@
+/*
+ * Test writer for the shared-memory parameter block, see
+ * include/couleurs_params.h. Lists the current patch's parameters, sets one,
+ * or sweeps one between its min and max as fast as it can and prints the
+ * writes per second.
+ *
+ *   couleurs_params_writer list
+ *   couleurs_params_writer set u_speed 2.5
+ *   couleurs_params_writer set u_tint 1 .5 0
+ *   couleurs_params_writer sweep u_speed 10
+ *
+ * COULEURS_PARAMS_BLOCK overrides the block name.
+ */
+#include "couleurs_params.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now( void )
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int usage( void )
+{
+    fprintf( stderr, "usage: couleurs_params_writer list | set <name> <value> [g b] | sweep <name> [seconds]\n" );
+    return 2;
+}
+
+int main( int argc, char **argv )
+{
+    const char *name = getenv( "COULEURS_PARAMS_BLOCK" ) ? getenv( "COULEURS_PARAMS_BLOCK" ) : "/couleurs-params";
+    couleurs_params_block *block;
+    uint32_t generation, i;
+    int fd, index, written;
+
+    if ( argc < 2 ) return usage();
+    fd = shm_open( name, O_RDWR, 0 );
+    if ( fd < 0 ) {
+        perror( name );
+        return 1;
+    }
+    block = mmap( NULL, sizeof( couleurs_params_block ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( block == MAP_FAILED || block->magic != COULEURS_PARAMS_MAGIC || block->version != COULEURS_PARAMS_VERSION ) {
+        fprintf( stderr, "%s: not a version %d parameter block\n", name, COULEURS_PARAMS_VERSION );
+        return 1;
+    }
+    generation = couleurs_params_generation( block );
+
+    if ( strcmp( argv[1], "list" ) == 0 ) {
+        for ( i = 0; i < block->count; i++ ) {
+            couleurs_params_entry *entry = &block->entries[i];
+            if ( entry->type == COULEURS_PARAMS_COLOR ) {
+                printf( "%-32s color  %g %g %g%s\n", entry->name, block->values[i][0], block->values[i][1], block->values[i][2], block->touched[i] ? " *" : "" );
+            }
+            else {
+                printf( "%-32s %g..%g  %g%s\n", entry->name, entry->min, entry->max, block->values[i][0], block->touched[i] ? " *" : "" );
+            }
+        }
+        return 0;
+    }
+
+    if ( argc < 3 ) return usage();
+    index = couleurs_params_find( block, argv[2] );
+    if ( index < 0 ) {
+        fprintf( stderr, "%s: no such parameter\n", argv[2] );
+        return 1;
+    }
+
+    if ( strcmp( argv[1], "set" ) == 0 ) {
+        float value[3] = { 0, 0, 0 };
+        int components = block->entries[index].type == COULEURS_PARAMS_COLOR ? 3 : 1;
+        if ( argc < 3 + components ) return usage();
+        for ( i = 0; i < (uint32_t)components; i++ ) {
+            value[i] = strtof( argv[ 3 + i ], NULL );
+        }
+        written = couleurs_params_set( block, generation, index, value );
+        if ( written <= 0 ) {
+            fprintf( stderr, written < 0 ? "The parameter block is locked, try again\n" : "The patch changed, try again\n" );
+            return 1;
+        }
+        return 0;
+    }
+
+    if ( strcmp( argv[1], "sweep" ) == 0 ) {
+        double seconds = argc > 3 ? atof( argv[3] ) : 5., start = now(), t;
+        float min = block->entries[index].min, max = block->entries[index].max;
+        unsigned long writes = 0;
+        while ( ( t = now() - start ) < seconds ) {
+            float v = min + ( max - min ) * (float)( .5 + .5 * sin( t * 1.5707963 ) );
+            float value[3] = { v, v, v };
+            written = couleurs_params_set( block, generation, index, value );
+            if ( written == 0 ) {
+                fprintf( stderr, "The patch changed, stopping\n" );
+                break;
+            }
+            writes += written > 0;
+        }
+        printf( "%lu writes in %.2f s, %.0f per second\n", writes, now() - start, writes / ( now() - start ) );
+        return 0;
+    }
+
+    return usage();
+}
\ No newline at end of file
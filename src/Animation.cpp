@@ -19,38 +19,29 @@ Animation::~Animation()
 {
 }
 
-void Animation::trigger()
+void Animation::trigger( const double t )
 {    
-    mTimer.start();
+    mTriggered = true;
+    mStartTime = t;
 }
 
-float Animation::tick()
+float Animation::tick( const double t )
 {
-    if ( mTimer.isStopped() ) {        
-        return hasCompleted() ? 1 : 0;
-    }
-    else {
-        if ( hasCompleted() ) {
-            mTimer.stop();
-            return 1;
-        }
-        else {
-            float t = mTimer.getSeconds() / mDuration;
-            t = easingFunctionsMap[ mCurve ]( t );
-            return t;
-        }
+    if ( hasCompleted( t ) ) {
+        return 1;
     }
+    float progress = (float)( ( t - mStartTime ) / mDuration );
+    // find(), operator[] would insert from the render thread's copies too
+    auto easing = easingFunctionsMap.find( mCurve );
+    return easing != easingFunctionsMap.end() ? easing->second( progress ) : progress;
 }
 
-bool Animation::isActive()
+bool Animation::isActive( const double t )
 {
-    return !mTimer.isStopped() || hasCompleted();
+    return mTriggered && t >= mStartTime;
 }
 
-bool Animation::hasCompleted()
+bool Animation::hasCompleted( const double t )
 {
-    return mTimer.getSeconds() >= mDuration;
-}
-
-
-
+    return t - mStartTime >= mDuration;
+}
\ No newline at end of file
@@ -0,0 +1,405 @@
+#include "AsyncLog.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+
+using namespace ci;
+using namespace std;
+
+namespace {
+    // Fixed storage, a message past it spills to the heap
+    class Buffer : public streambuf {
+        public:
+            Buffer() { reset(); }
+            void reset()
+            {
+                setp( mText, mText + LOG_MESSAGE_SIZE );
+                mSpill.clear();
+                mSpilled = false;
+            }
+            size_t size() const { return pptr() - pbase(); }
+            const char* data() const { return mText; }
+            bool spilled() const { return mSpilled; }
+            // The whole text of a spilled message
+            string* take()
+            {
+                mSpill.append( pbase(), pptr() );
+                return new string( move( mSpill ) );
+            }
+
+        protected:
+            int_type overflow( int_type c ) override
+            {
+                mSpilled = true;
+                mSpill.append( pbase(), pptr() );
+                setp( mText, mText + LOG_MESSAGE_SIZE );
+                if ( !traits_type::eq_int_type( c, traits_type::eof() ) ) {
+                    *pptr() = traits_type::to_char_type( c );
+                    pbump( 1 );
+                }
+                return traits_type::not_eof( c );
+            }
+
+        private:
+            char   mText[ LOG_MESSAGE_SIZE ];
+            string mSpill;
+            bool   mSpilled = false;
+    };
+
+    // One per thread, so formatting takes no lock and allocates nothing
+    struct Formatter {
+        Buffer  buffer;
+        ostream stream { &buffer };
+    };
+
+    Formatter& formatter()
+    {
+        static thread_local Formatter sFormatter;
+        return sFormatter;
+    }
+
+    constexpr uint64_t levelBits( int category, int level )
+    {
+        uint64_t bits = 0;
+        for ( ; level < AsyncLog::LEVEL_COUNT; level++ ) {
+            bits |= 1ull << ( category * AsyncLog::LEVEL_COUNT + level );
+        }
+        return bits;
+    }
+
+    constexpr uint64_t defaultLevels()
+    {
+        uint64_t bits = 0;
+        for ( int category = 0; category < AsyncLog::CATEGORY_COUNT; category++ ) {
+            bits |= levelBits( category, AsyncLog::LEVEL_INFO );
+        }
+        return bits;
+    }
+}
+
+std::atomic<uint64_t> AsyncLog::sEnabled { defaultLevels() };
+
+bool AsyncLog::Site::admit()
+{
+    int64_t now = chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+    int64_t start = windowStart.load( memory_order_relaxed );
+    if ( now - start >= int64_t( LOG_SITE_INTERVAL * 1000 ) && windowStart.compare_exchange_strong( start, now, memory_order_relaxed ) ) {
+        count.store( 0, memory_order_relaxed );
+    }
+    if ( count.fetch_add( 1, memory_order_relaxed ) < LOG_SITE_BURST ) {
+        return true;
+    }
+    suppressed.fetch_add( 1, memory_order_relaxed );
+    return false;
+}
+
+AsyncLog::Message::Message( Level level, Category category, Site &site ) : mLevel( level ), mCategory( category ), mSite( site )
+{
+    auto &f = formatter();
+    f.buffer.reset();
+    f.stream.clear();
+}
+
+AsyncLog::Message::~Message()
+{
+    auto &f = formatter();
+    auto longText = f.buffer.spilled() ? f.buffer.take() : nullptr;
+    instance().push( mLevel, mCategory, mSite, mSite.suppressed.exchange( 0, memory_order_relaxed ), f.buffer.data(), f.buffer.size(), longText );
+}
+
+ostream& AsyncLog::Message::stream()
+{
+    return formatter().stream;
+}
+
+AsyncLog& AsyncLog::instance()
+{
+    static AsyncLog sLog;
+    return sLog;
+}
+
+AsyncLog::AsyncLog() : mStart( chrono::steady_clock::now() )
+{
+}
+
+AsyncLog::~AsyncLog()
+{
+    stop();
+}
+
+void AsyncLog::start( const fs::path &path )
+{
+    stop();
+    {
+        lock_guard<mutex> lock( mWriteMutex );
+        if ( mFile.is_open() ) {
+            mFile.close();
+        }
+        if ( !path.empty() ) {
+            fs::create_directories( path.parent_path() );
+            mFile.open( path.string() );
+        }
+    }
+    mRunning = true;
+    mThread = thread( &AsyncLog::run, this );
+}
+
+void AsyncLog::stop()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        if ( !mRunning ) return;
+        mRunning = false;
+    }
+    mStopped.notify_all();
+    mThread.join();
+    flush();
+}
+
+double AsyncLog::now() const
+{
+    return chrono::duration<double>( chrono::steady_clock::now() - mStart ).count();
+}
+
+void AsyncLog::setLevel( Category category, Level level )
+{
+    uint64_t mask = levelBits( category, 0 ), bits = levelBits( category, level );
+    uint64_t enabled = sEnabled.load( memory_order_relaxed );
+    while ( !sEnabled.compare_exchange_weak( enabled, ( enabled & ~mask ) | bits, memory_order_relaxed ) );
+}
+
+AsyncLog::Level AsyncLog::level( Category category )
+{
+    for ( int level = 0; level < LEVEL_COUNT; level++ ) {
+        if ( isEnabled( (Level)level, category ) ) return (Level)level;
+    }
+    return LEVEL_COUNT;
+}
+
+AsyncLog::Ring& AsyncLog::ring()
+{
+    // Taken on the thread's first message, released when it exits and
+    // recycled by the writer once drained
+    struct Owner {
+        Ring *ring = nullptr;
+        ~Owner()
+        {
+            if ( ring ) ring->released.store( true, memory_order_release );
+        }
+    };
+    static thread_local Owner sOwner;
+    if ( !sOwner.ring ) {
+        lock_guard<mutex> lock( mRingsMutex );
+        if ( mFreeRings.empty() ) {
+            mRings.emplace_back( new Ring );
+            sOwner.ring = mRings.back().get();
+        }
+        else {
+            sOwner.ring = mFreeRings.back();
+            mFreeRings.pop_back();
+        }
+    }
+    return *sOwner.ring;
+}
+
+size_t AsyncLog::rings()
+{
+    lock_guard<mutex> lock( mRingsMutex );
+    return mRings.size();
+}
+
+void AsyncLog::push( Level level, Category category, const Site &site, uint32_t suppressed, const char *text, size_t length, string *longText )
+{
+    // A full ring means the writer is stalled, the message is counted as dropped
+    auto &r = ring();
+    uint64_t written = r.written.load( memory_order_relaxed );
+    if ( written - r.read.load( memory_order_acquire ) >= LOG_RING_SIZE ) {
+        mDropped.fetch_add( 1, memory_order_relaxed );
+        delete longText;
+        return;
+    }
+    auto &entry = r.entries[ written % LOG_RING_SIZE ];
+    entry.time = now();
+    entry.level = level;
+    entry.category = category;
+    entry.site = &site;
+    entry.suppressed = suppressed;
+    entry.length = (uint32_t)min<size_t>( length, LOG_MESSAGE_SIZE );
+    memcpy( entry.text, text, entry.length );
+    entry.longText = longText;
+    r.written.store( written + 1, memory_order_release );
+}
+
+void AsyncLog::run()
+{
+    unique_lock<mutex> lock( mMutex );
+    while ( mRunning ) {
+        mStopped.wait_for( lock, chrono::duration<double>( LOG_FLUSH_INTERVAL ) );
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void AsyncLog::flush()
+{
+    lock_guard<mutex> lock( mWriteMutex );
+    vector<Ring*> rings;
+    {
+        lock_guard<mutex> ringsLock( mRingsMutex );
+        for ( auto &r : mRings ) {
+            rings.push_back( r.get() );
+        }
+    }
+
+    // Every thread's messages, in time order
+    vector<uint64_t> ends( rings.size() );
+    vector<const Entry*> entries;
+    for ( size_t i = 0; i < rings.size(); i++ ) {
+        ends[i] = rings[i]->written.load( memory_order_acquire );
+        for ( uint64_t read = rings[i]->read.load( memory_order_relaxed ); read < ends[i]; read++ ) {
+            entries.push_back( &rings[i]->entries[ read % LOG_RING_SIZE ] );
+        }
+    }
+    stable_sort( entries.begin(), entries.end(), [] ( const Entry *a, const Entry *b ) { return a->time < b->time; } );
+    for ( auto entry : entries ) {
+        write( *entry );
+        delete entry->longText;
+    }
+    for ( size_t i = 0; i < rings.size(); i++ ) {
+        rings[i]->read.store( ends[i], memory_order_release );
+    }
+
+    // An exited thread's ring, drained, goes to the next thread that logs
+    {
+        lock_guard<mutex> ringsLock( mRingsMutex );
+        for ( auto r : rings ) {
+            if ( r->released.load( memory_order_acquire ) && r->written.load( memory_order_acquire ) == r->read.load( memory_order_relaxed ) ) {
+                r->released.store( false, memory_order_relaxed );
+                mFreeRings.push_back( r );
+            }
+        }
+    }
+
+    // Sites still repeating themselves say so once per interval
+    double time = now();
+    for ( auto &repeat : mRepeats ) {
+        if ( repeat.second.count && time - repeat.second.time >= LOG_SITE_INTERVAL ) {
+            writeRepeats( repeat.second );
+        }
+    }
+    uint64_t dropped = mDropped.load( memory_order_relaxed );
+    if ( dropped != mReportedDrops ) {
+        writeLine( time, LEVEL_WARNING, GENERAL, to_string( dropped - mReportedDrops ) + " messages dropped, a thread's log ring was full" );
+        mReportedDrops = dropped;
+    }
+    cout.flush();
+    if ( mFile.is_open() ) {
+        mFile.flush();
+    }
+}
+
+void AsyncLog::write( const Entry &entry )
+{
+    string text = entry.longText ? *entry.longText : string( entry.text, entry.length );
+    auto &repeat = mRepeats[ entry.site ];
+    mSuppressed.fetch_add( entry.suppressed, memory_order_relaxed );
+
+    // The same message from the same site again is folded into the first one
+    if ( repeat.record && text == repeat.text && entry.level == repeat.level ) {
+        repeat.count++;
+        lock_guard<mutex> lock( mHistoryMutex );
+        if ( repeat.record >= mHistoryFirst ) {
+            mHistory[ repeat.record - mHistoryFirst ].repeats++;
+            mHistoryVersion++;
+        }
+        return;
+    }
+
+    writeRepeats( repeat );
+    repeat.text = text;
+    repeat.level = entry.level;
+    repeat.category = entry.category;
+    repeat.time = entry.time;
+    if ( entry.suppressed ) {
+        text += " (" + to_string( entry.suppressed ) + " more suppressed)";
+    }
+    repeat.record = writeLine( entry.time, entry.level, entry.category, text );
+}
+
+void AsyncLog::writeRepeats( Repeat &repeat )
+{
+    if ( !repeat.count ) return;
+    repeat.time = now();
+    print( repeat.time, repeat.level, repeat.category, "last message repeated " + to_string( repeat.count ) + " times" );
+    repeat.count = 0;
+}
+
+void AsyncLog::print( double time, Level level, Category category, const string &text )
+{
+    char prefix[32];
+    snprintf( prefix, sizeof( prefix ), "%10.3f %c %-7s ", time, toupper( levelName( level )[0] ), categoryName( category ) );
+    cout << prefix << text << "\n";
+    if ( mFile.is_open() ) {
+        mFile << prefix << text << "\n";
+    }
+}
+
+uint64_t AsyncLog::writeLine( double time, Level level, Category category, const string &text )
+{
+    print( time, level, category, text );
+    lock_guard<mutex> lock( mHistoryMutex );
+    mHistory.push_back( { time, level, category, text, 0 } );
+    if ( mHistory.size() > LOG_HISTORY ) {
+        mHistory.pop_front();
+        mHistoryFirst++;
+    }
+    mHistoryVersion++;
+    return mHistoryFirst + mHistory.size() - 1;
+}
+
+bool AsyncLog::history( vector<Record> &records, uint64_t &version )
+{
+    lock_guard<mutex> lock( mHistoryMutex );
+    if ( version == mHistoryVersion ) return false;
+    records.assign( mHistory.begin(), mHistory.end() );
+    version = mHistoryVersion;
+    return true;
+}
+
+const char* AsyncLog::levelName( Level level )
+{
+    static const char *names[] = { "debug", "info", "warning", "error", "off" };
+    return names[ level ];
+}
+
+const char* AsyncLog::categoryName( Category category )
+{
+    static const char *names[] = { "general", "shader", "render", "osc", "midi", "audio", "export" };
+    return names[ category ];
+}
+
+void AsyncLog::CinderLogger::write( const log::Metadata &meta, const string &text )
+{
+    // Verbose to fatal. A CI_LOG_* site is known by its file and line, its
+    // Site is made the first time it logs and kept.
+    static const Level levels[] = { LEVEL_DEBUG, LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARNING, LEVEL_ERROR, LEVEL_ERROR };
+    Level level = levels[ meta.mLevel ];
+    if ( !isEnabled( level, GENERAL ) ) return;
+
+    Site *site;
+    {
+        lock_guard<mutex> lock( mSitesMutex );
+        auto &s = mSites[ meta.mLocation.getFileName() + ":" + to_string( meta.mLocation.getLineNumber() ) ];
+        if ( !s ) {
+            s.reset( new Site );
+        }
+        site = s.get();
+    }
+    if ( site->admit() ) {
+        Message( level, GENERAL, *site ).stream() << meta.mLocation.getFunctionName() << ": " << text;
+    }
+}
\ No newline at end of file
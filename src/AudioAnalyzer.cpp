@@ -0,0 +1,257 @@
+#include "AudioAnalyzer.h"
+#include "cinder/audio/Context.h"
+#include "cinder/audio/SamplePlayerNode.h"
+#include "cinder/audio/Source.h"
+#include "cinder/audio/dsp/Dsp.h"
+#include "cinder/audio/dsp/Fft.h"
+#include "cinder/Log.h"
+#include "TripleBuffer.h"
+#include "Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace ci;
+using namespace std;
+
+static double steadySeconds()
+{
+    return chrono::duration<double>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static float normalizedDb( float magnitude )
+{
+    float db = 20.f * log10( max( magnitude, 1e-9f ) );
+    return min( max( ( db + AUDIO_DB_RANGE ) / AUDIO_DB_RANGE, 0.f ), 1.f );
+}
+
+// Everything process() touches is allocated in initialize(): the audio
+// callback takes no lock and does not allocate. Windowing and the FFT go
+// through audio::dsp, which maps to vDSP (SIMD) on macOS, the remaining
+// loops are plain arrays the compiler vectorizes.
+class AudioAnalyzer::AnalysisNode : public audio::NodeAutoPullable {
+    public:
+        AnalysisNode() : audio::NodeAutoPullable( Format() ) {}
+
+        void initialize() override
+        {
+            mFft = make_unique<audio::dsp::Fft>( AUDIO_FFT_SIZE );
+            mFftBuffer = audio::Buffer( AUDIO_FFT_SIZE );
+            mSpectral = audio::BufferSpectral( AUDIO_FFT_SIZE );
+            mWindow.resize( AUDIO_FFT_SIZE );
+            audio::dsp::generateWindow( audio::dsp::WindowType::HANN, mWindow.data(), AUDIO_FFT_SIZE );
+            mRing.assign( AUDIO_FFT_SIZE, 0.f );
+            mMix.assign( getFramesPerBlock(), 0.f );
+            mMagnitudes.assign( AUDIO_FFT_SIZE / 2, 0.f );
+            mPrevious.assign( AUDIO_SPECTRUM_SIZE, 0.f );
+            mBlockSeconds = getFramesPerBlock() / (float)getSampleRate();
+
+            // Log-spaced bin edges, 30 Hz to Nyquist
+            double binHz = getSampleRate() / (double)AUDIO_FFT_SIZE;
+            auto edges = [binHz] ( vector<size_t> &bins, size_t count ) {
+                bins.resize( count + 1 );
+                double lo = log( 30. ), hi = log( ( AUDIO_FFT_SIZE / 2 ) * binHz );
+                for ( size_t i = 0; i <= count; i++ ) {
+                    double hz = exp( lo + ( hi - lo ) * i / count );
+                    bins[i] = min( (size_t)( hz / binHz ), (size_t)AUDIO_FFT_SIZE / 2 );
+                    if ( i > 0 && bins[i] <= bins[i - 1] ) {
+                        bins[i] = min( bins[i - 1] + 1, (size_t)AUDIO_FFT_SIZE / 2 );
+                    }
+                }
+            };
+            edges( mBandBins, AUDIO_BANDS );
+            edges( mSpectrumBins, AUDIO_SPECTRUM_SIZE );
+        }
+
+        void process( audio::Buffer *buffer ) override
+        {
+            auto start = chrono::steady_clock::now();
+            size_t frames = min( buffer->getNumFrames(), mMix.size() );
+            size_t channels = buffer->getNumChannels();
+
+            // Mono mix into the ring, one analysis every hop
+            fill( mMix.begin(), mMix.begin() + frames, 0.f );
+            for ( size_t ch = 0; ch < channels; ch++ ) {
+                const float *samples = buffer->getChannel( ch );
+                for ( size_t i = 0; i < frames; i++ ) {
+                    mMix[i] += samples[i];
+                }
+            }
+            float scale = 1.f / max( channels, (size_t)1 );
+            for ( size_t i = 0; i < frames; i++ ) {
+                mRing[ mWritePos ] = mMix[i] * scale;
+                mWritePos = ( mWritePos + 1 ) % AUDIO_FFT_SIZE;
+                if ( ++mSinceHop == AUDIO_HOP_SIZE ) {
+                    mSinceHop = 0;
+                    analyze();
+                }
+            }
+
+            float seconds = chrono::duration<float>( chrono::steady_clock::now() - start ).count();
+            mProcessSeconds = mProcessSeconds + ( seconds - mProcessSeconds ) * .05f;
+        }
+
+        TripleBuffer<AudioFeatures> mFeatures;
+        atomic<float>               mProcessSeconds { 0 }, mBlockSeconds { 0 };
+
+    private:
+        void analyze()
+        {
+            // Oldest sample first
+            float *data = mFftBuffer.getData();
+            size_t tail = AUDIO_FFT_SIZE - mWritePos;
+            memcpy( data, mRing.data() + mWritePos, tail * sizeof( float ) );
+            memcpy( data + tail, mRing.data(), mWritePos * sizeof( float ) );
+
+            auto &features = mFeatures.writeBuffer();
+            features.rms = audio::dsp::rms( data, AUDIO_FFT_SIZE );
+
+            audio::dsp::mul( data, mWindow.data(), data, AUDIO_FFT_SIZE );
+            mFft->forward( &mFftBuffer, &mSpectral );
+
+            // imag[0] packs Nyquist, not part of the DC bin
+            float *real = mSpectral.getReal();
+            float *imag = mSpectral.getImag();
+            imag[0] = 0.f;
+            float norm = 2.f / AUDIO_FFT_SIZE;
+            for ( size_t k = 0; k < mMagnitudes.size(); k++ ) {
+                mMagnitudes[k] = sqrt( real[k] * real[k] + imag[k] * imag[k] ) * norm;
+            }
+
+            float flux = 0;
+            for ( size_t i = 0; i < AUDIO_SPECTRUM_SIZE; i++ ) {
+                float peak = 0;
+                for ( size_t k = mSpectrumBins[i]; k < max( mSpectrumBins[i + 1], mSpectrumBins[i] + 1 ) && k < mMagnitudes.size(); k++ ) {
+                    peak = max( peak, mMagnitudes[k] );
+                }
+                float level = normalizedDb( peak );
+                flux += max( level - mPrevious[i], 0.f );
+                mPrevious[i] = level;
+                features.spectrum[i] = level;
+            }
+            features.flux = flux / AUDIO_SPECTRUM_SIZE;
+
+            for ( size_t b = 0; b < AUDIO_BANDS; b++ ) {
+                float power = 0;
+                size_t count = 0;
+                for ( size_t k = mBandBins[b]; k < mBandBins[b + 1]; k++, count++ ) {
+                    power += mMagnitudes[k] * mMagnitudes[k];
+                }
+                features.bands[b] = normalizedDb( sqrt( power / max( count, (size_t)1 ) ) );
+            }
+
+            features.captureTime = steadySeconds();
+            features.sequence = ++mSequence;
+            mFeatures.publish();
+        }
+
+        unique_ptr<audio::dsp::Fft> mFft;
+        audio::Buffer               mFftBuffer;
+        audio::BufferSpectral       mSpectral;
+        vector<float>               mWindow, mRing, mMix, mMagnitudes, mPrevious;
+        vector<size_t>              mBandBins, mSpectrumBins;
+        size_t                      mWritePos = 0, mSinceHop = 0;
+        uint64_t                    mSequence = 0;
+};
+
+AudioAnalyzer::AudioAnalyzer()
+{
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+    stop();
+}
+
+void AudioAnalyzer::start( const fs::path &file )
+{
+    auto ctx = audio::master();
+    try {
+        mNode = ctx->makeNode( new AnalysisNode() );
+        if ( file.empty() ) {
+            auto input = ctx->createInputDeviceNode();
+            input >> mNode;
+            input->enable();
+            mSource = input;
+        }
+        else {
+            // Stand-in for the live input, also played out
+            auto source = audio::load( loadFile( file ), ctx->getSampleRate() );
+            auto player = ctx->makeNode( new audio::BufferPlayerNode( source->loadBuffer() ) );
+            player->setLoopEnabled( true );
+            player >> mNode;
+            player >> ctx->getOutput();
+            player->start();
+            mSource = player;
+        }
+        mNode->enable();
+        ctx->enable();
+        CI_LOG_I( "Audio analysis: " << ( file.empty() ? "live input" : file.string() ) );
+    }
+    catch ( const std::exception &exc ) {
+        CI_LOG_E( "Audio analysis disabled: " << exc.what() );
+        mNode = nullptr;
+        mSource = nullptr;
+    }
+}
+
+void AudioAnalyzer::stop()
+{
+    if ( !mNode ) return;
+    mSource->disconnectAll();
+    mNode->disconnectAll();
+    mSource = nullptr;
+    mNode = nullptr;
+}
+
+bool AudioAnalyzer::update()
+{
+    if ( !mNode || !mNode->mFeatures.update() ) {
+        return false;
+    }
+    float latency = (float)( ( steadySeconds() - features().captureTime ) * 1000. );
+    mLatencyMilliseconds += ( latency - mLatencyMilliseconds ) * .1f;
+    return true;
+}
+
+const AudioFeatures& AudioAnalyzer::features() const
+{
+    return mNode ? mNode->mFeatures.readBuffer() : mSilence;
+}
+
+float AudioAnalyzer::blockMilliseconds() const
+{
+    return mNode ? mNode->mBlockSeconds * 1000.f : 0.f;
+}
+
+float AudioAnalyzer::cpuPercent() const
+{
+    return mNode && mNode->mBlockSeconds > 0 ? 100.f * mNode->mProcessSeconds / mNode->mBlockSeconds : 0.f;
+}
+
+AudioTexture::AudioTexture() : mHistory( AUDIO_SPECTRUM_SIZE * AUDIO_HISTORY, 0.f )
+{
+}
+
+AudioTexture::~AudioTexture()
+{
+}
+
+void AudioTexture::update( const AudioFeatures &features )
+{
+    if ( !mTexture ) {
+        auto format = gl::Texture::Format().internalFormat( GL_R32F ).dataType( GL_FLOAT )
+                                           .minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+        mTexture = gl::Texture2d::create( mHistory.data(), GL_RED, AUDIO_SPECTRUM_SIZE, AUDIO_HISTORY, format );
+    }
+    if ( features.sequence == mSequence ) return;
+    mSequence = features.sequence;
+
+    // Age the history by one row, newest on row 0
+    memmove( mHistory.data() + AUDIO_SPECTRUM_SIZE, mHistory.data(), AUDIO_SPECTRUM_SIZE * ( AUDIO_HISTORY - 1 ) * sizeof( float ) );
+    memcpy( mHistory.data(), features.spectrum, AUDIO_SPECTRUM_SIZE * sizeof( float ) );
+    mTexture->update( mHistory.data(), GL_RED, GL_FLOAT, 0, AUDIO_SPECTRUM_SIZE, AUDIO_HISTORY );
+    gl::printError( "AudioTexture::update" );
+}
\ No newline at end of file
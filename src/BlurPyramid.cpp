@@ -0,0 +1,113 @@
+#include "BlurPyramid.h"
+#include "cinder/app/App.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+static fs::path vertPath = "shaders/vertex/passthrough.vert";
+
+BlurPyramid::BlurPyramid( int levels, const std::string &radiusUniform ) : mLevelCount( std::max( levels, 1 ) ),
+                                                                            mHasRadius( !radiusUniform.empty() )
+{
+    auto format = gl::GlslProg::Format().version( 330 )
+                                        .vertex( app::loadAsset( vertPath ) );
+    if ( mHasRadius ) {
+        format = format.define( "RADIUS_UNIFORM", radiusUniform );
+    }
+    mDownShader = gl::GlslProg::create( gl::GlslProg::Format( format ).fragment( app::loadAsset( "shaders/filters/kawase_down.frag" ) ) );
+    mUpShader = gl::GlslProg::create( gl::GlslProg::Format( format ).fragment( app::loadAsset( "shaders/filters/kawase_up.frag" ) ) );
+}
+
+BlurPyramid::~BlurPyramid()
+{
+    release();
+}
+
+void BlurPyramid::process( const gl::TextureRef &source, const std::function<void ( gl::GlslProgRef )> &setUniforms )
+{
+    if ( !mOutput || mOutput->getSize() != source->getSize() ) {
+        resize( source->getSize() );
+    }
+
+    gl::ScopedMatrices scopedMatrices;
+    gl::ScopedBlend scopedBlend( false );
+
+    // Down to the smallest level
+    gl::TextureRef input = source;
+    for ( auto &level : mLevels ) {
+        pass( mDownShader, input, level, setUniforms );
+        input = level->getColorTexture();
+    }
+
+    // Back up, each level overwrites the downsample it no longer needs
+    for ( int k = (int)mLevels.size() - 2; k >= 0; k-- ) {
+        pass( mUpShader, input, mLevels[k], setUniforms );
+        input = mLevels[k]->getColorTexture();
+    }
+    pass( mUpShader, input, mOutput, setUniforms );
+
+    gl::printError( "BlurPyramid::process" );
+}
+
+void BlurPyramid::release()
+{
+    if ( mFboPool ) {
+        for ( auto &level : mLevels ) {
+            mFboPool->release( level );
+        }
+        mFboPool->release( mOutput );
+    }
+    mLevels.clear();
+    mOutput = nullptr;
+}
+
+void BlurPyramid::clear()
+{
+    if ( !mOutput ) return;
+    gl::ScopedFramebuffer scopedFbo( mOutput );
+    gl::clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+}
+
+size_t BlurPyramid::bytes() const
+{
+    size_t total = FboPool::bytes( mOutput );
+    for ( auto &level : mLevels ) {
+        total += FboPool::bytes( level );
+    }
+    return total;
+}
+
+const gl::TextureRef BlurPyramid::texture()
+{
+    return mOutput->getColorTexture();
+}
+
+void BlurPyramid::resize( const ivec2 &size )
+{
+    release();
+    auto acquire = [this] ( const ivec2 &s ) {
+        return mFboPool ? mFboPool->acquire( s.x, s.y ) : gl::Fbo::create( s.x, s.y );
+    };
+    for ( int k = 1; k <= mLevelCount; k++ ) {
+        mLevels.push_back( acquire( glm::max( size / ( 1 << k ), ivec2( 1 ) ) ) );
+    }
+    mOutput = acquire( size );
+}
+
+/* Privates */
+
+void BlurPyramid::pass( const gl::GlslProgRef &shader, const gl::TextureRef &texture, const gl::FboRef &fbo, const std::function<void ( gl::GlslProgRef )> &setUniforms )
+{
+    gl::ScopedFramebuffer scopedFbo( fbo );
+    gl::ScopedViewport scopedViewport( ivec2( 0 ), fbo->getSize() );
+    gl::setMatricesWindow( fbo->getSize(), false );
+    gl::ScopedGlslProg scopedShader( shader );
+    gl::ScopedTextureBind scopedTexture( texture, 0 );
+    shader->uniform( "u_tex", 0 );
+    shader->uniform( "u_halfPixel", vec2( .5f ) / vec2( texture->getSize() ) );
+    if ( mHasRadius ) {
+        setUniforms( shader );
+    }
+    gl::drawSolidRect( Rectf( fbo->getBounds() ) );
+}
\ No newline at end of file
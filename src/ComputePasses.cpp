@@ -0,0 +1,312 @@
+#include "ComputePasses.h"
+#include "cinder/app/App.h"
+#include "cinder/Exception.h"
+#include "cinder/Utilities.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+ComputePasses::ComputePasses() {}
+ComputePasses::~ComputePasses() {}
+
+static GLenum stringToFormat( const std::string &formatStr )
+{
+    if ( formatStr == "rgba32f" ) return GL_RGBA32F;
+    if ( formatStr == "rgba16f" ) return GL_RGBA16F;
+    if ( formatStr == "r32f" ) return GL_R32F;
+    if ( formatStr == "r32ui" ) return GL_R32UI;
+    return 0;
+}
+
+bool ComputePasses::isSupported()
+{
+#if defined( CINDER_GL_HAS_COMPUTE_SHADER )
+    auto version = gl::getVersion();
+    return version.first > 4 || ( version.first == 4 && version.second >= 3 );
+#else
+    return false;
+#endif
+}
+
+void ComputePasses::load( const fs::path &compPath, bool loopMode )
+{
+    if ( !isSupported() ) {
+        throw Exception( "Compute passes need an OpenGL 4.3 context: " + compPath.string() );
+    }
+
+#if defined( CINDER_GL_HAS_COMPUTE_SHADER )
+    // Compile everything first, a failed live reload keeps the running passes and state
+    auto source = loadString( app::loadAsset( compPath ) );
+    int count = getDefineBlockCount( source, "COMPUTE_" );
+    vector<gl::GlslProgRef> programs;
+    for ( int i = 0; i < std::max( count, 1 ); i++ ) {
+        auto format = gl::GlslProg::Format().version( 430 )
+                                            .compute( app::loadAsset( compPath ) );
+        if ( count > 0 ) {
+            format = format.define( "COMPUTE_" + std::to_string( i ) );
+        }
+        if ( loopMode ) {
+            format = format.define( "LOOP" );
+        }
+        programs.push_back( gl::GlslProg::create( format ) );
+    }
+
+    parse( source, programs.size() );
+    mPrograms = programs;
+    for ( size_t i = 0; i < mPrograms.size(); i++ ) {
+        glGetProgramiv( mPrograms[i]->getHandle(), GL_COMPUTE_WORK_GROUP_SIZE, mDispatches[i].localSize );
+    }
+
+    gl::printError( "ComputePasses::load" );
+#endif
+}
+
+void ComputePasses::unload()
+{
+    mPrograms.clear();
+    mDispatches.clear();
+    mStorageNames.clear();
+    mStorage.clear();
+    for ( auto &image : mImages ) {
+        release( image );
+    }
+    mImages.clear();
+    mFrame = 0;
+}
+
+void ComputePasses::resize( int width, int height )
+{
+    mWidth = width;
+    mHeight = height;
+    for ( auto &image : mImages ) {
+        if ( image.size == ivec2( 0 ) ) {
+            allocate( image );
+        }
+    }
+}
+
+void ComputePasses::reset()
+{
+    // Zeroed state, the same starting point for every render of the patch
+    for ( auto &entry : mStorage ) {
+        auto &storage = entry.second;
+        vector<uint8_t> zeros( storage.count * storage.stride, 0 );
+        storage.buffer->bufferData( zeros.size(), zeros.data(), GL_DYNAMIC_COPY );
+    }
+    for ( auto &image : mImages ) {
+        allocate( image );
+    }
+    mFrame = 0;
+}
+
+void ComputePasses::dispatch( size_t i )
+{
+#if defined( CINDER_GL_HAS_COMPUTE_SHADER )
+    auto &shader = mPrograms[i];
+    shader->uniform( "u_computeFrame", mFrame );
+
+    for ( size_t b = 0; b < mStorageNames.size(); b++ ) {
+        glBindBufferBase( GL_SHADER_STORAGE_BUFFER, b, mStorage[ mStorageNames[b] ].buffer->getId() );
+    }
+    for ( size_t unit = 0; unit < mImages.size(); unit++ ) {
+        auto &image = mImages[unit];
+        glBindImageTexture( unit, image.texture->getId(), 0, GL_FALSE, 0, GL_READ_WRITE, image.format );
+    }
+
+    auto &d = mDispatches[i];
+    GLuint groups[3];
+    for ( int axis = 0; axis < 3; axis++ ) {
+        GLuint local = std::max( d.localSize[axis], 1 );
+        groups[axis] = std::max( 1u, ( invocations( d.invocations[axis] ) + local - 1 ) / local );
+    }
+    glDispatchCompute( groups[0], groups[1], groups[2] );
+
+    // Later passes read what this one wrote
+    glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+    gl::printError( "glDispatchCompute" );
+#endif
+}
+
+void ComputePasses::finish()
+{
+#if defined( CINDER_GL_HAS_COMPUTE_SHADER )
+    // Fragment passes sample the images through the texture units
+    glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+#endif
+    mFrame++;
+}
+
+size_t ComputePasses::storageCount( const std::string &name ) const
+{
+    auto it = mStorage.find( name );
+    return it != mStorage.end() ? it->second.count : 0;
+}
+
+size_t ComputePasses::bytes() const
+{
+    size_t total = 0;
+    for ( auto &entry : mStorage ) {
+        total += entry.second.count * entry.second.stride;
+    }
+    for ( auto &image : mImages ) {
+        total += FboPool::bytes( image.texture );
+    }
+    return total;
+}
+
+gl::Texture2dRef ComputePasses::imageTexture( const std::string &name ) const
+{
+    for ( auto &image : mImages ) {
+        if ( image.name == name ) return image.texture;
+    }
+    return nullptr;
+}
+
+/* Privates */
+
+void ComputePasses::parse( const std::string &source, size_t passCount )
+{
+    vector<Dispatch> dispatches( passCount );
+    vector<std::string> storageNames;
+    map<std::string, Storage> storage;
+    vector<Image> images;
+
+    for ( auto &pragma : getPatchDirectives( source ) ) {
+        auto &directive = pragma.name;
+        auto &args = pragma.args;
+        try {
+            if ( directive == "storage" && args.size() == 3 ) {
+                Storage s;
+                s.count = stoul( args[1] );
+                s.stride = stoul( args[2] );
+                if ( s.count == 0 || s.stride == 0 || s.stride % 4 != 0 ) {
+                    throw Exception( "storage " + args[0] + " needs a count and a stride multiple of 4" );
+                }
+
+                // Keep the contents of unchanged buffers across live reloads
+                auto previous = mStorage.find( args[0] );
+                if ( previous != mStorage.end() && previous->second.count == s.count && previous->second.stride == s.stride ) {
+                    s.buffer = previous->second.buffer;
+                }
+                else {
+                    vector<uint8_t> zeros( s.count * s.stride, 0 );
+                    s.buffer = gl::BufferObj::create( GL_SHADER_STORAGE_BUFFER, zeros.size(), zeros.data(), GL_DYNAMIC_COPY );
+                }
+                storageNames.push_back( args[0] );
+                storage[ args[0] ] = s;
+            }
+            else if ( directive == "image" && !args.empty() ) {
+                Image image;
+                image.name = args[0];
+                size_t next = 1;
+                image.format = GL_RGBA32F;
+                if ( args.size() > next && stringToFormat( args[next] ) ) {
+                    image.format = stringToFormat( args[next++] );
+                }
+                if ( args.size() == next + 2 ) {
+                    image.size = ivec2( stoi( args[next] ), stoi( args[next + 1] ) );
+                }
+                else if ( args.size() != next ) {
+                    throw Exception( "image " + image.name + " takes [format] [width height]" );
+                }
+
+                for ( auto &previous : mImages ) {
+                    if ( previous.name == image.name && previous.format == image.format && previous.size == image.size ) {
+                        image.texture = previous.texture;
+                    }
+                }
+                images.push_back( image );
+            }
+            else if ( directive == "dispatch" && args.size() >= 2 && args.size() <= 4 ) {
+                size_t pass = stoul( args[0] );
+                if ( pass >= passCount ) {
+                    throw Exception( "dispatch for unknown pass " + args[0] );
+                }
+                Dispatch &d = dispatches[pass];
+                d.invocations[1] = d.invocations[2] = "1";
+                for ( size_t axis = 0; axis + 1 < args.size(); axis++ ) {
+                    d.invocations[axis] = args[axis + 1];
+                }
+            }
+            else {
+                throw Exception( "unknown directive" );
+            }
+        }
+        catch ( const std::logic_error & ) {
+            throw Exception( "Bad #pragma couleurs line: " + pragma.line );
+        }
+        catch ( const Exception &exc ) {
+            throw Exception( "Bad #pragma couleurs line: " + pragma.line + " (" + exc.what() + ")" );
+        }
+    }
+
+    // Dispatch sizes are numbers, the render size or a storage element count
+    for ( auto &d : dispatches ) {
+        for ( auto &token : d.invocations ) {
+            bool isNumber = !token.empty() && token.find_first_not_of( "0123456789" ) == std::string::npos;
+            if ( !isNumber && token != "width" && token != "height" && !storage.count( token ) ) {
+                throw Exception( "Unknown dispatch size: " + token );
+            }
+        }
+    }
+
+    for ( auto &previous : mImages ) {
+        bool kept = false;
+        for ( auto &image : images ) {
+            kept = kept || image.texture == previous.texture;
+        }
+        if ( !kept ) {
+            release( previous );
+        }
+    }
+
+    mDispatches = dispatches;
+    mStorageNames = storageNames;
+    mStorage = storage;
+    mImages = images;
+    for ( auto &image : mImages ) {
+        if ( !image.texture ) {
+            allocate( image );
+        }
+    }
+}
+
+void ComputePasses::allocate( Image &image )
+{
+    ivec2 size = glm::max( image.size == ivec2( 0 ) ? ivec2( mWidth, mHeight ) : image.size, ivec2( 1 ) );
+    bool isInteger = image.format == GL_R32UI;
+    release( image );
+    if ( mFboPool ) {
+        image.texture = mFboPool->acquireTexture( size.x, size.y, image.format );
+    }
+    else {
+        image.texture = gl::Texture2d::create( size.x, size.y, gl::Texture2d::Format().internalFormat( image.format ).immutableStorage() );
+    }
+    image.texture->setMinFilter( isInteger ? GL_NEAREST : GL_LINEAR );
+    image.texture->setMagFilter( isInteger ? GL_NEAREST : GL_LINEAR );
+    image.texture->setWrap( GL_REPEAT, GL_REPEAT );
+
+    // Immutable storage is undefined until written, start from zero
+    vector<uint8_t> zeros( size.x * size.y * 16, 0 );
+    gl::ScopedTextureBind scopedTexture( image.texture );
+    GLenum dataFormat = isInteger ? GL_RED_INTEGER : ( image.format == GL_R32F ? GL_RED : GL_RGBA );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, dataFormat, isInteger ? GL_UNSIGNED_INT : GL_FLOAT, zeros.data() );
+}
+
+void ComputePasses::release( Image &image )
+{
+    if ( mFboPool ) {
+        mFboPool->release( image.texture );
+    }
+    image.texture = nullptr;
+}
+
+GLuint ComputePasses::invocations( const std::string &token )
+{
+    if ( token == "width" ) return mWidth;
+    if ( token == "height" ) return mHeight;
+    auto it = mStorage.find( token );
+    if ( it != mStorage.end() ) return it->second.count;
+    return stoul( token );
+}
\ No newline at end of file
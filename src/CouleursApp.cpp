@@ -28,6 +28,22 @@
 #include "Patch.h"
 #include "Constants.h"
 #include "MultipassShader.h"
+#include "Outputs.h"
+#include "PatchBundle.h"
+#include "RenderThread.h"
+#include "ShaderCompiler.h"
+#include "FrameState.h"
+#include "FrameClock.h"
+#include "TemporalAccumulator.h"
+#include "AudioAnalyzer.h"
+#include "NoiseTextures.h"
+#include "ThumbnailRenderer.h"
+#include "LutTexture.h"
+#include "PatchCatalog.h"
+#include "LoopEncoder.h"
+#include "Metrics.h"
+#include "AsyncLog.h"
+#include "ParameterBlock.h"
 #include "Utils.h"
 
 using namespace ci;
@@ -39,6 +55,7 @@ public:
   CouleursApp();
   void setup() override;
   void update() override;
+  void cleanup() override;
   void keyDown( KeyEvent event ) override;
   void mouseMove( MouseEvent event ) override;
   void fileDrop( FileDropEvent event ) override;
@@ -52,28 +69,52 @@ private:
   void setupScene();
   void setupMidi();
   void setupOSC();
+  void setupOutputs();
   void loadCurrentPatch();  
+  void renderThumbnails();
+  gl::Texture2dRef thumbnail( const string &name );
+  void packPatches( const vector<string> &names );
   
   // Update
   void updateOSC();
   void updateUI();
   void updateShaders();
   void exportGIFFrames();
+  void stopLoopExport( const string &error );
   void updateTimer();
   void updateParams();
   void updateCamera();
+  void beginFrame();
+  void publishFrameState();
   
   void drawUI();
   void drawScene();
+  void retimeFrameState( FrameState &state );
+  gl::FboRef renderFrame( const FrameState &state );
+  void renderPasses( const FrameState &state );
+  void renderSupersampled( const FrameState &state );
+  static float tickAt( double t, int bpm );
   void bindUniforms( gl::GlslProgRef shader );  
+  void reportShaderStatus();
+  void reportMemoryUse();
+  void reportPassTimes();
+  void startMetrics();
+  void sendMetrics( const Metrics::Snapshot &snapshot );
   
   void resizeScene();
+  void applyResize();
+  ivec2 renderSize();
   
   void clearFBO( gl::FboRef fbo );
 
   void exportFrame( string suffix, bool exportParams );
+  void postExportFrame( string suffix );
+  void writeExport( const string &path, JsonTree *params );
   void saveParams();
   void resetParams();
+  void freezeParams();
+  void unfreezeParam( Parameter &param );
+  void unfreezeParams();
   
   void abletonMidiListener( midi::Message msg );
   void controllerMidiListener( midi::Message msg );
@@ -82,6 +123,10 @@ private:
   midi::Input                  mAbletonMidiIn, mControllerMidiIn;
   
   Performance                  mPerformance;
+  PatchCatalog                 mCatalog;
+  string                       mSetlistName = SETLIST_NAME;
+  map<string, gl::Texture2dRef> mThumbnails; // UI context, loaded on first display
+  ThumbnailRenderer            mThumbnailRenderer;
   Patch&                       currentPatch() { return mPerformance.currentPatch(); };
   Parameters&                  currentParams() { return currentPatch().params(); };
       
@@ -89,10 +134,19 @@ private:
   bool                         mHeadlessMode = false;
   bool                         mSaveHeadlessScreenshot = false;
   bool                         mLoopExportMode = false;
+  string                       mLoopFormat = LOOP_EXPORT_FORMAT;
+  string                       mLoopExportError; // shown in the UI, the export stopped
+  unique_ptr<LoopEncoder>      mLoopEncoder; // gif and apng loop exports, frames stream into it
   
-  // Time
+  // Time, sampled once per frame at its predicted presentation time
+  FrameClock                   mFrameClock;
+  double                       mFrameTime = 0, mPresentLead = 0;
+  double                       mPendingPresentTime = -1, mPendingRenderSeconds = 0; // drawn, reported after the swap
+  double                       mNextInlineFrame = -1; // due time of the next frame rendered by drawScene()
   float                        mTime = 0;
   bool                         mTimeStopped = false;
+  float                        mSnapshotMicroseconds = 0;
+  TemporalAccumulator          mAccumulator;
   
   // Mouse
   ivec2                        mMousePosition;
@@ -104,9 +158,50 @@ private:
   // AV Sync
   ci::Timer                    mTimer;
   int                          mBPM = 100, mSection = 0, mNumSections;
+  double                       mBeatTime = 0; // on mTimer, at the frame's present time
   float                        mTick; //[0 - 1]      
 
+  // Audio, analysed on the audio thread, uploaded on the render thread
+  AudioAnalyzer                mAudio;
+  AudioTexture                 mAudioTexture;
+
+  // Before its users: the shader releases its buffers into the pool when destroyed
+  FboPool                      mFboPool; // buffers and blur levels reused across patches
   MultipassShader              mMultipassShader;
+  MultipassShader::MemoryUse   mMemoryUse; // UI copy, see reportMemoryUse()
+  size_t                       mPoolBytes = 0;
+  MultipassShader::Fusion      mFusion; // UI copy, see reportShaderStatus()
+  MultipassShader::Textures    mPatchTextures; // UI copy, see reportShaderStatus()
+  LutTexture::Timing           mLutTiming; // UI copy, last "Measure LUTs"
+  bool                         mFusionEnabled = PASS_FUSION;
+  ivec2                        mRenderSize; // of the FBOs, lags the window while a resize settles
+  double                       mResizeTime = 0;
+  bool                         mResizePending = false;
+  NoiseTextures                mNoiseTextures;
+  ShaderCompiler               mShaderCompiler; // frozen programs, off the render thread
+  vector<MultipassShader::PassTime> mPassTimes; // UI copy, see reportPassTimes()
+  bool                         mProgramsFrozen = false, mProgramsFreezing = false;
+  double                       mFreezeSeconds = 0;
+  int                          mPassTimeFrames = 0; // render thread
+  bool                         mShaderCompilationFailed = false;
+  string                       mShaderCompileErrorMessage;
+
+  // Rendering, the shader is only touched from the render thread
+  RenderThread                 mRenderThread;
+  Metrics                      mMetrics;
+  asio::io_service             mMetricsService; // the sender's, only run by the metrics thread
+  unique_ptr<osc::SenderUdp>   mMetricsSender;
+  const FrameState             *mFrameState = nullptr;
+
+  // External controllers, see couleurs_params.h
+  ParameterBlock               mParameterBlock;
+  ParameterBlock::Values       mBlockValues; // main thread, onto the parameters
+
+  // Log window, a copy of the log's history
+  vector<AsyncLog::Record>     mLogRecords;
+  vector<int>                  mLogLines; // shown records
+  uint64_t                     mLogVersion = 0;
+  int                          mLogShownLevel = AsyncLog::LEVEL_DEBUG, mLogLinesLevel = -1;
   
   // Window Management
   ci::app::WindowRef           mUIWindow, mSceneWindow;
@@ -115,9 +210,14 @@ private:
   syphonServer                 mScreenSyphon;
   syphonClient                 mClientSyphon;
   ci::gl::FboRef               mSyphonFBO;
+
+  // Outputs
+  Outputs                                        mOutputs;
+  std::map<std::string, shared_ptr<syphonServer>> mOutputSyphons;
+  vector<ci::app::WindowRef>                     mOutputWindows;
 };
 
-CouleursApp::CouleursApp() : mPerformance( { PATCH_NAME } ), mOSCIn( OSC_PORT ) 
+CouleursApp::CouleursApp() : mFrameClock( 1. / RENDER_FRAME_RATE ), mOSCIn( OSC_PORT ) 
 {    
   // Window Management
   mUIWindow = getWindow();
@@ -125,14 +225,14 @@ CouleursApp::CouleursApp() : mPerformance( { PATCH_NAME } ), mOSCIn( OSC_PORT )
   mUIWindow->getSignalDraw().connect( bind( &CouleursApp::drawUI, this ) );
   mUIWindow->setPos( 0, WINDOW_PADDING );
   mUIWindow->setSize( UI_WIDTH, UI_HEIGHT );
-  console() << "UI Window content scale: " << mUIWindow->getContentScale() << endl;
+  LOG_I( GENERAL, "UI Window content scale: " << mUIWindow->getContentScale() );
     
   mSceneWindow = createWindow( Window::Format().size( SCENE_WIDTH, SCENE_HEIGHT ) );
   mSceneWindow->setTitle( "Couleurs: Render" );
   mSceneWindow->getSignalDraw().connect( bind( &CouleursApp::drawScene, this ) );
   mSceneWindow->getSignalResize().connect( bind( &CouleursApp::resizeScene, this ) );
   mSceneWindow->setPos( 0, UI_HEIGHT + 2 * WINDOW_PADDING );
-  console() << "Scene Window content scale: " << mSceneWindow->getContentScale() << endl;  
+  LOG_I( GENERAL, "Scene Window content scale: " << mSceneWindow->getContentScale() );
 
   // Midi
   setupMidi();
@@ -140,7 +240,13 @@ CouleursApp::CouleursApp() : mPerformance( { PATCH_NAME } ), mOSCIn( OSC_PORT )
 
 void CouleursApp::setup() 
 {
+  // Log first, CI_LOG_* included, written by its own thread
+  AsyncLog::instance().start( getHomeDirectory() / CACHE_FOLDER / LOG_FILE );
+  log::manager()->clearLoggers();
+  log::makeLogger<AsyncLog::CinderLogger>();
+
   // Read command-line arguments
+  fs::path audioFile;
   for( vector<string>::const_iterator argIt = getArgs().begin(); argIt != getArgs().end(); ++argIt ) {
 		if ( *argIt == "headless" ) {
       mHeadlessMode = true;
@@ -149,14 +255,89 @@ void CouleursApp::setup()
     if ( *argIt == "loop_export" ) {
       mLoopExportMode = true;
     };
+
+    if ( *argIt == "audio_file" && argIt + 1 != getArgs().end() ) {
+      audioFile = *( argIt + 1 );
+    };
+
+    if ( *argIt == "loop_format" && argIt + 1 != getArgs().end() ) {
+      mLoopFormat = *( argIt + 1 );
+    };
+
+    if ( *argIt == "setlist" && argIt + 1 != getArgs().end() ) {
+      mSetlistName = *( argIt + 1 );
+    };
+
+    if ( *argIt == "pack" ) {
+      packPatches( vector<string>( argIt + 1, getArgs().cend() ) );
+      quit();
+      return;
+    };
+  }
+
+  // A mistyped format is refused before anything is rendered
+  if ( mLoopExportMode && mLoopFormat != "png" ) {
+    try {
+      LoopEncoder::stringToFormat( mLoopFormat );
+    }
+    catch ( const std::exception &e ) {
+      stopLoopExport( string( e.what() ) + ", expected png, gif or apng" );
+    }
+  }
+
+  // Patches
+  mPerformance.load( Performance::readSetlist( mSetlistName ) );
+  mCatalog.scan();
+
+  // Audio, not for exports which should not depend on the room
+  if ( ( AUDIO_INPUT || !audioFile.empty() ) && !mHeadlessMode && !mLoopExportMode ) {
+    mAudio.start( audioFile );
   }
 
   setupUI();
+
+  // Render thread, not for exports which need every frame rendered in order
+  mSceneWindow->getRenderer()->makeCurrentContext();
+  if ( METRICS ) {
+    startMetrics();
+  }
+  if ( PARAMETER_BLOCK && !mHeadlessMode && !mLoopExportMode ) {
+    try {
+      mParameterBlock.open( PARAMETER_BLOCK_NAME );
+    }
+    catch ( const Exception &e ) {
+      CI_LOG_E( e.what() );
+    }
+  }
+  if ( RENDER_THREAD && !mHeadlessMode && !mLoopExportMode ) {
+    mRenderThread.setMetrics( &mMetrics );
+    mRenderThread.start( [this] ( FrameState &state ) {
+      retimeFrameState( state );
+      return renderFrame( state );
+    }, RENDER_FRAME_RATE );
+    mShaderCompiler.start();
+    // The render thread samples time and ticks the modulators itself, the
+    // main loop only has to keep up with the UI and the controllers
+    setFrameRate( UI_FRAME_RATE );
+  }
+
+  // Loop exports step time by exactly 1 / GIF_FPS per frame and run unthrottled
+  if ( mLoopExportMode ) {
+    mFrameClock.setFixedStep( 1. / GIF_FPS );
+    disableFrameRate();
+    gl::enableVerticalSync( false );
+  }
+
   setupScene();
   mTimer.start();
+  if ( mRenderThread.isRunning() ) {
+    renderThumbnails();
+  }
 
-  // Syphon
-  mScreenSyphon.setName( "Couleurs" );  
+  // Syphon, the server publishes from the render context
+  mRenderThread.post( [this] {
+    mScreenSyphon.setName( "Couleurs" );  
+  } );
   mClientSyphon.setServerName( "Processing Syphon" );	
   mSyphonFBO = gl::Fbo::create( toPixels( mSceneWindow->getWidth() ), toPixels( mSceneWindow->getHeight() ) );
 
@@ -185,24 +366,62 @@ void CouleursApp::setupScene()
 {
   mSceneWindow->getRenderer()->makeCurrentContext();
   
+  // Outputs
+  setupOutputs();
+
   // Shaders
   initShaderWatching();
-  auto width = mHeadlessMode ? HEADLESS_WIDTH : toPixels( mSceneWindow->getWidth() );
-  auto height = mHeadlessMode ? HEADLESS_HEIGHT : toPixels( mSceneWindow->getHeight() );
-  mMultipassShader.init( width, 
-                         height,
-                         [this] ( gl::GlslProgRef shader ) { bindUniforms( shader ); },
-                         mLoopExportMode );  
+  auto size = mRenderSize = renderSize();
+  mRenderThread.post( [this, size] {
+    mFboPool.setBudget( size_t( GPU_MEMORY_BUDGET_MB ) << 20 );
+    mMultipassShader.setFboPool( &mFboPool );
+    mMultipassShader.setShaderCompiler( &mShaderCompiler );
+    mMultipassShader.init( size.x, 
+                           size.y,
+                           [this] ( gl::GlslProgRef shader ) { bindUniforms( shader ); },
+                           mLoopExportMode );  
+    mNoiseTextures.load();
+    mNoiseTextures.bind( mMultipassShader );
+
+    // GL State
+    gl::disableDepthRead();
+    gl::disableDepthWrite();
+    gl::disableBlending();  
+  } );
   loadCurrentPatch();
   
-  // GL State
-  gl::disableDepthRead();
-  gl::disableDepthWrite();
-  gl::disableBlending();  
-  
   mSceneIsSetup = true;
 }
 
+void CouleursApp::setupOutputs()
+{
+  // Output FBOs are allocated by the context presenting them
+  mOutputs.load( "outputs.json" );
+
+  for ( auto &output : mOutputs.get() ) {
+    if ( output->mType == SYPHON ) {
+      auto server = make_shared<syphonServer>();
+      mOutputSyphons[ output->mName ] = server;
+      mRenderThread.post( [server, output] {
+        server->setName( "Couleurs " + output->mName );
+      } );
+    }
+    else if ( output->mType == WINDOW && !mHeadlessMode ) {
+      auto window = createWindow( Window::Format().size( output->mWidth, output->mHeight ) );
+      window->setTitle( "Couleurs: " + output->mName );
+      window->getSignalDraw().connect( [this, output] {
+        gl::clear( ColorA( 0.f, 0.f, 0.f, 1.f ) );
+        if ( output->texture() ) {
+          gl::draw( output->texture(), getWindow()->getBounds() );
+        }
+      } );
+      mOutputWindows.push_back( window );
+    }
+  }
+
+  mSceneWindow->getRenderer()->makeCurrentContext();
+}
+
 void CouleursApp::setupOSC()
 {
   int numOSCChannels = 8;
@@ -210,11 +429,12 @@ void CouleursApp::setupOSC()
     mOSCIn.setListener( "/jo_ann/" + std::to_string( i ),
     [&, i]( const osc::Message &msg ){
       float value = msg[0].flt();
-      console() << "OSC Value is: " << value << endl;
+      mMetrics.count( Metrics::OSC_EVENTS );
+      LOG_D( OSC, "/jo_ann/" << i << " " << value );
       auto params = currentParams().getParametersForOSCChannel( i );      
       for ( size_t j = 0; j < params.size(); j++ ) {        
         auto param = params[j];
-        console() << "Updating param: " << param->name << endl;
+        LOG_D( OSC, "Updating param: " << param->name );
         param->currentValue = lerp( param->min, param->max, value );  
       }
     });    
@@ -243,43 +463,47 @@ void CouleursApp::setupMidi()
 {
   if ( mAbletonMidiIn.getNumPorts() > 0 ) {    
     mAbletonMidiIn.openPort( 0 );
-    cout << "Opening MIDI port 0" << endl;
+    LOG_I( MIDI, "Opening MIDI port 0" );
     mAbletonMidiIn.midiSignal.connect( bind( &CouleursApp::abletonMidiListener, this, placeholders::_1 ) );
   }
   else {
-    cout << "No MIDI ports found" << endl;
+    LOG_W( MIDI, "No MIDI ports found" );
   }
     
   if ( mControllerMidiIn.getNumPorts() > MIDI_CONTROLLER_PORT ) {
     mControllerMidiIn.openPort( MIDI_CONTROLLER_PORT );
-    cout << "Opening MIDI port " << MIDI_CONTROLLER_PORT << endl;
+    LOG_I( MIDI, "Opening MIDI port " << MIDI_CONTROLLER_PORT );
     mControllerMidiIn.midiSignal.connect( bind( &CouleursApp::controllerMidiListener, this, placeholders::_1 ) );
   }
   else {
-    cout << "No MIDI ports found" << endl;
+    LOG_W( MIDI, "No MIDI ports found" );
   }
 }
 
 void CouleursApp::controllerMidiListener( midi::Message msg )
 {
+  mMetrics.count( Metrics::MIDI_EVENTS );
   auto param = currentParams().getParameterForMidiNumber( msg.control );
   if ( param != nullptr ) {
-    console() << "found param: " << param->name << endl;
+    LOG_D( MIDI, "found param: " << param->name );
     param->currentValue = lmap( (float)msg.value, 0.f, 127.f, param->min, param->max );
   }
-  console() << "msg value: " << msg.value << " || control: " << msg.control << " || channel: " << msg.channel << endl;
+  LOG_D( MIDI, "msg value: " << msg.value << " || control: " << msg.control << " || channel: " << msg.channel );
 }
 
 void CouleursApp::abletonMidiListener( midi::Message msg )
 {
+  if ( msg.status != MIDI_TIME_CLOCK ) {
+    mMetrics.count( Metrics::MIDI_EVENTS );
+  }
   switch ( msg.status ) {
     case MIDI_START:
-      console() << "MIDI START" << endl;
+      LOG_I( MIDI, "MIDI START" );
       mTimer.stop();
       mTimer.start();
       break;
     case MIDI_STOP:
-      console() << "MIDI STOP" << endl;
+      LOG_I( MIDI, "MIDI STOP" );
       mTimer.stop();
       mTimer.start();
       break;
@@ -290,38 +514,265 @@ void CouleursApp::abletonMidiListener( midi::Message msg )
 
 void CouleursApp::resizeScene() 
 {
-  auto w = mHeadlessMode ? HEADLESS_WIDTH : toPixels( mSceneWindow->getWidth() );
-  auto h = mHeadlessMode ? HEADLESS_HEIGHT : toPixels( mSceneWindow->getHeight() );
-  mMultipassShader.resize( w, h );
+  // Dragging the window fires dozens of these, update() applies the last one once it settles
+  mResizeTime = getElapsedSeconds();
+  mResizePending = true;
+}
+
+void CouleursApp::applyResize()
+{
+  mResizePending = false;
+  auto size = mRenderSize = renderSize();
+  mRenderThread.post( [this, size] {
+    mMultipassShader.resize( size.x, size.y );
+    // Targets of the old size would only pile up
+    mFboPool.clear();
+    reportShaderStatus();
+  } );
+}
+
+ivec2 CouleursApp::renderSize()
+{
+  if ( mHeadlessMode ) {
+    return ivec2( HEADLESS_WIDTH, HEADLESS_HEIGHT );
+  }
+  else if ( mOutputs.hasMasterSize() ) {
+    return mOutputs.masterSize();
+  }
+  return toPixels( mSceneWindow->getSize() );
 }
 
 void CouleursApp::initShaderWatching() 
 {
   vector<fs::path> shaderPaths;
   auto patchPath = currentPatch().path();
+  if ( getAssetPath( patchPath ).empty() ) {
+    return;
+  }
   for ( auto &p: boost::filesystem::directory_iterator( getAssetPath( patchPath ) ) ) {
     auto extension = p.path().extension();
-    if ( extension == ".frag" || extension == ".glsl" ) {
-      console() << p.path().filename() << endl;
+    if ( extension == ".frag" || extension == ".glsl" || extension == ".comp" || extension == ".vert" ) {
+      LOG_D( SHADER, "Watching " << p.path().filename() );
       auto assetPath = patchPath / p.path().filename();
       shaderPaths.push_back( getAssetPath( assetPath ) );
     }
   }  
 
   FileWatcher::instance().watch( shaderPaths, [this]( const WatchEvent &event ) {
-    console() << "Shader needs reload" << std::endl;      
-    mMultipassShader.reload();    
+    LOG_I( SHADER, "Shader needs reload" );
+    mRenderThread.post( [this] {
+      Timer timer( true );
+      mMultipassShader.reload();    
+      mMetrics.count( Metrics::SHADER_LOADS );
+      mMetrics.set( Metrics::SHADER_LOAD_SECONDS, timer.getSeconds() );
+      reportShaderStatus();
+    } );
  	} );
 }
 
 void CouleursApp::loadCurrentPatch()
 {
-  mMultipassShader.load( currentPatch().path() );
+  // Loading unfreezes everything
+  for ( auto &param : currentParams().get() ) {
+    param->frozen = false;
+  }
+  mParameterBlock.describe( currentParams() );
+  auto bundle = currentPatch().bundle();
+  auto path = currentPatch().path();
+  mRenderThread.post( [this, bundle, path] {
+    Timer timer( true );
+    if ( bundle ) {
+      mMultipassShader.load( bundle );
+    }
+    else {
+      mMultipassShader.load( path );
+    }
+    mMetrics.count( Metrics::SHADER_LOADS );
+    mMetrics.set( Metrics::SHADER_LOAD_SECONDS, timer.getSeconds() );
+    reportShaderStatus();
+  } );
+}
+
+void CouleursApp::renderThumbnails()
+{
+  // On their own thread and context, the render thread never compiles them
+  auto stale = mCatalog.staleThumbnails();
+  if ( stale.empty() ) return;
+
+  fs::create_directories( PatchCatalog::thumbnailPath( "" ).parent_path() );
+  if ( !mThumbnailRenderer.isRunning() ) {
+    mThumbnailRenderer.start( [this] ( const string &name ) {
+      dispatchAsync( [this, name] {
+        mCatalog.setThumbnailRendered( name );
+        mCatalog.save();
+        mThumbnails.erase( name );
+      } );
+    } );
+  }
+  for ( auto &name : stale ) {
+    mThumbnailRenderer.render( name );
+  }
+}
+
+gl::Texture2dRef CouleursApp::thumbnail( const string &name )
+{
+  auto it = mThumbnails.find( name );
+  if ( it != mThumbnails.end() ) {
+    return it->second;
+  }
+
+  gl::Texture2dRef texture;
+  auto path = PatchCatalog::thumbnailPath( name );
+  if ( fs::exists( path ) ) {
+    try {
+      texture = gl::Texture2d::create( loadImage( path ) );
+    }
+    catch ( const std::exception &e ) {
+      CI_LOG_W( "Cannot read thumbnail " << path << ": " << e.what() );
+    }
+  }
+  mThumbnails[ name ] = texture;
+  return texture;
+}
+
+void CouleursApp::reportShaderStatus()
+{
+  // Called on the render thread, the UI reads its own copy
+  bool failed = mMultipassShader.mShaderCompilationFailed;
+  string message = mMultipassShader.mShaderCompileErrorMessage;
+  auto fusion = mMultipassShader.fusion();
+  auto textures = mMultipassShader.textures();
+  dispatchAsync( [this, failed, message, fusion, textures] {
+    // Once per error, the Debug window keeps showing it
+    if ( failed && ( !mShaderCompilationFailed || message != mShaderCompileErrorMessage ) ) {
+      LOG_E( SHADER, message );
+    }
+    mShaderCompilationFailed = failed;
+    mShaderCompileErrorMessage = message;
+    mFusion = fusion;
+    mPatchTextures = textures;
+  } );
+  reportMemoryUse();
+}
+
+void CouleursApp::reportMemoryUse()
+{
+  // Render thread, like reportShaderStatus()
+  auto use = mMultipassShader.memoryUse();
+  size_t poolBytes = mFboPool.allocatedBytes();
+  dispatchAsync( [this, use, poolBytes] {
+    mMemoryUse = use;
+    mPoolBytes = poolBytes;
+  } );
+}
+
+void CouleursApp::reportPassTimes()
+{
+  // Render thread, like reportShaderStatus()
+  auto times = mMultipassShader.passTimes();
+  bool frozen = mMultipassShader.isFrozen();
+  bool freezing = mMultipassShader.isFreezing();
+  double seconds = mMultipassShader.mFreezeSeconds;
+  vector<pair<string, float>> passes;
+  for ( auto &time : times ) {
+    passes.push_back( { time.name, frozen ? time.frozen : time.generic } );
+  }
+  mMetrics.setPassTimes( passes );
+  mMetrics.set( Metrics::FREEZE_COMPILE_SECONDS, seconds );
+  dispatchAsync( [this, times, frozen, freezing, seconds] {
+    mPassTimes = times;
+    mProgramsFrozen = frozen;
+    mProgramsFreezing = freezing;
+    mFreezeSeconds = seconds;
+  } );
+}
+
+void CouleursApp::startMetrics()
+{
+  try {
+    mMetricsSender = make_unique<osc::SenderUdp>( 0, METRICS_HOST, METRICS_PORT, asio::ip::udp::v4(), mMetricsService );
+    mMetricsSender->bind();
+  }
+  catch ( const std::exception &e ) {
+    CI_LOG_E( "No metrics over OSC: " << e.what() );
+    mMetricsSender = nullptr;
+  }
+  auto folder = getHomeDirectory() / CACHE_FOLDER;
+  mMetrics.start( folder / "couleurs.prom", folder / "frame_drops.log", [this] ( const Metrics::Snapshot &snapshot ) {
+    sendMetrics( snapshot );
+  } );
+}
+
+void CouleursApp::sendMetrics( const Metrics::Snapshot &snapshot )
+{
+  // Metrics thread: one bundle per interval, addresses under /couleurs/metrics
+  if ( !mMetricsSender ) return;
+  auto message = [] ( const string &name ) { return osc::Message( "/couleurs/metrics/" + name ); };
+  osc::Bundle bundle;
+  auto frames = message( "frames" );
+  frames.append( (int32_t)snapshot.frames );
+  frames.append( (int32_t)snapshot.late );
+  frames.append( (int32_t)snapshot.dropped );
+  bundle.append( frames );
+  auto render = message( "render_ms" );
+  render.append( snapshot.renderMean );
+  render.append( snapshot.renderP99 );
+  render.append( snapshot.renderMax );
+  bundle.append( render );
+  auto interval = message( "interval_ms" );
+  interval.append( snapshot.intervalMean );
+  interval.append( snapshot.intervalMax );
+  bundle.append( interval );
+  for ( auto counter : { Metrics::MIDI_EVENTS, Metrics::OSC_EVENTS } ) {
+    auto rate = message( string( Metrics::counterName( counter ) ) + "_rate" );
+    rate.append( snapshot.rates[ counter ] );
+    bundle.append( rate );
+  }
+  for ( int i = 0; i < Metrics::GAUGE_COUNT; i++ ) {
+    auto gauge = message( Metrics::gaugeName( (Metrics::Gauge)i ) );
+    gauge.append( (float)snapshot.gauges[i] );
+    bundle.append( gauge );
+  }
+  for ( auto &pass : snapshot.passes ) {
+    auto gpu = message( "pass_ms" );
+    gpu.append( pass.first );
+    gpu.append( pass.second );
+    bundle.append( gpu );
+  }
+  mMetricsSender->send( bundle );
+
+  // Completes the send on this thread
+  mMetricsService.reset();
+  mMetricsService.poll();
+}
+
+void CouleursApp::packPatches( const vector<string> &names )
+{
+  // No names: pack every patch folder
+  auto patchesPath = getAssetPath( "patches" );
+  vector<string> patchNames = names;
+  if ( patchNames.empty() ) {
+    for ( auto &p: boost::filesystem::directory_iterator( patchesPath ) ) {
+      if ( boost::filesystem::is_directory( p.path() ) ) {
+        patchNames.push_back( p.path().filename().string() );
+      }
+    }
+  }
+
+  for ( auto &name : patchNames ) {
+    try {
+      PatchBundle::write( name, patchesPath / ( name + PATCH_BUNDLE_EXTENSION ) );
+    }
+    catch ( const std::exception &e ) {
+      CI_LOG_E( "Failed to pack " << name << ": " << e.what() );
+    }
+  }
 }
 
 void CouleursApp::fileDrop( FileDropEvent event )
 {
   auto path = event.getFile( 0 );
+  unfreezeParams();
   currentParams().load( path );
 }
 
@@ -336,7 +787,7 @@ void CouleursApp::keyDown( KeyEvent event )
     saveParams();
   }
   else if ( event.getCode() == KeyEvent::KEY_f ) {
-    exportFrame( to_string( getElapsedSeconds() ), true );
+    postExportFrame( to_string( getElapsedSeconds() ) );
   }
   else if ( event.getCode() == KeyEvent::KEY_r ) {
     resetParams();
@@ -353,7 +804,7 @@ void CouleursApp::keyDown( KeyEvent event )
   else if ( event.getCode() == KeyEvent::KEY_SPACE ) {    
     auto anims = currentParams().getAnimationsForMidiNumber( -1 );
     for ( size_t i = 0; i < anims.size(); i++ ) {      
-      anims[i]->trigger();
+      anims[i]->trigger( mFrameTime );
     }
   }
   else if ( event.getCode() == KeyEvent::KEY_p ) {
@@ -373,37 +824,118 @@ void CouleursApp::keyDown( KeyEvent event )
 }
 
 void CouleursApp::exportFrame( string suffix, bool exportParams )
+{
+  // Main thread, with the render thread stopped
+  auto path = string( getenv( "HOME" ) ) + string( "/Desktop/screenshot_" ) + currentPatch().name() + string("_") + suffix;
+  JsonTree params;
+  if ( exportParams ) {
+    params = currentParams().toJson();
+  }
+  writeExport( path, exportParams ? &params : nullptr );
+}
+
+void CouleursApp::postExportFrame( string suffix )
+{
+  // The patch and its values are read here, the render thread only reads back its FBOs
+  auto path = string( getenv( "HOME" ) ) + string( "/Desktop/screenshot_" ) + currentPatch().name() + string("_") + suffix;
+  auto params = currentParams().toJson();
+  mRenderThread.post( [this, path, params] () mutable { writeExport( path, &params ); } );
+}
+
+void CouleursApp::writeExport( const string &path, JsonTree *params )
 {
   CI_LOG_I( "Saving screenshot" );
-  const char *homeDir = getenv( "HOME" );
-  auto path = string( homeDir ) + string( "/Desktop/screenshot_" ) + currentPatch().name() + string("_") + suffix;
   auto surface = Surface8u( mMultipassShader.mMainFbo->getColorTexture()->createSource() );    
   writeImage( path + string( ".png" ), surface );
 
-  if ( exportParams ) {
-    currentParams().writeTo( path + string( ".json" ) );
+  if ( params ) {
+    params->write( path + string( ".json" ) );
+  }
+
+  for ( auto &output : mOutputs.get() ) {
+    if ( output->mType == OFFSCREEN ) {
+      writeImage( path + string( "_" ) + output->mName + string( ".png" ), Surface8u( output->texture()->createSource() ) );
+    }
   }
 }
 
 void CouleursApp::resetParams()
 {
   CI_LOG_I( "Resetting params" );
+  unfreezeParams();
   currentParams().reload();
 }
 
+void CouleursApp::freezeParams()
+{
+  // Every frozen parameter at once, the new programs replace the previous ones
+  map<string, float> values;
+  for ( auto &param : currentParams().get() ) {
+    if ( param->frozen ) {
+      param->frozenValue = param->currentValue;
+      values[ param->name ] = param->frozenValue;
+    }
+  }
+  mRenderThread.post( [this, values] { mMultipassShader.freeze( values ); } );
+}
+
+void CouleursApp::unfreezeParam( Parameter &param )
+{
+  if ( !param.frozen ) return;
+  param.frozen = false;
+  auto name = param.name;
+  mRenderThread.post( [this, name] { mMultipassShader.unfreeze( name ); } );
+}
+
+void CouleursApp::unfreezeParams()
+{
+  for ( auto &param : currentParams().get() ) {
+    param->frozen = false;
+  }
+  mRenderThread.post( [this] { mMultipassShader.unfreezeAll(); } );
+}
+
 void CouleursApp::saveParams()
 {
   CI_LOG_I( "Saving config file" );
   currentParams().save();
 }
 
+void CouleursApp::cleanup()
+{
+  // Before any member the render thread uses is destroyed
+  mRenderThread.stop();
+  mShaderCompiler.stop();
+  mThumbnailRenderer.stop();
+  mAudio.stop();
+  mMetrics.stop();
+
+  // An interrupted loop export still closes its file
+  mLoopEncoder.reset();
+
+  // Last, with whatever the rings still hold
+  log::manager()->restoreToDefault();
+  AsyncLog::instance().stop();
+}
+
 void CouleursApp::update()
 {
+  // The scene window swapped since the last update(): the closest the CPU
+  // gets to seeing the frame presented
+  if ( mPendingPresentTime >= 0 ) {
+    mFrameClock.presented( mPendingPresentTime, mPendingRenderSeconds );
+    mPendingPresentTime = -1;
+  }
   // updateOSC();
+  if ( mResizePending && getElapsedSeconds() - mResizeTime > RESIZE_SETTLE_SECONDS ) {
+    applyResize();
+  }
+  beginFrame();
   updateUI();
   updateTimer();
   updateParams();
   updateCamera();
+  publishFrameState();
 }
 
 // void CouleursApp::updateOSC()
@@ -428,7 +960,7 @@ void CouleursApp::updateUI()
         saveParams();
       }   
       if ( ui::MenuItem( "Export Window Res")) {
-        exportFrame( to_string( getElapsedSeconds() ), true );
+        postExportFrame( to_string( getElapsedSeconds() ) );
       }
       if ( ui::MenuItem( "Export Headless Res")) {
         if (mHeadlessMode) {
@@ -454,6 +986,17 @@ void CouleursApp::updateUI()
       ui::ScopedId scopedId( id );
       ui::SliderFloat( param->name.c_str(), &param->currentValue, param->min, param->max, "%.3f" );
       ui::SameLine();
+      bool frozen = param->frozen;
+      if ( ui::Checkbox( "Freeze", &frozen ) ) {
+        if ( frozen ) {
+          param->frozen = true;
+          freezeParams();
+        }
+        else {
+          unfreezeParam( *param );
+        }
+      }
+      ui::SameLine();
  
       if ( ui::Button( "Mod" ) ) {
         if ( !param->hasModulator() ) {
@@ -487,6 +1030,18 @@ void CouleursApp::updateUI()
       id++;
     }
 
+    // Stable: nothing but a person moves them
+    if ( ui::Button( "Freeze stable" ) ) {
+      for ( auto &param : params ) {
+        param->frozen = param->frozen || ( !param->hasModulator() && param->animations.empty() );
+      }
+      freezeParams();
+    }
+    ui::SameLine();
+    if ( ui::Button( "Unfreeze all" ) ) {
+      unfreezeParams();
+    }
+
     auto colorParams = currentParams().getColors();
     for (auto it = colorParams.begin(); it != colorParams.end(); it++ ) {
       auto colorParam = *it;
@@ -498,6 +1053,10 @@ void CouleursApp::updateUI()
     ui::ScopedWindow win( "Patches" );
     for ( int i = 0; i < mPerformance.numPatches(); i++ ) {
       auto patchName = mPerformance.patchNameAtIndex( i );
+      if ( auto texture = thumbnail( patchName ) ) {
+        ui::Image( texture, vec2( THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT ) / 2.f );
+        ui::SameLine();
+      }
       if ( i == mPerformance.currentPatchIndex() ) {
         ui::TextColored( ImVec4( 0.914, 0.392, 0.588, 1.f ), patchName.c_str(), i );
       }
@@ -505,13 +1064,148 @@ void CouleursApp::updateUI()
         ui::Text( patchName.c_str(), i );
       }
     }
+    if ( ui::Button( "Save setlist" ) ) {
+      mPerformance.writeSetlist( mSetlistName );
+    }
+  }
+
+  {
+    ui::ScopedWindow win( "Catalog" );
+    ui::Text( "%d patches, %d rescanned in %.1f ms", (int)mCatalog.patches().size(), mCatalog.mParsedCount, mCatalog.mScanSeconds * 1000. );
+    for ( auto &info : mCatalog.patches() ) {
+      ui::PushID( info.name.c_str() );
+      if ( ui::SmallButton( "+" ) ) {
+        mPerformance.add( info.name );
+      }
+      ui::SameLine();
+      ui::Text( "%s", info.name.c_str() );
+      if ( ui::IsItemHovered() ) {
+        ui::BeginTooltip();
+        if ( auto texture = thumbnail( info.name ) ) {
+          ui::Image( texture, vec2( THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT ) );
+        }
+        ui::Text( "%d buffers%s%s, %d uniforms, %d textures, %d includes", info.bufferCount, info.compute ? ", compute" : "", info.instanced ? ", instanced" : "",
+                  (int)info.uniforms.size(), (int)info.textures.size(), (int)info.includes.size() );
+        ui::EndTooltip();
+      }
+      ui::PopID();
+    }
   }
 
   {
     ui::ScopedWindow win( "Perf" );
     ui::Text( "FPS: %d", (int)getAverageFps() );
+    if ( mRenderThread.isRunning() ) {
+      ui::Text( "Render thread: %.2f ms, %d late frames", mRenderThread.mFrameMilliseconds.load(), mRenderThread.mLateFrames.load() );
+    }
+    ui::Text( "Present interval: %.2f ms, jitter %.2f ms", mFrameClock.presentInterval() * 1000., mFrameClock.intervalJitterMilliseconds() );
+    ui::Text( "Pacing error at swap: %.2f ms, max %.2f ms", mFrameClock.predictionErrorMilliseconds(), mFrameClock.maxPredictionErrorMilliseconds() );
+    ui::SameLine();
+    if ( ui::SmallButton( "Reset" ) ) {
+      mFrameClock.resetMaxPredictionError();
+    }
+    ui::Text( "Frame snapshot: %.1f us", mSnapshotMicroseconds );
+    if ( mAudio.isRunning() ) {
+      ui::Text( "Audio: %.1f ms latency + %.1f ms blocks, %.1f%% CPU", mAudio.mLatencyMilliseconds, mAudio.blockMilliseconds(), mAudio.cpuPercent() );
+    }
+    auto mb = [] ( size_t bytes ) { return bytes / ( 1024.f * 1024.f ); };
+    ui::Text( "Patch GPU memory: %.1f MB", mb( mMemoryUse.total() ) );
+    ui::Text( "  buffers %.1f MB (%d aliased), blurs %.1f MB, compute %.1f MB, textures %.1f MB",
+              mb( mMemoryUse.buffers ), mMemoryUse.aliased, mb( mMemoryUse.blurs ), mb( mMemoryUse.compute ), mb( mMemoryUse.textures ) );
+    ui::Text( "Render targets: %.1f of %d MB", mb( mPoolBytes ), GPU_MEMORY_BUDGET_MB );
+    if ( ui::Checkbox( "Fuse passes", &mFusionEnabled ) ) {
+      bool enabled = mFusionEnabled;
+      mRenderThread.post( [this, enabled] {
+        mMultipassShader.setFusion( enabled );
+        reportShaderStatus();
+      } );
+    }
+    if ( mFusion.count > 0 ) {
+      ui::Text( "Fused %s: %.1f MB less traffic per frame", mFusion.passes.c_str(), mb( mFusion.bytesPerFrame ) );
+    }
+    if ( !mFusion.error.empty() ) {
+      ui::TextColored( ImVec4( .9f, .3f, .3f, 1.f ), "Not fused: %s", mFusion.error.c_str() );
+    }
+    ui::Text( "Texture units: %d used, %d per pass at most, %d rebinds per frame", mPatchTextures.units, mPatchTextures.unitLimit, mPatchTextures.rebindsPerFrame );
+    if ( mPatchTextures.arrays > 0 ) {
+      ui::Text( "Packed %s", mPatchTextures.packed.c_str() );
+    }
+    if ( ui::SmallButton( "Measure LUTs" ) ) {
+      auto size = mRenderSize;
+      mRenderThread.post( [this, size] {
+        auto timing = LutTexture::measure( size );
+        dispatchAsync( [this, timing] { mLutTiming = timing; } );
+      } );
+    }
+    if ( mLutTiming.lut2d > 0 ) {
+      ui::SameLine();
+      ui::Text( "Grading pass: lut() %.3f ms, lut3d() %.3f ms", mLutTiming.lut2d, mLutTiming.lut3d );
+    }
+    if ( mParameterBlock.isOpen() ) {
+      ui::Text( "Parameter block %s: %u parameters, %u written by controllers", mParameterBlock.name().c_str(), mParameterBlock.entryCount(), mParameterBlock.touchedCount() );
+    }
+    ui::Text( "Programs: %s%s", mProgramsFrozen ? "frozen" : "generic", mProgramsFreezing ? ", freezing..." : "" );
+    if ( mFreezeSeconds > 0 ) {
+      ui::SameLine();
+      ui::Text( "(last freeze compiled in %.0f ms)", mFreezeSeconds * 1000. );
+    }
+    for ( auto &time : mPassTimes ) {
+      ui::Text( "  %s: %.3f ms generic, %.3f ms frozen", time.name.c_str(), time.generic, time.frozen );
+    }
+    for ( auto &output : mOutputs.get() ) {
+      ui::Text( "%s %dx%d: %.2f ms GPU, %.2f ms CPU", output->mName.c_str(), output->mWidth, output->mHeight, output->mGpuMilliseconds, output->mCpuMilliseconds );
+    }
   }
   
+  {
+    ui::ScopedWindow win( "Log" );
+    auto &log = AsyncLog::instance();
+    ui::Text( "%llu rate limited, %llu dropped", (unsigned long long)log.suppressed(), (unsigned long long)log.dropped() );
+    if ( ui::CollapsingHeader( "Levels" ) ) {
+      ui::ScopedItemWidth scopedWidth( 100 );
+      for ( int c = 0; c < AsyncLog::CATEGORY_COUNT; c++ ) {
+        auto category = (AsyncLog::Category)c;
+        int level = AsyncLog::level( category );
+        if ( ui::Combo( AsyncLog::categoryName( category ), &level, "debug\0info\0warning\0error\0off\0" ) ) {
+          AsyncLog::setLevel( category, (AsyncLog::Level)level );
+        }
+      }
+    }
+    {
+      ui::ScopedItemWidth scopedWidth( 100 );
+      ui::Combo( "Show", &mLogShownLevel, "debug\0info\0warning\0error\0" );
+    }
+
+    // Filtered again only when the history or the filter changed
+    if ( log.history( mLogRecords, mLogVersion ) || mLogLinesLevel != mLogShownLevel ) {
+      mLogLinesLevel = mLogShownLevel;
+      mLogLines.clear();
+      for ( int i = 0; i < (int)mLogRecords.size(); i++ ) {
+        if ( mLogRecords[i].level >= mLogShownLevel ) {
+          mLogLines.push_back( i );
+        }
+      }
+    }
+    ui::BeginChild( "Lines" );
+    bool atBottom = ui::GetScrollY() >= ui::GetScrollMaxY();
+    ImGuiListClipper clipper( mLogLines.size(), ui::GetTextLineHeightWithSpacing() );
+    for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ ) {
+      auto &record = mLogRecords[ mLogLines[i] ];
+      auto color = record.level == AsyncLog::LEVEL_ERROR ? ImVec4( .9f, .3f, .3f, 1.f ) : record.level == AsyncLog::LEVEL_WARNING ? ImVec4( .9f, .7f, .3f, 1.f ) : ImVec4( .85f, .87f, .92f, 1.f );
+      if ( record.repeats ) {
+        ui::TextColored( color, "%8.3f %-7s %s (x%u)", record.time, AsyncLog::categoryName( record.category ), record.text.c_str(), record.repeats + 1 );
+      }
+      else {
+        ui::TextColored( color, "%8.3f %-7s %s", record.time, AsyncLog::categoryName( record.category ), record.text.c_str() );
+      }
+    }
+    clipper.End();
+    if ( atBottom ) {
+      ui::SetScrollHere();
+    }
+    ui::EndChild();
+  }
+
   {
     ui::ScopedWindow win( "AV Sync" );
     ui::SliderInt( "Section", &mSection, 0, mNumSections - 1 );
@@ -524,28 +1218,50 @@ void CouleursApp::updateUI()
   }
   
   {
-    if ( mMultipassShader.mShaderCompilationFailed ) {
+    if ( mShaderCompilationFailed ) {
       ui::ScopedStyleColor color( ImGuiCol_TitleBgActive, ImVec4( .9f, .1f, .1f, .85f ) );
       ui::ScopedWindow win( "Debug" );      
-      ui::Text( "%s", mMultipassShader.mShaderCompileErrorMessage.c_str() );
-      console() << "Shader exception: " << mMultipassShader.mShaderCompileErrorMessage << std::endl;      
+      ui::Text( "%s", mShaderCompileErrorMessage.c_str() );
     }
   }
+
+  if ( !mLoopExportError.empty() ) {
+    ui::ScopedStyleColor color( ImGuiCol_TitleBgActive, ImVec4( .9f, .1f, .1f, .85f ) );
+    ui::ScopedWindow win( "Loop export" );
+    ui::Text( "Loop export failed: %s", mLoopExportError.c_str() );
+  }
 }
 
 void CouleursApp::updateTimer()
 {
-  double t = mTimer.getSeconds();
-  float bps = mBPM / 60.f;
+  mBeatTime = mFrameClock.isFixedStep() ? mFrameTime : mTimer.getSeconds() + mPresentLead;
+  mTick = tickAt( mBeatTime, mBPM );
+}
+
+float CouleursApp::tickAt( double t, int bpm )
+{
+  float bps = bpm / 60.f;
   float beatLengthSeconds = 1.f / bps;
-  mTick = ( fmod( t, beatLengthSeconds ) ) / beatLengthSeconds;
+  return ( fmod( t, beatLengthSeconds ) ) / beatLengthSeconds;
 }
 
 void CouleursApp::updateParams()
 {
+  // The only path from controllers to the values: what they write lands
+  // here once, then the UI, MIDI and modulators move it on, like a MIDI knob
+  if ( mParameterBlock.read( mBlockValues ) ) {
+    ParameterBlock::apply( mBlockValues, currentParams() );
+  }
+
   auto params = currentParams().get();
   for ( auto it = params.begin(); it != params.end(); it++ ) {
-    (*it)->tick( getElapsedSeconds() );
+    (*it)->tick( mFrameTime );
+
+    // Touched by MIDI, OSC, the UI or a modulator since it was frozen:
+    // back to the generic programs before this frame is published
+    if ( (*it)->frozen && (*it)->currentValue != (*it)->frozenValue ) {
+      unfreezeParam( **it );
+    }
   }
 }
 
@@ -563,20 +1279,85 @@ void CouleursApp::updateCamera()
   }
 }
 
+void CouleursApp::beginFrame()
+{
+  // Everything time-based in this frame samples the moment it will be seen,
+  // not the moment update() happened to run
+  mFrameTime = mFrameClock.predictPresentTime();
+  mPresentLead = mFrameTime - mFrameClock.now();
+  if ( !mTimeStopped ) {
+    mTime = (float)mFrameTime;
+  }
+}
+
+void CouleursApp::publishFrameState()
+{
+  // One immutable snapshot per update(), the render thread never reads app state directly
+  Timer timer( true );
+  auto &state = mRenderThread.frameStates().writeBuffer();
+  state.presentTime = mFrameTime;
+  state.presentLead = mPresentLead;
+  state.beatTime = mBeatTime;
+  state.bpm = mBPM;
+  state.timeStopped = mTimeStopped;
+  state.time = mTime;
+  state.frameNumber = mFrameClock.isFixedStep() ? (float)mFrameClock.fixedFrame() : (float)getElapsedFrames();
+  state.tick = mTick;
+  state.section = mSection;
+  state.resolution = mRenderSize;
+  state.mouse = vec2( mMousePosition.x, toPixels( mSceneWindow->getHeight() ) - mMousePosition.y );
+  state.captureParams( currentParams() );
+  state.syphonTexture = mSyphonFBO ? mSyphonFBO->getColorTexture() : nullptr;
+  state.cameraTexture = mCaptureTex;
+  mAudio.update();
+  state.audio = mAudio.features();
+  mRenderThread.frameStates().publish();
+  mSnapshotMicroseconds += ( (float)timer.getSeconds() * 1e6f - mSnapshotMicroseconds ) * .1f;
+}
+
 void CouleursApp::exportGIFFrames()	
 {	
   if ( !mLoopExportMode ) return;
 
-  if ( getElapsedFrames() <= GIF_LENGTH ) {
+  // After the frame was presented, so numbered from 1
+  auto frame = mFrameClock.fixedFrame();
+  if ( frame <= GIF_LENGTH && mLoopFormat == "png" ) {
     std::stringstream ss;
-    ss << std::setw(3) << std::setfill('0') << getElapsedFrames();    
+    ss << std::setw(3) << std::setfill('0') << frame;    
     exportFrame( ss.str(), false );
   }
-  else {
+  else if ( frame <= GIF_LENGTH ) {
+    // One animated file, encoded on its own threads while the next frames render
+    auto surface = Surface8u( mMultipassShader.mMainFbo->getColorTexture()->createSource() );
+    if ( !mLoopEncoder ) {
+      try {
+        auto format = LoopEncoder::stringToFormat( mLoopFormat );
+        auto path = string( getenv( "HOME" ) ) + "/Desktop/loop_" + currentPatch().name() + LoopEncoder::extension( format );
+        mLoopEncoder = make_unique<LoopEncoder>( path, format, surface.getWidth(), surface.getHeight(), GIF_FPS,
+                                                 LoopEncoder::stringToPalette( GIF_PALETTE ) );
+      }
+      catch ( const std::exception &e ) {
+        stopLoopExport( e.what() );
+        return;
+      }
+    }
+    mLoopEncoder->add( surface );
+    mMetrics.set( Metrics::EXPORT_QUEUE_FRAMES, mLoopEncoder->queuedFrames() );
+  }
+  if ( frame >= GIF_LENGTH ) {
+    mLoopEncoder.reset();
     quit();
   }
  }
 
+void CouleursApp::stopLoopExport( const string &error )
+{
+  // The app stays open on the error instead of quitting with nothing written
+  CI_LOG_E( "Loop export failed: " << error );
+  mLoopExportError = error;
+  mLoopExportMode = false;
+}
+
 void CouleursApp::drawUI()
 {
   gl::clear( ColorA( 0.f, 0.f, 0.05f, 1.f ) );
@@ -593,59 +1374,147 @@ void CouleursApp::drawScene()
   gl::draw( mClientSyphon.getTexture(), mSceneWindow->getBounds() );
   mSyphonFBO->unbindFramebuffer();
 
-  // Headless mode for high-resolution exports
-  if ( mSaveHeadlessScreenshot ) {
-    gl::setMatricesWindow( ivec2( HEADLESS_WIDTH, HEADLESS_HEIGHT ), true );
-    gl::pushViewport( ivec2( HEADLESS_WIDTH, HEADLESS_HEIGHT ) );
-    Rectf rect = Rectf( 0.f, 0.f, HEADLESS_WIDTH, HEADLESS_HEIGHT );
-    mMultipassShader.draw( rect, mSyphonFBO->getColorTexture(), mCaptureTex );  
-    exportFrame( to_string( getElapsedSeconds() ), true );
-    quit();
-  }
-  
-  // Draw patch  
   Rectf rect = Rectf( 0.f, 0.f, mSceneWindow->getWidth(), mSceneWindow->getHeight() );
-  mMultipassShader.draw( rect, mSyphonFBO->getColorTexture(), mCaptureTex );
-  mScreenSyphon.publishTexture( mMultipassShader.mMainFbo->getColorTexture(), false );
+  if ( mRenderThread.isRunning() ) {
+    // Preview of the newest frame from the render thread
+    auto texture = mRenderThread.acquireFrame();
+    if ( texture ) {
+      gl::draw( texture, rect );
+    }
+    double presentTime, renderSeconds;
+    if ( mRenderThread.newFrameTiming( presentTime, renderSeconds ) ) {
+      mPendingPresentTime = presentTime;
+      mPendingRenderSeconds = renderSeconds;
+    }
+    mRenderThread.releaseFrame();
+  }
+  else {
+    mRenderThread.frameStates().update();
+    auto &state = mRenderThread.frameStates().readBuffer();
+    double renderStart = mFrameClock.now();
+    renderFrame( state );
+    gl::draw( mMultipassShader.mMainFbo->getColorTexture(), rect );
+    if ( mFrameClock.isFixedStep() ) {
+      // Only counts frames, exportGIFFrames() numbers them from it
+      mFrameClock.presented( state.presentTime, 0 );
+    }
+    else {
+      mPendingPresentTime = state.presentTime;
+      mPendingRenderSeconds = mFrameClock.now() - renderStart;
+    }
+
+    // Same metrics as the render thread's, late against the app's frame rate
+    double now = mFrameClock.now(), frameDuration = 1. / getFrameRate();
+    bool late = false;
+    uint32_t dropped = 0;
+    if ( !mFrameClock.isFixedStep() && mNextInlineFrame >= 0 ) {
+      mNextInlineFrame += frameDuration;
+      late = mNextInlineFrame < now;
+      if ( late ) dropped = (uint32_t)( ( now - mNextInlineFrame ) / frameDuration );
+    }
+    if ( mNextInlineFrame < 0 || late ) mNextInlineFrame = now;
+    mMetrics.recordFrame( (float)( ( now - renderStart ) * 1000. ), late, dropped );
+
+    // Headless mode for high-resolution exports
+    if ( mSaveHeadlessScreenshot ) {
+      exportFrame( to_string( getElapsedSeconds() ), true );
+      quit();
+    }
+
+    exportGIFFrames();
+  }
 
   // Draw red rect if error
-  if ( mMultipassShader.mShaderCompilationFailed ) {
+  if ( mShaderCompilationFailed ) {
     gl::ScopedColor red( Color( 1.f, 0.f, 0.f ) );    
     float h = 20.f;
     gl::drawSolidRect( Rectf( 0.f, mSceneWindow->getHeight() - h, mSceneWindow->getWidth(), mSceneWindow->getHeight() ) );
   }  
 
-  exportGIFFrames();
-
   gl::printError( "drawScene" );
 }
 
-void CouleursApp::bindUniforms( gl::GlslProgRef shader )
+void CouleursApp::retimeFrameState( FrameState &state )
 {
-  // Common Uniforms
-  vec2 resolution = toPixels( mSceneWindow->getSize() ); 
-  shader->uniform( "u_resolution", resolution );
-  if (!mTimeStopped) {
-    mTime = (float)getElapsedSeconds();
-  }
-  shader->uniform( "u_frameNumber", (float)getElapsedFrames() );
-  shader->uniform( "u_time", mTime );
-  shader->uniform( "u_tick", mTick );
-  shader->uniform( "u_section", mSection );
-  shader->uniform( "u_mouse", vec2( mMousePosition.x, toPixels( mSceneWindow->getHeight() ) - mMousePosition.y ) );
-  
-  // Scalar Parameters
-  auto params = currentParams().get();
-  for ( auto it = params.begin(); it != params.end(); it++ ) {
-      shader->uniform( (*it)->name, (*it)->currentValue );
+  // Render thread: the moment this frame will be seen, with the snapshot's
+  // lead over the clock, so the output keeps moving when update() stalls
+  double t = mFrameClock.now() + state.presentLead;
+  state.beatTime += t - state.presentTime;
+  state.presentTime = t;
+  if ( !state.timeStopped ) {
+    state.time = (float)t;
+  }
+  state.tick = tickAt( state.beatTime, state.bpm );
+  state.frameNumber = (float)mRenderThread.mFramesRendered;
+  state.tickParams( t );
+}
+
+gl::FboRef CouleursApp::renderFrame( const FrameState &state )
+{
+  // Render thread, or the main thread when the render thread is not running
+  mAudioTexture.update( state.audio );
+  mMultipassShader.setGlobalTexture( "audioTex", mAudioTexture.texture() );
+  if ( mLoopExportMode && GIF_SAMPLES > 1 ) {
+    renderSupersampled( state );
+  }
+  else {
+    renderPasses( state );
+  }
+  mScreenSyphon.publishTexture( mMultipassShader.mMainFbo->getColorTexture(), false );
+
+  // Additional outputs: a resample / crop of the master frame each
+  mOutputs.present( mMultipassShader.mMainFbo );
+  for ( auto &output : mOutputs.get() ) {
+    if ( output->mType == SYPHON ) {
+      mOutputSyphons[ output->mName ]->publishTexture( output->texture(), false );
+    }
+  }
+
+  // Twice a second is plenty for the Perf window
+  if ( ++mPassTimeFrames % 30 == 0 ) {
+    reportPassTimes();
   }
 
-  // Color Parameters
-  auto colorParams = currentParams().getColors();
-  for ( auto it = colorParams.begin(); it != colorParams.end(); it++ ) {
-      Colorf value = (*it)->value;
-      shader->uniform( (*it)->name, vec3( value.r, value.g, value.b ) );
+  gl::printError( "renderFrame" );
+  return mMultipassShader.mMainFbo;
+}
+
+void CouleursApp::renderPasses( const FrameState &state )
+{
+  mFrameState = &state;
+  ivec2 size( state.resolution );
+  gl::ScopedViewport scopedViewport( ivec2( 0 ), size );
+  gl::ScopedMatrices scopedMatrices;
+  gl::setMatricesWindow( size, true );
+  mMultipassShader.render( Rectf( 0.f, 0.f, size.x, size.y ), state.syphonTexture, state.cameraTexture );
+}
+
+void CouleursApp::renderSupersampled( const FrameState &state )
+{
+  // Sub-frames spread over the frame interval, wrapping over the loop so
+  // the last frame blends into the first
+  double period = GIF_LENGTH / (double)GIF_FPS;
+  ivec2 size( state.resolution );
+  FrameState subframe = state;
+  mAccumulator.begin( size.x, size.y );
+  for ( int i = 0; i < GIF_SAMPLES; i++ ) {
+    double t = fmod( state.presentTime + i / (double)( GIF_SAMPLES * GIF_FPS ), period );
+    for ( auto &param : currentParams().get() ) {
+      param->tick( t );
+    }
+    subframe.captureParams( currentParams() );
+    subframe.time = (float)t;
+    subframe.tick = tickAt( t, state.bpm );
+    renderPasses( subframe );
+    mAccumulator.add( mMultipassShader.mMainFbo->getColorTexture(), 1.f / GIF_SAMPLES );
   }
+  mAccumulator.resolve( mMultipassShader.mMainFbo );
+  mFrameState = &state;
+}
+
+void CouleursApp::bindUniforms( gl::GlslProgRef shader )
+{
+  mFrameState->bind( shader, mMultipassShader.constUniforms( shader ) );
 }
 
 void CouleursApp::clearFBO( gl::FboRef fbo ) 
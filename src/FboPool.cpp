@@ -0,0 +1,143 @@
+#include "FboPool.h"
+#include "cinder/Exception.h"
+#include <algorithm>
+
+using namespace ci;
+using namespace std;
+
+static string megabytes( size_t bytes )
+{
+    return to_string( ( bytes + ( 1 << 19 ) ) >> 20 ) + " MB";
+}
+
+FboPool::FboPool()
+{
+}
+
+FboPool::~FboPool()
+{
+}
+
+gl::FboRef FboPool::acquire( int width, int height, GLint internalFormat )
+{
+    auto &free = mFree[ make_tuple( width, height, internalFormat ) ];
+    if ( !free.empty() ) {
+        auto fbo = free.back();
+        free.pop_back();
+        return fbo;
+    }
+
+    size_t size = bytes( width, height, internalFormat );
+    reserve( size );
+    auto colorFormat = gl::Texture2d::Format().internalFormat( internalFormat ).immutableStorage();
+    auto fbo = gl::Fbo::create( width, height, gl::Fbo::Format().colorTexture( colorFormat ).disableDepth() );
+    mAllocations.push_back( { fbo, size } );
+    return fbo;
+}
+
+void FboPool::release( const gl::FboRef &fbo )
+{
+    if ( !fbo ) return;
+    auto format = fbo->getColorTexture()->getInternalFormat();
+    mFree[ make_tuple( fbo->getWidth(), fbo->getHeight(), format ) ].push_back( fbo );
+}
+
+gl::Texture2dRef FboPool::acquireTexture( int width, int height, GLint internalFormat )
+{
+    auto &free = mFreeTextures[ make_tuple( width, height, internalFormat ) ];
+    if ( !free.empty() ) {
+        auto texture = free.back();
+        free.pop_back();
+        return texture;
+    }
+
+    size_t size = bytes( width, height, internalFormat );
+    reserve( size );
+    auto texture = gl::Texture2d::create( width, height, gl::Texture2d::Format().internalFormat( internalFormat ).immutableStorage() );
+    mAllocations.push_back( { texture, size } );
+    return texture;
+}
+
+void FboPool::release( const gl::Texture2dRef &texture )
+{
+    if ( !texture ) return;
+    mFreeTextures[ make_tuple( texture->getWidth(), texture->getHeight(), texture->getInternalFormat() ) ].push_back( texture );
+}
+
+void FboPool::clear()
+{
+    mFree.clear();
+    mFreeTextures.clear();
+}
+
+size_t FboPool::allocatedBytes()
+{
+    // Whoever holds a resource may drop it without releasing it, it is freed then
+    mAllocations.erase( remove_if( mAllocations.begin(), mAllocations.end(), [] ( const Allocation &a ) { return a.resource.expired(); } ), mAllocations.end() );
+    size_t total = 0;
+    for ( auto &allocation : mAllocations ) {
+        total += allocation.bytes;
+    }
+    return total;
+}
+
+size_t FboPool::freeBytes() const
+{
+    size_t total = 0;
+    for ( auto &entry : mFree ) {
+        total += entry.second.size() * bytes( get<0>( entry.first ), get<1>( entry.first ), get<2>( entry.first ) );
+    }
+    for ( auto &entry : mFreeTextures ) {
+        total += entry.second.size() * bytes( get<0>( entry.first ), get<1>( entry.first ), get<2>( entry.first ) );
+    }
+    return total;
+}
+
+size_t FboPool::freeCount() const
+{
+    size_t count = 0;
+    for ( auto &entry : mFree ) {
+        count += entry.second.size();
+    }
+    for ( auto &entry : mFreeTextures ) {
+        count += entry.second.size();
+    }
+    return count;
+}
+
+size_t FboPool::bytes( int width, int height, GLint internalFormat )
+{
+    size_t pixelBytes = 4;
+    switch ( internalFormat ) {
+        case GL_R16F:    pixelBytes = 2; break;
+        case GL_RGB16F:  pixelBytes = 6; break;
+        case GL_RGBA16F: pixelBytes = 8; break;
+        case GL_RGB32F:  pixelBytes = 12; break;
+        case GL_RGBA32F: pixelBytes = 16; break;
+    }
+    return size_t( width ) * height * pixelBytes;
+}
+
+size_t FboPool::bytes( const gl::FboRef &fbo )
+{
+    return fbo ? bytes( fbo->getColorTexture() ) : 0;
+}
+
+size_t FboPool::bytes( const gl::Texture2dRef &texture )
+{
+    return texture ? bytes( texture->getWidth(), texture->getHeight(), texture->getInternalFormat() ) : 0;
+}
+
+/* Privates */
+
+void FboPool::reserve( size_t size )
+{
+    if ( mBudget == 0 || allocatedBytes() + size <= mBudget ) return;
+
+    // Unused targets go first
+    clear();
+    if ( allocatedBytes() + size > mBudget ) {
+        throw Exception( "GPU memory budget exceeded: " + megabytes( size ) + " more with " +
+                         megabytes( allocatedBytes() ) + " of " + megabytes( mBudget ) + " in use" );
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "FrameClock.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const double smoothing = .1;
+
+FrameClock::FrameClock( double nominalInterval ) : mStart( chrono::steady_clock::now() ), mInterval( nominalInterval )
+{
+}
+
+FrameClock::~FrameClock()
+{
+}
+
+double FrameClock::now() const
+{
+    return chrono::duration<double>( chrono::steady_clock::now() - mStart ).count();
+}
+
+void FrameClock::setFixedStep( double interval )
+{
+    mFixedStep = interval;
+    mFixedFrame = 0;
+    mInterval = interval;
+}
+
+double FrameClock::predictPresentTime() const
+{
+    if ( isFixedStep() ) {
+        return mFixedFrame * mFixedStep;
+    }
+
+    double t = now();
+    double lastPresent = mLastPresent;
+    if ( lastPresent < 0 ) {
+        return t;
+    }
+
+    // First present slot after the frame has had time to render
+    double interval = mInterval;
+    double ready = t + mRenderSeconds;
+    double slots = max( 1., ceil( ( ready - lastPresent ) / interval ) );
+    return lastPresent + slots * interval;
+}
+
+void FrameClock::presented( double predictedTime, double renderSeconds )
+{
+    if ( isFixedStep() ) {
+        mFixedFrame++;
+        return;
+    }
+
+    double t = now();
+    double lastPresent = mLastPresent.exchange( t );
+    mRenderSeconds = mRenderSeconds + ( renderSeconds - mRenderSeconds ) * smoothing;
+
+    double error = abs( t - predictedTime );
+    mPredictionError = mPredictionError + ( error - mPredictionError ) * smoothing;
+    if ( error > mMaxPredictionError ) {
+        mMaxPredictionError = error;
+    }
+
+    if ( lastPresent < 0 ) return;
+
+    // Stalls count as jitter but do not drag the interval estimate
+    double interval = t - lastPresent;
+    double jitter = abs( interval - mInterval );
+    mIntervalJitter = mIntervalJitter + ( jitter - mIntervalJitter ) * smoothing;
+    if ( interval < mInterval * 4. ) {
+        mInterval = mInterval + ( interval - mInterval ) * smoothing;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "cinder/gl/gl.h"
+#include "cinder/Log.h"
+#include "Utils.h"
+
+// Apart from the rest of Utils, which builds into the core library without GL
+namespace cinder {
+  namespace gl {
+    void printError(const std::string &method) {
+      GLenum errorFlag = getError();
+      if ( errorFlag != GL_NO_ERROR ) {
+        CI_LOG_E( method << " -- glGetError flag set: " << getErrorString( errorFlag ) );
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "InstancedPasses.h"
+#include "cinder/app/App.h"
+#include "cinder/Exception.h"
+#include "cinder/Utilities.h"
+#include "CounterRandom.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+InstancedPasses::InstancedPasses() {}
+InstancedPasses::~InstancedPasses() {}
+
+void InstancedPasses::load( const fs::path &vertPath, const fs::path &fragPath, bool loopMode, const ComputePasses &compute )
+{
+    // Compile everything first, a failed live reload keeps the running passes
+    auto source = loadString( app::loadAsset( vertPath ) );
+    int count = getDefineBlockCount( source, "INSTANCES_" );
+    vector<Pass> passes( std::max( count, 1 ) );
+    for ( size_t i = 0; i < passes.size(); i++ ) {
+        // Compute storage is only readable from 4.3 shaders
+        auto format = gl::GlslProg::Format().version( ComputePasses::isSupported() ? 430 : 330 )
+                                            .vertex( app::loadAsset( vertPath ) )
+                                            .fragment( app::loadAsset( fragPath ) )
+                                            .attribLocation( "a_corner", 0 )
+                                            .attribLocation( "a_random", 1 );
+        if ( count > 0 ) {
+            format = format.define( "INSTANCES_" + std::to_string( i ) );
+        }
+        if ( loopMode ) {
+            format = format.define( "LOOP" );
+        }
+        passes[i].program = gl::GlslProg::create( format );
+    }
+
+    parse( source, passes, compute );
+    for ( size_t i = 0; i < passes.size(); i++ ) {
+        createGeometry( passes[i], i );
+    }
+    mPasses = passes;
+
+    gl::printError( "InstancedPasses::load" );
+}
+
+void InstancedPasses::unload()
+{
+    mPasses.clear();
+}
+
+void InstancedPasses::draw( size_t i )
+{
+    auto &pass = mPasses[i];
+    gl::ScopedVao scopedVao( pass.vao );
+
+    // Replace is a blend that ignores the destination
+    GLenum src = pass.blend == ALPHA ? GL_SRC_ALPHA : GL_ONE;
+    GLenum dst = pass.blend == ALPHA ? GL_ONE_MINUS_SRC_ALPHA : ( pass.blend == ADD ? GL_ONE : GL_ZERO );
+    gl::ScopedBlend scopedBlend( src, dst );
+
+    if ( pass.points ) {
+        glEnable( GL_PROGRAM_POINT_SIZE );
+        gl::drawArraysInstanced( GL_POINTS, 0, 1, pass.count );
+        glDisable( GL_PROGRAM_POINT_SIZE );
+    }
+    else {
+        gl::drawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, pass.count );
+    }
+    gl::printError( "drawArraysInstanced" );
+}
+
+/* Privates */
+
+void InstancedPasses::parse( const std::string &source, vector<Pass> &passes, const ComputePasses &compute )
+{
+    for ( auto &pragma : getPatchDirectives( source ) ) {
+        auto &args = pragma.args;
+        try {
+            if ( pragma.name != "instances" || args.size() < 2 ) {
+                throw Exception( "unknown directive" );
+            }
+            size_t index = stoul( args[0] );
+            if ( index >= passes.size() ) {
+                throw Exception( "unknown pass " + args[0] );
+            }
+
+            Pass &pass = passes[index];
+            bool isNumber = args[1].find_first_not_of( "0123456789" ) == std::string::npos;
+            pass.count = isNumber ? stoul( args[1] ) : compute.storageCount( args[1] );
+            if ( pass.count == 0 ) {
+                throw Exception( "no instances in " + args[1] );
+            }
+
+            // Options in any order
+            for ( size_t a = 2; a < args.size(); a++ ) {
+                auto &option = args[a];
+                if ( option == "main" ) pass.target = -1;
+                else if ( option.compare( 0, 6, "buffer" ) == 0 ) pass.target = stoi( option.substr( 6 ) );
+                else if ( option == "quads" ) pass.points = false;
+                else if ( option == "points" ) pass.points = true;
+                else if ( option == "add" ) pass.blend = ADD;
+                else if ( option == "alpha" ) pass.blend = ALPHA;
+                else if ( option == "replace" ) pass.blend = REPLACE;
+                else throw Exception( "unknown option " + option );
+            }
+        }
+        catch ( const std::logic_error & ) {
+            throw Exception( "Bad #pragma couleurs line: " + pragma.line );
+        }
+        catch ( const Exception &exc ) {
+            throw Exception( "Bad #pragma couleurs line: " + pragma.line + " (" + exc.what() + ")" );
+        }
+    }
+
+    for ( size_t i = 0; i < passes.size(); i++ ) {
+        if ( passes[i].count == 0 ) {
+            throw Exception( "Instanced pass " + std::to_string( i ) + " has no #pragma couleurs instances" );
+        }
+    }
+}
+
+void InstancedPasses::createGeometry( Pass &pass, size_t index )
+{
+    if ( !mCorners ) {
+        const vec2 corners[] = { vec2( -1, -1 ), vec2( 1, -1 ), vec2( -1, 1 ), vec2( 1, 1 ) };
+        mCorners = gl::Vbo::create( GL_ARRAY_BUFFER, sizeof( corners ), corners, GL_STATIC_DRAW );
+    }
+
+    // Same values for a given pass and instance on every load and machine
+    vector<vec4> randoms( pass.count );
+    for ( size_t i = 0; i < randoms.size(); i++ ) {
+        for ( int k = 0; k < 4; k++ ) {
+            randoms[i][k] = CounterRandom::uniform( index, i, k );
+        }
+    }
+    pass.randoms = gl::Vbo::create( GL_ARRAY_BUFFER, randoms.size() * sizeof( vec4 ), randoms.data(), GL_STATIC_DRAW );
+
+    pass.vao = gl::Vao::create();
+    gl::ScopedVao scopedVao( pass.vao );
+    {
+        gl::ScopedBuffer scopedBuffer( mCorners );
+        gl::enableVertexAttribArray( 0 );
+        gl::vertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 0, nullptr );
+    }
+    gl::ScopedBuffer scopedBuffer( pass.randoms );
+    gl::enableVertexAttribArray( 1 );
+    gl::vertexAttribPointer( 1, 4, GL_FLOAT, GL_FALSE, 0, nullptr );
+    gl::vertexAttribDivisor( 1, 1 );
+}
\ No newline at end of file
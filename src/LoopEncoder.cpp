@@ -0,0 +1,653 @@
+#include "LoopEncoder.h"
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <zlib.h>
+
+using namespace ci;
+using namespace std;
+
+#define TRANSPARENT_INDEX 255
+
+// f( band, firstRow, endRow ) on every core, band 0 on the calling thread
+static void parallelBands( int rows, const function<void ( int, int, int )> &f )
+{
+    int bands = max( 1, min( rows, (int)thread::hardware_concurrency() ) );
+    vector<future<void>> futures;
+    for ( int band = 1; band < bands; band++ ) {
+        futures.push_back( async( launch::async, f, band, rows * band / bands, rows * ( band + 1 ) / bands ) );
+    }
+    f( 0, 0, rows / bands );
+    for ( auto &future : futures ) {
+        future.get();
+    }
+}
+
+static void put16le( vector<uint8_t> &out, uint32_t v )
+{
+    out.push_back( v & 0xff );
+    out.push_back( ( v >> 8 ) & 0xff );
+}
+
+static void put16be( vector<uint8_t> &out, uint32_t v )
+{
+    out.push_back( ( v >> 8 ) & 0xff );
+    out.push_back( v & 0xff );
+}
+
+static void put32be( vector<uint8_t> &out, uint32_t v )
+{
+    for ( int shift = 24; shift >= 0; shift -= 8 ) {
+        out.push_back( ( v >> shift ) & 0xff );
+    }
+}
+
+LoopEncoder::LoopEncoder( const fs::path &path, Format format, int width, int height, float fps, Palette palette )
+    : mPath( path ), mFormat( format ), mPaletteMode( palette ), mWidth( width ), mHeight( height ), mFps( fps )
+{
+    mFile.open( path.string(), ios::binary | ios::trunc );
+    if ( !mFile ) {
+        throw Exception( "Cannot write " + path.string() );
+    }
+    mThread = thread( &LoopEncoder::run, this );
+}
+
+LoopEncoder::~LoopEncoder()
+{
+    finish();
+}
+
+void LoopEncoder::add( const Surface8u &frame )
+{
+    if ( frame.getWidth() != mWidth || frame.getHeight() != mHeight ) {
+        CI_LOG_E( "Frame of " << frame.getWidth() << "x" << frame.getHeight() << " for a " << mWidth << "x" << mHeight << " loop, skipped" );
+        return;
+    }
+
+    // Packed rgb, top row first
+    vector<uint8_t> rgb( mWidth * mHeight * 3 );
+    int inc = frame.getPixelInc();
+    int r = frame.getRedOffset(), g = frame.getGreenOffset(), b = frame.getBlueOffset();
+    for ( int y = 0; y < mHeight; y++ ) {
+        const uint8_t *src = frame.getData() + y * frame.getRowBytes();
+        uint8_t *dst = &rgb[ y * mWidth * 3 ];
+        for ( int x = 0; x < mWidth; x++, src += inc, dst += 3 ) {
+            dst[0] = src[r];
+            dst[1] = src[g];
+            dst[2] = src[b];
+        }
+    }
+
+    unique_lock<mutex> lock( mMutex );
+    mQueueChanged.wait( lock, [this] { return mQueue.size() < LOOP_ENCODER_QUEUE; } );
+    mQueue.push_back( move( rgb ) );
+    mStats.framesAdded++;
+    mQueueChanged.notify_all();
+}
+
+void LoopEncoder::finish()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        if ( mFinished ) return;
+        mFinishing = true;
+        mFinished = true;
+    }
+    mQueueChanged.notify_all();
+    if ( mThread.joinable() ) {
+        mThread.join();
+    }
+
+    if ( mFormat == GIF ) {
+        if ( !mHasCanvas ) {
+            writeGifHeader();
+        }
+        write( { 0x3b } );
+    }
+    else {
+        if ( !mHasCanvas ) {
+            writeApngHeader();
+        }
+        writeChunk( "IEND", {} );
+
+        // The frame count was unknown when acTL was written
+        vector<uint8_t> acTL = { 'a', 'c', 'T', 'L' };
+        put32be( acTL, mStats.framesWritten );
+        put32be( acTL, 0 );
+        vector<uint8_t> tail;
+        put32be( tail, mStats.framesWritten );
+        put32be( tail, 0 );
+        put32be( tail, crc32( 0, acTL.data(), acTL.size() ) );
+        mFile.seekp( mFrameCountPosition );
+        mFile.write( (const char *)tail.data(), tail.size() );
+    }
+    mFile.close();
+
+    auto stats = this->stats();
+    CI_LOG_I( "Encoded " << stats.framesWritten << " frames into " << mPath << ": " << stats.bytesWritten / 1024 << " KB, "
+              << stats.framesWritten / max( stats.encodeSeconds, 1e-6 ) << " frames/s, "
+              << 100. * stats.dirtyPixels / max<uint64_t>( stats.pixels, 1 ) << "% of pixels re-encoded" );
+}
+
+LoopEncoder::Stats LoopEncoder::stats()
+{
+    lock_guard<mutex> lock( mMutex );
+    return mStats;
+}
+
+int LoopEncoder::queuedFrames()
+{
+    lock_guard<mutex> lock( mMutex );
+    return mQueue.size();
+}
+
+void LoopEncoder::run()
+{
+    for ( int frame = 0; ; frame++ ) {
+        vector<uint8_t> rgb;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mQueueChanged.wait( lock, [this] { return !mQueue.empty() || mFinishing; } );
+            if ( mQueue.empty() ) return;
+            rgb = move( mQueue.front() );
+            mQueue.pop_front();
+        }
+        mQueueChanged.notify_all();
+
+        Timer timer( true );
+        if ( mFormat == GIF ) {
+            encodeGif( rgb, frame );
+        }
+        else {
+            encodeApng( rgb );
+        }
+        lock_guard<mutex> lock( mMutex );
+        mStats.encodeSeconds += timer.getSeconds();
+    }
+}
+
+LoopEncoder::Format LoopEncoder::stringToFormat( const string &formatStr )
+{
+    if ( formatStr == "gif" ) return GIF;
+    if ( formatStr == "apng" ) return APNG;
+    throw Exception( "Unknown loop format: " + formatStr );
+}
+
+LoopEncoder::Palette LoopEncoder::stringToPalette( const string &paletteStr )
+{
+    return paletteStr == "local" ? LOCAL : GLOBAL;
+}
+
+string LoopEncoder::extension( Format format )
+{
+    return format == APNG ? ".png" : ".gif";
+}
+
+void LoopEncoder::write( const vector<uint8_t> &bytes )
+{
+    mFile.write( (const char *)bytes.data(), bytes.size() );
+    lock_guard<mutex> lock( mMutex );
+    mStats.bytesWritten += bytes.size();
+}
+
+// GIF
+
+static int colorKey( int r, int g, int b )
+{
+    return ( r >> 3 ) << 10 | ( g >> 3 ) << 5 | ( b >> 3 );
+}
+
+void LoopEncoder::buildPalette( const vector<uint8_t> &rgb )
+{
+    // Histogram of at most LOOP_PALETTE_SAMPLES pixels, per band then merged
+    size_t pixels = mWidth * (size_t)mHeight;
+    size_t step = max<size_t>( 1, pixels / LOOP_PALETTE_SAMPLES );
+    int bands = max( 1, min( mHeight, (int)thread::hardware_concurrency() ) );
+    vector<vector<uint32_t>> histograms( bands, vector<uint32_t>( 32768, 0 ) );
+    parallelBands( mHeight, [&] ( int band, int y0, int y1 ) {
+        auto &histogram = histograms[ band ];
+        size_t begin = ( y0 * (size_t)mWidth + step - 1 ) / step * step;
+        for ( size_t i = begin; i < y1 * (size_t)mWidth; i += step ) {
+            histogram[ colorKey( rgb[ i * 3 ], rgb[ i * 3 + 1 ], rgb[ i * 3 + 2 ] ) ]++;
+        }
+    } );
+    vector<uint32_t> histogram( 32768, 0 );
+    vector<int> keys;
+    for ( int key = 0; key < 32768; key++ ) {
+        for ( auto &band : histograms ) {
+            histogram[ key ] += band[ key ];
+        }
+        if ( histogram[ key ] ) {
+            keys.push_back( key );
+        }
+    }
+
+    // Median cut: split the box with the most pixels times extent along its
+    // longest axis at the pixel median, until 255 boxes
+    struct Box {
+        size_t   begin, end;
+        int      axis, extent;
+        uint64_t count;
+    };
+    auto channel = [] ( int key, int axis ) { return ( key >> ( 10 - axis * 5 ) ) & 31; };
+    auto measure = [&] ( Box &box ) {
+        int lo[3] = { 31, 31, 31 }, hi[3] = { 0, 0, 0 };
+        box.count = 0;
+        for ( size_t i = box.begin; i < box.end; i++ ) {
+            for ( int axis = 0; axis < 3; axis++ ) {
+                lo[ axis ] = min( lo[ axis ], channel( keys[i], axis ) );
+                hi[ axis ] = max( hi[ axis ], channel( keys[i], axis ) );
+            }
+            box.count += histogram[ keys[i] ];
+        }
+        box.axis = 0;
+        for ( int axis = 1; axis < 3; axis++ ) {
+            if ( hi[ axis ] - lo[ axis ] > hi[ box.axis ] - lo[ box.axis ] ) box.axis = axis;
+        }
+        box.extent = hi[ box.axis ] - lo[ box.axis ];
+    };
+
+    vector<Box> boxes( 1, Box{ 0, keys.size(), 0, 0, 0 } );
+    measure( boxes[0] );
+    while ( boxes.size() < 255 ) {
+        auto box = max_element( boxes.begin(), boxes.end(), [] ( const Box &a, const Box &b ) {
+            return a.count * a.extent < b.count * b.extent;
+        } );
+        if ( box->extent == 0 ) break;
+
+        int axis = box->axis;
+        sort( keys.begin() + box->begin, keys.begin() + box->end, [&] ( int a, int b ) { return channel( a, axis ) < channel( b, axis ); } );
+        uint64_t half = 0;
+        size_t split = box->begin;
+        while ( split < box->end - 1 && ( half += histogram[ keys[ split ] ] ) < box->count / 2 ) {
+            split++;
+        }
+        split = max( split + 1, box->begin + 1 );
+        Box upper = { split, box->end, 0, 0, 0 };
+        box->end = split;
+        measure( *box );
+        measure( upper );
+        boxes.push_back( upper );
+    }
+
+    // Pixel-weighted mean of each box
+    mColors.clear();
+    for ( auto &box : boxes ) {
+        double sum[3] = { 0, 0, 0 };
+        for ( size_t i = box.begin; i < box.end; i++ ) {
+            for ( int axis = 0; axis < 3; axis++ ) {
+                sum[ axis ] += ( channel( keys[i], axis ) * 8 + 4 ) * (double)histogram[ keys[i] ];
+            }
+        }
+        for ( int axis = 0; axis < 3; axis++ ) {
+            mColors.push_back( (uint8_t)min( 255., sum[ axis ] / max<uint64_t>( box.count, 1 ) + .5 ) );
+        }
+    }
+    if ( mColors.empty() ) {
+        mColors = { 0, 0, 0 };
+    }
+
+    // Nearest palette color of every 5-5-5 color
+    int count = mColors.size() / 3;
+    mLookup.resize( 32768 );
+    parallelBands( 32, [&] ( int band, int r0, int r1 ) {
+        for ( int key = r0 << 10; key < r1 << 10; key++ ) {
+            int r = channel( key, 0 ) * 8 + 4, g = channel( key, 1 ) * 8 + 4, b = channel( key, 2 ) * 8 + 4;
+            int best = 0, bestDistance = INT32_MAX;
+            for ( int c = 0; c < count; c++ ) {
+                int dr = r - mColors[ c * 3 ], dg = g - mColors[ c * 3 + 1 ], db = b - mColors[ c * 3 + 2 ];
+                int distance = dr * dr + dg * dg + db * db;
+                if ( distance < bestDistance ) {
+                    best = c;
+                    bestDistance = distance;
+                }
+            }
+            mLookup[ key ] = best;
+        }
+    } );
+
+    // About half the distance between neighbouring palette colors
+    mDitherSpread = 128.f / cbrt( (float)count );
+}
+
+void LoopEncoder::writeGifHeader()
+{
+    vector<uint8_t> header = { 'G', 'I', 'F', '8', '9', 'a' };
+    put16le( header, mWidth );
+    put16le( header, mHeight );
+    bool global = mPaletteMode == GLOBAL && !mColors.empty();
+    header.push_back( global ? 0xf7 : 0x70 ); // 256 colors, 8 bits of color resolution
+    header.push_back( 0 );
+    header.push_back( 0 );
+    if ( global ) {
+        auto table = mColors;
+        table.resize( 768, 0 );
+        header.insert( header.end(), table.begin(), table.end() );
+    }
+
+    // NETSCAPE2.0 application extension: loop forever
+    const uint8_t loop[] = { 0x21, 0xff, 0x0b, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+    header.insert( header.end(), begin( loop ), end( loop ) );
+    write( header );
+}
+
+// LZW with 8-bit symbols, codes up to 12 bits, packed least significant bit first
+static void lzwEncode( const vector<uint8_t> &indices, vector<uint8_t> &out )
+{
+    const int clearCode = 256, maxCode = 4095;
+    vector<int32_t> keys( 8192 ), codes( 8192 );
+    uint32_t bits = 0;
+    int bitCount = 0, codeSize = 9, nextCode = clearCode + 2;
+    auto put = [&] ( int code ) {
+        bits |= code << bitCount;
+        for ( bitCount += codeSize; bitCount >= 8; bitCount -= 8 ) {
+            out.push_back( bits & 0xff );
+            bits >>= 8;
+        }
+    };
+    auto clear = [&] {
+        put( clearCode );
+        fill( keys.begin(), keys.end(), -1 );
+        codeSize = 9;
+        nextCode = clearCode + 2;
+    };
+
+    clear();
+    int prefix = indices[0];
+    for ( size_t i = 1; i < indices.size(); i++ ) {
+        int32_t key = prefix << 8 | indices[i];
+        size_t slot = ( key * 2654435761u ) >> 19;
+        while ( keys[ slot ] != -1 && keys[ slot ] != key ) {
+            slot = ( slot + 1 ) & 8191;
+        }
+        if ( keys[ slot ] == key ) {
+            prefix = codes[ slot ];
+            continue;
+        }
+
+        put( prefix );
+        prefix = indices[i];
+        if ( nextCode > maxCode ) {
+            clear();
+            continue;
+        }
+        keys[ slot ] = key;
+        codes[ slot ] = nextCode;
+        // Decoders widen codes once the table outgrows the current size
+        if ( nextCode++ == ( 1 << codeSize ) && codeSize < 12 ) {
+            codeSize++;
+        }
+    }
+    put( prefix );
+    put( clearCode + 1 );
+    if ( bitCount > 0 ) {
+        out.push_back( bits & 0xff );
+    }
+}
+
+void LoopEncoder::encodeGif( const vector<uint8_t> &rgb, int frame )
+{
+    // Delays are in centiseconds and players stretch anything under 2, so
+    // faster loops are resampled to 50 fps by dropping frames
+    float rate = min( mFps, 50.f );
+    auto slot = [&] ( int f ) { return (int)floor( f * rate / mFps + 1e-6 ); };
+    if ( frame > 0 && slot( frame ) == slot( frame - 1 ) ) return;
+    int k = slot( frame );
+    int delay = (int)lround( ( k + 1 ) * 100. / rate ) - (int)lround( k * 100. / rate );
+
+    bool newPalette = mPaletteMode == LOCAL || mColors.empty();
+    if ( newPalette ) {
+        buildPalette( rgb );
+    }
+    if ( !mHasCanvas ) {
+        writeGifHeader();
+        mCanvas.assign( rgb.size(), 0 );
+    }
+
+    // Ordered dithering keeps still areas identical from frame to frame,
+    // which error diffusion would not. Pixels that look as they already do
+    // become transparent, the rest is bounded by the dirty rectangle.
+    static const int bayer[8][8] = {
+        {  0, 32,  8, 40,  2, 34, 10, 42 }, { 48, 16, 56, 24, 50, 18, 58, 26 },
+        { 12, 44,  4, 36, 14, 46,  6, 38 }, { 60, 28, 52, 20, 62, 30, 54, 22 },
+        {  3, 35, 11, 43,  1, 33,  9, 41 }, { 51, 19, 59, 27, 49, 17, 57, 25 },
+        { 15, 47,  7, 39, 13, 45,  5, 37 }, { 63, 31, 55, 23, 61, 29, 53, 21 }
+    };
+    vector<uint8_t> indices( mWidth * mHeight );
+    int bands = max( 1, min( mHeight, (int)thread::hardware_concurrency() ) );
+    vector<Rect> dirty( bands, Rect{ mWidth, mHeight, 0, 0 } );
+    bool full = !mHasCanvas;
+    parallelBands( mHeight, [&] ( int band, int y0, int y1 ) {
+        auto &rect = dirty[ band ];
+        for ( int y = y0; y < y1; y++ ) {
+            for ( int x = 0; x < mWidth; x++ ) {
+                size_t i = y * (size_t)mWidth + x;
+                int offset = (int)( ( bayer[ y & 7 ][ x & 7 ] + .5f ) / 64.f * mDitherSpread - mDitherSpread * .5f );
+                int r = max( 0, min( 255, rgb[ i * 3 ] + offset ) );
+                int g = max( 0, min( 255, rgb[ i * 3 + 1 ] + offset ) );
+                int b = max( 0, min( 255, rgb[ i * 3 + 2 ] + offset ) );
+                int index = mLookup[ colorKey( r, g, b ) ];
+                const uint8_t *color = &mColors[ index * 3 ];
+                uint8_t *shown = &mCanvas[ i * 3 ];
+                if ( !full && shown[0] == color[0] && shown[1] == color[1] && shown[2] == color[2] ) {
+                    indices[i] = TRANSPARENT_INDEX;
+                    continue;
+                }
+                indices[i] = index;
+                shown[0] = color[0];
+                shown[1] = color[1];
+                shown[2] = color[2];
+                rect = { min( rect.x0, x ), min( rect.y0, y ), max( rect.x1, x + 1 ), max( rect.y1, y + 1 ) };
+            }
+        }
+    } );
+    mHasCanvas = true;
+
+    Rect rect = dirty[0];
+    for ( auto &band : dirty ) {
+        rect = { min( rect.x0, band.x0 ), min( rect.y0, band.y0 ), max( rect.x1, band.x1 ), max( rect.y1, band.y1 ) };
+    }
+    if ( rect.empty() ) {
+        // Nothing changed, a transparent pixel carries the delay
+        rect = { 0, 0, 1, 1 };
+        indices[0] = TRANSPARENT_INDEX;
+    }
+    int w = rect.x1 - rect.x0, h = rect.y1 - rect.y0;
+    vector<uint8_t> cropped( w * h );
+    for ( int y = 0; y < h; y++ ) {
+        copy_n( &indices[ ( rect.y0 + y ) * (size_t)mWidth + rect.x0 ], w, &cropped[ y * (size_t)w ] );
+    }
+
+    // Graphic control extension: keep the previous frame, delay, transparency
+    vector<uint8_t> out = { 0x21, 0xf9, 0x04, 0x05 };
+    put16le( out, delay );
+    out.push_back( TRANSPARENT_INDEX );
+    out.push_back( 0 );
+
+    out.push_back( 0x2c );
+    put16le( out, rect.x0 );
+    put16le( out, rect.y0 );
+    put16le( out, w );
+    put16le( out, h );
+    bool local = mPaletteMode == LOCAL;
+    out.push_back( local ? 0x87 : 0 );
+    if ( local ) {
+        auto table = mColors;
+        table.resize( 768, 0 );
+        out.insert( out.end(), table.begin(), table.end() );
+    }
+
+    vector<uint8_t> data;
+    lzwEncode( cropped, data );
+    out.push_back( 8 );
+    for ( size_t i = 0; i < data.size(); i += 255 ) {
+        size_t size = min<size_t>( 255, data.size() - i );
+        out.push_back( size );
+        out.insert( out.end(), data.begin() + i, data.begin() + i + size );
+    }
+    out.push_back( 0 );
+    write( out );
+
+    lock_guard<mutex> lock( mMutex );
+    mStats.framesWritten++;
+    mStats.pixels += mWidth * (uint64_t)mHeight;
+    mStats.dirtyPixels += w * (uint64_t)h;
+}
+
+// APNG
+
+void LoopEncoder::writeChunk( const char *type, const vector<uint8_t> &data )
+{
+    vector<uint8_t> chunk;
+    put32be( chunk, data.size() );
+    chunk.insert( chunk.end(), type, type + 4 );
+    chunk.insert( chunk.end(), data.begin(), data.end() );
+    put32be( chunk, crc32( 0, chunk.data() + 4, chunk.size() - 4 ) );
+    write( chunk );
+}
+
+void LoopEncoder::writeApngHeader()
+{
+    write( { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' } );
+    vector<uint8_t> ihdr;
+    put32be( ihdr, mWidth );
+    put32be( ihdr, mHeight );
+    ihdr.insert( ihdr.end(), { 8, 2, 0, 0, 0 } ); // 8-bit rgb, not interlaced
+    writeChunk( "IHDR", ihdr );
+
+    mFrameCountPosition = mFile.tellp() + streamoff( 8 );
+    vector<uint8_t> actl;
+    put32be( actl, 0 ); // frames, see finish()
+    put32be( actl, 0 ); // loop forever
+    writeChunk( "acTL", actl );
+}
+
+// Rows filtered with the filter of smallest absolute sum, the usual heuristic
+static void filterRow( const uint8_t *row, const uint8_t *above, int bytes, uint8_t *out )
+{
+    auto left = [&] ( int i ) { return i >= 3 ? row[ i - 3 ] : 0; };
+    auto up = [&] ( int i ) { return above ? above[i] : 0; };
+    auto upLeft = [&] ( int i ) { return above && i >= 3 ? above[ i - 3 ] : 0; };
+    auto paeth = [&] ( int i ) {
+        int a = left( i ), b = up( i ), c = upLeft( i ), p = a + b - c;
+        int pa = abs( p - a ), pb = abs( p - b ), pc = abs( p - c );
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    };
+
+    uint64_t bestSum = UINT64_MAX;
+    vector<uint8_t> candidate( bytes );
+    for ( int filter = 0; filter < 5; filter++ ) {
+        if ( filter == 3 ) continue; // average rarely wins on rendered frames
+        uint64_t sum = 0;
+        for ( int i = 0; i < bytes; i++ ) {
+            int predicted = filter == 1 ? left( i ) : filter == 2 ? up( i ) : filter == 4 ? paeth( i ) : 0;
+            candidate[i] = row[i] - predicted;
+            sum += abs( (int8_t)candidate[i] );
+        }
+        if ( sum < bestSum ) {
+            bestSum = sum;
+            out[0] = filter;
+            copy( candidate.begin(), candidate.end(), out + 1 );
+        }
+    }
+}
+
+void LoopEncoder::encodeApng( const vector<uint8_t> &rgb )
+{
+    if ( !mHasCanvas ) {
+        writeApngHeader();
+    }
+
+    int bands = max( 1, min( mHeight, (int)thread::hardware_concurrency() ) );
+    vector<Rect> dirty( bands, Rect{ mWidth, mHeight, 0, 0 } );
+    if ( mHasCanvas ) {
+        parallelBands( mHeight, [&] ( int band, int y0, int y1 ) {
+            auto &rect = dirty[ band ];
+            for ( int y = y0; y < y1; y++ ) {
+                for ( int x = 0; x < mWidth; x++ ) {
+                    size_t i = ( y * (size_t)mWidth + x ) * 3;
+                    if ( rgb[i] != mCanvas[i] || rgb[ i + 1 ] != mCanvas[ i + 1 ] || rgb[ i + 2 ] != mCanvas[ i + 2 ] ) {
+                        rect = { min( rect.x0, x ), min( rect.y0, y ), max( rect.x1, x + 1 ), max( rect.y1, y + 1 ) };
+                    }
+                }
+            }
+        } );
+    }
+    Rect rect = mHasCanvas ? dirty[0] : Rect{ 0, 0, mWidth, mHeight };
+    for ( auto &band : dirty ) {
+        rect = mHasCanvas ? Rect{ min( rect.x0, band.x0 ), min( rect.y0, band.y0 ), max( rect.x1, band.x1 ), max( rect.y1, band.y1 ) } : rect;
+    }
+    if ( rect.empty() ) {
+        // Nothing changed, the first pixel again carries the delay
+        rect = { 0, 0, 1, 1 };
+    }
+    int w = rect.x1 - rect.x0, h = rect.y1 - rect.y0;
+    int rowBytes = w * 3;
+
+    // Bands filtered and deflated in parallel, each ending on a byte-aligned
+    // sync flush so the raw streams concatenate into one zlib stream
+    int deflateBands = max( 1, min( h, bands ) );
+    vector<vector<uint8_t>> streams( deflateBands );
+    vector<uLong> checksums( deflateBands ), lengths( deflateBands );
+    parallelBands( h, [&] ( int band, int y0, int y1 ) {
+        vector<uint8_t> filtered( ( y1 - y0 ) * (size_t)( rowBytes + 1 ) );
+        for ( int y = y0; y < y1; y++ ) {
+            const uint8_t *row = &rgb[ ( ( rect.y0 + y ) * (size_t)mWidth + rect.x0 ) * 3 ];
+            const uint8_t *above = y > 0 ? row - mWidth * 3 : nullptr;
+            filterRow( row, above, rowBytes, &filtered[ ( y - y0 ) * (size_t)( rowBytes + 1 ) ] );
+        }
+        checksums[ band ] = adler32( adler32( 0, nullptr, 0 ), filtered.data(), filtered.size() );
+        lengths[ band ] = filtered.size();
+
+        z_stream stream = {};
+        deflateInit2( &stream, LOOP_APNG_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY );
+        auto &out = streams[ band ];
+        out.resize( deflateBound( &stream, filtered.size() ) + 16 );
+        stream.next_in = filtered.data();
+        stream.avail_in = filtered.size();
+        stream.next_out = out.data();
+        stream.avail_out = out.size();
+        deflate( &stream, band == deflateBands - 1 ? Z_FINISH : Z_SYNC_FLUSH );
+        out.resize( stream.total_out );
+        deflateEnd( &stream );
+    } );
+
+    // Frame control: keep the previous frame, replace the rectangle
+    vector<uint8_t> fctl;
+    put32be( fctl, mSequence++ );
+    put32be( fctl, w );
+    put32be( fctl, h );
+    put32be( fctl, rect.x0 );
+    put32be( fctl, rect.y0 );
+    put16be( fctl, 100 );
+    put16be( fctl, (int)lround( mFps * 100 ) );
+    fctl.push_back( 0 );
+    fctl.push_back( 0 );
+    writeChunk( "fcTL", fctl );
+
+    // The first frame is the default image, later ones are numbered
+    vector<uint8_t> data;
+    if ( mHasCanvas ) {
+        put32be( data, mSequence++ );
+    }
+    data.push_back( 0x78 );
+    data.push_back( 0x9c );
+    uLong checksum = adler32( 0, nullptr, 0 );
+    for ( int band = 0; band < deflateBands; band++ ) {
+        data.insert( data.end(), streams[ band ].begin(), streams[ band ].end() );
+        checksum = adler32_combine( checksum, checksums[ band ], lengths[ band ] );
+    }
+    put32be( data, checksum );
+    writeChunk( mHasCanvas ? "fdAT" : "IDAT", data );
+
+    mCanvas = rgb;
+    mHasCanvas = true;
+    lock_guard<mutex> lock( mMutex );
+    mStats.framesWritten++;
+    mStats.pixels += mWidth * (uint64_t)mHeight;
+    mStats.dirtyPixels += w * (uint64_t)h;
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "LutTexture.h"
+#include "cinder/app/App.h"
+#include "cinder/Exception.h"
+#include "cinder/Log.h"
+#include "cinder/Surface.h"
+#include "cinder/Utilities.h"
+#include "Utils.h"
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace ci;
+using namespace std;
+
+// 64^3 table stored as 8x8 tiles of 64x64
+#define LUT_TILE_SIZE 64
+#define LUT_TILES 8
+#define LUT_IMAGE_SIZE ( LUT_TILE_SIZE * LUT_TILES )
+// Draws timed per lookup in measure()
+#define LUT_MEASURE_DRAWS 20
+
+typedef decltype( fs::last_write_time( "" ) ) FileTime;
+static map<std::string, pair<FileTime, gl::Texture3dRef>> sCache;
+
+static gl::Texture3dRef findCached( const fs::path &path )
+{
+    auto it = sCache.find( path.string() );
+    if ( it != sCache.end() && it->second.first == fs::last_write_time( path ) ) {
+        return it->second.second;
+    }
+    return nullptr;
+}
+
+static gl::Texture3dRef addCached( const fs::path &path, const gl::Texture3dRef &texture )
+{
+    sCache[ path.string() ] = make_pair( fs::last_write_time( path ), texture );
+    return texture;
+}
+
+// The table over [0, 1]: each entry reads the .cube table where its color
+// falls in the domain, trilinearly, clamped at the edges like the spec says
+static vector<float> remapDomain( const vector<float> &rgb, int size, const vec3 &domainMin, const vec3 &domainMax )
+{
+    auto at = [&] ( int r, int g, int b ) {
+        const float *p = &rgb[ ( ( b * size + g ) * size + r ) * 3 ];
+        return vec3( p[0], p[1], p[2] );
+    };
+    vector<float> remapped( rgb.size() );
+    for ( int b = 0; b < size; b++ ) {
+        for ( int g = 0; g < size; g++ ) {
+            for ( int r = 0; r < size; r++ ) {
+                vec3 color = vec3( r, g, b ) / float( size - 1 );
+                vec3 p = clamp( ( color - domainMin ) / ( domainMax - domainMin ), 0.f, 1.f ) * float( size - 1 );
+                ivec3 i = min( ivec3( p ), ivec3( size - 2 ) );
+                vec3 f = p - vec3( i );
+                vec3 c00 = mix( at( i.x, i.y, i.z ), at( i.x + 1, i.y, i.z ), f.x );
+                vec3 c10 = mix( at( i.x, i.y + 1, i.z ), at( i.x + 1, i.y + 1, i.z ), f.x );
+                vec3 c01 = mix( at( i.x, i.y, i.z + 1 ), at( i.x + 1, i.y, i.z + 1 ), f.x );
+                vec3 c11 = mix( at( i.x, i.y + 1, i.z + 1 ), at( i.x + 1, i.y + 1, i.z + 1 ), f.x );
+                vec3 value = mix( mix( c00, c10, f.y ), mix( c01, c11, f.y ), f.z );
+                float *dst = &remapped[ ( ( b * size + g ) * size + r ) * 3 ];
+                dst[0] = value.x;
+                dst[1] = value.y;
+                dst[2] = value.z;
+            }
+        }
+    }
+    return remapped;
+}
+
+bool LutTexture::isLutName( const std::string &name )
+{
+    return name.compare( 0, 6, "lookup" ) == 0 || name.compare( 0, 3, "lut" ) == 0;
+}
+
+bool LutTexture::isLutSize( int width, int height )
+{
+    return width == LUT_IMAGE_SIZE && height == LUT_IMAGE_SIZE;
+}
+
+gl::Texture3dRef LutTexture::fromImage( const fs::path &path )
+{
+    if ( auto cached = findCached( path ) ) {
+        return cached;
+    }
+
+    Surface8u surface( loadImage( path ) );
+    if ( !isLutSize( surface.getWidth(), surface.getHeight() ) ) {
+        CI_LOG_W( path.filename() << " is named like a LUT but is not " << LUT_IMAGE_SIZE << "x" << LUT_IMAGE_SIZE );
+        return nullptr;
+    }
+
+    vector<uint8_t> rgba( LUT_IMAGE_SIZE * LUT_IMAGE_SIZE * 4 );
+    for ( int y = 0; y < LUT_IMAGE_SIZE; y++ ) {
+        for ( int x = 0; x < LUT_IMAGE_SIZE; x++ ) {
+            ColorA8u c = surface.getPixel( ivec2( x, y ) );
+            uint8_t *p = &rgba[ ( y * LUT_IMAGE_SIZE + x ) * 4 ];
+            p[0] = c.r;
+            p[1] = c.g;
+            p[2] = c.b;
+            p[3] = 255;
+        }
+    }
+    return addCached( path, fromTiles( rgba.data(), false ) );
+}
+
+gl::Texture3dRef LutTexture::fromTiles( const uint8_t *rgba, bool bottomUp )
+{
+    // Same addressing as lut.glsl: blue picks the tile, counted from the
+    // top left, red and green go right and down inside it
+    int size = LUT_TILE_SIZE;
+    vector<float> rgb( size * size * size * 3 );
+    for ( int b = 0; b < size; b++ ) {
+        for ( int g = 0; g < size; g++ ) {
+            for ( int r = 0; r < size; r++ ) {
+                int x = ( b % LUT_TILES ) * size + r;
+                int y = ( b / LUT_TILES ) * size + g;
+                if ( bottomUp ) {
+                    y = LUT_IMAGE_SIZE - 1 - y;
+                }
+                const uint8_t *p = &rgba[ ( y * LUT_IMAGE_SIZE + x ) * 4 ];
+                float *dst = &rgb[ ( ( b * size + g ) * size + r ) * 3 ];
+                dst[0] = p[0] / 255.f;
+                dst[1] = p[1] / 255.f;
+                dst[2] = p[2] / 255.f;
+            }
+        }
+    }
+    return create( rgb, size );
+}
+
+gl::Texture3dRef LutTexture::fromCube( const fs::path &path )
+{
+    if ( auto cached = findCached( path ) ) {
+        return cached;
+    }
+
+    ifstream file( path.string() );
+    if ( !file ) {
+        throw Exception( "Cannot read LUT: " + path.string() );
+    }
+
+    // Adobe .cube: keywords, then size^3 "r g b" lines with red varying fastest
+    int size = 0;
+    vec3 domainMin( 0.f ), domainMax( 1.f );
+    vector<float> rgb;
+    string line;
+    while ( getline( file, line ) ) {
+        istringstream stream( line );
+        string keyword;
+        if ( !( stream >> keyword ) || keyword[0] == '#' ) continue;
+
+        if ( keyword == "LUT_3D_SIZE" ) {
+            stream >> size;
+            rgb.reserve( size * size * size * 3 );
+        }
+        else if ( keyword == "DOMAIN_MIN" ) {
+            stream >> domainMin.x >> domainMin.y >> domainMin.z;
+        }
+        else if ( keyword == "DOMAIN_MAX" ) {
+            stream >> domainMax.x >> domainMax.y >> domainMax.z;
+        }
+        else if ( keyword == "LUT_1D_SIZE" ) {
+            throw Exception( "1D LUTs are not supported: " + path.string() );
+        }
+        else if ( isdigit( keyword[0] ) || keyword[0] == '-' || keyword[0] == '.' ) {
+            vec3 value;
+            istringstream values( line );
+            values >> value.x >> value.y >> value.z;
+            rgb.push_back( value.x );
+            rgb.push_back( value.y );
+            rgb.push_back( value.z );
+        }
+    }
+
+    if ( size < 2 || rgb.size() != size_t( size * size * size * 3 ) ) {
+        throw Exception( "Invalid LUT_3D_SIZE or entry count in " + path.string() );
+    }
+
+    // lut3d() looks up colors in [0, 1], other input domains are resampled onto it
+    if ( domainMin != vec3( 0.f ) || domainMax != vec3( 1.f ) ) {
+        if ( any( lessThanEqual( domainMax, domainMin ) ) ) {
+            throw Exception( "Invalid DOMAIN_MIN/MAX in " + path.string() );
+        }
+        rgb = remapDomain( rgb, size, domainMin, domainMax );
+    }
+    return addCached( path, create( rgb, size ) );
+}
+
+void LutTexture::clearCache()
+{
+    sCache.clear();
+}
+
+LutTexture::Timing LutTexture::measure( const ivec2 &size )
+{
+    // Identity table in the 2D layout, and its 3D version
+    vector<uint8_t> rgba( LUT_IMAGE_SIZE * LUT_IMAGE_SIZE * 4 );
+    for ( int y = 0; y < LUT_IMAGE_SIZE; y++ ) {
+        for ( int x = 0; x < LUT_IMAGE_SIZE; x++ ) {
+            uint8_t *p = &rgba[ ( y * LUT_IMAGE_SIZE + x ) * 4 ];
+            p[0] = ( x % LUT_TILE_SIZE ) * 255 / ( LUT_TILE_SIZE - 1 );
+            p[1] = ( y % LUT_TILE_SIZE ) * 255 / ( LUT_TILE_SIZE - 1 );
+            p[2] = ( y / LUT_TILE_SIZE * LUT_TILES + x / LUT_TILE_SIZE ) * 255 / ( LUT_TILE_SIZE - 1 );
+            p[3] = 255;
+        }
+    }
+    auto format = gl::Texture2d::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR ).wrap( GL_CLAMP_TO_EDGE );
+    auto table2d = gl::Texture2d::create( rgba.data(), GL_RGBA, LUT_IMAGE_SIZE, LUT_IMAGE_SIZE, format );
+    auto table3d = fromTiles( rgba.data(), false );
+
+    // The library functions as the patches include them, on colors that change every pixel
+    auto program = [] ( const std::string &library, const std::string &sampler, const std::string &call ) {
+        auto fragment = "#version 330\n" + loadString( app::loadAsset( "shaders/couleurs_lib/" + library ) ) + "\n"
+                        "uniform " + sampler + " u_table;\n"
+                        "out vec4 oColor;\n"
+                        "void main() {\n"
+                        "  vec4 color = vec4(fract(gl_FragCoord.xy / 97.), fract(gl_FragCoord.x * gl_FragCoord.y / 4099.), 1.);\n"
+                        "  oColor = " + call + ";\n"
+                        "}\n";
+        return gl::GlslProg::create( gl::GlslProg::Format().vertex( app::loadAsset( "shaders/vertex/passthrough.vert" ) ).fragment( fragment ) );
+    };
+
+    auto fbo = gl::Fbo::create( size.x, size.y );
+    gl::ScopedFramebuffer scopedFbo( fbo );
+    gl::ScopedViewport scopedViewport( ivec2( 0 ), size );
+    gl::ScopedMatrices scopedMatrices;
+    gl::setMatricesWindow( size );
+    auto time = [&] ( const gl::GlslProgRef &shader, const gl::TextureRef &table ) {
+        gl::ScopedGlslProg scopedShader( shader );
+        gl::ScopedTextureBind scopedTable( table, 0 );
+        shader->uniform( "u_table", 0 );
+        Rectf rect( vec2( 0 ), vec2( size ) );
+        gl::drawSolidRect( rect );
+
+        GLuint query;
+        GLuint64 nanoseconds = 0;
+        glGenQueries( 1, &query );
+        glBeginQuery( GL_TIME_ELAPSED, query );
+        for ( int i = 0; i < LUT_MEASURE_DRAWS; i++ ) {
+            gl::drawSolidRect( rect );
+        }
+        glEndQuery( GL_TIME_ELAPSED );
+        glGetQueryObjectui64v( query, GL_QUERY_RESULT, &nanoseconds );
+        glDeleteQueries( 1, &query );
+        return nanoseconds / 1e6 / LUT_MEASURE_DRAWS;
+    };
+
+    Timing timing;
+    timing.lut2d = time( program( "lut.glsl", "sampler2D", "lut(color, u_table)" ), table2d );
+    timing.lut3d = time( program( "lut3d.glsl", "sampler3D", "lut3d(color, u_table)" ), table3d );
+    gl::printError( "LutTexture::measure" );
+    return timing;
+}
+
+/* Privates */
+
+gl::Texture3dRef LutTexture::create( const vector<float> &rgb, int size )
+{
+    // Half floats keep the precision of float sources and filter everywhere
+    auto format = gl::Texture3d::Format().internalFormat( GL_RGB16F )
+                                         .dataType( GL_FLOAT )
+                                         .minFilter( GL_LINEAR )
+                                         .magFilter( GL_LINEAR )
+                                         .wrap( GL_CLAMP_TO_EDGE )
+                                         .wrapR( GL_CLAMP_TO_EDGE );
+    auto texture = gl::Texture3d::create( rgb.data(), GL_RGB, size, size, size, format );
+    gl::printError( "LutTexture::create" );
+    return texture;
+}
\ No newline at end of file
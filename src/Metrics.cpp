@@ -0,0 +1,277 @@
+#include "Metrics.h"
+#include "cinder/Log.h"
+#include "Constants.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace ci;
+using namespace std;
+
+Metrics::Metrics() : mStart( chrono::steady_clock::now() )
+{
+    for ( auto &counter : mCounters ) {
+        counter = 0;
+    }
+    for ( auto &gauge : mGauges ) {
+        gauge = 0;
+    }
+}
+
+Metrics::~Metrics()
+{
+    stop();
+}
+
+void Metrics::start( const fs::path &prometheusPath, const fs::path &journalPath, const function<void ( const Snapshot & )> &send )
+{
+    stop();
+    mPrometheusPath = prometheusPath;
+    mJournalPath = journalPath;
+    mSend = send;
+    for ( auto &path : { prometheusPath, journalPath } ) {
+        if ( !path.empty() ) {
+            fs::create_directories( path.parent_path() );
+        }
+    }
+    mRunning = true;
+    mThread = thread( &Metrics::run, this );
+}
+
+void Metrics::stop()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        if ( !mRunning ) return;
+        mRunning = false;
+    }
+    mStopped.notify_all();
+    mThread.join();
+}
+
+double Metrics::now() const
+{
+    return chrono::duration<double>( chrono::steady_clock::now() - mStart ).count();
+}
+
+void Metrics::recordFrame( float renderMilliseconds, bool late, uint32_t dropped )
+{
+    // A full ring means the publisher is stalled, frames are counted as lost
+    uint64_t written = mWritten.load( memory_order_relaxed );
+    if ( written - mRead.load( memory_order_acquire ) >= RING_SIZE ) {
+        mLost.fetch_add( 1, memory_order_relaxed );
+        mFrame++;
+        return;
+    }
+    mRing[ written % RING_SIZE ] = { mFrame++, now(), renderMilliseconds, dropped, late };
+    mWritten.store( written + 1, memory_order_release );
+}
+
+void Metrics::setPassTimes( const vector<pair<string, float>> &passes )
+{
+    lock_guard<mutex> lock( mPassMutex );
+    mPasses = passes;
+}
+
+void Metrics::run()
+{
+    unique_lock<mutex> lock( mMutex );
+    while ( mRunning ) {
+        mStopped.wait_for( lock, chrono::duration<double>( METRICS_INTERVAL ) );
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+Metrics::Snapshot Metrics::publish()
+{
+    Snapshot snapshot;
+    snapshot.time = now();
+    snapshot.seconds = max( snapshot.time - mLastPublish, 1e-6 );
+    mLastPublish = snapshot.time;
+
+    // Samples since the last publish
+    vector<float> renderTimes;
+    double renderSum = 0, intervalSum = 0;
+    uint32_t intervals = 0;
+    uint64_t read = mRead.load( memory_order_relaxed ), written = mWritten.load( memory_order_acquire );
+    for ( ; read < written; read++ ) {
+        auto sample = mRing[ read % RING_SIZE ];
+        snapshot.frames++;
+        snapshot.late += sample.late;
+        snapshot.dropped += sample.dropped;
+        renderTimes.push_back( sample.renderMilliseconds );
+        renderSum += sample.renderMilliseconds;
+        snapshot.renderMax = max( snapshot.renderMax, sample.renderMilliseconds );
+        if ( mLastSampleTime >= 0 ) {
+            float interval = (float)( ( sample.time - mLastSampleTime ) * 1000. );
+            intervalSum += interval;
+            intervals++;
+            snapshot.intervalMax = max( snapshot.intervalMax, interval );
+        }
+        mLastSampleTime = sample.time;
+
+        if ( sample.late ) {
+            journal( sample );
+        }
+        mHistory.push_back( sample );
+        if ( mHistory.size() > METRICS_JOURNAL_FRAMES ) {
+            mHistory.pop_front();
+        }
+    }
+    mRead.store( read, memory_order_release );
+
+    if ( !renderTimes.empty() ) {
+        snapshot.renderMean = (float)( renderSum / renderTimes.size() );
+        auto p99 = renderTimes.begin() + ( renderTimes.size() - 1 ) * 99 / 100;
+        nth_element( renderTimes.begin(), p99, renderTimes.end() );
+        snapshot.renderP99 = *p99;
+    }
+    snapshot.intervalMean = intervals ? (float)( intervalSum / intervals ) : 0.f;
+
+    mTotals.framesTotal += snapshot.frames;
+    mTotals.lateTotal += snapshot.late;
+    mTotals.droppedTotal += snapshot.dropped;
+    snapshot.framesTotal = mTotals.framesTotal;
+    snapshot.lateTotal = mTotals.lateTotal;
+    snapshot.droppedTotal = mTotals.droppedTotal;
+    snapshot.samplesLost = mLost.load( memory_order_relaxed );
+    for ( int i = 0; i < COUNTER_COUNT; i++ ) {
+        snapshot.counters[i] = mCounters[i].load( memory_order_relaxed );
+        snapshot.rates[i] = (float)( ( snapshot.counters[i] - mTotals.counters[i] ) / snapshot.seconds );
+        mTotals.counters[i] = snapshot.counters[i];
+    }
+    for ( int i = 0; i < GAUGE_COUNT; i++ ) {
+        snapshot.gauges[i] = mGauges[i].load( memory_order_relaxed );
+    }
+    {
+        lock_guard<mutex> lock( mPassMutex );
+        snapshot.passes = mPasses;
+    }
+
+    if ( mSend ) {
+        mSend( snapshot );
+    }
+
+    // Replaced in one rename, so a scraper never reads half a file
+    if ( !mPrometheusPath.empty() ) {
+        auto temporary = mPrometheusPath;
+        temporary += ".tmp";
+        ofstream( temporary.string() ) << prometheusText( snapshot );
+        try {
+            fs::rename( temporary, mPrometheusPath );
+        }
+        catch ( const std::exception &e ) {
+            CI_LOG_W( "Cannot write " << mPrometheusPath << ": " << e.what() );
+        }
+    }
+    return snapshot;
+}
+
+void Metrics::journal( const FrameSample &sample )
+{
+    if ( mJournalPath.empty() ) return;
+
+    try {
+        if ( fs::exists( mJournalPath ) && fs::file_size( mJournalPath ) > METRICS_JOURNAL_BYTES ) {
+            auto previous = mJournalPath;
+            previous += ".1";
+            fs::rename( mJournalPath, previous );
+        }
+    }
+    catch ( const std::exception &e ) {
+        CI_LOG_W( "Cannot rotate " << mJournalPath << ": " << e.what() );
+    }
+
+    // The frames before it, but none already written with an earlier miss
+    time_t wallTime = time( nullptr );
+    ofstream file( mJournalPath.string(), ios::app );
+    file << put_time( localtime( &wallTime ), "%Y-%m-%d %H:%M:%S" ) << " frame " << sample.frame << " missed its deadline: "
+         << fixed << setprecision( 2 ) << sample.renderMilliseconds << " ms, " << sample.dropped << " dropped\n"
+         << "  frame      time_s  render_ms  late  dropped\n";
+    for ( auto &previous : mHistory ) {
+        if ( previous.frame < mJournaledFrame ) continue;
+        file << setw( 7 ) << previous.frame << setw( 12 ) << setprecision( 3 ) << previous.time
+             << setw( 11 ) << setprecision( 2 ) << previous.renderMilliseconds << setw( 6 ) << previous.late << setw( 9 ) << previous.dropped << "\n";
+    }
+    file << "\n";
+    mJournaledFrame = sample.frame + 1;
+}
+
+const char* Metrics::counterName( Counter counter )
+{
+    switch ( counter ) {
+        case MIDI_EVENTS:  return "midi";
+        case OSC_EVENTS:   return "osc";
+        case SHADER_LOADS: return "shader_loads";
+        default:           return "";
+    }
+}
+
+const char* Metrics::gaugeName( Gauge gauge )
+{
+    switch ( gauge ) {
+        case SHADER_LOAD_SECONDS:    return "shader_load_seconds";
+        case FREEZE_COMPILE_SECONDS: return "freeze_compile_seconds";
+        case EXPORT_QUEUE_FRAMES:    return "export_queue_frames";
+        default:                     return "";
+    }
+}
+
+string Metrics::prometheusText( const Snapshot &snapshot )
+{
+    // Text exposition format: HELP and TYPE, then samples, label values quoted
+    ostringstream text;
+    auto metric = [&] ( const string &name, const string &type, const string &help ) {
+        text << "# HELP couleurs_" << name << " " << help << "\n# TYPE couleurs_" << name << " " << type << "\n";
+    };
+
+    metric( "frames_total", "counter", "Frames rendered." );
+    text << "couleurs_frames_total " << snapshot.framesTotal << "\n";
+    metric( "late_frames_total", "counter", "Frames that missed their deadline." );
+    text << "couleurs_late_frames_total " << snapshot.lateTotal << "\n";
+    metric( "dropped_frames_total", "counter", "Frame intervals skipped after late frames." );
+    text << "couleurs_dropped_frames_total " << snapshot.droppedTotal << "\n";
+    metric( "metric_samples_lost_total", "counter", "Frames not recorded because the publisher fell behind." );
+    text << "couleurs_metric_samples_lost_total " << snapshot.samplesLost << "\n";
+
+    metric( "frame_render_milliseconds", "gauge", "Render thread time per frame over the last interval." );
+    text << "couleurs_frame_render_milliseconds{stat=\"mean\"} " << snapshot.renderMean << "\n"
+         << "couleurs_frame_render_milliseconds{stat=\"p99\"} " << snapshot.renderP99 << "\n"
+         << "couleurs_frame_render_milliseconds{stat=\"max\"} " << snapshot.renderMax << "\n";
+    metric( "frame_interval_milliseconds", "gauge", "Time between frames over the last interval." );
+    text << "couleurs_frame_interval_milliseconds{stat=\"mean\"} " << snapshot.intervalMean << "\n"
+         << "couleurs_frame_interval_milliseconds{stat=\"max\"} " << snapshot.intervalMax << "\n";
+
+    metric( "input_events_total", "counter", "Control messages received." );
+    for ( auto input : { MIDI_EVENTS, OSC_EVENTS } ) {
+        text << "couleurs_input_events_total{source=\"" << counterName( input ) << "\"} " << snapshot.counters[ input ] << "\n";
+    }
+    metric( "input_events_per_second", "gauge", "Control messages per second over the last interval." );
+    for ( auto input : { MIDI_EVENTS, OSC_EVENTS } ) {
+        text << "couleurs_input_events_per_second{source=\"" << counterName( input ) << "\"} " << snapshot.rates[ input ] << "\n";
+    }
+    metric( "shader_loads_total", "counter", "Patch loads and shader reloads." );
+    text << "couleurs_shader_loads_total " << snapshot.counters[ SHADER_LOADS ] << "\n";
+
+    const char *gaugeHelp[ GAUGE_COUNT ] = {
+        "Duration of the last patch load or shader reload.",
+        "Compile time of the last frozen programs.",
+        "Loop export frames waiting for the encoder."
+    };
+    for ( int i = 0; i < GAUGE_COUNT; i++ ) {
+        metric( gaugeName( (Gauge)i ), "gauge", gaugeHelp[i] );
+        text << "couleurs_" << gaugeName( (Gauge)i ) << " " << snapshot.gauges[i] << "\n";
+    }
+
+    if ( !snapshot.passes.empty() ) {
+        metric( "pass_gpu_milliseconds", "gauge", "GPU time per pass, smoothed." );
+        for ( auto &pass : snapshot.passes ) {
+            text << "couleurs_pass_gpu_milliseconds{pass=\"" << pass.first << "\"} " << pass.second << "\n";
+        }
+    }
+    return text.str();
+}
\ No newline at end of file
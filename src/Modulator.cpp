@@ -1,28 +1,32 @@
 #include "Modulator.h"
 #include "cinder/CinderMath.h"
+#include "CounterRandom.h"
+#include <cmath>
 
 Modulator::Modulator( ModulatorType type, float frequency, float amount ) : mType( type ), mFrequency( frequency ), mAmount( amount ) 
 {
-    mRand.seed( 0 );
 }
 
 Modulator::~Modulator()
 {
 }
 
-float Modulator::tick( const double t )
+float Modulator::tick( const double t, const uint64_t seed )
 {
     switch( mType ) {
-        case RANDOM:    return tickRandom( t );
+        case RANDOM:    return tickRandom( t, seed );
         case SINE:      return tickSine( t );
         case TRIANGLE:  return tickTriangle( t );
-        case NOISE:     return tickNoise( t );
+        case NOISE:     return tickNoise( t, seed );
     }
+    return 0;
 }
 
-float Modulator::tickRandom( const double t )
+float Modulator::tickRandom( const double t, const uint64_t seed )
 {
-    return mAmount * ( mRand.nextFloat() * 2 - 1 );
+    // Sample and hold, a new value every 1 / frequency seconds
+    uint64_t step = mFrequency > 0 ? (uint64_t)(int64_t)floor( t * mFrequency ) : 0;
+    return mAmount * ( CounterRandom::uniform( seed, 0, step ) * 2 - 1 );
 }
 
 float Modulator::tickSine( const double t )
@@ -35,9 +39,11 @@ float Modulator::tickTriangle( const double t )
     return mAmount * ( 2 * abs( 2 * ( t * mFrequency - floor( t * mFrequency + .5 ) ) ) - 1 );
 }
 
-float Modulator::tickNoise( const double t )
+float Modulator::tickNoise( const double t, const uint64_t seed )
 {
-    return mAmount * mPerlin.noise( t );
+    // Each parameter walks its own row of the noise field
+    float row = CounterRandom::uniform( seed, 1, 0 ) * 256.f;
+    return mAmount * mPerlin.noise( (float)( t * mFrequency ), row );
 }
 
 ModulatorType Modulator::stringToType( const std::string typeStr )
@@ -1,6 +1,15 @@
 #include "MultipassShader.h"
+#include "Constants.h"
+#include "LutTexture.h"
+#include "cinder/Exception.h"
+#include "cinder/Log.h"
 #include "cinder/Utilities.h"
+#include <algorithm>
+#include <climits>
+#include <iomanip>
 #include <regex>
+#include <set>
+#include <sstream>
 #include "Utils.h"
 
 using namespace ci;
@@ -8,13 +17,22 @@ using namespace std;
 
 static fs::path vertPath = "shaders/vertex/passthrough.vert";
 
-MultipassShader::MultipassShader() {}
+static bool samplesBuffer( const gl::GlslProgRef &shader, int buffer )
+{
+    int location;
+    return shader && shader->findUniform( "u_buffer" + std::to_string( buffer ), &location );
+}
+
+MultipassShader::MultipassShader() : mFusionEnabled( PASS_FUSION ) {}
 MultipassShader::~MultipassShader() {}
 
 void MultipassShader::init( int width, int height, const std::function<void ( gl::GlslProgRef )> &setUniforms, bool loopMode ) 
 {
     mLoopMode = loopMode;
     mSetUniforms = setUniforms;    
+    glGetIntegerv( GL_MAX_TEXTURE_IMAGE_UNITS, &mPassUnitLimit );
+    glGetIntegerv( GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &mUnitLimit );
+    glGetIntegerv( GL_MAX_ARRAY_TEXTURE_LAYERS, &mLayerLimit );
     mFinalShader = gl::GlslProg::create( gl::GlslProg::Format().version( 330 )
                                                                .vertex( app::loadAsset( vertPath ) )
                                                                .fragment( app::loadAsset( "shaders/vertex/passthrough.frag" ) ) );
@@ -23,15 +41,202 @@ void MultipassShader::init( int width, int height, const std::function<void ( gl
 
 void MultipassShader::resize( int width, int height ) 
 {
+    if ( mMainFbo && width == mWidth && height == mHeight ) return;
+
     mWidth = width;
     mHeight = height;
-    mMainFbo = gl::Fbo::create( width, height );
-    for (unsigned int i = 0; i < mFbos.size(); i++) {
-        mFbos[i] = gl::Fbo::create( width, height );
+    releaseFbos();
+    try {
+        mMainFbo = createFbo();
+        allocateBuffers();
+        mCompute.resize( width, height );
+        for ( auto &blur : mBlurs ) {
+            blur.pyramid->resize( ivec2( width, height ) );
+        }
+    }
+
+    catch ( const std::exception &e ) {
+        shaderError( e.what() );
+    }
+
+    // Over the memory budget: the error is still drawn over an empty frame
+    if ( !mMainFbo ) {
+        mMainFbo = gl::Fbo::create( mWidth, mHeight );
+    }
+}
+
+void MultipassShader::releaseFbos() 
+{
+    // Hand the render targets back to the pool, resize() takes new ones
+    releaseBlurs();
+    if ( mFboPool ) {
+        mFboPool->release( mMainFbo );
+    }
+    mMainFbo = nullptr;
+    releaseBuffers();
+}
+
+void MultipassShader::clearFbos() 
+{
+    // Pooled or fresh FBOs hold leftovers, feedback patches must start from the same state
+    for ( auto &fbo : mSlots ) {
+        gl::ScopedFramebuffer scopedFbo( fbo );
+        gl::clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+    }
+    gl::ScopedFramebuffer scopedFbo( mMainFbo );
+    gl::clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+    for ( auto &blur : mBlurs ) {
+        blur.pyramid->clear();
+    }
+    mCompute.reset();
+}
+
+bool MultipassShader::hasFeedback() 
+{
+    // Compute state carries over from frame to frame
+    if ( mCompute.passCount() > 0 ) return true;
+
+    // Buffer i sees buffers rendered after it as they were on the previous frame
+    for (unsigned int i = 0; i < mShaders.size(); i++) {
+        for ( auto &uniform : mShaders[i]->getActiveUniforms() ) {
+            for (unsigned int j = i + 1; j < mShaders.size(); j++) {
+                if ( uniform.mName == "u_buffer" + std::to_string( j ) ) {
+                    return true;
+                }
+            }
+            // Blurs are ready right after their source buffer
+            for ( auto &blur : mBlurs ) {
+                if ( blur.source >= (int)i && uniform.mName == "u_" + blur.name ) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+gl::FboRef MultipassShader::createFbo() 
+{
+    return mFboPool ? mFboPool->acquire( mWidth, mHeight ) : gl::Fbo::create( mWidth, mHeight );
+}
+
+void MultipassShader::allocateBuffers()
+{
+    // A buffer only sampled later in the same frame is dead after its last
+    // reader, buffers with disjoint lifetimes share one FBO. Buffers read
+    // on the next frame, or by compute and instanced passes, get their own.
+    int count = mFbos.size();
+    vector<int> slots( count, -1 ), slotEnds;
+    for (int j = 0; j < count; j++) {
+        // Inlined buffers are never drawn nor sampled, any FBO will do
+        if ( isFused( j ) ) {
+            if ( slotEnds.empty() ) {
+                slotEnds.push_back( -1 );
+            }
+            slots[j] = 0;
+            continue;
+        }
+
+        int lastRead = j;
+        bool persistent = false;
+        for (int i = 0; i <= count; i++) {
+            auto &shader = i < (int)mShaders.size() ? mShaders[i] : mMainShader;
+            if ( ( i < (int)mShaders.size() || i == count ) && samplesBuffer( shader, j ) ) {
+                persistent = persistent || i < j;
+                lastRead = std::max( lastRead, i );
+            }
+        }
+        for (unsigned int i = 0; i < mCompute.passCount(); i++) {
+            persistent = persistent || samplesBuffer( mCompute.program( i ), j );
+        }
+        for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+            persistent = persistent || samplesBuffer( mInstances.program( i ), j );
+        }
+
+        for (unsigned int s = 0; s < slotEnds.size() && !persistent && slots[j] < 0; s++) {
+            if ( slotEnds[s] < j ) {
+                slots[j] = s;
+            }
+        }
+        if ( slots[j] < 0 ) {
+            slots[j] = slotEnds.size();
+            slotEnds.push_back( 0 );
+        }
+        slotEnds[ slots[j] ] = persistent ? INT_MAX : lastRead;
     }
+
+    // Keep the FBOs already held, only the difference goes through the pool
+    while ( mSlots.size() > slotEnds.size() ) {
+        if ( mFboPool ) {
+            mFboPool->release( mSlots.back() );
+        }
+        mSlots.pop_back();
+    }
+    while ( mSlots.size() < slotEnds.size() ) {
+        mSlots.push_back( createFbo() );
+    }
+    for (int j = 0; j < count; j++) {
+        mFbos[j] = mSlots[ slots[j] ];
+    }
+}
+
+void MultipassShader::releaseBuffers()
+{
+    if ( mFboPool ) {
+        for ( auto &fbo : mSlots ) {
+            mFboPool->release( fbo );
+        }
+    }
+    mSlots.clear();
+    std::fill( mFbos.begin(), mFbos.end(), nullptr );
+}
+
+MultipassShader::MemoryUse MultipassShader::memoryUse() const
+{
+    MemoryUse use;
+    use.buffers = FboPool::bytes( mMainFbo );
+    for ( auto &fbo : mSlots ) {
+        use.buffers += FboPool::bytes( fbo );
+    }
+    use.aliased = mFbos.size() - mSlots.size();
+    for ( auto &blur : mBlurs ) {
+        use.blurs += blur.pyramid->bytes();
+    }
+    use.compute = mCompute.bytes();
+    for ( auto &texture : mTextures ) {
+        use.textures += FboPool::bytes( texture.second );
+    }
+    for ( auto &lut : mLuts ) {
+        auto &t = lut.second;
+        use.textures += FboPool::bytes( t->getWidth() * t->getHeight(), t->getDepth(), t->getInternalFormat() );
+    }
+    for ( auto &array : mArrays ) {
+        auto &t = array.second;
+        use.textures += FboPool::bytes( t->getWidth() * t->getHeight(), t->getDepth(), t->getInternalFormat() );
+    }
+    return use;
+}
+
+bool MultipassShader::buffersAllocated() const
+{
+    for ( auto &fbo : mFbos ) {
+        if ( !fbo ) return false;
+    }
+    return mMainFbo != nullptr;
+}
+
+void MultipassShader::clearBuffers() 
+{
+    releaseBuffers();
+    mFbos.clear();
+    mShaders.clear();
+    releaseBlurs();
+    mBlurs.clear();
 }
 
 const std::string fragFilename = "/shader.frag";
+const std::string compFilename = "/shader.comp";
+const std::string instancesFilename = "/instances";
 void MultipassShader::load( const fs::path &path ) 
 {
     fs::path fragPath = path.string() + fragFilename;
@@ -42,27 +247,79 @@ void MultipassShader::load( const fs::path &path )
         format = format.define( "LOOP" );
     }     
 
+    unfreezeAll();
+    mCompute.unload();
+    mInstances.unload();
     try {
         mPatchPath = path;
+        mBundle = nullptr;
         mMainShader = gl::GlslProg::create( format );
         mFragPath = fragPath;
         mMainFragSource = format.getFragment();        
         mShaderCompilationFailed = false;
 
-        mFbos.clear();
-        mShaders.clear();
+        clearBuffers();
         updateBuffers();        
+        loadCompute();
+        loadInstances();
+        resolveSource();
+        loadTextures();
+        uploadTextures();
+        fusePasses();
+        allocateBuffers();
+        loadBlurs();
+        assignTextureUnits();
+        resetPassTimes();
     }
 
     catch ( const std::exception &e ) {
         shaderError( e.what() );
     }
+}
+
+void MultipassShader::load( const PatchBundleRef &bundle )
+{
+    unfreezeAll();
+    try {
+        mBundle = bundle;
+        mMainShader = nullptr;
+        mCompute.unload();
+        mInstances.unload();
+        clearBuffers();
+
+        for ( uint32_t i = 0; i < mBundle->header().passCount; i++ ) {
+            auto &pass = mBundle->pass( i );
+            auto shader = gl::GlslProg::create( programFormat( mBundle->source( pass ) ) );
+            if ( pass.bufferIndex < 0 ) {
+                mMainShader = shader;
+                mMainFragSource = mBundle->source( pass );
+            }
+            else {
+                mFbos.push_back( nullptr );
+                mShaders.push_back( shader );
+            }
+        }
+        resolveSource();
+        loadBundleTextures();
+        uploadTextures();
+        fusePasses();
+        allocateBuffers();
+        loadBlurs();
+        assignTextureUnits();
+        resetPassTimes();
+        mShaderCompilationFailed = false;
+    }
 
-    loadTextures();
+    catch ( const std::exception &e ) {
+        shaderError( e.what() );
+    }
 }
 
 void MultipassShader::reload() 
 {
+    // Bundles are immutable, only loose patch folders are live-reloaded
+    if ( mBundle ) return;
+
     auto format = gl::GlslProg::Format().version( 330 )
                                         .vertex( app::loadAsset( vertPath ) )
                                         .fragment( app::loadAsset( mFragPath ) );
@@ -70,29 +327,68 @@ void MultipassShader::reload()
         format = format.define( "LOOP" );
     }    
  
+    // Frozen programs of the old source are stale, the same values are frozen again
+    releaseFrozen();
     try {
         mMainShader = gl::GlslProg::create( format );
         mMainFragSource = format.getFragment(); 
         mShaderCompilationFailed = false;   
         updateBuffers();
+        loadCompute();
+        loadInstances();
+        resolveSource();
+        loadTextures();
+        uploadTextures();
+        fusePasses();
+        allocateBuffers();
+        loadBlurs();
+        assignTextureUnits();
+        resetPassTimes();
+        submitFrozen();
     }
 
     catch ( const std::exception &e ) {
         shaderError( e.what() );
     }
-
-    loadTextures();
 }
 
-void MultipassShader::draw( const Rectf &r, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture ) 
+void MultipassShader::render( const Rectf &r, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture ) 
 {
+    // Nothing to render into after a failed load or allocation
+    if ( !buffersAllocated() ) {
+        gl::ScopedFramebuffer scopedFbo( mMainFbo );
+        gl::clear( ColorA( 0.f, 0.f, 0.f, 1.f ) );
+        return;
+    }
+
+    pollFrozen();
+    if ( mPassTimings.size() != mShaders.size() + 1 ) {
+        resetPassTimes();
+    }
+
+    // Compute passes, before anything samples their results
+    if ( mCompute.passCount() > 0 ) {
+        runCompute( syphonTexture, cameraTexture );
+    }
+
     // Intermediary passes
     for (unsigned int i = 0; i < mFbos.size(); i++) {
-        drawShaderInFBO( r, mShaders[i], mFbos[i], syphonTexture, cameraTexture, i );
+        // Runs inside the pass it was inlined into
+        if ( isFused( i ) ) continue;
+
+        drawPass( r, i, syphonTexture, cameraTexture );
+        drawInstances( i, mFbos[i], syphonTexture, cameraTexture );
+        processBlurs( i );
     }
 
     // Final pass
-    drawShaderInFBO( r, mMainShader, mMainFbo, syphonTexture, cameraTexture, -1 );
+    drawPass( r, -1, syphonTexture, cameraTexture );
+    drawInstances( -1, mMainFbo, syphonTexture, cameraTexture );
+}
+
+void MultipassShader::draw( const Rectf &r, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture ) 
+{
+    render( r, syphonTexture, cameraTexture );
 
     // Draw on screen
     {
@@ -103,6 +399,43 @@ void MultipassShader::draw( const Rectf &r, const gl::Texture2dRef &syphonTextur
     }
 }
 
+void MultipassShader::freeze( const std::map<std::string, float> &values )
+{
+    if ( values.empty() ) {
+        unfreezeAll();
+        return;
+    }
+
+    // The current frozen programs stay in use until the new ones are ready
+    mFrozenValues = values;
+    submitFrozen();
+}
+
+void MultipassShader::unfreeze( const std::string &name )
+{
+    if ( !mFrozenValues.erase( name ) ) return;
+
+    // Generic programs from this frame on, the others are frozen again in the background
+    releaseFrozen();
+    submitFrozen();
+}
+
+void MultipassShader::unfreezeAll()
+{
+    mFrozenValues.clear();
+    mFreezeJob = 0;
+    releaseFrozen();
+}
+
+vector<MultipassShader::PassTime> MultipassShader::passTimes() const
+{
+    vector<PassTime> times;
+    for ( auto &timing : mPassTimings ) {
+        times.push_back( timing.time );
+    }
+    return times;
+}
+
 void MultipassShader::shaderError(const char *msg) 
 {    
     mShaderCompilationFailed = true;
@@ -113,7 +446,7 @@ void MultipassShader::shaderError(const char *msg)
 
 void MultipassShader::loadTextures() 
 {
-  vector<fs::path> imageNames;  
+  vector<fs::path> imageNames, cubeNames;  
 
   // Iterate through project directory to detect images
   for ( auto &p: boost::filesystem::directory_iterator( app::getAssetPath( mPatchPath ) ) ) {
@@ -121,151 +454,687 @@ void MultipassShader::loadTextures()
     if ( extension == ".jpg" || extension == ".png" ) {
       imageNames.push_back( p.path().filename() );
     }
+    else if ( extension == ".cube" ) {
+      cubeNames.push_back( p.path().filename() );
+    }
   }    
 
-  // Create textures
-  mTextures.clear();
+  // Images named otherwise can be declared with #pragma couleurs lut <name>
+  set<std::string> lutNames;
+  for ( auto &pragma : getPatchDirectives( mMainFragSource ) ) {
+    if ( pragma.name == "lut" && pragma.args.size() == 1 ) {
+      lutNames.insert( pragma.args[0] );
+    }
+  }
+
+  // Decode images, uploadTextures() creates the textures
+  mImages.clear();
+  mLuts.clear();
   for ( int i = 0; i < imageNames.size(); i++ ) {
     auto assetPath = mPatchPath / imageNames[i];
     auto nameWithoutExtension = imageNames[i].replace_extension( "" );
-    gl::Texture::Format textureFormat;        
-    mTextures[ nameWithoutExtension.string() ] = gl::Texture2d::create( loadImage( app::loadAsset( assetPath ) ), textureFormat );
+    Image image;
+    image.name = nameWithoutExtension.string();
+    image.surface = Surface8u( loadImage( app::loadAsset( assetPath ) ) );
+    image.width = image.surface.getWidth();
+    image.height = image.surface.getHeight();
+    image.levels = 1;
+    mImages.push_back( image );
+
+    // Grading tables also get a 3D version for lut3d()
+    auto name = nameWithoutExtension.string();
+    if ( LutTexture::isLutName( name ) || lutNames.count( name ) ) {
+      if ( auto lut = LutTexture::fromImage( app::getAssetPath( assetPath ) ) ) {
+        mLuts[ name + "_3d" ] = lut;
+      }
+    }
+  }
+
+  for ( auto &cubeName : cubeNames ) {
+    try {
+      mLuts[ fs::path( cubeName ).replace_extension( "" ).string() ] = LutTexture::fromCube( app::getAssetPath( mPatchPath / cubeName ) );
+    }
+    catch ( const std::exception &e ) {
+      shaderError( e.what() );
+    }
   }
 }
 
-void MultipassShader::drawShaderInFBO( const Rectf &r, const gl::GlslProgRef &shader, const gl::FboRef &fbo, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture, int index ) 
+gl::GlslProg::Format MultipassShader::programFormat( const std::string &source )
 {
-    if ( fbo != nullptr ) {
-        fbo->bindFramebuffer();        
+    // Sources with includes resolved (bundles, fused or frozen passes), only the version and loop mode are added
+    std::string header = mLoopMode ? "#version 330\n#define LOOP\n" : "#version 330\n";
+    return gl::GlslProg::Format().vertex( app::loadAsset( vertPath ) )
+                                 .fragment( header + source )
+                                 .preprocess( false );
+}
+
+void MultipassShader::resolveSource()
+{
+    set<fs::path> included;
+    try {
+        mResolvedSource = mBundle ? mMainFragSource : resolveShaderIncludes( app::getAssetPath( mFragPath ), included );
     }
-    gl::ScopedGlslProg scopedShader( shader );
-            
-    // Bind textures from other buffers
-    int textureIndex = 1;
-    for (unsigned int j = 0; j < mFbos.size(); j++) {
-        if (j != index) {
-            mFbos[j]->getColorTexture()->bind( textureIndex );            
-            shader->uniform( "u_buffer" + std::to_string( j ), textureIndex );                
-            textureIndex++;
+    catch ( const std::exception &e ) {
+        // The patch still runs, neither packed, fused nor freezable
+        CI_LOG_W( "Cannot read the patch source: " << e.what() );
+        mResolvedSource.clear();
+    }
+}
+
+void MultipassShader::fusePasses()
+{
+    // The programs compiled from the files, or packed, stay around for the fallback
+    mUnfusedShaders = mShaders;
+    mUnfusedMainShader = mMainShader;
+    applyFusion();
+}
+
+void MultipassShader::applyFusion()
+{
+    mShaders = mUnfusedShaders;
+    mMainShader = mUnfusedMainShader;
+    mFused.assign( mShaders.size(), false );
+    mFusion = Fusion();
+    mPassSources.clear();
+    int count = mShaders.size();
+    std::string source = mResolvedSource;
+    if ( source.empty() ) return;
+
+    if ( mFusionEnabled ) {
+        // Buffers something else than a fragment pass reads or draws into keep their FBO
+        vector<bool> pinned( count, false );
+        vector<string> blurNames;
+        for ( auto &pragma : getPatchDirectives( mMainFragSource ) ) {
+            if ( pragma.name == "blur" && pragma.args.size() >= 2 ) {
+                blurNames.push_back( pragma.args[0] );
+                int buffer = atoi( pragma.args[1].c_str() + std::min<size_t>( 6, pragma.args[1].size() ) );
+                if ( buffer >= 0 && buffer < count ) {
+                    pinned[ buffer ] = true;
+                }
+            }
+        }
+        for (int j = 0; j < count; j++) {
+            for (unsigned int i = 0; i < mCompute.passCount(); i++) {
+                pinned[j] = pinned[j] || samplesBuffer( mCompute.program( i ), j );
+            }
+            for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+                pinned[j] = pinned[j] || samplesBuffer( mInstances.program( i ), j ) || mInstances.target( i ) == j;
+            }
+        }
+
+        PassFusion fusion( mResolvedSource, count, pinned, blurNames );
+        if ( !fusion.refused().empty() ) {
+            mFusion.error = fusion.refused();
+            CI_LOG_I( "Not fused: " << fusion.refused() );
+        }
+        if ( fusion.fusedCount() > 0 ) {
+            // Only the passes the stages were inlined into are rebuilt
+            try {
+                auto shaders = mShaders;
+                auto mainShader = mMainShader;
+                for (int i = -1; i < count; i++) {
+                    if ( ( i >= 0 && fusion.isFused( i ) ) || !fusion.isConsumer( i ) ) continue;
+                    auto program = gl::GlslProg::create( programFormat( i < 0 ? fusion.source() : "#define BUFFER_" + std::to_string( i ) + "\n" + fusion.source() ) );
+                    ( i < 0 ? mainShader : shaders[i] ) = program;
+                }
+                mShaders = shaders;
+                mMainShader = mainShader;
+                for (int j = 0; j < count; j++) {
+                    mFused[j] = fusion.isFused( j );
+                }
+                source = fusion.source();
+                mFusion.passes = fusion.describe();
+                mFusion.count = fusion.fusedCount();
+                CI_LOG_I( "Fused " << mFusion.passes );
+            }
+            catch ( const std::exception &e ) {
+                mFusion.error = e.what();
+                CI_LOG_W( "Pass fusion failed, running unfused: " << e.what() );
+            }
         }
     }
 
-    // Set non-texture uniforms
-    mSetUniforms( shader ); 
+    // Frozen programs are built from the same sources
+    for (int i = 0; i < count; i++) {
+        mPassSources.push_back( "#define BUFFER_" + std::to_string( i ) + "\n" + source );
+    }
+    mPassSources.push_back( source );
+}
 
-    // Set texture uniforms
-    for ( auto it = mTextures.begin(); it != mTextures.end(); it++ ) {    
-        it->second->bind( textureIndex );
-        shader->uniform( "u_" + it->first, textureIndex );
-        textureIndex++;
-    }  
-
-    // Set Syphon texture
-    if ( syphonTexture ) {
-        syphonTexture->bind( textureIndex );
-        shader->uniform( "u_syphonTex", textureIndex );
-        textureIndex++;
-    }    
+void MultipassShader::setFusion( bool enabled )
+{
+    if ( enabled == mFusionEnabled ) return;
+    mFusionEnabled = enabled;
+    if ( !mUnfusedMainShader || mShaderCompilationFailed ) return;
 
-    // Set Camera texture
-    if ( cameraTexture ) {
-        cameraTexture->bind( textureIndex );
-        shader->uniform( "u_cameraTex", textureIndex );
-    }    
+    releaseFrozen();
+    applyFusion();
+    allocateBuffers();
+    try {
+        assignTextureUnits();
+    }
+    catch ( const std::exception &e ) {
+        shaderError( e.what() );
+    }
+    resetPassTimes();
+    submitFrozen();
+}
 
-    // Draw
-    gl::drawSolidRect( r );    
-    gl::printError( "drawSolidRect" );
+MultipassShader::Fusion MultipassShader::fusion() const
+{
+    // Each inlined buffer was written once and read once per frame
+    Fusion fusion = mFusion;
+    fusion.bytesPerFrame = 2 * FboPool::bytes( mWidth, mHeight, GL_RGBA8 ) * fusion.count;
+    return fusion;
+}
+
+void MultipassShader::loadCompute()
+{
+    // shader.comp is optional, next to shader.frag
+    fs::path compPath = mPatchPath.string() + compFilename;
+    if ( app::getAssetPath( compPath ).empty() ) {
+        mCompute.unload();
+        return;
+    }
+    mCompute.load( compPath, mLoopMode );
+    mCompute.resize( mWidth, mHeight );
+}
+
+void MultipassShader::runCompute( const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture )
+{
+    for (unsigned int i = 0; i < mCompute.passCount(); i++) {
+        auto &shader = mCompute.program( i );
+        gl::ScopedGlslProg scopedShader( shader );
+        bindTextures( shader, syphonTexture, cameraTexture, i, nullptr );
+        mCompute.dispatch( i );
+    }
+    mCompute.finish();
+}
 
-    // Unbind FBOs & textures
-    for (unsigned int j = 0; j < mFbos.size(); j++) {
-        if (j != index) {
-            mFbos[j]->getColorTexture()->unbind();            
+void MultipassShader::loadInstances()
+{
+    // instances.vert and instances.frag are optional, read after the compute passes for storage counts
+    fs::path vertPath = mPatchPath.string() + instancesFilename + ".vert";
+    fs::path fragPath = mPatchPath.string() + instancesFilename + ".frag";
+    if ( app::getAssetPath( vertPath ).empty() ) {
+        mInstances.unload();
+        return;
+    }
+    mInstances.load( vertPath, fragPath, mLoopMode, mCompute );
+    for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+        if ( mInstances.target( i ) >= (int)mFbos.size() ) {
+            throw Exception( "Instanced pass " + std::to_string( i ) + " draws into a missing buffer" );
         }
     }
-    
-    for ( auto it = mTextures.begin(); it != mTextures.end(); it++ ) {    
-        it->second->unbind();    
+}
+
+void MultipassShader::drawInstances( int index, const gl::FboRef &fbo, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture )
+{
+    for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+        if ( mInstances.target( i ) != index ) continue;
+
+        auto &shader = mInstances.program( i );
+        gl::ScopedFramebuffer scopedFbo( fbo );
+        gl::ScopedViewport scopedViewport( ivec2( 0 ), fbo->getSize() );
+        gl::ScopedGlslProg scopedShader( shader );
+        bindTextures( shader, syphonTexture, cameraTexture, mCompute.passCount() + mShaders.size() + 1 + i, fbo );
+        mInstances.draw( i );
     }
+}
 
-    syphonTexture->unbind();
+void MultipassShader::loadBlurs()
+{
+    vector<Blur> blurs;
+    for ( auto &pragma : getPatchDirectives( mMainFragSource ) ) {
+        auto &args = pragma.args;
+        if ( pragma.name == "lut" ) continue;
+        if ( pragma.name != "blur" || args.size() < 2 || args.size() > 4 || args[1].compare( 0, 6, "buffer" ) != 0 ) {
+            throw Exception( "Bad #pragma couleurs line: " + pragma.line );
+        }
 
-    if ( fbo != nullptr ) {
-        fbo->unbindFramebuffer();        
-    }     
+        Blur blur;
+        blur.name = args[0];
+        blur.source = atoi( args[1].c_str() + 6 );
+        if ( blur.source < 0 || blur.source >= (int)mFbos.size() ) {
+            throw Exception( "Blur " + blur.name + " reads a missing buffer" );
+        }
+        int levels = args.size() > 2 ? atoi( args[2].c_str() ) : BLUR_LEVELS;
+        blur.pyramid = make_shared<BlurPyramid>( levels, args.size() > 3 ? args[3] : "" );
+        blur.pyramid->setFboPool( mFboPool );
+        blur.pyramid->resize( ivec2( mWidth, mHeight ) );
+        blurs.push_back( blur );
+    }
+
+    releaseBlurs();
+    mBlurs = blurs;
 }
 
-void MultipassShader::updateBuffers() 
+void MultipassShader::releaseBlurs()
 {
-    int bufferCount = getBufferCount();
-    
-    if ( bufferCount != mFbos.size() ) {
-        mFbos.clear();
-        mShaders.clear();
-
-        for (int i = 0; i < bufferCount; i++) {
-            // New FBO
-            auto fbo = gl::Fbo::create( mWidth, mHeight );
-            mFbos.push_back( fbo );
-
-            // New SHADER
-            auto format = gl::GlslProg::Format().version( 330 )
-                                                .vertex( app::loadAsset( vertPath ) )
-                                                .fragment( app::loadAsset( mFragPath ) )
-                                                .define( "BUFFER_" + std::to_string( i ) );
-            if ( mLoopMode ) {
-                format = format.define( "LOOP" );
-            }
+    // Pyramid levels go back to the pool for the next patch
+    for ( auto &blur : mBlurs ) {
+        blur.pyramid->release();
+    }
+}
+
+void MultipassShader::processBlurs( int index )
+{
+    for ( auto &blur : mBlurs ) {
+        if ( blur.source == index ) {
+            blur.pyramid->process( mFbos[index]->getColorTexture(), mSetUniforms );
+        }
+    }
+}
 
-            auto shader = gl::GlslProg::create( format );
-            mShaders.push_back( shader );
+void MultipassShader::loadBundleTextures()
+{
+    mImages.clear();
+    mLuts.clear();
+    for ( uint32_t i = 0; i < mBundle->header().textureCount; i++ ) {
+        auto &t = mBundle->texture( i );
+        auto name = mBundle->stringAt( t.name );
+        Image image;
+        image.name = name;
+        image.width = t.width;
+        image.height = t.height;
+        image.levels = t.levels;
+        image.bundled = &t;
+        mImages.push_back( image );
+        if ( LutTexture::isLutName( name ) && LutTexture::isLutSize( t.width, t.height ) ) {
+            mLuts[ name + "_3d" ] = LutTexture::fromTiles( mBundle->textureLevel( t, 0 ), true );
         }
     }
-    else {
-        for (unsigned int i = 0; i < mShaders.size(); i++) {
-            auto format = gl::GlslProg::Format().version( 330 )
-                                                .vertex( app::loadAsset( vertPath ) )
-                                                .fragment( app::loadAsset( mFragPath ) )
-                                                .define( "BUFFER_" + std::to_string( i ) );
-            if ( mLoopMode ) {
-                format = format.define( "LOOP" );
+}
+
+void MultipassShader::uploadTextures()
+{
+    // Images sampled by compute or instanced passes keep their own texture, those sources are not rewritten
+    set<std::string> excluded;
+    vector<gl::GlslProgRef> programs;
+    for (unsigned int i = 0; i < mCompute.passCount(); i++) {
+        programs.push_back( mCompute.program( i ) );
+    }
+    for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+        programs.push_back( mInstances.program( i ) );
+    }
+    for ( auto &program : programs ) {
+        for ( auto &uniform : program->getActiveUniforms() ) {
+            if ( uniform.mName.compare( 0, 2, "u_" ) == 0 ) {
+                excluded.insert( uniform.mName.substr( 2 ) );
             }
+        }
+    }
 
-            mShaders[i] = gl::GlslProg::create( format );
+    // A grading table only read through its 3D version is not uploaded as an image
+    set<std::string> sampled = excluded;
+    programs = mShaders;
+    if ( mMainShader ) {
+        programs.push_back( mMainShader );
+    }
+    for ( auto &program : programs ) {
+        for ( auto &uniform : program->getActiveUniforms() ) {
+            if ( uniform.mName.compare( 0, 2, "u_" ) == 0 ) {
+                sampled.insert( uniform.mName.substr( 2 ) );
+            }
         }
     }
+    mImages.erase( remove_if( mImages.begin(), mImages.end(), [&] ( const Image &image ) {
+        return mLuts.count( image.name + "_3d" ) && !sampled.count( image.name );
+    } ), mImages.end() );
 
-    gl::printError( "updateBuffers" );
+    vector<TexturePacking::Image> images;
+    for ( auto &image : mImages ) {
+        images.push_back( { image.name, image.width, image.height, image.levels } );
+    }
+    TexturePacking packing( mResolvedSource, TEXTURE_PACKING && !mResolvedSource.empty() ? images : vector<TexturePacking::Image>(), excluded, mLayerLimit );
+
+    // Every pass reads the packed images from their layers, the programs compiled from the files cannot
+    if ( packing.arrayCount() > 0 ) {
+        try {
+            vector<gl::GlslProgRef> shaders;
+            for (unsigned int i = 0; i < mShaders.size(); i++) {
+                shaders.push_back( gl::GlslProg::create( programFormat( "#define BUFFER_" + std::to_string( i ) + "\n" + packing.source() ) ) );
+            }
+            mMainShader = gl::GlslProg::create( programFormat( packing.source() ) );
+            mShaders = shaders;
+            mResolvedSource = packing.source();
+            CI_LOG_I( "Packed " << packing.describe() );
+        }
+        catch ( const std::exception &e ) {
+            CI_LOG_W( "Texture packing failed, running unpacked: " << e.what() );
+            packing = TexturePacking( mResolvedSource, {}, {}, mLayerLimit );
+        }
+    }
+
+    mTextures.clear();
+    mArrays.clear();
+    for ( int a = 0; a < packing.arrayCount(); a++ ) {
+        mArrays[ TexturePacking::arrayName( a ) ] = createArray( packing.layers( a ) );
+    }
+    for ( auto &image : mImages ) {
+        if ( packing.isPacked( image.name ) ) continue;
+
+        if ( image.bundled ) {
+            mTextures[ image.name ] = createTexture( *image.bundled );
+        }
+        else {
+            gl::Texture::Format textureFormat;
+            mTextures[ image.name ] = gl::Texture2d::create( image.surface, textureFormat );
+        }
+    }
+    mPacked = packing.describe();
+    mImages.clear();
+    gl::printError( "uploadTextures" );
 }
 
-int MultipassShader::getBufferCount() 
+gl::Texture2dRef MultipassShader::createTexture( const BundleTexture &t ) const
 {
-    std::vector<std::string> lines = split(mMainFragSource, '\n');
-    std::vector<std::string> results;
+    // Upload the mmapped levels directly, no decoding
+    GLuint textureId;
+    glGenTextures( 1, &textureId );
+    auto texture = gl::Texture2d::create( GL_TEXTURE_2D, textureId, t.width, t.height, false );
+    gl::ScopedTextureBind scopedTexture( texture );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    int width = t.width, height = t.height;
+    for ( uint32_t level = 0; level < t.levels; level++ ) {
+        glTexImage2D( GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mBundle->textureLevel( t, level ) );
+        width = std::max( 1, width / 2 );
+        height = std::max( 1, height / 2 );
+    }
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, t.levels - 1 );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    return texture;
+}
 
-    std::regex re(R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*BUFFER_)(\d+)(?:\s*\))|(?:^\s*#ifdef\s+BUFFER_)(\d+))");
-    std::smatch match;
+gl::Texture3dRef MultipassShader::createArray( const vector<std::string> &names ) const
+{
+    vector<const Image*> layers;
+    for ( auto &name : names ) {
+        layers.push_back( &*find_if( mImages.begin(), mImages.end(), [&] ( const Image &image ) { return image.name == name; } ) );
+    }
 
-    for (int l = 0; l < lines.size(); l++) {
-        if (std::regex_search(lines[l], match, re)) {
-            std::string number = std::ssub_match(match[2]).str();
-            if (number.size() == 0) {
-                number = std::ssub_match(match[3]).str();
+    // Sampled like the single textures: linear, clamped, rows bottom-up
+    auto &first = *layers[0];
+    auto format = gl::Texture3d::Format().target( GL_TEXTURE_2D_ARRAY )
+                                         .internalFormat( GL_RGBA8 )
+                                         .minFilter( GL_LINEAR )
+                                         .magFilter( GL_LINEAR )
+                                         .wrap( GL_CLAMP_TO_EDGE );
+    auto array = gl::Texture3d::create( first.width, first.height, layers.size(), format );
+    gl::ScopedTextureBind scopedTexture( array );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    int width = first.width, height = first.height;
+    for ( int level = 0; level < first.levels; level++ ) {
+        if ( level > 0 ) {
+            glTexImage3D( GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, width, height, layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+        }
+        for ( size_t layer = 0; layer < layers.size(); layer++ ) {
+            auto &image = *layers[layer];
+            if ( image.bundled ) {
+                glTexSubImage3D( GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, mBundle->textureLevel( *image.bundled, level ) );
+                continue;
             }
 
-            bool already = false;
-            for (int i = 0; i < results.size(); i++) {
-                if (results[i] == number) {
-                    already = true;
-                    break;
+            // Decoded images are top-down, Cinder flips them when it creates a texture
+            vector<uint8_t> rgba( width * height * 4 );
+            for ( int y = 0; y < height; y++ ) {
+                for ( int x = 0; x < width; x++ ) {
+                    ColorA8u c = image.surface.getPixel( ivec2( x, y ) );
+                    uint8_t *p = &rgba[ ( ( height - 1 - y ) * width + x ) * 4 ];
+                    p[0] = c.r;
+                    p[1] = c.g;
+                    p[2] = c.b;
+                    p[3] = image.surface.hasAlpha() ? c.a : 255;
                 }
             }
+            glTexSubImage3D( GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data() );
+        }
+        width = std::max( 1, width / 2 );
+        height = std::max( 1, height / 2 );
+    }
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, first.levels - 1 );
+    return array;
+}
 
-            if (!already) {
-                results.push_back(number);
-            }
+void MultipassShader::drawShaderInFBO( const Rectf &r, const gl::GlslProgRef &shader, const gl::FboRef &fbo, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture, int index ) 
+{
+    if ( fbo != nullptr ) {
+        fbo->bindFramebuffer();        
+    }
+    gl::ScopedGlslProg scopedShader( shader );
+    bindTextures( shader, syphonTexture, cameraTexture, mCompute.passCount() + ( index < 0 ? mShaders.size() : index ), fbo );
+
+    // Draw
+    gl::drawSolidRect( r );    
+    gl::printError( "drawSolidRect" );
+
+    if ( fbo != nullptr ) {
+        fbo->unbindFramebuffer();        
+    }     
+}
+
+void MultipassShader::drawPass( const Rectf &r, int index, const gl::Texture2dRef &syphonTexture, const gl::TextureRef &cameraTexture )
+{
+    bool frozen = isFrozen();
+    auto &shader = index < 0 ? ( frozen ? mFrozenMainShader : mMainShader ) : ( frozen ? mFrozenShaders[index] : mShaders[index] );
+    auto &timing = mPassTimings[ index < 0 ? mShaders.size() : index ];
+    if ( !timing.query ) {
+        timing.query = gl::QueryTimeSwapped::create();
+    }
+
+    timing.query->begin();
+    drawShaderInFBO( r, shader, index < 0 ? mMainFbo : mFbos[index], syphonTexture, cameraTexture, index );
+    timing.query->end();
+
+    // The swapped query reads back the previous frame, drawn with the program used then
+    double milliseconds = timing.query->getElapsedMilliseconds();
+    if ( milliseconds > 0 ) {
+        double &average = timing.queriedFrozen ? timing.time.frozen : timing.time.generic;
+        average = average > 0 ? average + ( milliseconds - average ) * .05 : milliseconds;
+    }
+    timing.queriedFrozen = frozen;
+}
+
+void MultipassShader::resetPassTimes()
+{
+    mPassTimings.assign( mShaders.size() + 1, PassTiming() );
+    for (unsigned int i = 0; i < mShaders.size(); i++) {
+        mPassTimings[i].time.name = "buffer" + std::to_string( i ) + ( isFused( i ) ? " (fused)" : "" );
+    }
+    mPassTimings.back().time.name = "main";
+}
+
+void MultipassShader::submitFrozen()
+{
+    // Any job still compiling is superseded
+    mFreezeJob = 0;
+    if ( mFrozenValues.empty() || mPassSources.empty() || mShaderCompilationFailed ) return;
+
+    vector<gl::GlslProg::Format> formats;
+    for ( auto &source : mPassSources ) {
+        formats.push_back( programFormat( frozenSource( source ) ) );
+    }
+    mFreezeJobValues = mFrozenValues;
+    mFreezeJob = ( mCompiler ? mCompiler : &mInlineCompiler )->submit( formats );
+}
+
+void MultipassShader::pollFrozen()
+{
+    ShaderCompiler::Job job;
+    while ( ( mCompiler ? mCompiler : &mInlineCompiler )->poll( job ) ) {
+        // Superseded by a later freeze, unfreeze or load
+        if ( job.id != mFreezeJob ) continue;
+
+        mFreezeJob = 0;
+        mFreezeSeconds = job.seconds;
+        if ( !job.error.empty() ) {
+            CI_LOG_W( "Frozen programs failed, keeping the generic ones: " << job.error );
+            continue;
         }
+        mFrozenMainShader = job.programs.back();
+        mFrozenShaders.assign( job.programs.begin(), job.programs.end() - 1 );
+        mFrozenProgramValues = mFreezeJobValues;
+        for ( auto &timing : mPassTimings ) {
+            timing.time.frozen = 0;
+        }
+    }
+}
+
+void MultipassShader::releaseFrozen()
+{
+    mFrozenShaders.clear();
+    mFrozenMainShader = nullptr;
+    mFrozenProgramValues.clear();
+}
+
+const std::map<std::string, float>* MultipassShader::constUniforms( const gl::GlslProgRef &shader ) const
+{
+    if ( !isFrozen() ) return nullptr;
+    if ( shader == mFrozenMainShader || std::find( mFrozenShaders.begin(), mFrozenShaders.end(), shader ) != mFrozenShaders.end() ) {
+        return &mFrozenProgramValues;
     }
+    return nullptr;
+}
 
-    return results.size();
+std::string MultipassShader::frozenSource( const std::string &source ) const
+{
+    // `uniform float u_x;` becomes a constant the compiler can fold,
+    // declarations in any other form stay uniforms
+    std::string frozen = source;
+    for ( auto &value : mFrozenValues ) {
+        ostringstream literal;
+        literal << showpoint << setprecision( 9 ) << value.second;
+        regex declaration( "\\buniform\\s+float\\s+" + value.first + "\\s*;" );
+        frozen = regex_replace( frozen, declaration, "const float " + value.first + " = " + literal.str() + ";" );
+    }
+    return frozen;
 }
+
+static bool isSampler( GLenum type )
+{
+    switch ( type ) {
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_ARRAY:
+        case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static vector<std::string> samplerNames( const gl::GlslProgRef &shader )
+{
+    vector<std::string> names;
+    for ( auto &uniform : shader->getActiveUniforms() ) {
+        if ( isSampler( uniform.mType ) ) {
+            names.push_back( uniform.mName );
+        }
+    }
+    return names;
+}
+
+void MultipassShader::assignTextureUnits()
+{
+    // Instanced passes draw between the others, only how often units change depends on the order
+    mTextureUnits = TextureUnits();
+    vector<TextureUnits::Pass> passes;
+    for (unsigned int i = 0; i < mCompute.passCount(); i++) {
+        passes.push_back( { "compute" + std::to_string( i ), samplerNames( mCompute.program( i ) ) } );
+    }
+    for (unsigned int i = 0; i < mShaders.size(); i++) {
+        auto name = "buffer" + std::to_string( i );
+        passes.push_back( { name, isFused( i ) ? vector<std::string>() : samplerNames( mShaders[i] ) } );
+    }
+    passes.push_back( { "main", samplerNames( mMainShader ) } );
+    for (unsigned int i = 0; i < mInstances.passCount(); i++) {
+        passes.push_back( { "instanced" + std::to_string( i ), samplerNames( mInstances.program( i ) ) } );
+    }
+    mTextureUnits = TextureUnits( passes, mPassUnitLimit, mUnitLimit );
+}
+
+MultipassShader::Textures MultipassShader::textures() const
+{
+    Textures textures;
+    textures.packed = mPacked;
+    textures.arrays = mArrays.size();
+    textures.units = mTextureUnits.unitsUsed();
+    textures.unitLimit = mPassUnitLimit;
+    textures.rebindsPerFrame = mTextureUnits.rebindsPerFrame();
+    return textures;
+}
+
+gl::TextureBaseRef MultipassShader::samplerTexture( const std::string &uniform, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture ) const
+{
+    if ( uniform == "u_syphonTex" ) return syphonTexture;
+    if ( uniform == "u_cameraTex" ) return cameraTexture;
+    if ( uniform.compare( 0, 2, "u_" ) != 0 ) return nullptr;
+
+    auto name = uniform.substr( 2 );
+    if ( name.compare( 0, 6, "buffer" ) == 0 && name.size() > 6 && name.find_first_not_of( "0123456789", 6 ) == std::string::npos ) {
+        unsigned int j = atoi( name.c_str() + 6 );
+        return j < mFbos.size() && mFbos[j] ? mFbos[j]->getColorTexture() : nullptr;
+    }
+    auto texture = mTextures.find( name );
+    if ( texture != mTextures.end() ) return texture->second;
+    auto array = mArrays.find( name );
+    if ( array != mArrays.end() ) return array->second;
+    auto lut = mLuts.find( name );
+    if ( lut != mLuts.end() ) return lut->second;
+    auto global = mGlobalTextures.find( name );
+    if ( global != mGlobalTextures.end() ) return global->second;
+    for ( auto &blur : mBlurs ) {
+        if ( blur.name == name ) return blur.pyramid->texture();
+    }
+    return mCompute.imageTexture( name );
+}
+
+void MultipassShader::bindTextures( const gl::GlslProgRef &shader, const gl::TextureRef &syphonTexture, const gl::TextureRef &cameraTexture, int pass, const gl::FboRef &target )
+{
+    // Set non-texture uniforms
+    mSetUniforms( shader ); 
+
+    // Units were given out when the patch loaded and nothing is unbound,
+    // so most textures are already on their unit from an earlier pass.
+    // Skipping those is left to Cinder's context, which drops a bind that
+    // matches its cached binding for the unit.
+    if ( pass >= mTextureUnits.passCount() ) return;
+    for ( auto &binding : mTextureUnits.bindings( pass ) ) {
+        auto texture = samplerTexture( binding.first, syphonTexture, cameraTexture );
+        int location;
+        // The target is never sampled, aliased buffers share its FBO
+        if ( !texture || ( target && texture == target->getColorTexture() ) || !shader->findUniform( binding.first, &location ) ) continue;
+        texture->bind( binding.second );
+        shader->uniform( location, binding.second );
+    }
+}
+
+void MultipassShader::updateBuffers() 
+{
+    // Programs only, allocateBuffers() hands out the FBOs once every pass
+    // is known. All compile before anything is replaced.
+    int bufferCount = getBufferCount( mMainFragSource );
+    vector<gl::GlslProgRef> shaders;
+    for (int i = 0; i < bufferCount; i++) {
+        auto format = gl::GlslProg::Format().version( 330 )
+                                            .vertex( app::loadAsset( vertPath ) )
+                                            .fragment( app::loadAsset( mFragPath ) )
+                                            .define( "BUFFER_" + std::to_string( i ) );
+        if ( mLoopMode ) {
+            format = format.define( "LOOP" );
+        }
+        shaders.push_back( gl::GlslProg::create( format ) );
+    }
+    mShaders = shaders;
+    mFbos.resize( bufferCount );
+
+    gl::printError( "updateBuffers" );
+}
+
+int MultipassShader::getBufferCount( const std::string &source ) 
+{
+    return getDefineBlockCount( source, "BUFFER_" );
+}
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "NoiseTextures.h"
+#include "cinder/Log.h"
+#include "Constants.h"
+#include "CounterRandom.h"
+#include "MultipassShader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+using namespace ci;
+using namespace std;
+
+// Bump when the generators change, old cache files are then ignored
+#define NOISE_CACHE_VERSION 1
+#define BLUE_NOISE_SIGMA 1.9f
+
+static float fade( float t )
+{
+    return t * t * t * ( t * ( t * 6.f - 15.f ) + 10.f );
+}
+
+static float lerp( float a, float b, float t )
+{
+    return a + ( b - a ) * t;
+}
+
+// Improved noise gradients: the 12 cube edge directions. A table rather
+// than a switch, so the row loops have no branches to mispredict.
+static const float gradients[12][3] = {
+    {  1,  1,  0 }, { -1,  1,  0 }, {  1, -1,  0 }, { -1, -1,  0 },
+    {  1,  0,  1 }, { -1,  0,  1 }, {  1,  0, -1 }, { -1,  0, -1 },
+    {  0,  1,  1 }, {  0, -1,  1 }, {  0,  1, -1 }, {  0, -1, -1 }
+};
+
+static float gradient( uint32_t h, float x, float y, float z )
+{
+    const float *g = gradients[ h % 12 ];
+    return g[0] * x + g[1] * y + g[2] * z;
+}
+
+// One hash per lattice point of a period^3 tile, wrapping makes the noise tile
+struct Lattice {
+    Lattice( int period, uint64_t seed ) : period( period ), hashes( period * period * period )
+    {
+        for ( size_t i = 0; i < hashes.size(); i++ ) {
+            hashes[i] = uint32_t( CounterRandom::hash( seed, i, 0 ) >> 32 );
+        }
+    }
+
+    uint32_t at( int x, int y, int z ) const
+    {
+        x %= period; y %= period; z %= period;
+        return hashes[ ( z * period + y ) * period + x ];
+    }
+
+    // [-1, 1]
+    float value( int x, int y, int z ) const
+    {
+        return at( x, y, z ) * ( 2.f / 4294967296.f ) - 1.f;
+    }
+
+    int              period;
+    vector<uint32_t> hashes;
+};
+
+static float perlin( const Lattice &l, float x, float y, float z )
+{
+    int ix = int( x ), iy = int( y ), iz = int( z );
+    float fx = x - ix, fy = y - iy, fz = z - iz;
+    float u = fade( fx ), v = fade( fy ), w = fade( fz );
+    float x00 = lerp( gradient( l.at( ix, iy, iz ), fx, fy, fz ),                   gradient( l.at( ix + 1, iy, iz ), fx - 1.f, fy, fz ), u );
+    float x10 = lerp( gradient( l.at( ix, iy + 1, iz ), fx, fy - 1.f, fz ),         gradient( l.at( ix + 1, iy + 1, iz ), fx - 1.f, fy - 1.f, fz ), u );
+    float x01 = lerp( gradient( l.at( ix, iy, iz + 1 ), fx, fy, fz - 1.f ),         gradient( l.at( ix + 1, iy, iz + 1 ), fx - 1.f, fy, fz - 1.f ), u );
+    float x11 = lerp( gradient( l.at( ix, iy + 1, iz + 1 ), fx, fy - 1.f, fz - 1.f ), gradient( l.at( ix + 1, iy + 1, iz + 1 ), fx - 1.f, fy - 1.f, fz - 1.f ), u );
+    return lerp( lerp( x00, x10, v ), lerp( x01, x11, v ), w );
+}
+
+static float valueNoise( const Lattice &l, float x, float y, float z )
+{
+    int ix = int( x ), iy = int( y ), iz = int( z );
+    float u = fade( x - ix ), v = fade( y - iy ), w = fade( z - iz );
+    float x00 = lerp( l.value( ix, iy, iz ), l.value( ix + 1, iy, iz ), u );
+    float x10 = lerp( l.value( ix, iy + 1, iz ), l.value( ix + 1, iy + 1, iz ), u );
+    float x01 = lerp( l.value( ix, iy, iz + 1 ), l.value( ix + 1, iy, iz + 1 ), u );
+    float x11 = lerp( l.value( ix, iy + 1, iz + 1 ), l.value( ix + 1, iy + 1, iz + 1 ), u );
+    return lerp( lerp( x00, x10, v ), lerp( x01, x11, v ), w );
+}
+
+// Splits [0, count) in interleaved rows over the hardware threads
+template<typename F>
+static void parallelFor( int count, const F &f )
+{
+    int threads = max( 1, min( int( thread::hardware_concurrency() ), count ) );
+    vector<thread> workers;
+    for ( int t = 0; t < threads; t++ ) {
+        workers.emplace_back( [&f, t, threads, count] {
+            for ( int i = t; i < count; i += threads ) {
+                f( i );
+            }
+        } );
+    }
+    for ( auto &worker : workers ) {
+        worker.join();
+    }
+}
+
+void NoiseTextures::load( uint64_t seed )
+{
+    auto start = chrono::steady_clock::now();
+
+    auto volumeKey = "noise_volume_" + to_string( NOISE_VOLUME_SIZE ) + "_" + to_string( NOISE_VOLUME_PERIOD ) + "_" + to_string( seed );
+    auto blueKey = "blue_noise_" + to_string( BLUE_NOISE_SIZE ) + "_" + to_string( seed );
+
+    vector<float> volume, blue;
+    mFromCache = readCache( volumeKey, NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE * 4, volume ) &&
+                 readCache( blueKey, BLUE_NOISE_SIZE * BLUE_NOISE_SIZE, blue );
+    if ( !mFromCache ) {
+        volume = generateVolume( NOISE_VOLUME_SIZE, NOISE_VOLUME_PERIOD, seed );
+        blue = generateBlueNoise( BLUE_NOISE_SIZE, seed );
+        writeCache( volumeKey, volume );
+        writeCache( blueKey, blue );
+    }
+
+    // Noise is read far more than it is precise, half floats halve the fetch bandwidth
+    auto volumeFormat = gl::Texture3d::Format().internalFormat( GL_RGBA16F )
+                                               .dataType( GL_FLOAT )
+                                               .minFilter( GL_LINEAR )
+                                               .magFilter( GL_LINEAR )
+                                               .wrap( GL_REPEAT )
+                                               .wrapR( GL_REPEAT );
+    mVolume = gl::Texture3d::create( volume.data(), GL_RGBA, NOISE_VOLUME_SIZE, NOISE_VOLUME_SIZE, NOISE_VOLUME_SIZE, volumeFormat );
+
+    // Ranks are read per pixel, never filtered
+    auto blueFormat = gl::Texture2d::Format().internalFormat( GL_R16F )
+                                             .dataType( GL_FLOAT )
+                                             .minFilter( GL_NEAREST )
+                                             .magFilter( GL_NEAREST )
+                                             .wrap( GL_REPEAT );
+    mBlueNoise = gl::Texture2d::create( blue.data(), GL_RED, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, blueFormat );
+    gl::printError( "NoiseTextures::load" );
+
+    mLoadSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+    CI_LOG_I( "Noise textures " << ( mFromCache ? "read from cache" : "generated" ) << " in " << mLoadSeconds << " s" );
+}
+
+void NoiseTextures::bind( MultipassShader &shader ) const
+{
+    shader.setGlobalTexture( "noiseVolume", mVolume );
+    shader.setGlobalTexture( "noiseBlueMask", mBlueNoise );
+}
+
+vector<float> NoiseTextures::generateVolume( int size, int period, uint64_t seed )
+{
+    Lattice perlinA( period, CounterRandom::hash( seed, 0, 0 ) );
+    Lattice value( period, CounterRandom::hash( seed, 1, 0 ) );
+    Lattice perlinB( period, CounterRandom::hash( seed, 2, 0 ) );
+    Lattice perlinC( period, CounterRandom::hash( seed, 3, 0 ) );
+
+    // Texel centers, so a linear fetch at pos / period returns the noise at pos
+    float scale = float( period ) / size;
+    vector<float> rgba( size_t( size ) * size * size * 4 );
+    parallelFor( size, [&] ( int z ) {
+        float pz = ( z + .5f ) * scale;
+        for ( int y = 0; y < size; y++ ) {
+            float py = ( y + .5f ) * scale;
+            float *row = &rgba[ ( size_t( z ) * size + y ) * size * 4 ];
+            for ( int x = 0; x < size; x++ ) {
+                float px = ( x + .5f ) * scale;
+                row[ x * 4 + 0 ] = perlin( perlinA, px, py, pz );
+                row[ x * 4 + 1 ] = valueNoise( value, px, py, pz );
+                row[ x * 4 + 2 ] = perlin( perlinB, px, py, pz );
+                row[ x * 4 + 3 ] = perlin( perlinC, px, py, pz );
+            }
+        }
+    } );
+    return rgba;
+}
+
+vector<float> NoiseTextures::generateBlueNoise( int size, uint64_t seed )
+{
+    // Void-and-cluster (Ulichney 1993) with a toroidal gaussian energy
+    int n = size * size, mask = size - 1;
+    vector<float> kernel( n );
+    for ( int y = 0; y < size; y++ ) {
+        for ( int x = 0; x < size; x++ ) {
+            float dx = float( min( x, size - x ) ), dy = float( min( y, size - y ) );
+            kernel[ y * size + x ] = exp( -( dx * dx + dy * dy ) / ( 2.f * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA ) );
+        }
+    }
+
+    vector<uint8_t> pattern( n, 0 );
+    vector<float> energy( n, 0.f );
+    auto splat = [&] ( int i, float sign ) {
+        // Too little work per call to be worth threads, rows vectorize
+        int px = i & mask, py = i / size;
+        for ( int y = 0; y < size; y++ ) {
+            const float *k = &kernel[ ( ( y - py ) & mask ) * size ];
+            float *e = &energy[ y * size ];
+            for ( int x = 0; x < size; x++ ) {
+                e[x] += sign * k[ ( x - px ) & mask ];
+            }
+        }
+    };
+    auto set = [&] ( int i, uint8_t on ) {
+        pattern[i] = on;
+        splat( i, on ? 1.f : -1.f );
+    };
+    // Tightest cluster: the set pixel with the most energy, largest void: the empty one with the least
+    auto find = [&] ( uint8_t on, bool highest ) {
+        int best = -1;
+        for ( int i = 0; i < n; i++ ) {
+            if ( pattern[i] == on && ( best < 0 || ( highest ? energy[i] > energy[best] : energy[i] < energy[best] ) ) ) {
+                best = i;
+            }
+        }
+        return best;
+    };
+
+    // Initial binary pattern: 10% random points, relaxed until moving the
+    // tightest cluster to the largest void changes nothing
+    int ones = max( 1, n / 10 );
+    for ( int placed = 0, counter = 0; placed < ones; counter++ ) {
+        int i = int( CounterRandom::uniform( seed, 4, counter ) * n );
+        if ( !pattern[i] ) {
+            set( i, 1 );
+            placed++;
+        }
+    }
+    for ( int iteration = 0; iteration < n; iteration++ ) {
+        int cluster = find( 1, true );
+        set( cluster, 0 );
+        int gap = find( 0, false );
+        set( gap, 1 );
+        if ( gap == cluster ) break;
+    }
+
+    vector<uint8_t> prototype = pattern;
+    vector<float> prototypeEnergy = energy;
+    vector<int> ranks( n );
+
+    // Phase 1: remove the prototype points, tightest clusters get the lowest ranks
+    for ( int rank = ones - 1; rank >= 0; rank-- ) {
+        int cluster = find( 1, true );
+        set( cluster, 0 );
+        ranks[ cluster ] = rank;
+    }
+
+    // Phase 2: fill the largest voids up to half
+    pattern = prototype;
+    energy = prototypeEnergy;
+    int rank = ones;
+    for ( ; rank < n / 2; rank++ ) {
+        int gap = find( 0, false );
+        set( gap, 1 );
+        ranks[ gap ] = rank;
+    }
+
+    // Phase 3: past half, the empty pixels are the minority, so rank the
+    // tightest clusters of empty pixels instead
+    for ( auto &p : pattern ) {
+        p = !p;
+    }
+    fill( energy.begin(), energy.end(), 0.f );
+    for ( int i = 0; i < n; i++ ) {
+        if ( pattern[i] ) splat( i, 1.f );
+    }
+    for ( ; rank < n; rank++ ) {
+        int cluster = find( 1, true );
+        set( cluster, 0 );
+        ranks[ cluster ] = rank;
+    }
+
+    vector<float> values( n );
+    for ( int i = 0; i < n; i++ ) {
+        values[i] = ( ranks[i] + .5f ) / n;
+    }
+    return values;
+}
+
+/* Privates */
+
+fs::path NoiseTextures::cachePath( const string &key )
+{
+    return getHomeDirectory() / CACHE_FOLDER / ( key + "_v" + to_string( NOISE_CACHE_VERSION ) + ".f32" );
+}
+
+bool NoiseTextures::readCache( const string &key, size_t count, vector<float> &data )
+{
+    auto path = cachePath( key );
+    ifstream file( path.string(), ios::binary | ios::ate );
+    if ( !file ) return false;
+
+    // Raw floats, anything else than the expected count is a partial write
+    auto bytes = count * sizeof( float );
+    if ( size_t( file.tellg() ) != bytes ) return false;
+    data.resize( count );
+    file.seekg( 0 );
+    return bool( file.read( reinterpret_cast<char*>( data.data() ), bytes ) );
+}
+
+void NoiseTextures::writeCache( const string &key, const vector<float> &data )
+{
+    auto path = cachePath( key );
+    try {
+        fs::create_directories( path.parent_path() );
+        ofstream file( path.string(), ios::binary );
+        file.write( reinterpret_cast<const char*>( data.data() ), data.size() * sizeof( float ) );
+    }
+    catch ( const exception &e ) {
+        // Read-only home on a render node: generate every time
+        CI_LOG_W( "Cannot write noise cache " << path << ": " << e.what() );
+    }
+}
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "OfflineRenderer.h"
+#include "cinder/app/App.h"
+#include "cinder/ImageIo.h"
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+#include "Constants.h"
+#include "ParameterSweep.h"
+#include "Utils.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+using namespace ci;
+using namespace std;
+
+namespace {
+    // Hands the job's render targets back to the pool however it ends, so a
+    // failed job in the render server does not hold them against the budget
+    class PoolGuard {
+        public:
+            PoolGuard( FboPool &pool, MultipassShader &shader ) : mPool( pool ), mShader( shader ) {}
+            ~PoolGuard()
+            {
+                mPool.release( atlas );
+                mShader.releaseFbos();
+            }
+
+            gl::FboRef atlas;
+
+        private:
+            FboPool         &mPool;
+            MultipassShader &mShader;
+    };
+}
+
+OfflineRenderer::OfflineRenderer()
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    waitForWrites( 0 );
+}
+
+bool OfflineRenderer::render( const RenderJob &job, const atomic<bool> *cancelled )
+{
+    if ( job.isSweep() ) {
+        return renderSweep( job, cancelled );
+    }
+
+    Timer timer( true );
+    loadPatch( job );
+    mLoadSeconds = timer.getSeconds();
+    checkCompiled( job );
+
+    auto &shader = *mCurrent->shader;
+    PoolGuard guard( mFboPool, shader );
+
+    if ( job.frameCount() > 1 ) {
+        fs::create_directories( job.output );
+    }
+
+    // Every frame is a function of its time only, except for buffers fed back
+    // from the previous frame: those are replayed from frame 0 up to this shard
+    shader.clearFbos();
+    if ( job.firstFrame() > 0 && shader.hasFeedback() ) {
+        CI_LOG_I( job.patch << " uses feedback, replaying " << job.firstFrame() << " frames" );
+        for ( int frame = 0; frame < job.firstFrame(); frame++ ) {
+            renderFrame( job, frame );
+        }
+    }
+
+    // PNG encoding runs on worker threads, at most one frame in flight per core
+    size_t maxPendingWrites = max( 1u, thread::hardware_concurrency() );
+    mFramesRendered = 0;
+    mWriteSeconds = 0;
+    mFrameHashes.assign( job.lastFrame() - job.firstFrame(), 0 );
+    timer.start();
+    for ( int frame = job.firstFrame(); frame < job.lastFrame(); frame++ ) {
+        if ( cancelled && *cancelled ) break;
+
+        renderFrame( job, frame );
+        writeFrame( job.framePath( frame ), job.hashesPath.empty() ? nullptr : &mFrameHashes[ frame - job.firstFrame() ] );
+        mFramesRendered++;
+
+        Timer writeTimer( true );
+        waitForWrites( maxPendingWrites );
+        mWriteSeconds += writeTimer.getSeconds();
+    }
+    waitForWrites( 0 );
+    mRenderSeconds = timer.getSeconds();
+
+    if ( !job.hashesPath.empty() ) {
+        map<int, uint64_t> hashes;
+        for ( int i = 0; i < mFramesRendered; i++ ) {
+            hashes[ job.firstFrame() + i ] = mFrameHashes[i];
+        }
+        writeHashes( job.hashesPath, hashes );
+    }
+
+    return mFramesRendered == job.lastFrame() - job.firstFrame();
+}
+
+bool OfflineRenderer::renderSweep( const RenderJob &job, const atomic<bool> *cancelled )
+{
+    // The patch at tile size, each variant's passes rendered and copied into
+    // its tile. Nothing is read back until the atlas is complete.
+    RenderJob tileJob = job;
+    tileJob.width = job.tileWidth;
+    tileJob.height = job.tileHeight;
+    Timer timer( true );
+    loadPatch( tileJob );
+    mLoadSeconds = timer.getSeconds();
+    checkCompiled( tileJob );
+    auto &shader = *mCurrent->shader;
+    PoolGuard guard( mFboPool, shader );
+
+    auto &params = mCurrent->patch->params();
+    ParameterSweep sweep( params, job.sweep, job.variants, job.seed, ivec2( job.tileWidth, job.tileHeight ) );
+    auto atlasSize = sweep.atlasSize();
+    GLint maxSize = 0;
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxSize );
+    if ( atlasSize.x > maxSize || atlasSize.y > maxSize ) {
+        throw Exception( "A " + to_string( atlasSize.x ) + "x" + to_string( atlasSize.y ) + " atlas is over the " + to_string( maxSize ) + " texture limit: fewer variants or smaller tiles" );
+    }
+    auto atlas = guard.atlas = mFboPool.acquire( atlasSize.x, atlasSize.y );
+    {
+        gl::ScopedFramebuffer scopedFramebuffer( atlas );
+        gl::clear();
+    }
+
+    // A still at the start time, as a single frame render would give.
+    // Feedback buffers start over for each variant.
+    mFramesRendered = 0;
+    mWriteSeconds = 0;
+    timer.start();
+    for ( int v = 0; v < sweep.variantCount(); v++ ) {
+        if ( cancelled && *cancelled ) break;
+
+        sweep.apply( v, params );
+        shader.clearFbos();
+        renderFrame( tileJob, 0 );
+
+        // Tile origins are top-left, the atlas framebuffer's bottom-left
+        auto origin = sweep.tileOrigin( v );
+        int y = atlasSize.y - origin.y - job.tileHeight;
+        shader.mMainFbo->blitTo( atlas, shader.mMainFbo->getBounds(), Area( origin.x, y, origin.x + job.tileWidth, y + job.tileHeight ) );
+        mFramesRendered++;
+    }
+    auto surface = atlas->readPixels8u( atlas->getBounds() );
+    mRenderSeconds = timer.getSeconds();
+
+    // The atlas, and the table of each tile's values next to it
+    auto atlasPath = job.output.has_extension() ? job.output : job.output / ( job.patch + "_sweep.png" );
+    auto tablePath = atlasPath;
+    tablePath.replace_extension( ".json" );
+    if ( atlasPath.has_parent_path() ) {
+        fs::create_directories( atlasPath.parent_path() );
+    }
+    timer.start();
+    writeImage( atlasPath, surface );
+    sweep.write( tablePath, job.patch, job.paramsPath, job.startTime, job.seed, params, mFramesRendered );
+    mWriteSeconds = timer.getSeconds();
+    return mFramesRendered == sweep.variantCount();
+}
+
+void OfflineRenderer::checkCompiled( const RenderJob &job )
+{
+    auto &shader = *mCurrent->shader;
+    if ( shader.mShaderCompilationFailed ) {
+        string message = shader.mShaderCompileErrorMessage;
+        shader.releaseFbos();
+        mPatches.erase( job.patch + ( job.loop ? "#loop" : "" ) );
+        mCurrent = nullptr;
+        throw Exception( "Shader compilation failed for " + job.patch + ": " + message );
+    }
+}
+
+void OfflineRenderer::loadPatch( const RenderJob &job )
+{
+    if ( !mInitialized ) {
+        gl::disableDepthRead();
+        gl::disableDepthWrite();
+        gl::disableBlending();
+        mNoiseTextures.load();
+        mFboPool.setBudget( size_t( GPU_MEMORY_BUDGET_MB ) << 20 );
+        mInitialized = true;
+    }
+
+    // LOOP is a compile-time define, so looping and non-looping programs are cached apart
+    auto key = job.patch + ( job.loop ? "#loop" : "" );
+    auto &cached = mPatches[ key ];
+    mCurrent = &cached;
+    mWarm = cached.shader != nullptr;
+    cached.lastUsed = ++mJobCount;
+
+    if ( !mWarm ) {
+        cached.patch = make_unique<Patch>( job.patch );
+        cached.shader = make_unique<MultipassShader>();
+        cached.shader->setFboPool( &mFboPool );
+        mAudioTexture.update( mFrameState.audio );
+        cached.shader->setGlobalTexture( "audioTex", mAudioTexture.texture() );
+        mNoiseTextures.bind( *cached.shader );
+        cached.shader->init( job.width, job.height, [this] ( gl::GlslProgRef shader ) { mFrameState.bind( shader ); }, job.loop );
+        if ( cached.patch->bundle() ) {
+            cached.shader->load( cached.patch->bundle() );
+        }
+        else {
+            cached.shader->load( cached.patch->path() );
+        }
+        evictPatches();
+    }
+    else {
+        cached.shader->resize( job.width, job.height );
+        cached.patch->params().reload();
+    }
+
+    // Sources edited since the program was compiled
+    auto shaderPath = app::getAssetPath( cached.patch->shaderPath() );
+    if ( !cached.patch->bundle() && !shaderPath.empty() ) {
+        auto shaderTime = fs::last_write_time( shaderPath );
+        for ( auto &name : { "shader.comp", "instances.vert", "instances.frag" } ) {
+            auto passPath = shaderPath.parent_path() / name;
+            if ( fs::exists( passPath ) ) {
+                shaderTime = std::max( shaderTime, fs::last_write_time( passPath ) );
+            }
+        }
+        if ( mWarm && shaderTime > cached.shaderTime ) {
+            cached.shader->reload();
+            mWarm = false;
+        }
+        cached.shaderTime = shaderTime;
+    }
+
+    if ( !job.paramsPath.empty() ) {
+        cached.patch->params().load( job.paramsPath );
+    }
+    cached.patch->params().setSeed( job.seed );
+    applyOverrides( job );
+}
+
+void OfflineRenderer::applyOverrides( const RenderJob &job )
+{
+    auto &params = mCurrent->patch->params();
+    for ( auto &entry : job.overrides ) {
+        bool found = false;
+        for ( auto &param : params.get() ) {
+            if ( param->name == entry.first ) {
+                param->baseValue = param->currentValue = stof( entry.second );
+                found = true;
+            }
+        }
+
+        float r, g, b;
+        for ( auto &color : params.getColors() ) {
+            if ( color->name == entry.first && sscanf( entry.second.c_str(), "%f,%f,%f", &r, &g, &b ) == 3 ) {
+                color->value = Colorf( r, g, b );
+                found = true;
+            }
+        }
+
+        if ( !found ) {
+            CI_LOG_W( "No parameter " << entry.first << " in " << job.patch );
+        }
+    }
+}
+
+void OfflineRenderer::evictPatches()
+{
+    while ( mPatches.size() > RENDER_CACHED_PATCHES ) {
+        auto oldest = mPatches.begin();
+        for ( auto it = mPatches.begin(); it != mPatches.end(); it++ ) {
+            if ( it->second.lastUsed < oldest->second.lastUsed ) {
+                oldest = it;
+            }
+        }
+        if ( oldest->second.shader ) {
+            oldest->second.shader->releaseFbos();
+        }
+        mPatches.erase( oldest );
+    }
+}
+
+void OfflineRenderer::renderFrame( const RenderJob &job, int frame )
+{
+    if ( job.samples <= 1 ) {
+        renderPasses( job, frame, 0 );
+        return;
+    }
+
+    // Sub-frames spread evenly over the frame interval
+    auto &fbo = mCurrent->shader->mMainFbo;
+    mAccumulator.begin( job.width, job.height );
+    for ( int i = 0; i < job.samples; i++ ) {
+        renderPasses( job, frame, i / (double)job.samples );
+        mAccumulator.add( fbo->getColorTexture(), 1.f / job.samples );
+    }
+    mAccumulator.resolve( fbo );
+}
+
+void OfflineRenderer::renderPasses( const RenderJob &job, int frame, double offset )
+{
+    auto &params = mCurrent->patch->params();
+    double t = job.frameTime( frame, offset );
+    for ( auto &param : params.get() ) {
+        param->tick( t );
+    }
+
+    double beatLengthSeconds = 60. / job.bpm;
+    mFrameState.time = (float)t;
+    mFrameState.presentTime = t;
+    mFrameState.frameNumber = (float)frame;
+    mFrameState.tick = (float)( fmod( t, beatLengthSeconds ) / beatLengthSeconds );
+    mFrameState.section = 0;
+    mFrameState.resolution = vec2( job.width, job.height );
+    mFrameState.mouse = mFrameState.resolution * .5f;
+    mFrameState.captureParams( params );
+
+    ivec2 size( job.width, job.height );
+    gl::ScopedViewport scopedViewport( ivec2( 0 ), size );
+    gl::ScopedMatrices scopedMatrices;
+    gl::setMatricesWindow( size, true );
+    mCurrent->shader->render( Rectf( 0.f, 0.f, size.x, size.y ), nullptr, nullptr );
+    gl::printError( "OfflineRenderer::renderPasses" );
+}
+
+static uint64_t hashSurface( const Surface8u &surface )
+{
+    // FNV-1a over the visible bytes of each row
+    uint64_t h = 14695981039346656037ull;
+    size_t rowSize = surface.getWidth() * surface.getPixelInc();
+    for ( int y = 0; y < surface.getHeight(); y++ ) {
+        const uint8_t *row = surface.getData() + y * surface.getRowBytes();
+        for ( size_t x = 0; x < rowSize; x++ ) {
+            h = ( h ^ row[x] ) * 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+void OfflineRenderer::writeFrame( const fs::path &path, uint64_t *hash )
+{
+    auto &fbo = mCurrent->shader->mMainFbo;
+    auto surface = fbo->readPixels8u( fbo->getBounds() );
+    mWrites.push_back( async( launch::async, [surface, path, hash] {
+        if ( hash ) {
+            *hash = hashSurface( surface );
+        }
+        try {
+            writeImage( path, surface );
+        }
+        catch ( const std::exception &exc ) {
+            CI_LOG_E( "Failed to write " << path << ": " << exc.what() );
+        }
+    } ) );
+}
+
+void OfflineRenderer::waitForWrites( size_t maxPending )
+{
+    while ( mWrites.size() > maxPending ) {
+        mWrites.front().wait();
+        mWrites.pop_front();
+    }
+}
+
+map<int, uint64_t> OfflineRenderer::readHashes( const fs::path &path )
+{
+    map<int, uint64_t> hashes;
+    ifstream file( path.string() );
+    int frame;
+    string hash;
+    while ( file >> frame >> hash ) {
+        hashes[ frame ] = stoull( hash, nullptr, 16 );
+    }
+    return hashes;
+}
+
+void OfflineRenderer::writeHashes( const fs::path &path, const map<int, uint64_t> &hashes )
+{
+    ofstream file( path.string() );
+    char line[40];
+    for ( auto &entry : hashes ) {
+        snprintf( line, sizeof( line ), "%05d %016llx\n", entry.first, (unsigned long long)entry.second );
+        file << line;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "Output.h"
+#include "cinder/Timer.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+Output::Output( const string &name, OutputType type, int width, int height ) : mName( name ), mType( type ), mWidth( width ), mHeight( height )
+{
+}
+
+Output::~Output()
+{
+}
+
+void Output::present( const gl::FboRef &master )
+{
+    // FBOs are not shared between contexts, allocate in the presenting one
+    if ( !mFbo ) {
+        auto textureFormat = gl::Texture::Format().minFilter( GL_LINEAR ).magFilter( GL_LINEAR );
+        mFbo = gl::Fbo::create( mWidth, mHeight, gl::Fbo::Format().colorTexture( textureFormat ).disableDepth() );
+        mTexture = mFbo->getColorTexture();
+        mQuery = gl::QueryTimeSwapped::create();
+    }
+
+    Timer timer( true );
+    mQuery->begin();
+
+    // Normalized source / destination rects, GL orientation (bottom-up)
+    ivec2 masterSize = master->getSize();
+    Rectf src, dst;
+    computeRects( masterSize, src, dst );
+
+    gl::ScopedFramebuffer scopedFbo( mFbo );
+    if ( mFit == LETTERBOX ) {
+        gl::clear( ColorA( 0.f, 0.f, 0.f, 1.f ) );
+    }
+
+    if ( mFilter == MIPMAP ) {
+        // Master mip chain is built once per frame by Outputs::present
+        gl::ScopedViewport scopedViewport( ivec2( 0 ), mFbo->getSize() );
+        gl::ScopedMatrices scopedMatrices;
+        gl::setMatricesWindow( mFbo->getSize(), false );
+        auto texture = master->getColorTexture();
+        gl::ScopedGlslProg scopedShader( gl::getStockShader( gl::ShaderDef().texture() ) );
+        gl::ScopedTextureBind scopedTexture( texture, 0 );
+        texture->setMinFilter( GL_LINEAR_MIPMAP_LINEAR );
+        gl::drawSolidRect( Rectf( dst.x1 * mWidth, dst.y1 * mHeight, dst.x2 * mWidth, dst.y2 * mHeight ),
+                           vec2( src.x1, src.y1 ), vec2( src.x2, src.y2 ) );
+        texture->setMinFilter( GL_LINEAR );
+    }
+    else {
+        Area srcArea( src.x1 * masterSize.x, src.y1 * masterSize.y, src.x2 * masterSize.x, src.y2 * masterSize.y );
+        Area dstArea( dst.x1 * mWidth, dst.y1 * mHeight, dst.x2 * mWidth, dst.y2 * mHeight );
+        master->blitTo( mFbo, srcArea, dstArea, mFilter == NEAREST ? GL_NEAREST : GL_LINEAR, GL_COLOR_BUFFER_BIT );
+    }
+
+    mQuery->end();
+    mGpuMilliseconds = mQuery->getElapsedMilliseconds();
+    mCpuMilliseconds = timer.getSeconds() * 1000.;
+    gl::printError( "Output::present" );
+}
+
+void Output::computeRects( const ivec2 &masterSize, Rectf &src, Rectf &dst )
+{
+    // Crop is given top-left origin, GL textures are bottom-up
+    src = Rectf( mCrop.x1, 1.f - mCrop.y2, mCrop.x2, 1.f - mCrop.y1 );
+    dst = Rectf( 0.f, 0.f, 1.f, 1.f );
+
+    float srcAspect = ( src.getWidth() * masterSize.x ) / ( src.getHeight() * masterSize.y );
+    float dstAspect = (float)mWidth / mHeight;
+
+    if ( mFit == LETTERBOX ) {
+        if ( srcAspect > dstAspect ) {
+            float h = dstAspect / srcAspect;
+            dst = Rectf( 0.f, .5f - h * .5f, 1.f, .5f + h * .5f );
+        }
+        else {
+            float w = srcAspect / dstAspect;
+            dst = Rectf( .5f - w * .5f, 0.f, .5f + w * .5f, 1.f );
+        }
+    }
+    else if ( mFit == FILL ) {
+        vec2 center( ( src.x1 + src.x2 ) * .5f, ( src.y1 + src.y2 ) * .5f );
+        float w = src.getWidth(), h = src.getHeight();
+        if ( srcAspect > dstAspect ) {
+            w *= dstAspect / srcAspect;
+        }
+        else {
+            h *= srcAspect / dstAspect;
+        }
+        src = Rectf( center.x - w * .5f, center.y - h * .5f, center.x + w * .5f, center.y + h * .5f );
+    }
+}
+
+OutputType Output::stringToType( const string typeStr )
+{
+    if ( typeStr == "syphon" ) return SYPHON;
+    else if ( typeStr == "window" ) return WINDOW;
+    else return OFFSCREEN;
+}
+
+OutputFit Output::stringToFit( const string fitStr )
+{
+    if ( fitStr == "stretch" ) return STRETCH;
+    else if ( fitStr == "letterbox" ) return LETTERBOX;
+    else return FILL;
+}
+
+OutputFilter Output::stringToFilter( const string filterStr )
+{
+    if ( filterStr == "nearest" ) return NEAREST;
+    else if ( filterStr == "mipmap" ) return MIPMAP;
+    else return LINEAR;
+}
\ No newline at end of file
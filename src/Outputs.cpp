@@ -0,0 +1,82 @@
+#include "Outputs.h"
+#include "cinder/app/App.h"
+#include "cinder/Log.h"
+
+using namespace ci;
+using namespace std;
+
+Outputs::Outputs() : mMasterSize( 0, 0 )
+{
+}
+
+Outputs::~Outputs()
+{
+}
+
+void Outputs::load( const fs::path &path )
+{
+    mOutputs.clear();
+    if ( app::getAssetPath( path ).empty() ) {
+        return;
+    }
+
+    try {
+        JsonTree json( app::loadAsset( path ) );
+
+        // Optional fixed master resolution, otherwise the scene window size is used
+        if ( json.hasChild( "master" ) ) {
+            mMasterSize = ivec2( json["master"]["width"].getValue<int>(), json["master"]["height"].getValue<int>() );
+        }
+
+        JsonTree outputs = json.getChild( "outputs" );
+        for ( auto it = outputs.begin(); it != outputs.end(); it++ ) {
+            auto output = make_shared<Output>( (*it)["name"].getValue(),
+                                               Output::stringToType( (*it)["type"].getValue() ),
+                                               (*it)["width"].getValue<int>(),
+                                               (*it)["height"].getValue<int>() );
+            if ( it->hasChild( "fit" ) ) {
+                output->mFit = Output::stringToFit( (*it)["fit"].getValue() );
+            }
+            if ( it->hasChild( "filter" ) ) {
+                output->mFilter = Output::stringToFilter( (*it)["filter"].getValue() );
+            }
+            if ( it->hasChild( "crop" ) ) {
+                auto crop = (*it)["crop"];
+                float x = crop["x"].getValue<float>(), y = crop["y"].getValue<float>();
+                output->mCrop = Rectf( x, y, x + crop["width"].getValue<float>(), y + crop["height"].getValue<float>() );
+            }
+            mOutputs.push_back( output );
+            CI_LOG_I( "Output " << output->mName << ": " << output->mWidth << "x" << output->mHeight );
+        }
+    }
+    catch ( const std::exception &e ) {
+        CI_LOG_E( "Failed to load outputs: " << path << " " << e.what() );
+    }
+}
+
+void Outputs::present( const gl::FboRef &master )
+{
+    if ( mOutputs.empty() ) return;
+
+    bool needsMipmaps = false;
+    for ( auto &output : mOutputs ) {
+        needsMipmaps |= output->mFilter == MIPMAP;
+    }
+    if ( needsMipmaps ) {
+        gl::ScopedTextureBind scopedTexture( master->getColorTexture() );
+        glGenerateMipmap( GL_TEXTURE_2D );
+    }
+
+    for ( auto &output : mOutputs ) {
+        output->present( master );
+    }
+}
+
+double Outputs::gpuMilliseconds()
+{
+    double total = 0;
+    for ( auto &output : mOutputs ) {
+        total += output->mGpuMilliseconds;
+    }
+    return total;
+}
\ No newline at end of file
@@ -1,6 +1,26 @@
 #include "Parameter.h"
 #include "cinder/CinderMath.h"
 
+// Modulator first, then any active animation from the base value
+static Animation& animation( Animation &anim ) { return anim; }
+static Animation& animation( const std::shared_ptr<Animation> &anim ) { return *anim; }
+
+template<typename Animations>
+static float valueAt( const double t, float value, float baseValue, uint64_t seed, Modulator *modulator, Animations &animations )
+{
+    if ( modulator != nullptr ) {
+      value = baseValue + modulator->tick( t, seed );
+    }
+
+    for ( auto &it : animations ) {
+      auto &anim = animation( it );
+      if ( anim.isActive( t ) ) {
+        value = ci::lerp( baseValue, anim.mTargetValue, anim.tick( t ) );
+      }
+    }
+    return value;
+}
+
 Parameter::Parameter()
 {
 }
@@ -11,16 +31,7 @@ Parameter::~Parameter()
 
 void Parameter::tick( const double t ) 
 {   
-    if ( modulator != nullptr ) {
-      currentValue = baseValue + modulator->tick( t );
-    }
-
-    for ( size_t i = 0; i < animations.size(); i++ ) {
-      auto anim = animations[ i ];      
-      if ( anim->isActive() ) {
-        currentValue = ci::lerp( baseValue, anim->mTargetValue, anim->tick() );
-      }
-    }
+    currentValue = valueAt( t, currentValue, baseValue, seed, modulator.get(), animations );
   }
 
   bool Parameter::hasModulator() {
@@ -38,3 +49,20 @@ void Parameter::tick( const double t )
     currentValue = baseValue;
   }
 
+  void ParameterMotion::capture( const Parameter &parameter ) {
+    // Assigned in place, so steady state does not allocate
+    baseValue = parameter.baseValue;
+    seed = parameter.seed;
+    modulated = parameter.modulator != nullptr;
+    if ( modulated ) {
+      modulator = *parameter.modulator;
+    }
+    animations.resize( parameter.animations.size() );
+    for ( size_t i = 0; i < animations.size(); i++ ) {
+      animations[ i ] = *parameter.animations[ i ];
+    }
+  }
+
+  float ParameterMotion::tick( const double t, float value ) {
+    return valueAt( t, value, baseValue, seed, modulated ? &modulator : nullptr, animations );
+  }
\ No newline at end of file
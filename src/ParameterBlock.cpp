@@ -0,0 +1,267 @@
+#include "ParameterBlock.h"
+#include "cinder/Exception.h"
+#include "cinder/Log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ci;
+using namespace std;
+
+// Tries before a read gives up on a writer stuck inside the lock
+static const int READ_ATTEMPTS = 64;
+
+// Takes the lock held at sequence from a writer that died inside it. A
+// preempted one still has its pid, it keeps the lock. No pid yet means it
+// died right after locking, trusted only when the caller waited it out.
+// The generation is bumped so the other writers find their indices again.
+static bool takeOver( couleurs_params_block *block, uint32_t sequence, bool waited )
+{
+    if ( !( sequence & 1 ) ) return false;
+    uint32_t owner = __atomic_load_n( &block->owner, __ATOMIC_RELAXED );
+    bool dead = owner ? kill( (pid_t)owner, 0 ) != 0 && errno == ESRCH : waited;
+    if ( !dead || !__atomic_compare_exchange_n( &block->sequence, &sequence, sequence + 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+        return false;
+    }
+    CI_LOG_W( "A controller died holding the parameter block, taking it over" );
+    __atomic_store_n( &block->owner, (uint32_t)getpid(), __ATOMIC_RELAXED );
+    __atomic_store_n( &block->generation, block->generation + 1, __ATOMIC_RELEASE );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    return true;
+}
+
+// couleurs_params_write_begin(), then the lock of a dead writer
+static bool writeBegin( couleurs_params_block *block )
+{
+    uint32_t held = __atomic_load_n( &block->sequence, __ATOMIC_RELAXED );
+    if ( couleurs_params_write_begin( block ) ) return true;
+    uint32_t sequence = __atomic_load_n( &block->sequence, __ATOMIC_RELAXED );
+    return takeOver( block, sequence, sequence == held );
+}
+
+ParameterBlock::~ParameterBlock()
+{
+    close();
+}
+
+void ParameterBlock::open( const string &name )
+{
+    close();
+    int fd = shm_open( name.c_str(), O_CREAT | O_RDWR, 0600 );
+    if ( fd < 0 ) {
+        throw Exception( "Cannot open the parameter block " + name + ": " + strerror( errno ) );
+    }
+
+    // Sized once: macOS refuses to truncate a shared memory object again.
+    // One left too small by something else is recreated.
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 ) {
+        ::close( fd );
+        throw Exception( "Cannot stat the parameter block " + name + ": " + strerror( errno ) );
+    }
+    if ( info.st_size > 0 && info.st_size < (off_t)sizeof( couleurs_params_block ) ) {
+        ::close( fd );
+        shm_unlink( name.c_str() );
+        fd = shm_open( name.c_str(), O_CREAT | O_RDWR, 0600 );
+        if ( fd < 0 ) {
+            throw Exception( "Cannot recreate the parameter block " + name + ": " + strerror( errno ) );
+        }
+        info.st_size = 0;
+    }
+    if ( info.st_size == 0 && ftruncate( fd, sizeof( couleurs_params_block ) ) != 0 ) {
+        ::close( fd );
+        throw Exception( "Cannot size the parameter block " + name + ": " + strerror( errno ) );
+    }
+    void *memory = mmap( nullptr, sizeof( couleurs_params_block ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( memory == MAP_FAILED ) {
+        throw Exception( "Cannot map the parameter block " + name + ": " + strerror( errno ) );
+    }
+
+    // Left by an older build: start over. Otherwise controllers that kept it
+    // mapped across a restart carry on once the next patch is described.
+    mBlock = static_cast<couleurs_params_block*>( memory );
+    mName = name;
+    if ( mBlock->magic != COULEURS_PARAMS_MAGIC || mBlock->version != COULEURS_PARAMS_VERSION ) {
+        memset( mBlock, 0, sizeof( couleurs_params_block ) );
+        mBlock->magic = COULEURS_PARAMS_MAGIC;
+        mBlock->version = COULEURS_PARAMS_VERSION;
+    }
+    // A controller killed inside the lock, or the app while describing
+    else if ( takeOver( mBlock, mBlock->sequence, true ) ) {
+        couleurs_params_write_end( mBlock );
+    }
+}
+
+void ParameterBlock::close()
+{
+    if ( !mBlock ) return;
+
+    // Not unlinked: the name stays valid for the next run. Writers see an
+    // empty patch until then.
+    if ( writeBegin( mBlock ) ) {
+        mBlock->count = 0;
+        __atomic_store_n( &mBlock->generation, mBlock->generation + 1, __ATOMIC_RELEASE );
+        couleurs_params_write_end( mBlock );
+    }
+    munmap( mBlock, sizeof( couleurs_params_block ) );
+    mBlock = nullptr;
+}
+
+void ParameterBlock::describe( Parameters &parameters )
+{
+    if ( !mBlock ) return;
+
+    // The values stay with the previous patch, the next describe() tries again
+    if ( !writeBegin( mBlock ) ) {
+        CI_LOG_W( "The parameter block stayed locked, not describing the patch" );
+        return;
+    }
+    uint32_t count = 0;
+    auto add = [&] ( const string &name, uint32_t type, float min, float max, const float *value ) {
+        if ( count == COULEURS_PARAMS_MAX_ENTRIES || name.size() >= COULEURS_PARAMS_NAME_SIZE ) {
+            CI_LOG_W( "Not in the parameter block: " << name );
+            return;
+        }
+        auto &entry = mBlock->entries[ count ];
+        memset( entry.name, 0, sizeof( entry.name ) );
+        memcpy( entry.name, name.data(), name.size() );
+        entry.type = type;
+        entry.min = min;
+        entry.max = max;
+        memcpy( mBlock->values[ count ], value, sizeof( float ) * ( type == COULEURS_PARAMS_COLOR ? 3 : 1 ) );
+        mBlock->touched[ count ] = 0;
+        count++;
+    };
+    for ( auto &param : parameters.get() ) {
+        add( param->name, COULEURS_PARAMS_SCALAR, param->min, param->max, &param->currentValue );
+    }
+    for ( auto &colorParam : parameters.getColors() ) {
+        add( colorParam->name, COULEURS_PARAMS_COLOR, 0.f, 1.f, &colorParam->value.r );
+    }
+    mBlock->count = count;
+    // Names first: a writer that sees the new generation finds them
+    __atomic_store_n( &mBlock->generation, mBlock->generation + 1, __ATOMIC_RELEASE );
+    couleurs_params_write_end( mBlock );
+}
+
+bool ParameterBlock::read( Values &values ) const
+{
+    if ( !mBlock ) return false;
+
+    // Nothing was written: a single load, the common case
+    uint32_t sequence = __atomic_load_n( &mBlock->sequence, __ATOMIC_ACQUIRE );
+    if ( sequence == values.sequence ) return false;
+
+    // Copied while the sequence holds still, only the touched entries' names
+    uint32_t count = 0, generation = 0;
+    uint8_t touched[ COULEURS_PARAMS_MAX_ENTRIES ];
+    uint32_t types[ COULEURS_PARAMS_MAX_ENTRIES ];
+    float slots[ COULEURS_PARAMS_MAX_ENTRIES ][ 3 ];
+    char names[ COULEURS_PARAMS_MAX_ENTRIES ][ COULEURS_PARAMS_NAME_SIZE ];
+    bool consistent = false;
+    for ( int attempt = 0; attempt < READ_ATTEMPTS && !consistent; attempt++ ) {
+        sequence = __atomic_load_n( &mBlock->sequence, __ATOMIC_ACQUIRE );
+        if ( sequence & 1 ) continue;
+
+        count = std::min<uint32_t>( mBlock->count, COULEURS_PARAMS_MAX_ENTRIES );
+        generation = mBlock->generation;
+        memcpy( touched, mBlock->touched, count );
+        memcpy( slots, mBlock->values, sizeof( slots[0] ) * count );
+        for ( uint32_t i = 0; i < count; i++ ) {
+            if ( !touched[i] ) continue;
+            types[i] = mBlock->entries[i].type;
+            memcpy( names[i], mBlock->entries[i].name, COULEURS_PARAMS_NAME_SIZE );
+        }
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        consistent = __atomic_load_n( &mBlock->sequence, __ATOMIC_RELAXED ) == sequence;
+    }
+    if ( !consistent ) {
+        // Stuck rather than busy: the next frame reads after the takeover
+        if ( takeOver( mBlock, __atomic_load_n( &mBlock->sequence, __ATOMIC_RELAXED ), false ) ) {
+            couleurs_params_write_end( mBlock );
+        }
+        return false;
+    }
+
+    // Names are reassigned in place, so steady state does not allocate.
+    // Entries not written since are left out of apply(), another
+    // controller's write must not undo what the UI did to them.
+    bool samePatch = generation == values.generation;
+    size_t scalarCount = 0, colorCount = 0;
+    for ( uint32_t i = 0; i < count; i++ ) {
+        if ( !touched[i] ) continue;
+        names[i][ COULEURS_PARAMS_NAME_SIZE - 1 ] = 0;
+        uint8_t changed = !samePatch || touched[i] != values.writes[i];
+        values.writes[i] = touched[i];
+        if ( types[i] == COULEURS_PARAMS_COLOR ) {
+            if ( colorCount == values.colors.size() ) {
+                values.colors.emplace_back();
+                values.colorsChanged.emplace_back();
+            }
+            values.colorsChanged[ colorCount ] = changed;
+            values.colors[ colorCount ].first = names[i];
+            values.colors[ colorCount++ ].second = vec3( slots[i][0], slots[i][1], slots[i][2] );
+        }
+        else {
+            if ( scalarCount == values.params.size() ) {
+                values.params.emplace_back();
+                values.paramsChanged.emplace_back();
+            }
+            values.paramsChanged[ scalarCount ] = changed;
+            values.params[ scalarCount ].first = names[i];
+            values.params[ scalarCount++ ].second = slots[i][0];
+        }
+    }
+    values.params.resize( scalarCount );
+    values.paramsChanged.resize( scalarCount );
+    values.colors.resize( colorCount );
+    values.colorsChanged.resize( colorCount );
+    values.sequence = sequence;
+    values.generation = generation;
+    return true;
+}
+
+void ParameterBlock::apply( const Values &values, Parameters &parameters )
+{
+    for ( size_t i = 0; i < values.params.size(); i++ ) {
+        if ( !values.paramsChanged[i] ) continue;
+        auto &value = values.params[i];
+        for ( auto &param : parameters.get() ) {
+            if ( param->name == value.first ) {
+                param->currentValue = value.second;
+                break;
+            }
+        }
+    }
+    for ( size_t i = 0; i < values.colors.size(); i++ ) {
+        if ( !values.colorsChanged[i] ) continue;
+        auto &value = values.colors[i];
+        for ( auto &colorParam : parameters.getColors() ) {
+            if ( colorParam->name == value.first ) {
+                colorParam->value = Colorf( value.second.x, value.second.y, value.second.z );
+                break;
+            }
+        }
+    }
+}
+
+uint32_t ParameterBlock::entryCount() const
+{
+    return mBlock ? __atomic_load_n( &mBlock->count, __ATOMIC_RELAXED ) : 0;
+}
+
+uint32_t ParameterBlock::touchedCount() const
+{
+    if ( !mBlock ) return 0;
+    uint32_t touched = 0;
+    for ( uint32_t i = 0; i < entryCount() && i < COULEURS_PARAMS_MAX_ENTRIES; i++ ) {
+        touched += mBlock->touched[i] != 0;
+    }
+    return touched;
+}
\ No newline at end of file
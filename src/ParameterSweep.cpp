@@ -0,0 +1,167 @@
+#include "ParameterSweep.h"
+#include "cinder/Exception.h"
+#include "cinder/Json.h"
+#include "Constants.h"
+#include "CounterRandom.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace ci;
+using namespace std;
+
+ParameterSweep::ParameterSweep( Parameters &params, const vector<string> &specs, int variants, uint64_t seed, const ivec2 &tileSize )
+    : mTileSize( tileSize )
+{
+    auto find = [&] ( const string &name ) {
+        for ( auto &param : params.get() ) {
+            if ( param->name == name ) return param;
+        }
+        throw Exception( "No parameter " + name + " to sweep" );
+    };
+
+    vector<Axis> axes;
+    for ( auto &spec : specs ) {
+        auto equals = spec.find( '=' );
+        auto param = find( spec.substr( 0, equals ) );
+        Axis axis = { param->name, param->min, param->max, SWEEP_STEPS };
+        if ( equals != string::npos ) {
+            int fields = sscanf( spec.c_str() + equals + 1, "%f:%f:%d", &axis.min, &axis.max, &axis.steps );
+            if ( fields < 2 || axis.steps < 1 ) {
+                throw Exception( "Invalid sweep " + spec + ", expected name=min:max or name=min:max:steps" );
+            }
+        }
+        axes.push_back( axis );
+    }
+    if ( specs.empty() ) {
+        for ( auto &param : params.get() ) {
+            axes.push_back( { param->name, param->min, param->max, SWEEP_STEPS } );
+        }
+    }
+    if ( axes.empty() ) {
+        throw Exception( "Nothing to sweep" );
+    }
+
+    // Random samples are a function of (seed, name, variant), so adding a
+    // parameter to the sweep does not change the others' values
+    if ( variants > 0 ) {
+        if ( variants > SWEEP_MAX_VARIANTS ) {
+            throw Exception( to_string( variants ) + " variants, the limit is " + to_string( SWEEP_MAX_VARIANTS ) );
+        }
+        for ( int v = 0; v < variants; v++ ) {
+            Values values;
+            for ( auto &axis : axes ) {
+                float u = CounterRandom::uniform( seed, CounterRandom::hashString( axis.name ), v );
+                values.push_back( { axis.name, axis.min + ( axis.max - axis.min ) * u } );
+            }
+            mVariants.push_back( values );
+        }
+    }
+    else {
+        // The first axis varies fastest
+        double count = 1;
+        for ( auto &axis : axes ) {
+            count *= axis.steps;
+        }
+        if ( count > SWEEP_MAX_VARIANTS ) {
+            throw Exception( "The sweep grid has " + to_string( (long long)count ) + " variants, the limit is " + to_string( SWEEP_MAX_VARIANTS ) + ": sweep fewer steps or use random variants" );
+        }
+        for ( int v = 0; v < (int)count; v++ ) {
+            Values values;
+            int index = v;
+            for ( auto &axis : axes ) {
+                int step = index % axis.steps;
+                index /= axis.steps;
+                float t = axis.steps > 1 ? step / float( axis.steps - 1 ) : 0.f;
+                values.push_back( { axis.name, axis.min + ( axis.max - axis.min ) * t } );
+            }
+            mVariants.push_back( values );
+        }
+    }
+
+    int n = mVariants.size();
+    mColumns = min( n, max( 1, (int)ceil( sqrt( n * mTileSize.y / (double)mTileSize.x ) - 1e-9 ) ) );
+    mRows = ( n + mColumns - 1 ) / mColumns;
+}
+
+void ParameterSweep::apply( int variant, Parameters &params ) const
+{
+    for ( auto &value : mVariants[variant] ) {
+        for ( auto &param : params.get() ) {
+            if ( param->name == value.first ) {
+                param->baseValue = param->currentValue = value.second;
+            }
+        }
+    }
+}
+
+void ParameterSweep::write( const fs::path &path, const string &patch, const fs::path &paramsPath, double time, uint64_t seed,
+                            Parameters &params, int rendered ) const
+{
+    JsonTree root;
+    root.addChild( JsonTree( "patch", patch ) );
+    root.addChild( JsonTree( "paramsPath", paramsPath.string() ) );
+    root.addChild( JsonTree( "time", time ) );
+    root.addChild( JsonTree( "seed", to_string( seed ) ) );
+    root.addChild( JsonTree( "tileWidth", mTileSize.x ) );
+    root.addChild( JsonTree( "tileHeight", mTileSize.y ) );
+    root.addChild( JsonTree( "columns", mColumns ) );
+
+    // Colors are not swept, every tile has the same
+    JsonTree colors = JsonTree::makeObject( "colors" );
+    for ( auto &colorParam : params.getColors() ) {
+        JsonTree color = JsonTree::makeObject( colorParam->name );
+        color.addChild( JsonTree( "r", colorParam->value.r ) );
+        color.addChild( JsonTree( "g", colorParam->value.g ) );
+        color.addChild( JsonTree( "b", colorParam->value.b ) );
+        colors.addChild( color );
+    }
+
+    JsonTree variants = JsonTree::makeArray( "variants" );
+    for ( int v = 0; v < variantCount(); v++ ) {
+        JsonTree variant;
+        auto origin = tileOrigin( v );
+        variant.addChild( JsonTree( "index", v ) );
+        variant.addChild( JsonTree( "x", origin.x ) );
+        variant.addChild( JsonTree( "y", origin.y ) );
+        variant.addChild( JsonTree( "rendered", v < rendered ) );
+        JsonTree values = JsonTree::makeObject( "params" );
+        for ( auto &param : params.get() ) {
+            // As params.json saves it
+            float value = param->hasModulator() ? param->baseValue : param->currentValue;
+            for ( auto &swept : mVariants[v] ) {
+                if ( swept.first == param->name ) value = swept.second;
+            }
+            values.addChild( JsonTree( param->name, value ) );
+        }
+        variant.addChild( values );
+        variant.addChild( colors );
+        variants.addChild( variant );
+    }
+    root.addChild( variants );
+    root.write( path );
+}
+
+ParameterSweep::Variant ParameterSweep::readVariant( const fs::path &path, int index )
+{
+    JsonTree root( loadFile( path ) );
+    auto &variants = root.getChild( "variants" );
+    if ( index < 0 || index >= (int)variants.getNumChildren() ) {
+        throw Exception( path.string() + " has no variant " + to_string( index ) );
+    }
+
+    Variant variant;
+    auto &tile = variants.getChild( index );
+    variant.patch = root["patch"].getValue();
+    variant.paramsPath = root["paramsPath"].getValue();
+    variant.time = root["time"].getValue<double>();
+    variant.seed = stoull( root["seed"].getValue() );
+    variant.rendered = tile["rendered"].getValue<bool>();
+    for ( auto &value : tile.getChild( "params" ) ) {
+        variant.params.push_back( { value.getKey(), value.getValue<float>() } );
+    }
+    for ( auto &color : tile.getChild( "colors" ) ) {
+        variant.colors.push_back( { color.getKey(), vec3( color["r"].getValue<float>(), color["g"].getValue<float>(), color["b"].getValue<float>() ) } );
+    }
+    return variant;
+}
\ No newline at end of file
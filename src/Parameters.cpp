@@ -1,6 +1,8 @@
 #include "Parameters.h"
 #include "cinder/app/App.h"
 #include "cinder/Log.h"
+#include "AsyncLog.h"
+#include "CounterRandom.h"
 
 using namespace ci;
 
@@ -9,6 +11,11 @@ Parameters::Parameters( const fs::path &path ) : mPath( path ), mJson( app::load
   init();
 }
 
+Parameters::Parameters( const fs::path &path, const PatchBundleRef &bundle ) : mPath( path ), mBundle( bundle )
+{
+  initFromBundle();
+}
+
 Parameters::~Parameters()
 {
 }
@@ -21,6 +28,7 @@ void Parameters::init()
   for ( auto it = params.begin(); it != params.end(); it++ ) {
     auto param = std::make_shared<Parameter>();
     param->name = (*it)["name"].getValue();
+    param->seed = mSeed ^ CounterRandom::hashString( param->name );
     param->baseValue = (*it)["value"].getValue<float>();
     param->currentValue = (*it)["value"].getValue<float>();
 
@@ -51,7 +59,7 @@ void Parameters::init()
     // OSC
     try {
       param->oscChannel = (*it)["osc"].getValue<int>();
-      cinder::app::console() << "Found channel " << param->oscChannel << " for param " << param->name << std::endl;
+      LOG_D( OSC, "Found channel " << param->oscChannel << " for param " << param->name );
     } catch ( const JsonTree::ExcChildNotFound &e ) {      
     }
 
@@ -118,17 +126,95 @@ void Parameters::init()
 
 }
 
+void Parameters::initFromBundle()
+{
+  // Same fields as init(), read from the bundle's binary tables
+  mParameters.clear();
+  for ( uint32_t i = 0; i < mBundle->header().paramCount; i++ ) {
+    auto &p = mBundle->param( i );
+    auto param = std::make_shared<Parameter>();
+    param->name = mBundle->stringAt( p.name );
+    param->seed = mSeed ^ CounterRandom::hashString( param->name );
+    param->baseValue = p.value;
+    param->currentValue = p.value;
+    param->min = p.min;
+    param->max = p.max;
+    param->midiNumber = p.midiNumber;
+    param->oscChannel = p.oscChannel;
+    if ( p.modulatorType >= 0 ) {
+      param->modulator = std::make_unique<Modulator>( (ModulatorType)p.modulatorType, p.modulatorFrequency, p.modulatorAmount );
+    }
+
+    for ( uint32_t a = 0; a < p.animationCount; a++ ) {
+      auto &anim = mBundle->animation( p.firstAnimation + a );
+      auto animation = std::make_shared<Animation>();
+      animation->mTargetValue = anim.target;
+      animation->mDuration = anim.duration;
+      animation->mMidiMapping = anim.midiMapping;
+      animation->mCurve = mBundle->stringAt( anim.curve );
+      param->animations.push_back( animation );
+    }
+
+    mParameters.push_back( param );
+  }
+
+  mColorParameters.clear();
+  for ( uint32_t i = 0; i < mBundle->header().colorCount; i++ ) {
+    auto &c = mBundle->color( i );
+    auto colorParam = std::make_shared<ColorParameter>();
+    colorParam->name = mBundle->stringAt( c.name );
+    colorParam->value = Colorf( c.r, c.g, c.b );
+    mColorParameters.push_back( colorParam );
+  }
+}
+
+void Parameters::ensureJsonTree()
+{
+  if ( mJson.hasChild( "params" ) ) return;
+
+  // Loaded from a bundle: the JSON is only needed when saving
+  try {
+    mJson = JsonTree( app::loadAsset( mPath ) );
+  }
+  catch ( const std::exception &e ) {
+    mJson = JsonTree();
+    JsonTree params = JsonTree::makeArray( "params" );
+    for ( auto &param : mParameters ) {
+      JsonTree tree;
+      tree.addChild( JsonTree( "name", param->name ) );
+      tree.addChild( JsonTree( "min", param->min ) );
+      tree.addChild( JsonTree( "max", param->max ) );
+      params.addChild( tree );
+    }
+    mJson.addChild( params );
+    JsonTree colorParams = JsonTree::makeArray( "colorParams" );
+    for ( auto &colorParam : mColorParameters ) {
+      JsonTree tree;
+      tree.addChild( JsonTree( "name", colorParam->name ) );
+      colorParams.addChild( tree );
+    }
+    mJson.addChild( colorParams );
+  }
+}
+
 void Parameters::save()
 {
+  ensureJsonTree();
   updateJsonTree( mJson );
   mJson.write( app::getAssetPath( mPath ) );
 }
 
 void Parameters::writeTo( const ci::fs::path &path )
 {
+  toJson().write( path );
+}
+
+JsonTree Parameters::toJson()
+{
+  ensureJsonTree();
   auto newJson = JsonTree( mJson );
   updateJsonTree( newJson );
-  newJson.write( path );  
+  return newJson;
 }
 
 void Parameters::updateJsonTree( ci::JsonTree &oldTree )
@@ -178,8 +264,21 @@ void Parameters::load( const ci::fs::path &path )
   }
 }
 
+void Parameters::setSeed( uint64_t seed )
+{
+  // Random modulators draw from (seed, time), so the same seed renders the same frames
+  mSeed = seed;
+  for ( auto &param : mParameters ) {
+    param->seed = mSeed ^ CounterRandom::hashString( param->name );
+  }
+}
+
 void Parameters::reload()
 {
+  if ( mBundle ) {
+    initFromBundle();
+    return;
+  }
   mJson = JsonTree( app::loadAsset( mPath ) );
   init();
 }
@@ -0,0 +1,256 @@
+#include "PassFusion.h"
+#include <cctype>
+#include <regex>
+#include <set>
+#include <sstream>
+
+using namespace std;
+
+static string fetchPattern( int buffer )
+{
+    auto name = "u_buffer" + to_string( buffer );
+    return "texture\\s*\\(\\s*" + name + "\\s*,\\s*vTexCoord0\\s*\\)"
+           "|texelFetch\\s*\\(\\s*" + name + "\\s*,\\s*ivec2\\s*\\(\\s*gl_FragCoord\\.xy\\s*\\)\\s*,\\s*0\\s*\\)";
+}
+
+static int countMatches( const string &text, const regex &re )
+{
+    return distance( sregex_iterator( text.begin(), text.end(), re ), sregex_iterator() );
+}
+
+static string stageName( int buffer )
+{
+    return "couleurs_stage" + to_string( buffer );
+}
+
+// Variables declared by text, for "vec2 uv = ..., st;" both uv and st
+static set<string> declaredNames( const string &text )
+{
+    static const regex declarationRe( R"(\b(?:(?:const|highp|mediump|lowp)\s+)*(?:float|int|uint|bool|[biu]?vec[234]|mat[234](?:x[234])?)\s+(?=[A-Za-z_]))" );
+    set<string> names;
+    for ( auto it = sregex_iterator( text.begin(), text.end(), declarationRe ); it != sregex_iterator(); ++it ) {
+        // Names at the start and after each top-level comma, up to the semicolon
+        int depth = 0;
+        bool expectName = true;
+        for ( size_t i = it->position() + it->length(); i < text.size() && !( depth == 0 && ( text[i] == ';' || text[i] == ')' ) ); i++ ) {
+            char c = text[i];
+            if ( expectName && ( isalpha( c ) || c == '_' ) ) {
+                size_t end = i;
+                while ( end < text.size() && ( isalnum( text[end] ) || text[end] == '_' ) ) end++;
+                names.insert( text.substr( i, end - i ) );
+                i = end - 1;
+                expectName = false;
+            }
+            else if ( c == '(' || c == '[' ) depth++;
+            else if ( c == ')' || c == ']' ) depth--;
+            else if ( c == ',' && depth == 0 ) expectName = true;
+        }
+    }
+    return names;
+}
+
+// main() with the chain's blocks blanked out: what every block can see
+static string mainScope( const string &source, const map<int, PassFusion::Block> &blocks )
+{
+    smatch match;
+    if ( !regex_search( source, match, regex( R"(\bvoid\s+main\s*\([^)]*\)\s*\{)" ) ) ) return "";
+    size_t begin = match.position() + match.length(), end = begin;
+    for ( int depth = 1; end < source.size() && depth > 0; end++ ) {
+        depth += source[end] == '{' ? 1 : source[end] == '}' ? -1 : 0;
+    }
+    string scope = source.substr( begin, end - begin );
+    for ( auto &block : blocks ) {
+        if ( block.second.begin < begin || block.second.end > end ) continue;
+        scope.replace( block.second.begin - begin, block.second.end - block.second.begin, block.second.end - block.second.begin, ' ' );
+    }
+    return scope;
+}
+
+PassFusion::PassFusion( const string &source, int bufferCount, const vector<bool> &pinned, const vector<string> &blurNames )
+    : mSource( source ), mInto( bufferCount, NOT_FUSED )
+{
+    auto blocks = findBlocks( source );
+    auto text = [] ( const string &s, const Block &block ) { return s.substr( block.begin, block.end - block.begin ); };
+
+    static const regex exitRe( R"(\b(return|discard)\b)" );
+    static const regex bufferRe( R"(\bu_buffer(\d+)\b)" );
+    auto locals = declaredNames( mainScope( source, blocks ) );
+    for ( int j = 0; j < bufferCount; j++ ) {
+        if ( pinned[j] || !blocks.count( j ) ) continue;
+        auto body = text( source, blocks[j] );
+        if ( regex_search( body, exitRe ) ) continue;
+
+        // Buffers rendered after this one are read as they were on the
+        // previous frame, blurs right after their source: both would change once inlined
+        bool ordered = true;
+        for ( auto it = sregex_iterator( body.begin(), body.end(), bufferRe ); it != sregex_iterator(); ++it ) {
+            ordered = ordered && stoi( (*it)[1].str() ) < j;
+        }
+        for ( auto &name : blurNames ) {
+            ordered = ordered && !regex_search( body, regex( "\\bu_" + name + "\\b" ) );
+        }
+        if ( !ordered ) continue;
+
+        // The same-texel fetch must be the only use besides the declaration
+        regex use( "\\bu_buffer" + to_string( j ) + "\\b" );
+        regex declaration( "uniform\\s+sampler2D\\s+u_buffer" + to_string( j ) + "\\s*;" );
+        if ( countMatches( source, use ) - countMatches( source, declaration ) != 1 ) continue;
+
+        regex fetch( fetchPattern( j ) );
+        for ( auto &block : blocks ) {
+            if ( block.first == j || countMatches( text( source, block.second ), fetch ) != 1 ) continue;
+            if ( block.first < 0 || block.first > j ) {
+                mInto[j] = block.first;
+            }
+        }
+        if ( !isFused( j ) ) continue;
+
+        // A stage is a function of its own, main()'s locals are out of its
+        // scope there: compiling would fail, or a global of the same name
+        // would be read instead
+        auto own = declaredNames( body );
+        string outOfScope;
+        for ( auto &name : locals ) {
+            if ( own.count( name ) || !regex_search( body, regex( "\\b" + name + "\\b" ) ) ) continue;
+            outOfScope += ( outOfScope.empty() ? "" : ", " ) + name;
+        }
+        if ( !outOfScope.empty() ) {
+            mInto[j] = NOT_FUSED;
+            mRefused += ( mRefused.empty() ? "" : "; " ) + string( "buffer" ) + to_string( j ) + " reads main() locals " + outOfScope;
+        }
+    }
+    if ( fusedCount() == 0 ) return;
+
+    // Every fused fetch becomes a call, then the stages are cut from the rewritten blocks
+    string fused = source;
+    for ( int j = 0; j < bufferCount; j++ ) {
+        if ( isFused( j ) ) {
+            fused = regex_replace( fused, regex( fetchPattern( j ) ), stageName( j ) + "()" );
+        }
+    }
+    blocks = findBlocks( fused );
+
+    // Stages go right before main(), which must hold the whole chain
+    smatch mainMatch;
+    size_t mainPosition = regex_search( fused, mainMatch, regex( R"(\bvoid\s+main\s*\()" ) ) ? mainMatch.position() : string::npos;
+    for ( auto &block : blocks ) {
+        if ( mainPosition == string::npos || block.second.begin < mainPosition ) {
+            mInto.assign( bufferCount, NOT_FUSED );
+            return;
+        }
+    }
+
+    // Buffers in order, so a stage only calls the ones defined above it.
+    // The local oColor hides the output. Buffers are RGBA8, the clamp is
+    // what the FBO write did.
+    ostringstream stages;
+    for ( int j = 0; j < bufferCount; j++ ) {
+        if ( !isFused( j ) ) continue;
+        stages << "vec4 " << stageName( j ) << "() {\n"
+               << "  vec4 oColor = vec4( 0. );\n"
+               << text( fused, blocks[j] )
+               << "  return clamp( oColor, 0., 1. );\n"
+               << "}\n\n";
+    }
+    mSource = fused.insert( mainPosition, stages.str() );
+}
+
+bool PassFusion::isConsumer( int pass ) const
+{
+    for ( auto into : mInto ) {
+        if ( into == pass ) return true;
+    }
+    return false;
+}
+
+int PassFusion::fusedCount() const
+{
+    int count = 0;
+    for ( auto into : mInto ) {
+        count += into != NOT_FUSED;
+    }
+    return count;
+}
+
+string PassFusion::describe() const
+{
+    string description;
+    for ( size_t j = 0; j < mInto.size(); j++ ) {
+        if ( mInto[j] == NOT_FUSED ) continue;
+        description += description.empty() ? "" : ", ";
+        description += "buffer" + to_string( j ) + " > " + ( mInto[j] < 0 ? string( "main" ) : "buffer" + to_string( mInto[j] ) );
+    }
+    return description;
+}
+
+map<int, PassFusion::Block> PassFusion::findBlocks( const string &source )
+{
+    // Same markers as getDefineBlockCount()
+    static const regex markerRe( R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*BUFFER_)(\d+)(?:\s*\))|(?:^\s*#ifdef\s+BUFFER_)(\d+))" );
+    static const regex ifRe( R"(^\s*#\s*if)" );
+    static const regex elifRe( R"(^\s*#\s*elif\b)" );
+    static const regex elseRe( R"(^\s*#\s*else\b)" );
+    static const regex endifRe( R"(^\s*#\s*endif\b)" );
+
+    struct Frame {
+        bool   chain;
+        int    block; // NOT_FUSED between blocks
+        size_t begin;
+    };
+    vector<Frame> frames;
+    map<int, Block> blocks;
+    set<int> repeated;
+    auto close = [&] ( Frame &frame, size_t end ) {
+        if ( frame.block == NOT_FUSED ) return;
+        if ( blocks.count( frame.block ) ) {
+            repeated.insert( frame.block );
+        }
+        blocks[ frame.block ] = { frame.begin, end };
+        frame.block = NOT_FUSED;
+    };
+
+    size_t lineStart = 0;
+    while ( lineStart < source.size() ) {
+        size_t lineEnd = source.find( '\n', lineStart );
+        lineEnd = lineEnd == string::npos ? source.size() : lineEnd;
+        size_t next = min( lineEnd + 1, source.size() );
+        string line = source.substr( lineStart, lineEnd - lineStart );
+
+        smatch match;
+        int index = NOT_FUSED;
+        if ( regex_search( line, match, markerRe ) ) {
+            index = stoi( match[2].matched ? match[2].str() : match[3].str() );
+        }
+
+        if ( regex_search( line, elifRe ) ) {
+            // Any other #elif ends the chain's regular shape, that block is skipped
+            if ( !frames.empty() && frames.back().chain ) {
+                close( frames.back(), lineStart );
+                frames.back().block = index;
+                frames.back().begin = next;
+            }
+        }
+        else if ( regex_search( line, ifRe ) ) {
+            frames.push_back( { index != NOT_FUSED, index, next } );
+        }
+        else if ( regex_search( line, elseRe ) ) {
+            if ( !frames.empty() && frames.back().chain ) {
+                close( frames.back(), lineStart );
+                frames.back().block = -1;
+                frames.back().begin = next;
+            }
+        }
+        else if ( regex_search( line, endifRe ) && !frames.empty() ) {
+            if ( frames.back().chain ) {
+                close( frames.back(), lineStart );
+            }
+            frames.pop_back();
+        }
+        lineStart = next;
+    }
+
+    for ( auto index : repeated ) {
+        blocks.erase( index );
+    }
+    return blocks;
+}
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include "Patch.h"
+#include "cinder/app/App.h"
+#include "cinder/Log.h"
+#include "Utils.h"
+#include <set>
 
 using namespace std;
 
@@ -6,11 +10,38 @@ const string patchFolder = "patches/";
 const string fragFilename = "/shader.frag";
 const string paramFilename = "/params.json";  
 
+// Whether anything packed into bundlePath changed after it: the folder's
+// files, the folder itself for added or removed images, and every source
+// shader.frag includes
+static bool sourcesNewerThan( const ci::fs::path &folder, const ci::fs::path &bundlePath )
+{
+    auto time = ci::fs::last_write_time( bundlePath );
+    set<ci::fs::path> sources = { folder };
+    for ( auto &p : ci::fs::directory_iterator( folder ) ) {
+        auto extension = p.path().extension();
+        if ( extension == ".json" || extension == ".jpg" || extension == ".png" ) {
+            sources.insert( p.path() );
+        }
+    }
+    auto shaderPath = folder / "shader.frag";
+    if ( ci::fs::exists( shaderPath ) ) {
+        try {
+            resolveShaderIncludes( shaderPath, sources );
+        }
+        catch ( const ci::Exception & ) {
+            return true;
+        }
+    }
+    for ( auto &source : sources ) {
+        if ( ci::fs::last_write_time( source ) > time ) return true;
+    }
+    return false;
+}
+
 Patch::Patch( string name ) : mName( name ), 
-                              mParams( patchFolder + name + paramFilename ), 
                               mFolderPath( patchFolder + name ),
-                              mShaderPath( patchFolder + name + fragFilename )
-
+                              mShaderPath( patchFolder + name + fragFilename ),
+                              mBundle( openBundle( name ) )
 {
 }
 
@@ -20,5 +51,32 @@ Patch::~Patch()
 
 Parameters& Patch::params()
 {
-    return mParams;
+    if ( !mParams ) {
+        auto path = patchFolder + mName + paramFilename;
+        mParams = mBundle ? make_shared<Parameters>( path, mBundle ) : make_shared<Parameters>( path );
+    }
+    return *mParams;
+}
+
+PatchBundleRef Patch::openBundle( const string &name )
+{
+    auto bundlePath = ci::app::getAssetPath( PatchBundle::pathForPatch( name ) );
+    if ( bundlePath.empty() ) {
+        return nullptr;
+    }
+
+    // A loose folder edited after packing wins over a stale bundle
+    auto folder = ci::app::getAssetPath( patchFolder + name );
+    if ( !folder.empty() && sourcesNewerThan( folder, bundlePath ) ) {
+        CI_LOG_W( "Bundle for " << name << " is older than its folder, loading sources" );
+        return nullptr;
+    }
+
+    try {
+        return make_shared<PatchBundle>( bundlePath );
+    }
+    catch ( const ci::Exception &exc ) {
+        CI_LOG_EXCEPTION( "Failed to open bundle for " << name, exc );
+        return nullptr;
+    }
 }
\ No newline at end of file
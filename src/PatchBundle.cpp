@@ -0,0 +1,351 @@
+#include "PatchBundle.h"
+#include "Parameters.h"
+#include "Utils.h"
+#include "cinder/app/App.h"
+#include "cinder/ImageIo.h"
+#include "cinder/Surface.h"
+#include "cinder/Log.h"
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ci;
+using namespace std;
+
+static const string patchFolder = "patches/";
+
+PatchBundle::PatchBundle( const fs::path &path ) : mPath( path )
+{
+    mFd = open( path.string().c_str(), O_RDONLY );
+    if ( mFd < 0 ) {
+        throw Exception( "Cannot open patch bundle: " + path.string() );
+    }
+
+    struct stat st;
+    if ( fstat( mFd, &st ) != 0 || st.st_size < (off_t)sizeof( BundleHeader ) ) {
+        close( mFd );
+        throw Exception( "Invalid patch bundle: " + path.string() );
+    }
+
+    mSize = st.st_size;
+    void *data = mmap( nullptr, mSize, PROT_READ, MAP_PRIVATE, mFd, 0 );
+    if ( data == MAP_FAILED ) {
+        close( mFd );
+        throw Exception( "Cannot map patch bundle: " + path.string() );
+    }
+
+    mData = static_cast<const uint8_t*>( data );
+    mHeader = reinterpret_cast<const BundleHeader*>( mData );
+    if ( strncmp( mHeader->magic, PATCH_BUNDLE_MAGIC, sizeof( mHeader->magic ) ) != 0
+         || mHeader->version != PATCH_BUNDLE_VERSION
+         || mHeader->fileSize != mSize ) {
+        munmap( const_cast<uint8_t*>( mData ), mSize );
+        close( mFd );
+        throw Exception( "Incompatible patch bundle: " + path.string() );
+    }
+}
+
+PatchBundle::~PatchBundle()
+{
+    if ( mData != nullptr ) {
+        munmap( const_cast<uint8_t*>( mData ), mSize );
+    }
+    if ( mFd >= 0 ) {
+        close( mFd );
+    }
+}
+
+fs::path PatchBundle::pathForPatch( const string &name )
+{
+    return patchFolder + name + PATCH_BUNDLE_EXTENSION;
+}
+
+template<typename T>
+const T& PatchBundle::entry( uint64_t tableOffset, uint32_t count, size_t i ) const
+{
+    if ( i >= count ) {
+        throw Exception( "Patch bundle entry out of range: " + mPath.string() );
+    }
+    checkRange( tableOffset, 0 );
+    checkRange( tableOffset + i * sizeof( T ), sizeof( T ) );
+    return reinterpret_cast<const T*>( mData + tableOffset )[ i ];
+}
+
+const BundlePass& PatchBundle::pass( size_t i ) const
+{
+    return entry<BundlePass>( mHeader->passTableOffset, mHeader->passCount, i );
+}
+
+const BundleParam& PatchBundle::param( size_t i ) const
+{
+    return entry<BundleParam>( mHeader->paramTableOffset, mHeader->paramCount, i );
+}
+
+const BundleAnimation& PatchBundle::animation( size_t i ) const
+{
+    return entry<BundleAnimation>( mHeader->animationTableOffset, mHeader->animationCount, i );
+}
+
+const BundleColor& PatchBundle::color( size_t i ) const
+{
+    return entry<BundleColor>( mHeader->colorTableOffset, mHeader->colorCount, i );
+}
+
+const BundleTexture& PatchBundle::texture( size_t i ) const
+{
+    return entry<BundleTexture>( mHeader->textureTableOffset, mHeader->textureCount, i );
+}
+
+void PatchBundle::checkRange( uint64_t offset, uint64_t size ) const
+{
+    // Written so neither side can wrap around
+    if ( offset > mSize || size > mSize - offset ) {
+        throw Exception( "Patch bundle data out of range: " + mPath.string() );
+    }
+}
+
+string PatchBundle::stringAt( const BundleString &s ) const
+{
+    checkRange( mHeader->stringsOffset, 0 );
+    checkRange( mHeader->stringsOffset + s.offset, s.size );
+    return std::string( reinterpret_cast<const char*>( mData + mHeader->stringsOffset + s.offset ), s.size );
+}
+
+const char* PatchBundle::source( const BundlePass &pass ) const
+{
+    // Strings are NUL-terminated so sources can be passed straight to GL
+    checkRange( mHeader->stringsOffset, 0 );
+    uint64_t offset = mHeader->stringsOffset + pass.source.offset;
+    checkRange( offset, (uint64_t)pass.source.size + 1 );
+    if ( mData[ offset + pass.source.size ] != 0 ) {
+        throw Exception( "Unterminated source in patch bundle: " + mPath.string() );
+    }
+    return reinterpret_cast<const char*>( mData + offset );
+}
+
+const uint8_t* PatchBundle::textureLevel( const BundleTexture &texture, uint32_t level ) const
+{
+    // Sizes past any GL limit would overflow the level offsets
+    if ( level >= texture.levels || texture.width > 65536 || texture.height > 65536 ) {
+        throw Exception( "Patch bundle texture level out of range: " + mPath.string() );
+    }
+    uint64_t offset = levelOffset( texture.width, texture.height, level );
+    uint64_t size = (uint64_t)max( 1u, texture.width >> level ) * max( 1u, texture.height >> level ) * 4;
+    checkRange( texture.dataOffset, texture.dataSize );
+    if ( offset + size > texture.dataSize ) {
+        throw Exception( "Patch bundle texture level out of range: " + mPath.string() );
+    }
+    return mData + texture.dataOffset + offset;
+}
+
+uint64_t PatchBundle::alignedSize( uint64_t size )
+{
+    return ( size + PATCH_BUNDLE_ALIGNMENT - 1 ) & ~(uint64_t)( PATCH_BUNDLE_ALIGNMENT - 1 );
+}
+
+uint64_t PatchBundle::levelOffset( uint32_t width, uint32_t height, uint32_t level )
+{
+    uint64_t offset = 0;
+    for ( uint32_t l = 0; l < level; l++ ) {
+        offset += alignedSize( (uint64_t)width * height * 4 );
+        width = max( 1u, width / 2 );
+        height = max( 1u, height / 2 );
+    }
+    return offset;
+}
+
+/* Writer */
+
+static vector<vector<uint8_t>> buildMipChain( const Surface8u &surface )
+{
+    uint32_t width = surface.getWidth();
+    uint32_t height = surface.getHeight();
+    vector<vector<uint8_t>> levels( 1, vector<uint8_t>( width * height * 4 ) );
+
+    // Level 0, flipped so rows are stored bottom-up like GL expects
+    auto &base = levels[0];
+    for ( uint32_t y = 0; y < height; y++ ) {
+        for ( uint32_t x = 0; x < width; x++ ) {
+            ColorA8u c = surface.getPixel( ivec2( x, y ) );
+            uint8_t *p = &base[ ( ( height - 1 - y ) * width + x ) * 4 ];
+            p[0] = c.r;
+            p[1] = c.g;
+            p[2] = c.b;
+            p[3] = surface.hasAlpha() ? c.a : 255;
+        }
+    }
+
+    // 2x2 box filter down to 1x1
+    while ( width > 1 || height > 1 ) {
+        uint32_t w = max( 1u, width / 2 );
+        uint32_t h = max( 1u, height / 2 );
+        const auto &src = levels.back();
+        vector<uint8_t> dst( w * h * 4 );
+        for ( uint32_t y = 0; y < h; y++ ) {
+            for ( uint32_t x = 0; x < w; x++ ) {
+                uint32_t x0 = min( x * 2, width - 1 ), x1 = min( x * 2 + 1, width - 1 );
+                uint32_t y0 = min( y * 2, height - 1 ), y1 = min( y * 2 + 1, height - 1 );
+                for ( int c = 0; c < 4; c++ ) {
+                    uint32_t sum = src[ ( y0 * width + x0 ) * 4 + c ] + src[ ( y0 * width + x1 ) * 4 + c ]
+                                 + src[ ( y1 * width + x0 ) * 4 + c ] + src[ ( y1 * width + x1 ) * 4 + c ];
+                    dst[ ( y * w + x ) * 4 + c ] = ( sum + 2 ) / 4;
+                }
+            }
+        }
+        levels.push_back( move( dst ) );
+        width = w;
+        height = h;
+    }
+
+    return levels;
+}
+
+void PatchBundle::write( const std::string &name, const fs::path &outPath )
+{
+    auto folder = app::getAssetPath( patchFolder + name );
+    if ( folder.empty() ) {
+        throw Exception( "Unknown patch: " + name );
+    }
+    if ( fs::exists( folder / "shader.comp" ) || fs::exists( folder / "instances.vert" ) ) {
+        throw Exception( "Compute and instanced passes are not bundled, keep " + name + " as a folder" );
+    }
+    for ( auto &p : fs::directory_iterator( folder ) ) {
+        if ( p.path().extension() == ".cube" ) {
+            throw Exception( ".cube LUTs are not bundled, keep " + name + " as a folder" );
+        }
+    }
+
+    // Strings blob, NUL-terminated entries
+    std::string strings;
+    auto addString = [&strings] ( const std::string &s ) {
+        BundleString bs = { (uint32_t)strings.size(), (uint32_t)s.size() };
+        strings += s;
+        strings.push_back( '\0' );
+        return bs;
+    };
+
+    // Passes
+    set<fs::path> included;
+    std::string mainSource = resolveShaderIncludes( folder / "shader.frag", included );
+    int bufferCount = getDefineBlockCount( mainSource, "BUFFER_" );
+    vector<BundlePass> passes;
+    for ( int i = -1; i < bufferCount; i++ ) {
+        BundlePass pass = {};
+        pass.bufferIndex = i;
+        pass.source = addString( i < 0 ? mainSource : "#define BUFFER_" + to_string( i ) + "\n" + mainSource );
+        passes.push_back( pass );
+    }
+
+    // Parameters
+    Parameters params( patchFolder + name + "/params.json" );
+    vector<BundleParam> paramTable;
+    vector<BundleAnimation> animationTable;
+    for ( auto &param : params.get() ) {
+        BundleParam p = {};
+        p.name = addString( param->name );
+        p.value = param->baseValue;
+        p.min = param->min;
+        p.max = param->max;
+        p.midiNumber = param->midiNumber;
+        p.oscChannel = param->oscChannel;
+        p.modulatorType = param->hasModulator() ? param->modulator->mType : -1;
+        p.modulatorFrequency = param->hasModulator() ? param->modulator->mFrequency : 0.f;
+        p.modulatorAmount = param->hasModulator() ? param->modulator->mAmount : 0.f;
+        p.firstAnimation = animationTable.size();
+        p.animationCount = param->animations.size();
+        for ( auto &anim : param->animations ) {
+            BundleAnimation a = {};
+            a.target = anim->mTargetValue;
+            a.duration = anim->mDuration;
+            a.midiMapping = anim->mMidiMapping;
+            a.curve = addString( anim->mCurve );
+            animationTable.push_back( a );
+        }
+        paramTable.push_back( p );
+    }
+
+    vector<BundleColor> colorTable;
+    for ( auto &colorParam : params.getColors() ) {
+        BundleColor c = {};
+        c.name = addString( colorParam->name );
+        c.r = colorParam->value.r;
+        c.g = colorParam->value.g;
+        c.b = colorParam->value.b;
+        colorTable.push_back( c );
+    }
+
+    // Textures
+    vector<BundleTexture> textureTable;
+    vector<vector<vector<uint8_t>>> texturePayloads;
+    for ( auto &p : fs::directory_iterator( folder ) ) {
+        auto extension = p.path().extension();
+        if ( extension != ".jpg" && extension != ".png" ) continue;
+
+        Surface8u surface( loadImage( p.path() ) );
+        BundleTexture t = {};
+        t.name = addString( p.path().stem().string() );
+        t.width = surface.getWidth();
+        t.height = surface.getHeight();
+        texturePayloads.push_back( buildMipChain( surface ) );
+        t.levels = texturePayloads.back().size();
+        t.dataSize = levelOffset( t.width, t.height, t.levels );
+        textureTable.push_back( t );
+    }
+
+    // Layout
+    BundleHeader header = {};
+    strncpy( header.magic, PATCH_BUNDLE_MAGIC, sizeof( header.magic ) );
+    header.version = PATCH_BUNDLE_VERSION;
+    header.passCount = passes.size();
+    header.paramCount = paramTable.size();
+    header.animationCount = animationTable.size();
+    header.colorCount = colorTable.size();
+    header.textureCount = textureTable.size();
+
+    uint64_t offset = alignedSize( sizeof( BundleHeader ) );
+    header.passTableOffset = offset;       offset += alignedSize( passes.size() * sizeof( BundlePass ) );
+    header.paramTableOffset = offset;      offset += alignedSize( paramTable.size() * sizeof( BundleParam ) );
+    header.animationTableOffset = offset;  offset += alignedSize( animationTable.size() * sizeof( BundleAnimation ) );
+    header.colorTableOffset = offset;      offset += alignedSize( colorTable.size() * sizeof( BundleColor ) );
+    header.textureTableOffset = offset;    offset += alignedSize( textureTable.size() * sizeof( BundleTexture ) );
+    header.stringsOffset = offset;         offset += alignedSize( strings.size() );
+    for ( auto &t : textureTable ) {
+        t.dataOffset = offset;
+        offset += alignedSize( t.dataSize );
+    }
+    header.fileSize = offset;
+
+    vector<uint8_t> file( header.fileSize, 0 );
+    auto put = [&file] ( uint64_t at, const void *data, size_t size ) {
+        if ( size > 0 ) memcpy( file.data() + at, data, size );
+    };
+    put( 0, &header, sizeof( header ) );
+    put( header.passTableOffset, passes.data(), passes.size() * sizeof( BundlePass ) );
+    put( header.paramTableOffset, paramTable.data(), paramTable.size() * sizeof( BundleParam ) );
+    put( header.animationTableOffset, animationTable.data(), animationTable.size() * sizeof( BundleAnimation ) );
+    put( header.colorTableOffset, colorTable.data(), colorTable.size() * sizeof( BundleColor ) );
+    put( header.textureTableOffset, textureTable.data(), textureTable.size() * sizeof( BundleTexture ) );
+    put( header.stringsOffset, strings.data(), strings.size() );
+    for ( size_t i = 0; i < textureTable.size(); i++ ) {
+        auto &t = textureTable[i];
+        for ( uint32_t l = 0; l < t.levels; l++ ) {
+            auto &level = texturePayloads[i][l];
+            put( t.dataOffset + levelOffset( t.width, t.height, l ), level.data(), level.size() );
+        }
+    }
+
+    ofstream out( outPath.string(), ios::binary );
+    out.write( reinterpret_cast<const char*>( file.data() ), file.size() );
+    if ( !out ) {
+        throw Exception( "Cannot write patch bundle: " + outPath.string() );
+    }
+
+    CI_LOG_I( "Packed " << name << " (" << passes.size() << " passes, " << paramTable.size() << " params, "
+              << textureTable.size() << " textures, " << file.size() / 1024 << " KB) to " << outPath );
+}
@@ -0,0 +1,318 @@
+#include "PatchCatalog.h"
+#include "cinder/app/App.h"
+#include "cinder/Json.h"
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+#include "Constants.h"
+#include "CounterRandom.h"
+#include "Utils.h"
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <regex>
+#include <set>
+#include <sstream>
+
+using namespace ci;
+using namespace std;
+
+// Bump when PatchInfo changes, older catalogs are then scanned again
+#define PATCH_CATALOG_VERSION 1
+
+static string readFile( const fs::path &path )
+{
+    ifstream file( path.string(), ios::binary );
+    stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// #include "..." resolved like the GLSL loader does, relative to the including file
+static void collectIncludes( const fs::path &path, const string &source, set<fs::path> &includes, string &text )
+{
+    static const regex includeRe( R"(^\s*#include\s+\"([^\"]+)\")" );
+    istringstream lines( source );
+    string line;
+    smatch match;
+    while ( getline( lines, line ) ) {
+        if ( !regex_search( line, match, includeRe ) ) continue;
+        auto included = path.parent_path() / match[1].str();
+        if ( !fs::exists( included ) ) continue;
+        included = fs::canonical( included );
+        if ( !includes.insert( included ).second ) continue;
+
+        auto includedSource = readFile( included );
+        text += includedSource;
+        collectIncludes( included, includedSource, includes, text );
+    }
+}
+
+// Modification times as ticks, whichever filesystem library Cinder uses
+static uint64_t ticks( time_t time ) { return (uint64_t)time; }
+template<typename Time>
+static uint64_t ticks( const Time &time ) { return (uint64_t)time.time_since_epoch().count(); }
+
+// Names, sizes and modification times: a stat per file, nothing is read
+static uint64_t stampFiles( uint64_t stamp, const vector<fs::path> &files )
+{
+    for ( auto &file : files ) {
+        if ( !fs::exists( file ) ) continue;
+        stamp = CounterRandom::hash( stamp, CounterRandom::hashString( file.string() ), (uint64_t)fs::file_size( file ) );
+        stamp = CounterRandom::hash( stamp, 0, ticks( fs::last_write_time( file ) ) );
+    }
+    return stamp;
+}
+
+static JsonTree stringsToJson( const string &key, const vector<string> &strings )
+{
+    auto tree = JsonTree::makeArray( key );
+    for ( auto &s : strings ) {
+        tree.pushBack( JsonTree( "", s ) );
+    }
+    return tree;
+}
+
+static vector<string> jsonToStrings( const JsonTree &tree )
+{
+    vector<string> strings;
+    for ( auto &child : tree ) {
+        strings.push_back( child.getValue() );
+    }
+    return strings;
+}
+
+const PatchInfo* PatchCatalog::find( const string &name ) const
+{
+    for ( auto &info : mPatches ) {
+        if ( info.name == name ) return &info;
+    }
+    return nullptr;
+}
+
+void PatchCatalog::scan()
+{
+    Timer timer( true );
+    auto patchesPath = app::getAssetPath( "patches" );
+    auto assets = fs::canonical( patchesPath.parent_path() );
+
+    // Entries of the previous scan are reused while their hash matches
+    vector<PatchInfo> cached;
+    try {
+        JsonTree json( loadFile( cachePath() ) );
+        if ( json["version"].getValue<int>() == PATCH_CATALOG_VERSION ) {
+            for ( auto &entry : json["patches"] ) {
+                PatchInfo info;
+                info.name = entry["name"].getValue();
+                info.hash = entry["hash"].getValue<uint64_t>();
+                info.stamp = entry.hasChild( "stamp" ) ? entry["stamp"].getValue<uint64_t>() : 0;
+                info.bufferCount = entry["buffers"].getValue<int>();
+                info.uniforms = jsonToStrings( entry["uniforms"] );
+                info.textures = jsonToStrings( entry["textures"] );
+                info.includes = jsonToStrings( entry["includes"] );
+                info.compute = entry["compute"].getValue<bool>();
+                info.instanced = entry["instanced"].getValue<bool>();
+                info.thumbnailHash = entry["thumbnailHash"].getValue<uint64_t>();
+                cached.push_back( info );
+            }
+        }
+    }
+    catch ( const std::exception & ) {
+        // First run, or a catalog from another version
+    }
+
+    vector<fs::path> folders;
+    for ( auto &entry : fs::directory_iterator( patchesPath ) ) {
+        if ( fs::is_directory( entry.path() ) ) {
+            folders.push_back( entry.path() );
+        }
+    }
+    sort( folders.begin(), folders.end() );
+
+    // One task per patch, hashing reads every file of the folder and its includes
+    vector<future<PatchInfo>> tasks;
+    vector<int> parsed( folders.size(), 0 );
+    for ( size_t i = 0; i < folders.size(); i++ ) {
+        tasks.push_back( async( launch::async, [&, i] {
+            bool wasParsed = false;
+            auto info = scanPatch( assets, folders[i], cached, &wasParsed );
+            parsed[i] = wasParsed;
+            return info;
+        } ) );
+    }
+
+    mPatches.clear();
+    mParsedCount = 0;
+    for ( size_t i = 0; i < tasks.size(); i++ ) {
+        try {
+            mPatches.push_back( tasks[i].get() );
+            mParsedCount += parsed[i];
+        }
+        catch ( const std::exception &e ) {
+            CI_LOG_W( "Cannot scan " << folders[i] << ": " << e.what() );
+        }
+    }
+
+    mScanSeconds = timer.getSeconds();
+    CI_LOG_I( "Scanned " << mPatches.size() << " patches, " << mParsedCount << " changed, in " << mScanSeconds * 1000. << " ms" );
+    save();
+}
+
+void PatchCatalog::save() const
+{
+    auto root = JsonTree::makeObject();
+    root.addChild( JsonTree( "version", PATCH_CATALOG_VERSION ) );
+    auto patches = JsonTree::makeArray( "patches" );
+    for ( auto &info : mPatches ) {
+        auto entry = JsonTree::makeObject();
+        entry.addChild( JsonTree( "name", info.name ) );
+        entry.addChild( JsonTree( "hash", info.hash ) );
+        entry.addChild( JsonTree( "stamp", info.stamp ) );
+        entry.addChild( JsonTree( "buffers", info.bufferCount ) );
+        entry.addChild( stringsToJson( "uniforms", info.uniforms ) );
+        entry.addChild( stringsToJson( "textures", info.textures ) );
+        entry.addChild( stringsToJson( "includes", info.includes ) );
+        entry.addChild( JsonTree( "compute", info.compute ) );
+        entry.addChild( JsonTree( "instanced", info.instanced ) );
+        entry.addChild( JsonTree( "thumbnailHash", info.thumbnailHash ) );
+        patches.pushBack( entry );
+    }
+    root.addChild( patches );
+
+    try {
+        fs::create_directories( cachePath().parent_path() );
+        root.write( cachePath() );
+    }
+    catch ( const std::exception &e ) {
+        CI_LOG_W( "Cannot write the patch catalog: " << e.what() );
+    }
+}
+
+vector<string> PatchCatalog::staleThumbnails() const
+{
+    vector<string> names;
+    for ( auto &info : mPatches ) {
+        if ( info.thumbnailHash != info.hash || !fs::exists( thumbnailPath( info.name ) ) ) {
+            names.push_back( info.name );
+        }
+    }
+    return names;
+}
+
+void PatchCatalog::setThumbnailRendered( const string &name )
+{
+    for ( auto &info : mPatches ) {
+        if ( info.name == name ) {
+            info.thumbnailHash = info.hash;
+        }
+    }
+}
+
+fs::path PatchCatalog::thumbnailPath( const string &name )
+{
+    return getHomeDirectory() / CACHE_FOLDER / "thumbnails" / ( name + ".png" );
+}
+
+/* Privates */
+
+fs::path PatchCatalog::cachePath()
+{
+    return getHomeDirectory() / CACHE_FOLDER / "catalog.json";
+}
+
+PatchInfo PatchCatalog::scanPatch( const fs::path &assets, const fs::path &folder, const vector<PatchInfo> &cached, bool *parsed )
+{
+    PatchInfo info;
+    info.name = folder.filename().string();
+
+    vector<fs::path> files;
+    for ( auto &entry : fs::directory_iterator( folder ) ) {
+        if ( fs::is_regular_file( entry.path() ) && entry.path().filename().string()[0] != '.' ) {
+            files.push_back( entry.path() );
+        }
+    }
+    sort( files.begin(), files.end() );
+
+    const PatchInfo *previous = nullptr;
+    for ( auto &entry : cached ) {
+        if ( entry.name == info.name ) {
+            previous = &entry;
+        }
+    }
+
+    // Unchanged since the last scan, includes too: nothing to read
+    vector<fs::path> previousIncludes;
+    if ( previous ) {
+        for ( auto &include : previous->includes ) {
+            previousIncludes.push_back( assets / include );
+        }
+        if ( previous->stamp && stampFiles( stampFiles( PATCH_CATALOG_VERSION, files ), previousIncludes ) == previous->stamp ) {
+            *parsed = false;
+            return *previous;
+        }
+    }
+
+    // Includes of every stage, the text of shader.frag with its includes appended
+    set<fs::path> includes;
+    string fragSource, fragText;
+    for ( auto &file : files ) {
+        auto extension = file.extension().string();
+        if ( extension != ".frag" && extension != ".vert" && extension != ".comp" ) continue;
+
+        auto source = readFile( file );
+        string text = source;
+        set<fs::path> stageIncludes;
+        collectIncludes( file, source, stageIncludes, text );
+        includes.insert( stageIncludes.begin(), stageIncludes.end() );
+        if ( file.filename() == "shader.frag" ) {
+            fragSource = source;
+            fragText = text;
+        }
+    }
+
+    auto assetName = [&assets] ( const fs::path &path ) {
+        auto name = path.string();
+        return name.compare( 0, assets.string().size(), assets.string() ) == 0 ? name.substr( assets.string().size() + 1 ) : name;
+    };
+
+    info.hash = PATCH_CATALOG_VERSION;
+    for ( auto &file : files ) {
+        info.hash = CounterRandom::hash( info.hash, CounterRandom::hashString( file.filename().string() ), CounterRandom::hashString( readFile( file ) ) );
+    }
+    for ( auto &include : includes ) {
+        info.hash = CounterRandom::hash( info.hash, CounterRandom::hashString( assetName( include ) ), CounterRandom::hashString( readFile( include ) ) );
+    }
+    info.stamp = stampFiles( stampFiles( PATCH_CATALOG_VERSION, files ), vector<fs::path>( includes.begin(), includes.end() ) );
+
+    // Touched but the same: only the stamp moves
+    *parsed = !previous || previous->hash != info.hash;
+    if ( !*parsed ) {
+        auto unchanged = *previous;
+        unchanged.stamp = info.stamp;
+        return unchanged;
+    }
+
+    info.bufferCount = getDefineBlockCount( fragSource, "BUFFER_" );
+
+    static const regex uniformRe( R"(\buniform\s+\w+\s+(\w+))" );
+    set<string> uniforms;
+    for ( sregex_iterator it( fragText.begin(), fragText.end(), uniformRe ), end; it != end; ++it ) {
+        uniforms.insert( ( *it )[1].str() );
+    }
+    info.uniforms.assign( uniforms.begin(), uniforms.end() );
+
+    for ( auto &file : files ) {
+        auto extension = file.extension().string();
+        if ( extension == ".png" || extension == ".jpg" || extension == ".cube" ) {
+            info.textures.push_back( file.filename().string() );
+        }
+        info.compute = info.compute || file.filename() == "shader.comp";
+        info.instanced = info.instanced || file.filename() == "instances.vert";
+    }
+    for ( auto &include : includes ) {
+        info.includes.push_back( assetName( include ) );
+    }
+
+    // The thumbnail is stale until rendered from this hash
+    info.thumbnailHash = previous ? previous->thumbnailHash : 0;
+    return info;
+}
\ No newline at end of file
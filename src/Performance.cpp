@@ -1,19 +1,88 @@
 #include "Performance.h"
+#include "cinder/app/App.h"
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+#include "Constants.h"
+#include <fstream>
 
 using namespace std;
 
-Performance::Performance( initializer_list<string> initList ) : mCurrentPatchIndex( 0 )
+const string setlistFolder = "setlists/";
+const string setlistExtension = ".txt";
+
+Performance::Performance() : mCurrentPatchIndex( 0 )
 {
-    for ( string s : initList ) {
-        Patch patch( s );
-        mPatches.push_back( patch );
-    }    
+}
+
+Performance::Performance( const vector<string> &names ) : mCurrentPatchIndex( 0 )
+{
+    load( names );
 }
 
 Performance::~Performance()
 {
 }
 
+void Performance::load( const vector<string> &names )
+{
+    ci::Timer timer( true );
+    mPatches.clear();
+    mCurrentPatchIndex = 0;
+    for ( auto &name : names ) {
+        add( name );
+    }    
+    CI_LOG_I( "Loaded " << mPatches.size() << " patches in " << timer.getSeconds() * 1000. << " ms" );
+}
+
+void Performance::add( const string &name )
+{
+    mPatches.push_back( Patch( name ) );
+}
+
+vector<string> Performance::names() const
+{
+    vector<string> names;
+    for ( auto &patch : mPatches ) {
+        names.push_back( patch.name() );
+    }
+    return names;
+}
+
+vector<string> Performance::readSetlist( const string &setlist )
+{
+    auto path = ci::app::getAssetPath( setlistFolder + setlist + setlistExtension );
+    ifstream file( path.string() );
+    if ( path.empty() || !file ) {
+        CI_LOG_W( "No setlist " << setlist << ", playing " << PATCH_NAME );
+        return { PATCH_NAME };
+    }
+
+    vector<string> names;
+    string line;
+    while ( getline( file, line ) ) {
+        line = line.substr( 0, line.find( '#' ) );
+        line.erase( 0, line.find_first_not_of( " \t\r" ) );
+        line.erase( line.find_last_not_of( " \t\r" ) + 1 );
+        if ( !line.empty() ) {
+            names.push_back( line );
+        }
+    }
+    if ( names.empty() ) {
+        names.push_back( PATCH_NAME );
+    }
+    return names;
+}
+
+void Performance::writeSetlist( const string &setlist ) const
+{
+    auto path = ci::app::getAssetPath( "" ) / ( setlistFolder + setlist + setlistExtension );
+    ci::fs::create_directories( path.parent_path() );
+    ofstream file( path.string() );
+    for ( auto &name : names() ) {
+        file << name << endl;
+    }
+}
+
 Patch& Performance::currentPatch()
 {
     return mPatches[ mCurrentPatchIndex ];
@@ -21,7 +90,7 @@ Patch& Performance::currentPatch()
 
 void Performance::goToPatch( int index )
 {
-    if ( index < 0 || index > mPatches.size() - 1 ) {
+    if ( index < 0 || index >= (int)mPatches.size() ) {
         return;
     }
     mCurrentPatchIndex = index;    
@@ -38,7 +107,7 @@ bool Performance::previous()
 
 bool Performance::next()
 {
-    if ( mCurrentPatchIndex < mPatches.size() - 1 ) {
+    if ( mCurrentPatchIndex + 1 < (int)mPatches.size() ) {
         mCurrentPatchIndex++;
         return true;
     }
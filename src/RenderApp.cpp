@@ -0,0 +1,181 @@
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+#include "cinder/Log.h"
+#include "cinder/Timer.h"
+
+#include "Constants.h"
+#include "OfflineRenderer.h"
+#include "RenderJob.h"
+#include "RenderServer.h"
+#include "RenderSocket.h"
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+using namespace ci;
+using namespace ci::app;
+using namespace std;
+
+// Windowless renderer for display-less render nodes. Built against a
+// headless Cinder (EGL pbuffer/surfaceless or OSMesa), it renders one job
+// from the command line, reports timings and exits. With --serve [socket]
+// it stays up as a render server instead (see RenderServer). With --shards N
+// the frame range is split across N worker processes. With --sweep or
+// --variants it renders variants of the parameters into one atlas.
+class CouleursRenderApp : public App {
+public:
+  void setup() override;
+
+private:
+  void serve( const string &socketPath );
+  bool renderShards( const RenderJob &job );
+};
+
+void CouleursRenderApp::setup()
+{
+  // Process start to a current context: Cinder and driver initialization
+  double contextSeconds = getElapsedSeconds();
+  const auto &args = getCommandLineArgs();
+  auto serveIt = find( args.begin(), args.end(), "--serve" );
+  if ( serveIt != args.end() ) {
+    bool hasPath = serveIt + 1 != args.end() && ( serveIt + 1 )->compare( 0, 2, "--" ) != 0;
+    serve( hasPath ? *( serveIt + 1 ) : defaultRenderSocketPath() );
+    quit();
+    return;
+  }
+
+  try {
+    auto job = RenderJob::fromArgs( getCommandLineArgs() );
+    if ( job.shards > 1 && !job.isSweep() ) {
+      if ( !renderShards( job ) ) {
+        exit( EXIT_FAILURE );
+      }
+      quit();
+      return;
+    }
+    gl::enableVerticalSync( false );
+
+    OfflineRenderer renderer;
+    renderer.render( job );
+
+    double startupSeconds = contextSeconds + renderer.mLoadSeconds;
+    double fps = renderer.mFramesRendered / renderer.mRenderSeconds;
+    if ( job.isSweep() ) {
+      console() << job.patch << " " << job.tileWidth << "x" << job.tileHeight << ": "
+                << renderer.mFramesRendered << " variants in " << renderer.mRenderSeconds << " s ("
+                << fps << " variants/s, " << 1000. / fps << " ms/variant, atlas written in " << renderer.mWriteSeconds << " s)" << endl;
+    }
+    else {
+      console() << job.patch << " " << job.width << "x" << job.height << ": "
+                << renderer.mFramesRendered << " frames in " << renderer.mRenderSeconds << " s ("
+                << fps << " fps, " << 1000. / fps << " ms/frame, " << renderer.mWriteSeconds << " s waiting on writes)" << endl;
+    }
+    console() << "Startup: " << startupSeconds << " s (context " << contextSeconds << " s, patch load " << renderer.mLoadSeconds << " s)" << endl;
+  }
+  catch ( const std::exception &exc ) {
+    CI_LOG_E( "Render failed: " << exc.what() );
+    exit( EXIT_FAILURE );
+  }
+
+  quit();
+}
+
+void CouleursRenderApp::serve( const string &socketPath )
+{
+  try {
+    gl::enableVerticalSync( false );
+    OfflineRenderer renderer;
+    RenderServer server( socketPath );
+    server.run( renderer );
+  }
+  catch ( const std::exception &exc ) {
+    CI_LOG_E( "Render server failed: " << exc.what() );
+  }
+}
+
+bool CouleursRenderApp::renderShards( const RenderJob &job )
+{
+  Timer timer( true );
+  fs::create_directories( job.output );
+
+  // Workers get the same arguments, minus the sharding ones, plus their slice
+  const auto &args = getCommandLineArgs();
+  vector<string> baseArgs = { args[0] };
+  for ( size_t i = 1; i < args.size(); i++ ) {
+    if ( args[i] == "--shards" || args[i] == "--hashes" || args[i] == "--verify" ) {
+      i++;
+      continue;
+    }
+    baseArgs.push_back( args[i] );
+  }
+
+  vector<pid_t> workers;
+  vector<fs::path> shardHashes;
+  for ( int i = 0; i < job.shards; i++ ) {
+    shardHashes.push_back( job.output / ( job.patch + ".shard" + to_string( i ) + ".hashes" ) );
+    auto workerArgs = baseArgs;
+    workerArgs.insert( workerArgs.end(), { "--shard", to_string( i ) + "/" + to_string( job.shards ), "--hashes", shardHashes.back().string() } );
+
+    vector<char *> argv;
+    for ( auto &arg : workerArgs ) {
+      argv.push_back( const_cast<char *>( arg.c_str() ) );
+    }
+    argv.push_back( nullptr );
+
+    pid_t pid;
+    if ( posix_spawn( &pid, "/proc/self/exe", nullptr, nullptr, argv.data(), environ ) != 0 ) {
+      CI_LOG_E( "Failed to start shard " << i );
+      return false;
+    }
+    workers.push_back( pid );
+  }
+
+  bool ok = true;
+  for ( size_t i = 0; i < workers.size(); i++ ) {
+    int status = 0;
+    waitpid( workers[i], &status, 0 );
+    if ( !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+      CI_LOG_E( "Shard " << i << " failed" );
+      ok = false;
+    }
+  }
+
+  // Merge the shard manifests, then compare with a reference render if asked
+  map<int, uint64_t> hashes;
+  for ( auto &path : shardHashes ) {
+    auto shard = OfflineRenderer::readHashes( path );
+    hashes.insert( shard.begin(), shard.end() );
+    fs::remove( path );
+  }
+  auto hashesPath = job.hashesPath.empty() ? job.output / ( job.patch + ".hashes" ) : job.hashesPath;
+  OfflineRenderer::writeHashes( hashesPath, hashes );
+  if ( (int)hashes.size() != job.frameCount() ) {
+    CI_LOG_E( "Expected " << job.frameCount() << " frames, shards produced " << hashes.size() );
+    ok = false;
+  }
+
+  if ( !job.verifyPath.empty() ) {
+    auto reference = OfflineRenderer::readHashes( job.verifyPath );
+    int mismatches = 0;
+    for ( auto &entry : reference ) {
+      auto it = hashes.find( entry.first );
+      if ( it == hashes.end() || it->second != entry.second ) {
+        if ( mismatches++ < 10 ) {
+          CI_LOG_E( "Frame " << entry.first << " differs from " << job.verifyPath );
+        }
+      }
+    }
+    console() << "Verify: " << reference.size() - mismatches << "/" << reference.size() << " frames identical" << endl;
+    ok = ok && mismatches == 0 && reference.size() == hashes.size();
+  }
+
+  double seconds = timer.getSeconds();
+  console() << job.patch << " " << job.width << "x" << job.height << ": " << hashes.size() << " frames on "
+            << job.shards << " shards in " << seconds << " s (" << hashes.size() / seconds << " fps)" << endl;
+  return ok;
+}
+
+// 4.5 core for compute passes, Mesa llvmpipe provides it without a GPU
+CINDER_APP( CouleursRenderApp, RendererGl( RendererGl::Options().version( 4, 5 ) ) )
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Command-line client for the render server (CouleursRender --serve).
+//
+//   couleurs-render [--socket path] [--priority n] [--detach] <render args>
+//   couleurs-render --status | --cancel <id> | --shutdown
+//
+// Render args are the ones CouleursRender takes (--patch, --params, --set,
+// --size, --from, --to, --fps, --bpm, --loop, --out, --sweep, --variants,
+// --tile, --variant). Prints the server's replies, one JSON object per line.
+
+#include "Constants.h"
+#include "RenderSocket.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+
+using namespace std;
+
+static string absolutePath( const string &path )
+{
+    // The server has its own working directory
+    if ( path.empty() || path[0] == '/' ) return path;
+    char cwd[4096];
+    return getcwd( cwd, sizeof( cwd ) ) ? string( cwd ) + "/" + path : path;
+}
+
+int main( int argc, char **argv )
+{
+    string socketPath = defaultRenderSocketPath();
+    string request;
+    int priority = 0;
+    bool wait = true;
+    vector<string> args;
+
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ( arg == "--socket" && hasValue ) {
+            socketPath = argv[++i];
+        }
+        else if ( arg == "--priority" && hasValue ) {
+            priority = stoi( argv[++i] );
+        }
+        else if ( arg == "--detach" ) {
+            wait = false;
+        }
+        else if ( arg == "--status" ) {
+            request = "{\"cmd\":\"status\"}";
+        }
+        else if ( arg == "--shutdown" ) {
+            request = "{\"cmd\":\"shutdown\"}";
+        }
+        else if ( arg == "--cancel" && hasValue ) {
+            request = "{\"cmd\":\"cancel\",\"id\":" + to_string( stoull( argv[++i] ) ) + "}";
+        }
+        else if ( ( arg == "--out" || arg == "--params" || arg == "--variant" ) && hasValue ) {
+            args.push_back( arg );
+            args.push_back( absolutePath( argv[++i] ) );
+        }
+        else {
+            args.push_back( arg );
+        }
+    }
+
+    if ( request.empty() ) {
+        request = "{\"cmd\":\"submit\",\"priority\":" + to_string( priority ) + ",\"wait\":" + ( wait ? "true" : "false" ) + ",\"args\":[";
+        for ( size_t i = 0; i < args.size(); i++ ) {
+            request += ( i ? "," : "" ) + quoteJson( args[i] );
+        }
+        request += "]}";
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, socketPath.c_str(), sizeof( address.sun_path ) - 1 );
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 || connect( fd, (sockaddr *)&address, sizeof( address ) ) < 0 ) {
+        cerr << "Cannot connect to render server at " << socketPath << endl;
+        return 1;
+    }
+
+    request += "\n";
+    if ( write( fd, request.data(), request.size() ) != (ssize_t)request.size() ) {
+        cerr << "Failed to send request" << endl;
+        close( fd );
+        return 1;
+    }
+
+    string reply;
+    char buffer[4096];
+    ssize_t count;
+    while ( ( count = read( fd, buffer, sizeof( buffer ) ) ) > 0 ) {
+        reply.append( buffer, count );
+    }
+    close( fd );
+
+    cout << reply;
+    bool failed = reply.find( "\"error\"" ) != string::npos || reply.find( "\"status\":\"failed\"" ) != string::npos;
+    return failed ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "RenderJob.h"
+#include "ParameterSweep.h"
+#include "cinder/Exception.h"
+#include "cinder/Log.h"
+#include <cmath>
+#include <cstdio>
+
+using namespace ci;
+using namespace std;
+
+int RenderJob::frameCount() const
+{
+    return max( 1, (int)ceil( ( endTime - startTime ) * fps - 1e-6 ) );
+}
+
+int RenderJob::firstFrame() const
+{
+    return shardIndex * frameCount() / shardCount;
+}
+
+int RenderJob::lastFrame() const
+{
+    return ( shardIndex + 1 ) * frameCount() / shardCount;
+}
+
+double RenderJob::frameTime( int frame, double offset ) const
+{
+    // Exactly ( frame + offset ) / fps, whatever the wall time; loops wrap
+    // so sub-frames past the last frame land on the first
+    double t = ( frame + offset ) / fps;
+    if ( loop ) {
+        t = fmod( t, frameCount() / (double)fps );
+    }
+    return startTime + t;
+}
+
+fs::path RenderJob::framePath( int frame ) const
+{
+    if ( frameCount() == 1 && output.has_extension() ) {
+        return output;
+    }
+
+    char name[32];
+    snprintf( name, sizeof( name ), "_%05d.png", frame );
+    return output / ( patch + name );
+}
+
+// --patch name --params file.json --set name=value --size 1920x1080
+// --from 0 --to 10 --fps 60 --samples 1 --bpm 100 --loop --seed 0 --out path
+// --shards 4 --hashes file --verify file   (--shard 1/4 is set on workers)
+// --sweep name[=min:max[:steps]] --variants 64 --tile 256x256
+// --variant table.json:index   (a sweep tile again, at --size)
+RenderJob RenderJob::fromArgs( const vector<string> &args )
+{
+    RenderJob job;
+    job.output = fs::current_path();
+
+    for ( size_t i = 1; i < args.size(); i++ ) {
+        auto &arg = args[i];
+        auto value = [&] () -> const string& {
+            if ( i + 1 >= args.size() ) {
+                throw Exception( "Missing value for " + arg );
+            }
+            return args[++i];
+        };
+
+        if ( arg == "--patch" ) {
+            job.patch = value();
+        }
+        else if ( arg == "--params" ) {
+            job.paramsPath = value();
+        }
+        else if ( arg == "--set" ) {
+            auto &assignment = value();
+            auto equals = assignment.find( '=' );
+            if ( equals == string::npos ) {
+                throw Exception( "Invalid override " + assignment + ", expected name=value" );
+            }
+            job.overrides.push_back( make_pair( assignment.substr( 0, equals ), assignment.substr( equals + 1 ) ) );
+        }
+        else if ( arg == "--out" ) {
+            job.output = value();
+        }
+        else if ( arg == "--size" ) {
+            if ( sscanf( value().c_str(), "%dx%d", &job.width, &job.height ) != 2 || job.width <= 0 || job.height <= 0 ) {
+                throw Exception( "Invalid size " + args[i] + ", expected WIDTHxHEIGHT" );
+            }
+        }
+        else if ( arg == "--from" ) {
+            job.startTime = stod( value() );
+        }
+        else if ( arg == "--to" ) {
+            job.endTime = stod( value() );
+        }
+        else if ( arg == "--fps" ) {
+            job.fps = stof( value() );
+        }
+        else if ( arg == "--samples" ) {
+            job.samples = max( 1, stoi( value() ) );
+        }
+        else if ( arg == "--bpm" ) {
+            job.bpm = stoi( value() );
+        }
+        else if ( arg == "--loop" ) {
+            job.loop = true;
+        }
+        else if ( arg == "--seed" ) {
+            job.seed = stoull( value() );
+        }
+        else if ( arg == "--shards" ) {
+            job.shards = max( 1, stoi( value() ) );
+        }
+        else if ( arg == "--shard" ) {
+            if ( sscanf( value().c_str(), "%d/%d", &job.shardIndex, &job.shardCount ) != 2 || job.shardCount < 1 ||
+                 job.shardIndex < 0 || job.shardIndex >= job.shardCount ) {
+                throw Exception( "Invalid shard " + args[i] + ", expected INDEX/COUNT" );
+            }
+        }
+        else if ( arg == "--hashes" ) {
+            job.hashesPath = value();
+        }
+        else if ( arg == "--verify" ) {
+            job.verifyPath = value();
+        }
+        else if ( arg == "--sweep" ) {
+            job.sweep.push_back( value() );
+        }
+        else if ( arg == "--variants" ) {
+            job.variants = max( 1, stoi( value() ) );
+        }
+        else if ( arg == "--tile" ) {
+            if ( sscanf( value().c_str(), "%dx%d", &job.tileWidth, &job.tileHeight ) != 2 || job.tileWidth <= 0 || job.tileHeight <= 0 ) {
+                throw Exception( "Invalid tile " + args[i] + ", expected WIDTHxHEIGHT" );
+            }
+        }
+        else if ( arg == "--variant" ) {
+            // Its patch, time, seed and values; later arguments still apply
+            auto &entry = value();
+            auto colon = entry.rfind( ':' );
+            if ( colon == string::npos ) {
+                throw Exception( "Invalid variant " + entry + ", expected table.json:index" );
+            }
+            auto variant = ParameterSweep::readVariant( entry.substr( 0, colon ), stoi( entry.substr( colon + 1 ) ) );
+            if ( !variant.rendered ) {
+                CI_LOG_W( entry << " was not rendered, its sweep was cancelled" );
+            }
+            job.patch = variant.patch;
+            job.paramsPath = variant.paramsPath;
+            job.startTime = job.endTime = variant.time;
+            job.seed = variant.seed;
+            for ( auto &param : variant.params ) {
+                char text[32];
+                snprintf( text, sizeof( text ), "%.9g", param.second );
+                job.overrides.push_back( make_pair( param.first, string( text ) ) );
+            }
+            for ( auto &color : variant.colors ) {
+                char text[96];
+                snprintf( text, sizeof( text ), "%.9g,%.9g,%.9g", color.second.x, color.second.y, color.second.z );
+                job.overrides.push_back( make_pair( color.first, string( text ) ) );
+            }
+        }
+        else {
+            CI_LOG_W( "Ignoring unknown argument " << arg );
+        }
+    }
+
+    if ( job.fps <= 0 ) {
+        throw Exception( "fps must be positive" );
+    }
+    job.endTime = max( job.endTime, job.startTime );
+    return job;
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "RenderServer.h"
+#include "RenderSocket.h"
+#include "cinder/Json.h"
+#include "cinder/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ci;
+using namespace std;
+
+RenderServer::RenderServer( const string &socketPath ) : mSocketPath( socketPath )
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if ( socketPath.size() >= sizeof( address.sun_path ) ) {
+        throw Exception( "Socket path too long: " + socketPath );
+    }
+    strncpy( address.sun_path, socketPath.c_str(), sizeof( address.sun_path ) - 1 );
+
+    // A previous server that did not exit cleanly leaves its socket behind.
+    // Only that is removed, never a file or someone else's socket.
+    struct stat existing;
+    if ( lstat( socketPath.c_str(), &existing ) == 0 ) {
+        if ( !S_ISSOCK( existing.st_mode ) || existing.st_uid != getuid() ) {
+            throw Exception( socketPath + " exists and is not a socket of this user" );
+        }
+        unlink( socketPath.c_str() );
+    }
+
+    // Jobs write wherever --out says, so only this user may connect: the
+    // socket is created owner-only rather than opened up then narrowed
+    mSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+    mode_t mask = umask( 0077 );
+    bool bound = mSocket >= 0 && ::bind( mSocket, (sockaddr *)&address, sizeof( address ) ) == 0;
+    umask( mask );
+    if ( !bound || chmod( socketPath.c_str(), 0600 ) < 0 || listen( mSocket, 16 ) < 0 ) {
+        if ( mSocket >= 0 ) close( mSocket );
+        throw Exception( "Cannot listen on " + socketPath );
+    }
+    mAcceptThread = thread( &RenderServer::acceptConnections, this );
+    CI_LOG_I( "Render server listening on " << socketPath );
+}
+
+RenderServer::~RenderServer()
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mShutdown = true;
+        for ( int fd : mConnections ) {
+            shutdown( fd, SHUT_RDWR );
+        }
+    }
+    mCondition.notify_all();
+
+    shutdown( mSocket, SHUT_RDWR );
+    close( mSocket );
+    mAcceptThread.join();
+
+    unique_lock<mutex> lock( mMutex );
+    mCondition.wait( lock, [this] { return mConnections.empty(); } );
+    unlink( mSocketPath.c_str() );
+}
+
+void RenderServer::run( OfflineRenderer &renderer )
+{
+    while ( auto job = nextJob() ) {
+        bool complete = false;
+        string error;
+        try {
+            complete = renderer.render( job->job, &job->cancelled );
+        }
+        catch ( const std::exception &exc ) {
+            error = exc.what();
+        }
+
+        {
+            lock_guard<mutex> lock( mMutex );
+            job->status = !error.empty() ? "failed" : complete ? "done" : "cancelled";
+            job->error = error;
+            job->loadSeconds = renderer.mLoadSeconds;
+            job->renderSeconds = renderer.mRenderSeconds;
+            job->writeSeconds = renderer.mWriteSeconds;
+            job->frames = renderer.mFramesRendered;
+            job->warm = renderer.mWarm;
+            mRunning = nullptr;
+        }
+        mCondition.notify_all();
+        CI_LOG_I( report( *job ) );
+    }
+}
+
+RenderServer::JobRef RenderServer::nextJob()
+{
+    unique_lock<mutex> lock( mMutex );
+    mCondition.wait( lock, [this] { return mShutdown || !mQueue.empty(); } );
+    if ( mShutdown ) {
+        return nullptr;
+    }
+
+    // Highest priority first, then submission order
+    auto next = min_element( mQueue.begin(), mQueue.end(), [] ( const JobRef &a, const JobRef &b ) {
+        return a->priority != b->priority ? a->priority > b->priority : a->id < b->id;
+    } );
+    mRunning = *next;
+    mQueue.erase( next );
+    mRunning->status = "running";
+    mRunning->queueSeconds = mRunning->queueTimer.getSeconds();
+    return mRunning;
+}
+
+void RenderServer::acceptConnections()
+{
+    while ( true ) {
+        int fd = accept( mSocket, nullptr, nullptr );
+        lock_guard<mutex> lock( mMutex );
+        if ( fd < 0 || mShutdown ) {
+            if ( fd >= 0 ) close( fd );
+            return;
+        }
+        mConnections.push_back( fd );
+        thread( &RenderServer::handleConnection, this, fd ).detach();
+    }
+}
+
+void RenderServer::handleConnection( int fd )
+{
+    // One request per connection, a line no longer than RENDER_REQUEST_SIZE
+    string line;
+    char c;
+    while ( line.size() <= RENDER_REQUEST_SIZE && read( fd, &c, 1 ) == 1 && c != '\n' ) {
+        line += c;
+    }
+
+    auto send = [fd] ( const string &message ) {
+        string data = message + "\n";
+        return write( fd, data.data(), data.size() ) == (ssize_t)data.size();
+    };
+
+    try {
+        if ( line.size() > RENDER_REQUEST_SIZE ) {
+            throw Exception( "Request longer than " + to_string( RENDER_REQUEST_SIZE ) + " bytes" );
+        }
+        JsonTree request( line );
+        string command = request["cmd"].getValue();
+        if ( command == "submit" ) {
+            vector<string> args = { "render" };
+            for ( auto &arg : request["args"] ) {
+                args.push_back( arg.getValue() );
+            }
+            int priority = request.hasChild( "priority" ) ? request["priority"].getValue<int>() : 0;
+            bool wait = !request.hasChild( "wait" ) || request["wait"].getValue<bool>();
+
+            JobRef job;
+            if ( send( submit( args, priority, job ) ) && job && wait ) {
+                unique_lock<mutex> lock( mMutex );
+                mCondition.wait( lock, [this, &job] { return mShutdown || isFinished( *job ); } );
+                string message = report( *job );
+                lock.unlock();
+                send( message );
+            }
+        }
+        else if ( command == "cancel" ) {
+            send( cancel( request["id"].getValue<uint64_t>() ) );
+        }
+        else if ( command == "status" ) {
+            send( status() );
+        }
+        else if ( command == "shutdown" ) {
+            {
+                lock_guard<mutex> lock( mMutex );
+                mShutdown = true;
+            }
+            mCondition.notify_all();
+            send( "{\"shutdown\":true}" );
+        }
+        else {
+            send( "{\"error\":" + quoteJson( "Unknown command " + command ) + "}" );
+        }
+    }
+    catch ( const std::exception &exc ) {
+        send( "{\"error\":" + quoteJson( exc.what() ) + "}" );
+    }
+
+    {
+        lock_guard<mutex> lock( mMutex );
+        mConnections.erase( remove( mConnections.begin(), mConnections.end(), fd ), mConnections.end() );
+        close( fd );
+    }
+    mCondition.notify_all();
+}
+
+string RenderServer::submit( const vector<string> &args, int priority, JobRef &job )
+{
+    // Parse errors go straight back to the client
+    auto renderJob = RenderJob::fromArgs( args );
+
+    job = make_shared<Job>();
+    job->priority = priority;
+    job->job = renderJob;
+    job->queueTimer.start();
+    {
+        lock_guard<mutex> lock( mMutex );
+        if ( mShutdown ) {
+            job = nullptr;
+            return "{\"error\":\"Server is shutting down\"}";
+        }
+        job->id = mNextId++;
+        mQueue.push_back( job );
+    }
+    mCondition.notify_all();
+    return "{\"id\":" + to_string( job->id ) + "}";
+}
+
+string RenderServer::cancel( uint64_t id )
+{
+    bool found = false;
+    {
+        lock_guard<mutex> lock( mMutex );
+        if ( mRunning && mRunning->id == id ) {
+            // Stops between frames
+            mRunning->cancelled = true;
+            found = true;
+        }
+        for ( auto it = mQueue.begin(); it != mQueue.end(); it++ ) {
+            if ( (*it)->id == id ) {
+                (*it)->status = "cancelled";
+                mQueue.erase( it );
+                found = true;
+                break;
+            }
+        }
+    }
+    mCondition.notify_all();
+    return "{\"id\":" + to_string( id ) + ",\"cancelled\":" + ( found ? "true" : "false" ) + "}";
+}
+
+string RenderServer::status()
+{
+    lock_guard<mutex> lock( mMutex );
+    ostringstream ss;
+    ss << "{\"running\":";
+    if ( mRunning ) {
+        ss << "{\"id\":" << mRunning->id << ",\"patch\":" << quoteJson( mRunning->job.patch ) << "}";
+    }
+    else {
+        ss << "null";
+    }
+    ss << ",\"queued\":[";
+    for ( size_t i = 0; i < mQueue.size(); i++ ) {
+        ss << ( i ? "," : "" ) << "{\"id\":" << mQueue[i]->id << ",\"priority\":" << mQueue[i]->priority << ",\"patch\":" << quoteJson( mQueue[i]->job.patch ) << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+string RenderServer::report( const Job &job )
+{
+    ostringstream ss;
+    ss << "{\"id\":" << job.id << ",\"patch\":" << quoteJson( job.job.patch ) << ",\"status\":" << quoteJson( job.status );
+    if ( !job.error.empty() ) {
+        ss << ",\"error\":" << quoteJson( job.error );
+    }
+    ss << ",\"frames\":" << job.frames << ",\"warm\":" << ( job.warm ? "true" : "false" )
+       << ",\"queueSeconds\":" << job.queueSeconds << ",\"loadSeconds\":" << job.loadSeconds
+       << ",\"renderSeconds\":" << job.renderSeconds << ",\"writeSeconds\":" << job.writeSeconds
+       << ",\"fps\":" << ( job.renderSeconds > 0 ? job.frames / job.renderSeconds : 0 ) << "}";
+    return ss.str();
+}
+
+bool RenderServer::isFinished( const Job &job )
+{
+    return job.status == "done" || job.status == "cancelled" || job.status == "failed";
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "RenderThread.h"
+#include "cinder/Thread.h"
+#include "cinder/Log.h"
+#include "Utils.h"
+#include <chrono>
+
+using namespace ci;
+using namespace std;
+
+RenderThread::RenderThread()
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+void RenderThread::start( const function<gl::FboRef ( FrameState & )> &renderFrame, float frameRate )
+{
+    mRenderFrame = renderFrame;
+    mFrameRate = frameRate;
+
+    // Must be created on the main thread, with the scene context current
+    auto context = gl::Context::create( gl::context() );
+    mRunning = true;
+    mThread = thread( bind( &RenderThread::run, this, context ) );
+}
+
+void RenderThread::stop()
+{
+    if ( !mRunning ) return;
+    mRunning = false;
+    mThread.join();
+}
+
+void RenderThread::post( const function<void ()> &command )
+{
+    if ( !mRunning ) {
+        command();
+        return;
+    }
+    lock_guard<mutex> lock( mCommandMutex );
+    mCommands.push_back( command );
+}
+
+void RenderThread::runCommands()
+{
+    vector<function<void ()>> commands;
+    {
+        lock_guard<mutex> lock( mCommandMutex );
+        commands.swap( mCommands );
+    }
+    for ( auto &command : commands ) {
+        command();
+    }
+}
+
+void RenderThread::run( gl::ContextRef context )
+{
+    ThreadSetup threadSetup;
+    context->makeCurrent();
+
+    auto frameDuration = chrono::duration_cast<chrono::steady_clock::duration>( chrono::duration<double>( 1. / mFrameRate ) );
+    auto nextFrame = chrono::steady_clock::now();
+    bool hasState = false;
+
+    while ( mRunning ) {
+        runCommands();
+
+        // Newest snapshot, or the previous one again, re-timed, if the main thread is stalled
+        hasState |= mFrameStates.update();
+        float milliseconds = 0;
+        if ( hasState ) {
+            auto start = chrono::steady_clock::now();
+            auto &state = mFrameStates.readBuffer();
+            auto fbo = mRenderFrame( state );
+            double renderSeconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+            presentFrame( fbo, state.presentTime, renderSeconds );
+            mFrameMilliseconds = milliseconds = chrono::duration<float, milli>( chrono::steady_clock::now() - start ).count();
+            mFramesRendered++;
+        }
+
+        nextFrame += frameDuration;
+        auto now = chrono::steady_clock::now();
+        bool late = nextFrame < now;
+        uint32_t dropped = 0;
+        if ( late ) {
+            mLateFrames++;
+            dropped = (uint32_t)( ( now - nextFrame ) / frameDuration );
+            nextFrame = now;
+        }
+        if ( hasState && mMetrics ) {
+            mMetrics->recordFrame( milliseconds, late, dropped );
+        }
+        this_thread::sleep_until( nextFrame );
+    }
+
+    runCommands();
+}
+
+void RenderThread::presentFrame( const gl::FboRef &source, double presentTime, double renderSeconds )
+{
+    auto &frame = mFrames.writeBuffer();
+
+    // The main thread may still be sampling this frame on the GPU
+    if ( frame.consumedFence ) {
+        frame.consumedFence->waitSync();
+        frame.consumedFence = nullptr;
+    }
+
+    if ( !frame.fbo || frame.fbo->getSize() != source->getSize() ) {
+        frame.fbo = gl::Fbo::create( source->getWidth(), source->getHeight(), gl::Fbo::Format().disableDepth() );
+    }
+    source->blitTo( frame.fbo, source->getBounds(), frame.fbo->getBounds() );
+    frame.renderedFence = gl::Sync::create();
+    frame.presentTime = presentTime;
+    frame.renderSeconds = renderSeconds;
+    glFlush();
+    gl::printError( "RenderThread::presentFrame" );
+
+    mFrames.publish();
+}
+
+gl::TextureRef RenderThread::acquireFrame()
+{
+    mAcquiredNew = mFrames.update();
+    auto &frame = mFrames.readBuffer();
+    if ( !frame.fbo ) {
+        return nullptr;
+    }
+    if ( frame.renderedFence ) {
+        frame.renderedFence->waitSync();
+    }
+    return frame.fbo->getColorTexture();
+}
+
+void RenderThread::releaseFrame()
+{
+    auto &frame = mFrames.readBuffer();
+    if ( frame.fbo ) {
+        frame.consumedFence = gl::Sync::create();
+    }
+}
+
+bool RenderThread::newFrameTiming( double &presentTime, double &renderSeconds )
+{
+    auto &frame = mFrames.readBuffer();
+    if ( !mAcquiredNew || !frame.fbo ) {
+        return false;
+    }
+    mAcquiredNew = false;
+    presentTime = frame.presentTime;
+    renderSeconds = frame.renderSeconds;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "ShaderCompiler.h"
+#include "cinder/Thread.h"
+#include "cinder/Timer.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+ShaderCompiler::ShaderCompiler()
+{
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    stop();
+}
+
+void ShaderCompiler::start()
+{
+    // Must be created on the main thread, like the render thread's
+    auto context = gl::Context::create( gl::context() );
+    mRunning = true;
+    mThread = thread( bind( &ShaderCompiler::run, this, context ) );
+}
+
+void ShaderCompiler::stop()
+{
+    if ( !mRunning ) return;
+    {
+        lock_guard<mutex> lock( mMutex );
+        mRunning = false;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+uint64_t ShaderCompiler::submit( const vector<gl::GlslProg::Format> &formats )
+{
+    Job job;
+    job.id = mNextId++;
+    job.formats = formats;
+    if ( !mRunning ) {
+        compile( job );
+        lock_guard<mutex> lock( mMutex );
+        mDone.push_back( job );
+        return job.id;
+    }
+
+    {
+        lock_guard<mutex> lock( mMutex );
+        mPending.push_back( job );
+    }
+    mCondition.notify_one();
+    return job.id;
+}
+
+bool ShaderCompiler::poll( Job &job )
+{
+    lock_guard<mutex> lock( mMutex );
+    if ( mDone.empty() ) return false;
+    job = mDone.front();
+    mDone.pop_front();
+    return true;
+}
+
+void ShaderCompiler::run( gl::ContextRef context )
+{
+    ThreadSetup threadSetup;
+    context->makeCurrent();
+
+    while ( true ) {
+        Job job;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mCondition.wait( lock, [this] { return !mRunning || !mPending.empty(); } );
+            if ( !mRunning ) break;
+            job = mPending.front();
+            mPending.pop_front();
+        }
+
+        compile( job );
+
+        // Linked programs are only visible to the other contexts once finished here
+        glFinish();
+        lock_guard<mutex> lock( mMutex );
+        mDone.push_back( job );
+    }
+}
+
+void ShaderCompiler::compile( Job &job )
+{
+    Timer timer( true );
+    try {
+        for ( auto &format : job.formats ) {
+            job.programs.push_back( gl::GlslProg::create( format ) );
+        }
+    }
+    catch ( const std::exception &e ) {
+        job.programs.clear();
+        job.error = e.what();
+    }
+    job.seconds = timer.getSeconds();
+    gl::printError( "ShaderCompiler::compile" );
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "TemporalAccumulator.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+TemporalAccumulator::TemporalAccumulator()
+{
+}
+
+TemporalAccumulator::~TemporalAccumulator()
+{
+}
+
+void TemporalAccumulator::begin( int width, int height )
+{
+    if ( !mFbo || mFbo->getSize() != ivec2( width, height ) ) {
+        auto textureFormat = gl::Texture::Format().internalFormat( GL_RGBA32F );
+        mFbo = gl::Fbo::create( width, height, gl::Fbo::Format().colorTexture( textureFormat ).disableDepth() );
+    }
+    gl::ScopedFramebuffer scopedFbo( mFbo );
+    gl::clear( ColorA( 0.f, 0.f, 0.f, 0.f ) );
+}
+
+void TemporalAccumulator::add( const gl::TextureRef &texture, float weight )
+{
+    gl::ScopedFramebuffer scopedFbo( mFbo );
+    gl::ScopedViewport scopedViewport( ivec2( 0 ), mFbo->getSize() );
+    gl::ScopedMatrices scopedMatrices;
+    gl::setMatricesWindow( mFbo->getSize(), true );
+    gl::ScopedBlend scopedBlend( GL_ONE, GL_ONE );
+    gl::ScopedColor scopedColor( ColorA( weight, weight, weight, weight ) );
+    gl::draw( texture, Rectf( mFbo->getBounds() ) );
+    gl::printError( "TemporalAccumulator::add" );
+}
+
+void TemporalAccumulator::resolve( const gl::FboRef &target )
+{
+    gl::ScopedFramebuffer scopedFbo( target );
+    gl::ScopedViewport scopedViewport( ivec2( 0 ), target->getSize() );
+    gl::ScopedMatrices scopedMatrices;
+    gl::setMatricesWindow( target->getSize(), true );
+    gl::ScopedBlend scopedBlend( false );
+    gl::draw( mFbo->getColorTexture(), Rectf( target->getBounds() ) );
+    gl::printError( "TemporalAccumulator::resolve" );
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "TexturePacking.h"
+#include <algorithm>
+#include <cctype>
+#include <regex>
+
+using namespace std;
+
+static bool isIdentifier( const string &name )
+{
+    return !name.empty() && all_of( name.begin(), name.end(), [] ( char c ) { return isalnum( (unsigned char)c ) || c == '_'; } );
+}
+
+static int countMatches( const string &text, const regex &re )
+{
+    return distance( sregex_iterator( text.begin(), text.end(), re ), sregex_iterator() );
+}
+
+static regex declarationRe( const string &name )
+{
+    return regex( "\\buniform\\s+sampler2D\\s+u_" + name + "\\s*;" );
+}
+
+// The sampler is always the first argument, the match ends after its comma
+static regex callRe( const string &name )
+{
+    return regex( "\\b(texture|textureLod|texelFetch|textureSize)\\s*\\(\\s*u_" + name + "\\s*," );
+}
+
+static string trim( const string &text )
+{
+    auto begin = text.find_first_not_of( " \t\r\n" );
+    return begin == string::npos ? "" : text.substr( begin, text.find_last_not_of( " \t\r\n" ) - begin + 1 );
+}
+
+// The comma or closing parenthesis ending the argument that starts at begin
+static size_t argumentEnd( const string &text, size_t begin )
+{
+    int depth = 0;
+    for ( size_t i = begin; i < text.size(); i++ ) {
+        char c = text[i];
+        if ( c == '(' || c == '[' ) {
+            depth++;
+        }
+        else if ( c == ')' || c == ']' ) {
+            if ( depth-- == 0 ) return i;
+        }
+        else if ( c == ',' && depth == 0 ) {
+            return i;
+        }
+    }
+    return string::npos;
+}
+
+// texture( u_name, uv ) becomes texture( u_array, vec3( uv, layer. ) ), and
+// so on. Calls nested in the coordinate are rewritten too.
+static string rewriteCalls( const string &text, const regex &call, const string &array, int layer )
+{
+    string rewritten;
+    size_t position = 0;
+    for ( auto it = sregex_iterator( text.begin(), text.end(), call ); it != sregex_iterator(); ++it ) {
+        size_t start = it->position();
+        if ( start < position ) continue;
+
+        size_t argument = start + it->length();
+        size_t end = argumentEnd( text, argument );
+        if ( end == string::npos ) break;
+
+        auto function = (*it)[1].str();
+        auto coordinate = trim( rewriteCalls( text.substr( argument, end - argument ), call, array, layer ) );
+        rewritten += text.substr( position, start - position );
+        if ( function == "textureSize" ) {
+            rewritten += "textureSize( u_" + array + ", " + coordinate + " ).xy";
+            end++;
+        }
+        else if ( function == "texelFetch" ) {
+            rewritten += "texelFetch( u_" + array + ", ivec3( " + coordinate + ", " + to_string( layer ) + " )";
+        }
+        else {
+            rewritten += function + "( u_" + array + ", vec3( " + coordinate + ", " + to_string( layer ) + ". )";
+        }
+        position = end;
+    }
+    return rewritten + text.substr( position );
+}
+
+TexturePacking::TexturePacking( const string &source, const vector<Image> &images, const set<string> &excluded, int maxLayers )
+    : mSource( source )
+{
+    // Same size and mip levels, in the order given
+    vector<vector<const Image*>> groups;
+    for ( auto &image : images ) {
+        if ( excluded.count( image.name ) || !isPackable( source, image.name ) ) continue;
+        auto group = find_if( groups.begin(), groups.end(), [&] ( const vector<const Image*> &g ) {
+            return g[0]->width == image.width && g[0]->height == image.height && g[0]->levels == image.levels;
+        } );
+        if ( group == groups.end() ) {
+            groups.push_back( { &image } );
+        }
+        else {
+            group->push_back( &image );
+        }
+    }
+    for ( auto &group : groups ) {
+        for ( size_t first = 0; first + 1 < group.size(); first += maxLayers ) {
+            vector<string> layers;
+            for ( size_t i = first; i < min( group.size(), first + maxLayers ); i++ ) {
+                layers.push_back( group[i]->name );
+            }
+            if ( layers.size() > 1 ) {
+                mArrays.push_back( layers );
+            }
+        }
+    }
+    if ( mArrays.empty() ) return;
+
+    // Each image declaration becomes a note, the arrays are declared at the first one
+    vector<string> notes;
+    string declarations;
+    for ( int a = 0; a < arrayCount(); a++ ) {
+        declarations += "uniform sampler2DArray u_" + arrayName( a ) + ";\n";
+        for ( int layer = 0; layer < (int)mArrays[a].size(); layer++ ) {
+            auto &name = mArrays[a][layer];
+            auto note = "// u_" + name + ": layer " + to_string( layer ) + " of u_" + arrayName( a );
+            mSource = regex_replace( mSource, declarationRe( name ), note );
+            mSource = rewriteCalls( mSource, callRe( name ), arrayName( a ), layer );
+            notes.push_back( note );
+        }
+    }
+    size_t first = string::npos;
+    for ( auto &note : notes ) {
+        first = min( first, mSource.find( note ) );
+    }
+    mSource.insert( first, declarations );
+}
+
+bool TexturePacking::isPacked( const string &name ) const
+{
+    for ( auto &layers : mArrays ) {
+        if ( find( layers.begin(), layers.end(), name ) != layers.end() ) return true;
+    }
+    return false;
+}
+
+string TexturePacking::describe() const
+{
+    string description;
+    for ( int a = 0; a < arrayCount(); a++ ) {
+        description += a > 0 ? "; " : "";
+        for ( size_t layer = 0; layer < mArrays[a].size(); layer++ ) {
+            description += ( layer > 0 ? ", " : "" ) + mArrays[a][layer];
+        }
+        description += " > " + arrayName( a );
+    }
+    return description;
+}
+
+bool TexturePacking::isPackable( const string &source, const string &name )
+{
+    if ( !isIdentifier( name ) ) return false;
+
+    int declarations = countMatches( source, declarationRe( name ) );
+    int uses = countMatches( source, regex( "\\bu_" + name + "\\b" ) );
+    return declarations == 1 && uses == declarations + countMatches( source, callRe( name ) );
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "TextureUnits.h"
+#include "cinder/Exception.h"
+#include <algorithm>
+#include <climits>
+
+using namespace ci;
+using namespace std;
+
+TextureUnits::TextureUnits( const vector<Pass> &passes, int perPass, int units )
+{
+    int count = passes.size();
+    for ( auto &pass : passes ) {
+        int limit = std::min( perPass, units - 1 );
+        if ( (int)pass.samplers.size() > limit ) {
+            string names;
+            for ( auto &sampler : pass.samplers ) {
+                names += ( names.empty() ? "" : ", " ) + sampler;
+            }
+            throw Exception( pass.name + " samples " + to_string( pass.samplers.size() ) + " textures, the limit is " + to_string( limit ) + ": " + names );
+        }
+    }
+
+    // Passes until the texture is sampled again, counting around the frame
+    auto nextUse = [&] ( const string &sampler, int pass ) {
+        for ( int distance = 1; distance <= count; distance++ ) {
+            auto &samplers = passes[ ( pass + distance ) % count ].samplers;
+            if ( find( samplers.begin(), samplers.end(), sampler ) != samplers.end() ) return distance;
+        }
+        return INT_MAX;
+    };
+
+    // What each unit holds before the pass. A texture stays on its unit,
+    // new ones take a free unit, then the one needed again the latest.
+    vector<string> held( units );
+    for ( int i = 0; i < count; i++ ) {
+        auto &samplers = passes[i].samplers;
+        vector<bool> taken( units, false );
+        taken[0] = true;
+        Bindings bindings;
+        for ( auto &sampler : samplers ) {
+            auto unit = find( held.begin() + 1, held.end(), sampler ) - held.begin();
+            if ( unit < units ) {
+                taken[unit] = true;
+            }
+        }
+        for ( auto &sampler : samplers ) {
+            int unit = find( held.begin() + 1, held.end(), sampler ) - held.begin();
+            if ( unit == units ) {
+                int latest = -1;
+                for ( int u = 1; u < units; u++ ) {
+                    if ( taken[u] ) continue;
+                    int next = held[u].empty() ? INT_MAX : nextUse( held[u], i );
+                    if ( unit == units || next > latest ) {
+                        unit = u;
+                        latest = next;
+                    }
+                    if ( held[u].empty() ) break;
+                }
+                held[unit] = sampler;
+                taken[unit] = true;
+            }
+            bindings.push_back( { sampler, unit } );
+            mUnitsUsed = std::max( mUnitsUsed, unit + 1 );
+        }
+        mBindings.push_back( bindings );
+    }
+
+    // Once drawn, a unit changes texture when the pass wants something else there
+    vector<string> bound( units );
+    for ( int frame = 0; frame < 2; frame++ ) {
+        for ( auto &bindings : mBindings ) {
+            for ( auto &binding : bindings ) {
+                mRebinds += frame > 0 && bound[ binding.second ] != binding.first;
+                bound[ binding.second ] = binding.first;
+            }
+        }
+    }
+}
\ No newline at end of file
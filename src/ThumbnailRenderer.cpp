@@ -0,0 +1,86 @@
+#include "ThumbnailRenderer.h"
+#include "cinder/Log.h"
+#include "Constants.h"
+#include "OfflineRenderer.h"
+#include "PatchCatalog.h"
+#include "Utils.h"
+
+using namespace ci;
+using namespace std;
+
+ThumbnailRenderer::ThumbnailRenderer()
+{
+}
+
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+    stop();
+}
+
+void ThumbnailRenderer::start( const function<void ( const string & )> &done )
+{
+    mDone = done;
+
+    // Must be created on the main thread, like the render thread's
+    auto context = gl::Context::create( gl::context() );
+    mRunning = true;
+    mThread = thread( bind( &ThumbnailRenderer::run, this, context ) );
+}
+
+void ThumbnailRenderer::stop()
+{
+    if ( !mRunning ) return;
+    {
+        lock_guard<mutex> lock( mMutex );
+        mRunning = false;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void ThumbnailRenderer::render( const string &patch )
+{
+    {
+        lock_guard<mutex> lock( mMutex );
+        mPending.push_back( patch );
+    }
+    mCondition.notify_one();
+}
+
+void ThumbnailRenderer::run( gl::ContextRef context )
+{
+    ThreadSetup threadSetup;
+    context->makeCurrent();
+
+    // Its GL objects live in this context, so it goes before the thread ends
+    auto renderer = make_unique<OfflineRenderer>();
+    while ( true ) {
+        string name;
+        {
+            unique_lock<mutex> lock( mMutex );
+            mCondition.wait( lock, [this] { return !mRunning || !mPending.empty(); } );
+            if ( !mRunning ) break;
+            name = mPending.front();
+            mPending.pop_front();
+        }
+
+        RenderJob job;
+        job.patch = name;
+        job.output = PatchCatalog::thumbnailPath( name );
+        job.width = THUMBNAIL_WIDTH;
+        job.height = THUMBNAIL_HEIGHT;
+        job.startTime = job.endTime = THUMBNAIL_TIME;
+        try {
+            renderer->render( job );
+        }
+        catch ( const std::exception &e ) {
+            // Not retried until the patch changes
+            CI_LOG_W( "No thumbnail for " << name << ": " << e.what() );
+        }
+        mDone( name );
+
+        unique_lock<mutex> lock( mMutex );
+        mCondition.wait_for( lock, chrono::duration<double>( THUMBNAIL_INTERVAL ), [this] { return !mRunning; } );
+    }
+    renderer.reset();
+}
\ No newline at end of file
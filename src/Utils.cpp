@@ -1,13 +1,65 @@
-#include "cinder/gl/gl.h"
-#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+#include "cinder/Exception.h"
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include "Utils.h"
 
-namespace cinder {
-  namespace gl {
-    void printError(const std::string &method) {
-      GLenum errorFlag = getError();
-      if ( errorFlag != GL_NO_ERROR ) {
-        CI_LOG_E( method << " -- glGetError flag set: " << getErrorString( errorFlag ) );
-      }
+int getDefineBlockCount( const std::string &source, const std::string &prefix ) {
+  std::regex re( "(?:^\\s*#if|^\\s*#elif)\\s+defined\\s*\\(\\s*" + prefix + "(\\d+)\\s*\\)|^\\s*#ifdef\\s+" + prefix + "(\\d+)" );
+  std::set<std::string> numbers;
+  std::smatch match;
+  for ( auto &line : ci::split( source, '\n' ) ) {
+    if ( std::regex_search( line, match, re ) ) {
+      numbers.insert( match[1].matched ? match[1].str() : match[2].str() );
     }
   }
+  return numbers.size();
+}
+
+std::vector<PatchDirective> getPatchDirectives( const std::string &source ) {
+  static const std::regex re( R"(^\s*#pragma\s+couleurs\s+(\w+)(.*)$)" );
+  std::vector<PatchDirective> directives;
+  std::smatch match;
+  for ( auto &line : ci::split( source, '\n' ) ) {
+    if ( !std::regex_search( line, match, re ) ) continue;
+
+    PatchDirective directive;
+    directive.name = match[1].str();
+    directive.line = line;
+    std::istringstream stream( match[2].str() );
+    for ( std::string arg; stream >> arg && arg.compare( 0, 2, "//" ) != 0; ) {
+      directive.args.push_back( arg );
+    }
+    directives.push_back( directive );
+  }
+  return directives;
+}
+
+std::string resolveShaderIncludes( const ci::fs::path &path, std::set<ci::fs::path> &included ) {
+  auto canonicalPath = ci::fs::canonical( path );
+  if ( included.count( canonicalPath ) ) {
+    return "";
+  }
+  included.insert( canonicalPath );
+
+  std::ifstream file( path.string() );
+  if ( !file ) {
+    throw ci::Exception( "Cannot read shader source: " + path.string() );
+  }
+
+  static const std::regex includeRe( R"(^\s*#include\s+\"([^\"]+)\")" );
+  std::stringstream out;
+  std::string line;
+  std::smatch match;
+  while ( std::getline( file, line ) ) {
+    if ( std::regex_search( line, match, includeRe ) ) {
+      out << resolveShaderIncludes( path.parent_path() / match[1].str(), included );
+    }
+    else {
+      out << line << "\n";
+    }
+  }
+  return out.str();
 }
\ No newline at end of file
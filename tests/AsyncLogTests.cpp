@@ -0,0 +1,163 @@
+#include "gtest/gtest.h"
+#include "AsyncLog.h"
+#include <thread>
+
+using namespace std;
+
+// The log is process-wide: each test flushes and looks at its own records
+static vector<AsyncLog::Record> recordsOf( AsyncLog::Category category, const string &prefix )
+{
+    AsyncLog::instance().flush();
+    vector<AsyncLog::Record> records, found;
+    uint64_t version = 0;
+    AsyncLog::instance().history( records, version );
+    for ( auto &record : records ) {
+        if ( record.category == category && record.text.compare( 0, prefix.size(), prefix ) == 0 ) {
+            found.push_back( record );
+        }
+    }
+    return found;
+}
+
+TEST( AsyncLog, FiltersByLevelAndCategory )
+{
+    EXPECT_EQ( AsyncLog::level( AsyncLog::OSC ), AsyncLog::LEVEL_INFO );
+    LOG_D( OSC, "filtered debug" );
+    LOG_I( OSC, "filtered info" );
+    EXPECT_TRUE( recordsOf( AsyncLog::OSC, "filtered debug" ).empty() );
+    EXPECT_EQ( recordsOf( AsyncLog::OSC, "filtered info" ).size(), 1u );
+
+    AsyncLog::setLevel( AsyncLog::OSC, AsyncLog::LEVEL_DEBUG );
+    EXPECT_TRUE( AsyncLog::isEnabled( AsyncLog::LEVEL_DEBUG, AsyncLog::OSC ) );
+    EXPECT_FALSE( AsyncLog::isEnabled( AsyncLog::LEVEL_DEBUG, AsyncLog::MIDI ) );
+    LOG_D( OSC, "filtered debug" );
+    EXPECT_EQ( recordsOf( AsyncLog::OSC, "filtered debug" ).size(), 1u );
+
+    AsyncLog::setLevel( AsyncLog::OSC, AsyncLog::LEVEL_COUNT );
+    EXPECT_FALSE( AsyncLog::isEnabled( AsyncLog::LEVEL_ERROR, AsyncLog::OSC ) );
+    EXPECT_TRUE( AsyncLog::isEnabled( AsyncLog::LEVEL_ERROR, AsyncLog::MIDI ) );
+    AsyncLog::setLevel( AsyncLog::OSC, AsyncLog::LEVEL_INFO );
+}
+
+TEST( AsyncLog, RateLimitsEachSite )
+{
+    AsyncLog::Site site;
+    for ( int i = 0; i < LOG_SITE_BURST; i++ ) {
+        EXPECT_TRUE( site.admit() );
+    }
+    EXPECT_FALSE( site.admit() );
+    EXPECT_FALSE( site.admit() );
+    EXPECT_EQ( site.suppressed.load(), 2u );
+
+    // Distinct messages from one call site, only the burst gets through
+    for ( int i = 0; i < 20; i++ ) {
+        LOG_W( MIDI, "limited " << i );
+    }
+    auto records = recordsOf( AsyncLog::MIDI, "limited " );
+    ASSERT_EQ( records.size(), (size_t)LOG_SITE_BURST );
+    EXPECT_EQ( records.back().text, "limited " + to_string( LOG_SITE_BURST - 1 ) );
+    EXPECT_EQ( records.back().level, AsyncLog::LEVEL_WARNING );
+}
+
+TEST( AsyncLog, FoldsRepeats )
+{
+    uint64_t suppressed = AsyncLog::instance().suppressed();
+    for ( int i = 0; i < 3; i++ ) {
+        LOG_E( SHADER, "folded: unexpected token" );
+    }
+    auto records = recordsOf( AsyncLog::SHADER, "folded" );
+    ASSERT_EQ( records.size(), 1u );
+    EXPECT_EQ( records[0].repeats, 2u );
+    EXPECT_EQ( AsyncLog::instance().suppressed(), suppressed );
+
+    // The history is only copied again once it changed
+    vector<AsyncLog::Record> history;
+    uint64_t version = 0;
+    EXPECT_TRUE( AsyncLog::instance().history( history, version ) );
+    EXPECT_FALSE( AsyncLog::instance().history( history, version ) );
+}
+
+TEST( AsyncLog, MergesThreadsInTimeOrder )
+{
+    // Sites of their own, not rate limited
+    vector<thread> threads;
+    for ( int t = 0; t < 4; t++ ) {
+        threads.emplace_back( [t] {
+            AsyncLog::Site site;
+            for ( int i = 0; i < 100; i++ ) {
+                AsyncLog::Message( AsyncLog::LEVEL_INFO, AsyncLog::RENDER, site ).stream() << "thread " << t << " " << i;
+            }
+        } );
+    }
+    for ( auto &thread : threads ) {
+        thread.join();
+    }
+    auto records = recordsOf( AsyncLog::RENDER, "thread " );
+    ASSERT_EQ( records.size(), 400u );
+    for ( size_t i = 1; i < records.size(); i++ ) {
+        EXPECT_LE( records[ i - 1 ].time, records[i].time );
+    }
+}
+
+TEST( AsyncLog, RecyclesRingsOfExitedThreads )
+{
+    // One thread at a time: each takes the ring the last one left
+    AsyncLog::Site site;
+    auto logOnce = [&site] ( int t ) {
+        thread( [&site, t] {
+            AsyncLog::Message( AsyncLog::LEVEL_INFO, AsyncLog::AUDIO, site ).stream() << "recycled " << t;
+        } ).join();
+        AsyncLog::instance().flush();
+    };
+    logOnce( 0 );
+    size_t rings = AsyncLog::instance().rings();
+    for ( int t = 1; t < 10; t++ ) {
+        logOnce( t );
+    }
+    EXPECT_EQ( AsyncLog::instance().rings(), rings );
+    EXPECT_EQ( recordsOf( AsyncLog::AUDIO, "recycled " ).size(), 10u );
+}
+
+TEST( AsyncLog, CountsDroppedAndKeepsLongMessages )
+{
+    // Nothing drains the ring while this thread fills it
+    uint64_t dropped = AsyncLog::instance().dropped();
+    AsyncLog::Site site;
+    for ( int i = 0; i < LOG_RING_SIZE + 10; i++ ) {
+        AsyncLog::Message( AsyncLog::LEVEL_INFO, AsyncLog::EXPORT, site ).stream() << "full " << i;
+    }
+    EXPECT_EQ( AsyncLog::instance().dropped() - dropped, 10u );
+    EXPECT_EQ( recordsOf( AsyncLog::EXPORT, "full " ).size(), (size_t)LOG_RING_SIZE );
+
+    // A shader's error list, whole
+    string errors;
+    for ( int i = 0; i < 20; i++ ) {
+        errors += "ERROR: 0:" + to_string( i ) + ": '' : syntax error\n";
+    }
+    AsyncLog::Message( AsyncLog::LEVEL_INFO, AsyncLog::EXPORT, site ).stream() << "long " << errors << "end";
+    auto records = recordsOf( AsyncLog::EXPORT, "long " );
+    ASSERT_EQ( records.size(), 1u );
+    EXPECT_GT( records[0].text.size(), (size_t)LOG_MESSAGE_SIZE );
+    EXPECT_EQ( records[0].text, "long " + errors + "end" );
+
+    // The next message is inline again
+    AsyncLog::Message( AsyncLog::LEVEL_INFO, AsyncLog::EXPORT, site ).stream() << "short";
+    ASSERT_EQ( recordsOf( AsyncLog::EXPORT, "short" ).size(), 1u );
+    EXPECT_EQ( recordsOf( AsyncLog::EXPORT, "short" )[0].text, "short" );
+}
+
+TEST( AsyncLog, RateLimitsCinderLogsPerLine )
+{
+    // Two CI_LOG_W lines: one flooding does not silence the other
+    AsyncLog::CinderLogger logger;
+    ci::log::Metadata flood, other;
+    flood.mLevel = other.mLevel = ci::log::LEVEL_WARNING;
+    flood.mLocation = ci::log::Location( "cinderFlood", "Flood.cpp", 10 );
+    other.mLocation = ci::log::Location( "cinderOther", "Flood.cpp", 20 );
+    for ( int i = 0; i < 20; i++ ) {
+        logger.write( flood, "again " + to_string( i ) );
+    }
+    logger.write( other, "still heard" );
+    EXPECT_EQ( recordsOf( AsyncLog::GENERAL, "cinderFlood: " ).size(), (size_t)LOG_SITE_BURST );
+    EXPECT_EQ( recordsOf( AsyncLog::GENERAL, "cinderOther: " ).size(), 1u );
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "LoopEncoder.h"
+#include "TestAssets.h"
+#include <fstream>
+#include <iterator>
+#include <zlib.h>
+
+using namespace ci;
+using namespace std;
+
+struct Rect {
+    int x, y, w, h;
+    bool operator==( const Rect &o ) const { return x == o.x && y == o.y && w == o.w && h == o.h; }
+};
+
+// Black, with white squares
+static Surface8u frameWithSquare( int x0, int y0, int size )
+{
+    Surface8u surface( 32, 16, false );
+    for ( int y = 0; y < 16; y++ ) {
+        for ( int x = 0; x < 32; x++ ) {
+            uint8_t *pixel = surface.getData() + y * surface.getRowBytes() + x * surface.getPixelInc();
+            uint8_t value = ( x < 2 && y < 2 ) || ( x >= x0 && x < x0 + size && y >= y0 && y < y0 + size ) ? 255 : 0;
+            pixel[ surface.getRedOffset() ] = pixel[ surface.getGreenOffset() ] = pixel[ surface.getBlueOffset() ] = value;
+        }
+    }
+    return surface;
+}
+
+static vector<uint8_t> encode( const string &name, LoopEncoder::Format format, float fps, int frames, LoopEncoder::Stats &stats )
+{
+    auto path = testAssetFolder() / name;
+    LoopEncoder encoder( path, format, 32, 16, fps );
+    for ( int i = 0; i < frames; i++ ) {
+        encoder.add( i < 2 ? frameWithSquare( 0, 0, 0 ) : frameWithSquare( 8, 4, 4 ) );
+    }
+    encoder.finish();
+    stats = encoder.stats();
+    ifstream file( path.string(), ios::binary );
+    return vector<uint8_t>( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+}
+
+static int le16( const uint8_t *p ) { return p[0] | p[1] << 8; }
+static uint32_t be32( const uint8_t *p ) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+// Image descriptors of a GIF, walking its blocks
+static vector<Rect> gifFrames( const vector<uint8_t> &gif )
+{
+    vector<Rect> frames;
+    size_t pos = 13 + ( gif[10] & 0x80 ? 3 << ( ( gif[10] & 7 ) + 1 ) : 0 );
+    auto skipSubBlocks = [&] { while ( gif.at( pos ) ) pos += gif[ pos ] + 1; pos++; };
+    while ( gif.at( pos ) != 0x3b ) {
+        if ( gif[ pos ] == 0x21 ) {
+            pos += 2;
+            skipSubBlocks();
+        }
+        else {
+            EXPECT_EQ( gif[ pos ], 0x2c );
+            const uint8_t *d = &gif[ pos + 1 ];
+            frames.push_back( { le16( d ), le16( d + 2 ), le16( d + 4 ), le16( d + 6 ) } );
+            pos += 10 + ( d[8] & 0x80 ? 3 << ( ( d[8] & 7 ) + 1 ) : 0 ) + 1;
+            skipSubBlocks();
+        }
+    }
+    EXPECT_EQ( pos, gif.size() - 1 );
+    return frames;
+}
+
+TEST( LoopEncoder, GifWritesDirtyRectangles )
+{
+    LoopEncoder::Stats stats;
+    auto gif = encode( "loop.gif", LoopEncoder::GIF, 25, 3, stats );
+    ASSERT_GT( gif.size(), 13u );
+    EXPECT_EQ( string( gif.begin(), gif.begin() + 6 ), "GIF89a" );
+    EXPECT_EQ( le16( &gif[6] ), 32 );
+
+    // Whole first frame, a transparent pixel while still, then the square
+    vector<Rect> expected = { { 0, 0, 32, 16 }, { 0, 0, 1, 1 }, { 8, 4, 4, 4 } };
+    EXPECT_EQ( gifFrames( gif ), expected );
+    EXPECT_EQ( stats.framesWritten, 3 );
+    EXPECT_EQ( stats.bytesWritten, gif.size() );
+    EXPECT_EQ( stats.dirtyPixels, 32u * 16u + 1u + 16u );
+}
+
+TEST( LoopEncoder, GifResamplesFastLoopsTo50Fps )
+{
+    LoopEncoder::Stats stats;
+    auto gif = encode( "loop_60.gif", LoopEncoder::GIF, 60, 6, stats );
+    EXPECT_EQ( stats.framesAdded, 6 );
+    EXPECT_EQ( stats.framesWritten, 5 );
+    EXPECT_EQ( gifFrames( gif ).size(), 5u );
+}
+
+TEST( LoopEncoder, ApngChunksAreNumberedAndCounted )
+{
+    LoopEncoder::Stats stats;
+    auto png = encode( "loop.png", LoopEncoder::APNG, 60, 3, stats );
+    ASSERT_GT( png.size(), 8u );
+    EXPECT_EQ( png[1], 'P' );
+
+    vector<string> types;
+    vector<Rect> frames;
+    vector<uint32_t> sequence;
+    for ( size_t pos = 8; pos + 12 <= png.size(); ) {
+        uint32_t length = be32( &png[ pos ] );
+        string type( png.begin() + pos + 4, png.begin() + pos + 8 );
+        const uint8_t *data = &png[ pos + 8 ];
+        EXPECT_EQ( be32( data + length ), crc32( 0, &png[ pos + 4 ], length + 4 ) ) << type;
+        types.push_back( type );
+        if ( type == "acTL" ) {
+            EXPECT_EQ( be32( data ), 3u );
+        }
+        if ( type == "fcTL" ) {
+            frames.push_back( { (int)be32( data + 12 ), (int)be32( data + 16 ), (int)be32( data + 4 ), (int)be32( data + 8 ) } );
+        }
+        if ( type == "fcTL" || type == "fdAT" ) {
+            sequence.push_back( be32( data ) );
+        }
+        pos += length + 12;
+    }
+
+    vector<string> expectedTypes = { "IHDR", "acTL", "fcTL", "IDAT", "fcTL", "fdAT", "fcTL", "fdAT", "IEND" };
+    EXPECT_EQ( types, expectedTypes );
+    vector<Rect> expectedFrames = { { 0, 0, 32, 16 }, { 0, 0, 1, 1 }, { 8, 4, 4, 4 } };
+    EXPECT_EQ( frames, expectedFrames );
+    vector<uint32_t> expectedSequence = { 0, 1, 2, 3, 4 };
+    EXPECT_EQ( sequence, expectedSequence );
+}
\ No newline at end of file
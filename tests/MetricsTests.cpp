@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include "Metrics.h"
+#include "TestAssets.h"
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+static string readFile( const ci::fs::path &path )
+{
+    ifstream file( path.string() );
+    return string( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+}
+
+TEST( Metrics, AggregatesFramesAndCounters )
+{
+    Metrics metrics;
+    for ( int i = 0; i < 100; i++ ) {
+        metrics.recordFrame( i == 50 ? 40.f : 5.f, i == 50, i == 50 ? 2 : 0 );
+    }
+    metrics.count( Metrics::MIDI_EVENTS, 3 );
+    metrics.set( Metrics::EXPORT_QUEUE_FRAMES, 2 );
+    metrics.setPassTimes( { { "buffer0", 1.5f }, { "main", .5f } } );
+
+    auto snapshot = metrics.publish();
+    EXPECT_EQ( snapshot.frames, 100u );
+    EXPECT_EQ( snapshot.late, 1u );
+    EXPECT_EQ( snapshot.dropped, 2u );
+    EXPECT_FLOAT_EQ( snapshot.renderMax, 40.f );
+    EXPECT_FLOAT_EQ( snapshot.renderP99, 5.f );
+    EXPECT_NEAR( snapshot.renderMean, 5.35f, 1e-4f );
+    EXPECT_EQ( snapshot.counters[ Metrics::MIDI_EVENTS ], 3u );
+    EXPECT_GT( snapshot.rates[ Metrics::MIDI_EVENTS ], 0.f );
+    EXPECT_EQ( snapshot.gauges[ Metrics::EXPORT_QUEUE_FRAMES ], 2. );
+    ASSERT_EQ( snapshot.passes.size(), 2u );
+
+    // Totals carry over, the interval starts again
+    metrics.recordFrame( 5.f, false, 0 );
+    snapshot = metrics.publish();
+    EXPECT_EQ( snapshot.frames, 1u );
+    EXPECT_EQ( snapshot.framesTotal, 101u );
+    EXPECT_EQ( snapshot.lateTotal, 1u );
+    EXPECT_EQ( snapshot.rates[ Metrics::MIDI_EVENTS ], 0.f );
+}
+
+TEST( Metrics, CountsFramesLostToAFullRing )
+{
+    Metrics metrics;
+    for ( int i = 0; i < 5000; i++ ) {
+        metrics.recordFrame( 1.f, false, 0 );
+    }
+    auto snapshot = metrics.publish();
+    EXPECT_EQ( snapshot.frames + snapshot.samplesLost, 5000u );
+    EXPECT_GT( snapshot.samplesLost, 0u );
+}
+
+TEST( Metrics, WritesPrometheusText )
+{
+    Metrics::Snapshot snapshot;
+    snapshot.framesTotal = 42;
+    snapshot.lateTotal = 3;
+    snapshot.counters[ Metrics::OSC_EVENTS ] = 7;
+    snapshot.passes = { { "buffer1", 2.5f } };
+    auto text = Metrics::prometheusText( snapshot );
+    EXPECT_NE( text.find( "# TYPE couleurs_frames_total counter\ncouleurs_frames_total 42\n" ), string::npos );
+    EXPECT_NE( text.find( "couleurs_late_frames_total 3\n" ), string::npos );
+    EXPECT_NE( text.find( "couleurs_input_events_total{source=\"osc\"} 7\n" ), string::npos );
+    EXPECT_NE( text.find( "couleurs_pass_gpu_milliseconds{pass=\"buffer1\"} 2.5\n" ), string::npos );
+    EXPECT_NE( text.find( "# TYPE couleurs_export_queue_frames gauge\n" ), string::npos );
+}
+
+TEST( Metrics, JournalsTheFramesBeforeAMiss )
+{
+    auto folder = testAssetFolder() / "metrics";
+    ci::fs::remove_all( folder );
+    Metrics metrics;
+    metrics.start( folder / "couleurs.prom", folder / "frame_drops.log" );
+    metrics.stop();
+
+    // Started and stopped once so the paths are set, published by hand from here
+    for ( int i = 0; i < 300; i++ ) {
+        metrics.recordFrame( 5.f, i == 200 || i == 210, 0 );
+    }
+    metrics.publish();
+
+    auto journal = readFile( folder / "frame_drops.log" );
+    EXPECT_NE( journal.find( "frame 200 missed its deadline" ), string::npos );
+    EXPECT_NE( journal.find( "frame 210 missed its deadline" ), string::npos );
+
+    // METRICS_JOURNAL_FRAMES before the first miss, only the ones since it before the second
+    auto second = journal.find( "frame 210 missed" );
+    EXPECT_NE( journal.find( "\n     80 " ), string::npos );
+    EXPECT_EQ( journal.find( "\n     79 " ), string::npos );
+    EXPECT_NE( journal.find( "\n    201 ", second ), string::npos );
+    EXPECT_EQ( journal.find( "\n    199 ", second ), string::npos );
+
+    EXPECT_NE( readFile( folder / "couleurs.prom" ).find( "couleurs_late_frames_total 2\n" ), string::npos );
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+#include "Animation.h"
+#include "Modulator.h"
+#include "Parameter.h"
+#include <cmath>
+
+TEST( Modulator, StaysWithinAmount )
+{
+    for ( auto type : { RANDOM, SINE, TRIANGLE, NOISE } ) {
+        Modulator modulator( type, 1.7f, .5f );
+        for ( int i = 0; i < 1000; i++ ) {
+            float value = modulator.tick( i * .013, 1234 );
+            EXPECT_LE( std::abs( value ), .5f + 1e-5f ) << Modulator::typeToString( type );
+        }
+    }
+}
+
+TEST( Modulator, IsAPureFunctionOfSeedAndTime )
+{
+    for ( auto type : { RANDOM, NOISE } ) {
+        Modulator a( type, 2.f, 1.f ), b( type, 2.f, 1.f );
+        b.tick( 3.0, 99 ); // no state carried between ticks
+        for ( double t : { 0.0, .25, 7.5, 1000.125 } ) {
+            EXPECT_EQ( a.tick( t, 99 ), b.tick( t, 99 ) );
+        }
+
+        int differences = 0;
+        for ( int i = 0; i < 16; i++ ) {
+            differences += a.tick( i * .5 + .1, 1 ) != a.tick( i * .5 + .1, 2 );
+        }
+        EXPECT_GT( differences, 8 ) << Modulator::typeToString( type );
+    }
+}
+
+TEST( Modulator, RandomHoldsForAStep )
+{
+    Modulator modulator( RANDOM, 4.f, 1.f );
+    EXPECT_EQ( modulator.tick( 1.01, 7 ), modulator.tick( 1.24, 7 ) );
+    EXPECT_NE( modulator.tick( 1.24, 7 ), modulator.tick( 1.26, 7 ) );
+}
+
+TEST( Modulator, TypeNamesRoundTrip )
+{
+    for ( auto type : { RANDOM, SINE, TRIANGLE, NOISE } ) {
+        EXPECT_EQ( Modulator::stringToType( Modulator::typeToString( type ) ), type );
+    }
+    EXPECT_EQ( Modulator::stringToType( "unknown" ), SINE );
+}
+
+TEST( Animation, ProgressFollowsTheCurve )
+{
+    Animation animation;
+    animation.mDuration = 2.f;
+    animation.mCurve = "linear";
+    EXPECT_FALSE( animation.isActive( 10.0 ) );
+
+    animation.trigger( 10.0 );
+    EXPECT_FALSE( animation.isActive( 9.0 ) );
+    EXPECT_TRUE( animation.isActive( 10.0 ) );
+    EXPECT_FLOAT_EQ( animation.tick( 10.0 ), 0.f );
+    EXPECT_FLOAT_EQ( animation.tick( 11.0 ), .5f );
+    EXPECT_FLOAT_EQ( animation.tick( 12.0 ), 1.f );
+    EXPECT_FLOAT_EQ( animation.tick( 50.0 ), 1.f );
+
+    animation.mCurve = "quad";
+    EXPECT_FLOAT_EQ( animation.tick( 11.0 ), .75f );
+}
+
+TEST( ParameterMotion, TicksLikeTheParameter )
+{
+    Parameter parameter;
+    parameter.baseValue = parameter.currentValue = .5f;
+    parameter.seed = 42;
+    parameter.createModulator();
+    parameter.modulator->mType = NOISE;
+    parameter.modulator->mAmount = .2f;
+    auto animation = std::make_shared<Animation>();
+    animation->mTargetValue = 1.f;
+    animation->mDuration = 1.f;
+    animation->mCurve = "sine";
+    animation->trigger( 2.0 );
+    parameter.animations.push_back( animation );
+
+    ParameterMotion motion;
+    motion.capture( parameter );
+    for ( double t : { 0.0, 1.3, 2.0, 2.4, 5.0 } ) {
+        float value = motion.tick( t, parameter.currentValue );
+        parameter.tick( t );
+        EXPECT_EQ( value, parameter.currentValue ) << t;
+    }
+
+    // Later triggers on the parameter do not reach the copy
+    animation->trigger( 10.0 );
+    EXPECT_TRUE( motion.animations[0].isActive( 5.0 ) );
+    EXPECT_FLOAT_EQ( motion.tick( 10.5, 0.f ), 1.f );
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+#include "ParameterBlock.h"
+#include "TestAssets.h"
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+static string blockName( const string &test )
+{
+    return "/couleurs-" + test + "-" + to_string( getpid() );
+}
+
+// What a controller does, through the C header only
+static couleurs_params_block* mapAsWriter( const string &name )
+{
+    int fd = shm_open( name.c_str(), O_RDWR, 0 );
+    if ( fd < 0 ) return nullptr;
+    void *memory = mmap( nullptr, sizeof( couleurs_params_block ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    return memory == MAP_FAILED ? nullptr : static_cast<couleurs_params_block*>( memory );
+}
+
+TEST( ParameterBlock, DescribesTheParameters )
+{
+    Parameters params( writeTestParams( "block_describe", 4 ) );
+    ParameterBlock block;
+    block.open( blockName( "describe" ) );
+    block.describe( params );
+    EXPECT_EQ( block.entryCount(), 5u );
+
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    EXPECT_EQ( writer->magic, COULEURS_PARAMS_MAGIC );
+    int index = couleurs_params_find( writer, "u_param2" );
+    ASSERT_EQ( index, 2 );
+    EXPECT_FLOAT_EQ( writer->entries[ index ].max, 10.f );
+    EXPECT_FLOAT_EQ( writer->values[ index ][0], 2.5f );
+    int tint = couleurs_params_find( writer, "u_tint" );
+    ASSERT_EQ( tint, 4 );
+    EXPECT_EQ( writer->entries[ tint ].type, (uint32_t)COULEURS_PARAMS_COLOR );
+    EXPECT_FLOAT_EQ( writer->values[ tint ][2], 1.f );
+    EXPECT_EQ( couleurs_params_find( writer, "u_missing" ), -1 );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
+
+TEST( ParameterBlock, ReadsOnlyWhatControllersWrote )
+{
+    Parameters params( writeTestParams( "block_read", 4 ) );
+    ParameterBlock block;
+    block.open( blockName( "read" ) );
+    block.describe( params );
+
+    ParameterBlock::Values values;
+    EXPECT_TRUE( block.read( values ) );
+    EXPECT_TRUE( values.params.empty() );
+    EXPECT_FALSE( block.read( values ) );
+
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    auto generation = couleurs_params_generation( writer );
+    float speed = 7.123456f, tint[3] = { 1.f, 0.f, .5f };
+    EXPECT_TRUE( couleurs_params_set( writer, generation, couleurs_params_find( writer, "u_param3" ), &speed ) );
+    EXPECT_TRUE( couleurs_params_set( writer, generation, couleurs_params_find( writer, "u_tint" ), tint ) );
+    EXPECT_EQ( block.touchedCount(), 2u );
+
+    ASSERT_TRUE( block.read( values ) );
+    ASSERT_EQ( values.params.size(), 1u );
+    EXPECT_EQ( values.params[0].first, "u_param3" );
+    EXPECT_EQ( values.params[0].second, speed );
+    ASSERT_EQ( values.colors.size(), 1u );
+    EXPECT_EQ( values.colors[0].second.x, 1.f );
+    EXPECT_EQ( values.colors[0].second.z, .5f );
+
+    ParameterBlock::apply( values, params );
+    EXPECT_EQ( params.get()[3]->currentValue, speed );
+    EXPECT_FLOAT_EQ( params.getColors()[0]->value.b, .5f );
+
+    // Another patch: stale indices are refused, nothing is touched
+    block.describe( params );
+    EXPECT_FALSE( couleurs_params_set( writer, generation, 3, &speed ) );
+    ASSERT_TRUE( block.read( values ) );
+    EXPECT_TRUE( values.params.empty() );
+    EXPECT_TRUE( values.colors.empty() );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
+
+TEST( ParameterBlock, SnapshotsAreConsistent )
+{
+    // A color written as (v, v, v) must never be read half updated
+    Parameters params( writeTestParams( "block_consistent", 1 ) );
+    ParameterBlock block;
+    block.open( blockName( "consistent" ) );
+    block.describe( params );
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    auto generation = couleurs_params_generation( writer );
+    int tint = couleurs_params_find( writer, "u_tint" );
+
+    atomic<bool> running( true );
+    thread controller( [&] {
+        for ( float v = 0; running; v += 1.f ) {
+            float color[3] = { v, v, v };
+            couleurs_params_set( writer, generation, tint, color );
+        }
+    } );
+    ParameterBlock::Values values;
+    int reads = 0, torn = 0;
+    for ( int i = 0; i < 100000; i++ ) {
+        if ( !block.read( values ) || values.colors.empty() ) continue;
+        auto &color = values.colors[0].second;
+        torn += color.x != color.y || color.y != color.z;
+        reads++;
+    }
+    running = false;
+    controller.join();
+    EXPECT_GT( reads, 0 );
+    EXPECT_EQ( torn, 0 );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
+
+// A controller killed between begin and end
+static void lockAndDie( couleurs_params_block *writer )
+{
+    pid_t child = fork();
+    if ( child == 0 ) {
+        couleurs_params_write_begin( writer );
+        _exit( 0 );
+    }
+    waitpid( child, nullptr, 0 );
+}
+
+TEST( ParameterBlock, TakesOverFromADeadWriter )
+{
+    Parameters params( writeTestParams( "block_dead_writer", 2 ) );
+    ParameterBlock block;
+    block.open( blockName( "dead_writer" ) );
+    block.describe( params );
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    auto generation = couleurs_params_generation( writer );
+
+    // From the per-frame read, the next one goes through
+    ParameterBlock::Values values;
+    EXPECT_TRUE( block.read( values ) );
+    lockAndDie( writer );
+    EXPECT_FALSE( block.read( values ) );
+    EXPECT_EQ( writer->sequence & 1, 0u );
+    EXPECT_GT( couleurs_params_generation( writer ), generation );
+    EXPECT_TRUE( block.read( values ) );
+
+    // And when it happens while the app is not running
+    auto name = block.name();
+    block.close();
+    lockAndDie( writer );
+    block.open( name );
+    EXPECT_EQ( writer->sequence & 1, 0u );
+    EXPECT_EQ( block.entryCount(), 0u );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
+
+TEST( ParameterBlock, WaitsForALiveWriter )
+{
+    Parameters params( writeTestParams( "block_live_writer", 2 ) );
+    ParameterBlock block;
+    block.open( blockName( "live_writer" ) );
+    block.describe( params );
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    auto generation = couleurs_params_generation( writer );
+
+    // Preempted inside the lock: nobody takes it, writes fail instead of spinning
+    ASSERT_TRUE( couleurs_params_write_begin( writer ) );
+    ParameterBlock::Values values;
+    EXPECT_FALSE( block.read( values ) );
+    block.describe( params );
+    float speed = 1.f;
+    EXPECT_EQ( couleurs_params_set( writer, generation, 0, &speed ), -1 );
+    EXPECT_EQ( writer->sequence & 1, 1u );
+    EXPECT_EQ( couleurs_params_generation( writer ), generation );
+
+    couleurs_params_write_end( writer );
+    EXPECT_EQ( couleurs_params_set( writer, generation, 0, &speed ), 1 );
+    ASSERT_TRUE( block.read( values ) );
+    ASSERT_EQ( values.params.size(), 1u );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
+
+TEST( ParameterBlock, AppliesEachWriteOnce )
+{
+    Parameters params( writeTestParams( "block_apply_once", 4 ) );
+    ParameterBlock block;
+    block.open( blockName( "apply_once" ) );
+    block.describe( params );
+    auto writer = mapAsWriter( block.name() );
+    ASSERT_NE( writer, nullptr );
+    auto generation = couleurs_params_generation( writer );
+    float speed = 3.f, other = 4.f;
+    couleurs_params_set( writer, generation, 1, &speed );
+    ParameterBlock::Values values;
+    ASSERT_TRUE( block.read( values ) );
+    ParameterBlock::apply( values, params );
+    EXPECT_EQ( params.get()[1]->currentValue, speed );
+
+    // Moved in the UI, then another controller writes another entry
+    params.get()[1]->currentValue = 1.f;
+    couleurs_params_set( writer, generation, 2, &other );
+    ASSERT_TRUE( block.read( values ) );
+    ParameterBlock::apply( values, params );
+    EXPECT_EQ( params.get()[1]->currentValue, 1.f );
+    EXPECT_EQ( params.get()[2]->currentValue, other );
+
+    // Written again, even with the same value
+    couleurs_params_set( writer, generation, 1, &speed );
+    ASSERT_TRUE( block.read( values ) );
+    ParameterBlock::apply( values, params );
+    EXPECT_EQ( params.get()[1]->currentValue, speed );
+    munmap( writer, sizeof( couleurs_params_block ) );
+    shm_unlink( block.name().c_str() );
+}
\ No newline at end of file
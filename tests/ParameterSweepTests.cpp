@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "Constants.h"
+#include "ParameterSweep.h"
+#include "TestAssets.h"
+#include "cinder/Exception.h"
+
+using namespace std;
+
+static const ci::ivec2 tile( 256, 256 );
+
+TEST( ParameterSweep, BuildsTheGrid )
+{
+    Parameters params( writeTestParams( "sweep_grid", 4 ) );
+    ParameterSweep sweep( params, { "u_param0=0:1:3", "u_param2" }, 0, 0, tile );
+    ASSERT_EQ( sweep.variantCount(), 3 * SWEEP_STEPS );
+
+    // The first axis varies fastest, the second over its params.json range
+    auto &first = sweep.values( 0 );
+    ASSERT_EQ( first.size(), 2u );
+    EXPECT_EQ( first[0].first, "u_param0" );
+    EXPECT_FLOAT_EQ( first[0].second, 0.f );
+    EXPECT_FLOAT_EQ( first[1].second, 0.f );
+    EXPECT_FLOAT_EQ( sweep.values( 1 )[0].second, .5f );
+    EXPECT_FLOAT_EQ( sweep.values( 2 )[0].second, 1.f );
+    EXPECT_FLOAT_EQ( sweep.values( 3 )[0].second, 0.f );
+    EXPECT_FLOAT_EQ( sweep.values( sweep.variantCount() - 1 )[1].second, 10.f );
+
+    sweep.apply( 2, params );
+    EXPECT_FLOAT_EQ( params.get()[0]->baseValue, 1.f );
+    EXPECT_FLOAT_EQ( params.get()[0]->currentValue, 1.f );
+}
+
+TEST( ParameterSweep, SamplesWithinTheRanges )
+{
+    Parameters params( writeTestParams( "sweep_random", 4 ) );
+    ParameterSweep sweep( params, {}, 50, 7, tile );
+    ASSERT_EQ( sweep.variantCount(), 50 );
+    for ( int v = 0; v < sweep.variantCount(); v++ ) {
+        ASSERT_EQ( sweep.values( v ).size(), 4u );
+        for ( auto &value : sweep.values( v ) ) {
+            EXPECT_GE( value.second, 0.f );
+            EXPECT_LT( value.second, 10.f );
+        }
+    }
+    EXPECT_NE( sweep.values( 0 )[0].second, sweep.values( 1 )[0].second );
+
+    // Same seed, same values, whatever else is swept
+    ParameterSweep again( params, { "u_param3" }, 50, 7, tile );
+    EXPECT_EQ( again.values( 12 )[0].second, sweep.values( 12 )[3].second );
+    ParameterSweep other( params, {}, 50, 8, tile );
+    EXPECT_NE( other.values( 0 )[0].second, sweep.values( 0 )[0].second );
+}
+
+TEST( ParameterSweep, LaysOutTheAtlas )
+{
+    Parameters params( writeTestParams( "sweep_layout", 2 ) );
+    ParameterSweep square( params, {}, 10, 0, tile );
+    EXPECT_EQ( square.columns(), 4 );
+    EXPECT_EQ( square.rows(), 3 );
+    EXPECT_EQ( square.atlasSize(), ci::ivec2( 1024, 768 ) );
+    EXPECT_EQ( square.tileOrigin( 5 ), ci::ivec2( 256, 256 ) );
+
+    // Wide tiles stack in fewer columns
+    ParameterSweep wide( params, {}, 16, 0, ci::ivec2( 400, 100 ) );
+    EXPECT_EQ( wide.columns(), 2 );
+    EXPECT_EQ( wide.rows(), 8 );
+}
+
+TEST( ParameterSweep, RejectsBadSweeps )
+{
+    Parameters params( writeTestParams( "sweep_errors", 4 ) );
+    EXPECT_THROW( ParameterSweep( params, { "u_missing" }, 0, 0, tile ), ci::Exception );
+    EXPECT_THROW( ParameterSweep( params, { "u_param0=1" }, 0, 0, tile ), ci::Exception );
+    EXPECT_THROW( ParameterSweep( params, { "u_param0=0:1:0" }, 0, 0, tile ), ci::Exception );
+    EXPECT_THROW( ParameterSweep( params, {}, SWEEP_MAX_VARIANTS + 1, 0, tile ), ci::Exception );
+    EXPECT_THROW( ParameterSweep( params, { "u_param0=0:1:100", "u_param1=0:1:100" }, 0, 0, tile ), ci::Exception );
+}
+
+TEST( ParameterSweep, WritesTheTableForRerenders )
+{
+    Parameters params( writeTestParams( "sweep_table", 3 ) );
+    ParameterSweep sweep( params, { "u_param1" }, 6, 42, tile );
+    auto path = testAssetFolder() / "sweep_table_atlas.json";
+    sweep.write( path, "still_fbm", "", 2.5, 42, params, 4 );
+
+    auto variant = ParameterSweep::readVariant( path, 3 );
+    EXPECT_EQ( variant.patch, "still_fbm" );
+    EXPECT_TRUE( variant.paramsPath.empty() );
+    EXPECT_EQ( variant.time, 2.5 );
+    EXPECT_EQ( variant.seed, 42u );
+    EXPECT_TRUE( variant.rendered );
+
+    // The swept value, and every other parameter as it was
+    ASSERT_EQ( variant.params.size(), 3u );
+    EXPECT_EQ( variant.params[0].first, "u_param0" );
+    EXPECT_FLOAT_EQ( variant.params[0].second, .5f );
+    EXPECT_EQ( variant.params[1].first, "u_param1" );
+    EXPECT_FLOAT_EQ( variant.params[1].second, sweep.values( 3 )[0].second );
+    EXPECT_FLOAT_EQ( variant.params[2].second, 2.5f );
+    ASSERT_EQ( variant.colors.size(), 1u );
+    EXPECT_EQ( variant.colors[0].first, "u_tint" );
+    EXPECT_FLOAT_EQ( variant.colors[0].second.x, .25f );
+    EXPECT_FLOAT_EQ( variant.colors[0].second.z, 1.f );
+
+    // Cancelled before the last two tiles
+    EXPECT_FALSE( ParameterSweep::readVariant( path, 4 ).rendered );
+    EXPECT_THROW( ParameterSweep::readVariant( path, 6 ), ci::Exception );
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "Parameters.h"
+#include "TestAssets.h"
+
+using namespace ci;
+using namespace std;
+
+TEST( Parameters, ReadsEveryField )
+{
+    Parameters params( writeTestParams( "params_fields", 16 ) );
+    auto &scalars = params.get();
+    ASSERT_EQ( scalars.size(), 16u );
+
+    auto &first = scalars[0];
+    EXPECT_EQ( first->name, "u_param0" );
+    EXPECT_FLOAT_EQ( first->min, 0.f );
+    EXPECT_FLOAT_EQ( first->max, 10.f );
+    EXPECT_FLOAT_EQ( first->baseValue, .5f );
+    EXPECT_FLOAT_EQ( first->currentValue, .5f );
+    EXPECT_EQ( first->midiNumber, 0 );
+    EXPECT_EQ( first->oscChannel, 0 );
+    EXPECT_FALSE( first->hasModulator() );
+    ASSERT_EQ( first->animations.size(), 1u );
+    EXPECT_FLOAT_EQ( first->animations[0]->mTargetValue, 10.f );
+    EXPECT_EQ( first->animations[0]->mMidiMapping, 100 );
+    EXPECT_EQ( first->animations[0]->mCurve, "quad" );
+
+    auto &modulated = scalars[1];
+    ASSERT_TRUE( modulated->hasModulator() );
+    EXPECT_EQ( modulated->modulator->mType, NOISE );
+    EXPECT_FLOAT_EQ( modulated->modulator->mFrequency, .5f );
+    EXPECT_FLOAT_EQ( modulated->modulator->mAmount, 2.f );
+    EXPECT_EQ( modulated->midiNumber, -1 );
+    EXPECT_TRUE( modulated->animations.empty() );
+
+    ASSERT_EQ( params.getColors().size(), 1u );
+    EXPECT_EQ( params.getColors()[0]->name, "u_tint" );
+    EXPECT_FLOAT_EQ( params.getColors()[0]->value.g, .5f );
+}
+
+TEST( Parameters, DefaultsMissingRange )
+{
+    JsonTree param;
+    param.addChild( JsonTree( "name", "u_bare" ) );
+    param.addChild( JsonTree( "value", .25f ) );
+    JsonTree params = JsonTree::makeArray( "params" );
+    params.addChild( param );
+    JsonTree root;
+    root.addChild( params );
+    root.addChild( JsonTree::makeArray( "colorParams" ) );
+    root.write( testAssetFolder() / "params_bare.json" );
+
+    Parameters loaded( "params_bare.json" );
+    ASSERT_EQ( loaded.get().size(), 1u );
+    EXPECT_FLOAT_EQ( loaded.get()[0]->min, 0.f );
+    EXPECT_FLOAT_EQ( loaded.get()[0]->max, 1.f );
+    EXPECT_EQ( loaded.get()[0]->oscChannel, -1 );
+}
+
+TEST( Parameters, WriteToRoundTrips )
+{
+    Parameters params( writeTestParams( "params_source", 32 ) );
+    params.get()[2]->currentValue = 7.25f;
+    params.get()[5]->currentValue = 9.f;        // modulated: the base value is saved
+    params.get()[9]->deleteModulator();
+    params.getColors()[0]->value = Colorf( 1.f, 0.f, .5f );
+    params.writeTo( testAssetFolder() / "params_written.json" );
+
+    Parameters written( "params_written.json" );
+    auto &scalars = written.get();
+    ASSERT_EQ( scalars.size(), 32u );
+    EXPECT_FLOAT_EQ( scalars[2]->baseValue, 7.25f );
+    EXPECT_FLOAT_EQ( scalars[5]->baseValue, params.get()[5]->baseValue );
+    EXPECT_TRUE( scalars[5]->hasModulator() );
+    EXPECT_EQ( scalars[5]->modulator->mType, NOISE );
+    EXPECT_FALSE( scalars[9]->hasModulator() );
+    EXPECT_EQ( scalars[8]->midiNumber, 1 );
+    EXPECT_EQ( scalars[8]->animations.size(), 1u );
+    EXPECT_FLOAT_EQ( written.getColors()[0]->value.b, .5f );
+}
+
+TEST( Parameters, RoutesMidiAndOsc )
+{
+    Parameters params( writeTestParams( "params_routing", 64 ) );
+    auto param = params.getParameterForMidiNumber( 3 );
+    ASSERT_NE( param, nullptr );
+    EXPECT_EQ( param->name, "u_param24" );
+    EXPECT_EQ( params.getParameterForMidiNumber( 99 ), nullptr );
+
+    auto channel = params.getParametersForOSCChannel( 5 );
+    ASSERT_EQ( channel.size(), 1u );
+    EXPECT_EQ( channel[0]->name, "u_param5" );
+    EXPECT_TRUE( params.getParametersForOSCChannel( 8 ).empty() );
+
+    EXPECT_EQ( params.getAnimationsForMidiNumber( 102 ).size(), 1u );
+    EXPECT_TRUE( params.getAnimationsForMidiNumber( -1 ).empty() );
+}
+
+TEST( Parameters, SeedIsPerName )
+{
+    Parameters params( writeTestParams( "params_seed", 4 ) );
+    params.setSeed( 42 );
+    auto seed = params.get()[1]->seed;
+    EXPECT_NE( seed, params.get()[2]->seed );
+
+    params.reload();
+    EXPECT_EQ( params.get()[1]->seed, seed );
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "Constants.h"
+#include "Performance.h"
+#include "TestAssets.h"
+#include <fstream>
+
+using namespace std;
+
+static void writeSetlist( const string &name, const string &contents )
+{
+    auto folder = testAssetFolder() / "setlists";
+    ci::fs::create_directories( folder );
+    ofstream( ( folder / ( name + ".txt" ) ).string() ) << contents;
+}
+
+TEST( Performance, ReadsSetlists )
+{
+    writeSetlist( "tests_set", "# opening\nmountains\n  circles  # slow\n\r\nflow\n" );
+    vector<string> expected = { "mountains", "circles", "flow" };
+    EXPECT_EQ( Performance::readSetlist( "tests_set" ), expected );
+}
+
+TEST( Performance, FallsBackToTheDefaultPatch )
+{
+    vector<string> fallback = { PATCH_NAME };
+    EXPECT_EQ( Performance::readSetlist( "tests_missing" ), fallback );
+
+    writeSetlist( "tests_comments", "# nothing yet\n" );
+    EXPECT_EQ( Performance::readSetlist( "tests_comments" ), fallback );
+}
+
+TEST( Performance, NavigatesWithinBounds )
+{
+    Performance performance( { "mountains", "circles", "flow" } );
+    ASSERT_EQ( performance.numPatches(), 3 );
+    EXPECT_EQ( performance.names()[1], "circles" );
+    EXPECT_EQ( performance.currentPatch().shaderPath(), "patches/mountains/shader.frag" );
+
+    EXPECT_FALSE( performance.previous() );
+    EXPECT_TRUE( performance.next() );
+    EXPECT_TRUE( performance.next() );
+    EXPECT_FALSE( performance.next() );
+    EXPECT_EQ( performance.currentPatchIndex(), 2 );
+
+    performance.goToPatch( 3 );
+    performance.goToPatch( -1 );
+    EXPECT_EQ( performance.currentPatchIndex(), 2 );
+    performance.goToPatch( 0 );
+    EXPECT_EQ( performance.currentPatch().name(), "mountains" );
+}
+
+TEST( Performance, EmptyPerformanceStaysPut )
+{
+    Performance performance;
+    EXPECT_FALSE( performance.next() );
+    EXPECT_FALSE( performance.previous() );
+    performance.goToPatch( 0 );
+    EXPECT_EQ( performance.currentPatchIndex(), 0 );
+}
+
+TEST( Performance, ParsesPatchParamsLazily )
+{
+    Performance performance( { "mountains" } );
+    EXPECT_FALSE( performance.currentPatch().params().get().empty() );
+}
\ No newline at end of file
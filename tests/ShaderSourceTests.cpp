@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "PassFusion.h"
+#include "Utils.h"
+
+using namespace std;
+
+static const string chain =
+    "uniform sampler2D u_buffer0;\n"
+    "uniform sampler2D u_buffer1;\n"
+    "void main() {\n"
+    "#ifdef BUFFER_0\n"
+    "    oColor = vec4( vTexCoord0, 0., 1. );\n"
+    "#elif defined( BUFFER_1 )\n"
+    "    oColor = texture( u_buffer0, vTexCoord0 ) * .5;\n"
+    "#else\n"
+    "    oColor = texture( u_buffer1, vTexCoord0 + vec2( .01 ) );\n"
+    "#endif\n"
+    "}\n";
+
+TEST( ShaderSource, CountsDefineBlocks )
+{
+    EXPECT_EQ( getDefineBlockCount( chain, "BUFFER_" ), 2 );
+    EXPECT_EQ( getDefineBlockCount( "#ifdef BUFFER_0\n#endif\n#ifdef BUFFER_0\n#endif\n", "BUFFER_" ), 1 );
+    EXPECT_EQ( getDefineBlockCount( "#if defined(BLUR_3)\n#endif\n", "BLUR_" ), 1 );
+    EXPECT_EQ( getDefineBlockCount( "// BUFFER_0\nvoid main() {}\n", "BUFFER_" ), 0 );
+}
+
+TEST( ShaderSource, ReadsPatchDirectives )
+{
+    auto directives = getPatchDirectives( "#pragma couleurs blur glow buffer0 8 // radius\nvoid main() {}\n  #pragma couleurs lut\n" );
+    ASSERT_EQ( directives.size(), 2u );
+    EXPECT_EQ( directives[0].name, "blur" );
+    vector<string> args = { "glow", "buffer0", "8" };
+    EXPECT_EQ( directives[0].args, args );
+    EXPECT_EQ( directives[1].name, "lut" );
+    EXPECT_TRUE( directives[1].args.empty() );
+}
+
+TEST( PassFusion, FusesASameTexelReader )
+{
+    PassFusion fusion( chain, 2, { false, false }, {} );
+    EXPECT_EQ( fusion.into( 0 ), 1 );
+    EXPECT_FALSE( fusion.isFused( 1 ) ); // read at an offset
+    EXPECT_TRUE( fusion.isConsumer( 1 ) );
+    EXPECT_EQ( fusion.fusedCount(), 1 );
+    EXPECT_EQ( fusion.describe(), "buffer0 > buffer1" );
+    EXPECT_NE( fusion.source().find( "oColor = couleurs_stage0() * .5;" ), string::npos );
+    EXPECT_LT( fusion.source().find( "vec4 couleurs_stage0()" ), fusion.source().find( "void main" ) );
+}
+
+TEST( PassFusion, ClampsLikeTheBufferItReplaces )
+{
+    PassFusion fusion( chain, 2, { false, false }, {} );
+    EXPECT_NE( fusion.source().find( "return clamp( oColor, 0., 1. );" ), string::npos );
+}
+
+TEST( PassFusion, LeavesPinnedAndFeedbackBuffers )
+{
+    PassFusion pinned( chain, 2, { true, false }, {} );
+    EXPECT_EQ( pinned.fusedCount(), 0 );
+    EXPECT_EQ( pinned.source(), chain );
+
+    // buffer0 reads buffer1 from the previous frame
+    string feedback = chain;
+    feedback.replace( feedback.find( "vec4( vTexCoord0, 0., 1. )" ), 26, "texture( u_buffer1, vTexCoord0 ) * .9" );
+    EXPECT_EQ( PassFusion( feedback, 2, { false, false }, {} ).fusedCount(), 0 );
+}
+
+TEST( PassFusion, LeavesStagesReadingMainLocals )
+{
+    // uv is main()'s, and would be the global one inside the stage
+    string locals = chain;
+    locals.replace( locals.find( "void main() {\n" ), 14, "vec2 uv;\nvoid main() {\n    vec2 uv = vTexCoord0 * 2., st;\n" );
+    locals.replace( locals.find( "vec4( vTexCoord0, 0., 1. )" ), 26, "vec4( uv, 0., 1. )" );
+    PassFusion fusion( locals, 2, { false, false }, {} );
+    EXPECT_EQ( fusion.fusedCount(), 0 );
+    EXPECT_EQ( fusion.source(), locals );
+    EXPECT_EQ( fusion.refused(), "buffer0 reads main() locals uv" );
+
+    // Declared by the stage itself
+    locals.replace( locals.find( "    oColor = vec4( uv" ), 4, "    vec2 uv = vTexCoord0;\n    " );
+    PassFusion own( locals, 2, { false, false }, {} );
+    EXPECT_EQ( own.fusedCount(), 1 );
+    EXPECT_TRUE( own.refused().empty() );
+}
\ No newline at end of file
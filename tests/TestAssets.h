@@ -0,0 +1,70 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Json.h"
+#include <string>
+
+// Generated params.json files for the tests and benchmarks, written to a
+// temporary folder that TestMain adds as an asset directory
+
+inline ci::fs::path testAssetFolder()
+{
+    static ci::fs::path folder = [] {
+        auto path = ci::fs::temp_directory_path() / "couleurs_tests";
+        ci::fs::create_directories( path );
+        return path;
+    }();
+    return folder;
+}
+
+// count parameters: every fourth one modulated, every eighth one animated
+// and on a MIDI number, the first eight on OSC channels. Returns the asset path.
+inline std::string writeTestParams( const std::string &name, int count )
+{
+    using ci::JsonTree;
+    JsonTree params = JsonTree::makeArray( "params" );
+    for ( int i = 0; i < count; i++ ) {
+        JsonTree param;
+        param.addChild( JsonTree( "name", "u_param" + std::to_string( i ) ) );
+        param.addChild( JsonTree( "min", 0.f ) );
+        param.addChild( JsonTree( "max", 10.f ) );
+        param.addChild( JsonTree( "value", i % 10 + .5f ) );
+        if ( i < 8 ) {
+            param.addChild( JsonTree( "osc", i ) );
+        }
+        if ( i % 4 == 1 ) {
+            JsonTree modulator = JsonTree::makeObject( "modulator" );
+            modulator.addChild( JsonTree( "type", "noise" ) );
+            modulator.addChild( JsonTree( "frequency", .5f ) );
+            modulator.addChild( JsonTree( "amount", 2.f ) );
+            param.addChild( modulator );
+        }
+        if ( i % 8 == 0 ) {
+            param.addChild( JsonTree( "midi", i / 8 ) );
+            JsonTree animation;
+            animation.addChild( JsonTree( "target", 10.f ) );
+            animation.addChild( JsonTree( "duration", 2.f ) );
+            animation.addChild( JsonTree( "midi", 100 + i / 8 ) );
+            animation.addChild( JsonTree( "curve", "quad" ) );
+            JsonTree animations = JsonTree::makeArray( "animations" );
+            animations.addChild( animation );
+            param.addChild( animations );
+        }
+        params.addChild( param );
+    }
+
+    JsonTree color;
+    color.addChild( JsonTree( "name", "u_tint" ) );
+    color.addChild( JsonTree( "r", .25f ) );
+    color.addChild( JsonTree( "g", .5f ) );
+    color.addChild( JsonTree( "b", 1.f ) );
+    JsonTree colors = JsonTree::makeArray( "colorParams" );
+    colors.addChild( color );
+
+    JsonTree root;
+    root.addChild( params );
+    root.addChild( colors );
+    auto path = name + ".json";
+    root.write( testAssetFolder() / path );
+    return path;
+}
\ No newline at end of file
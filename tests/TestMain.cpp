@@ -0,0 +1,12 @@
+#include "cinder/app/Platform.h"
+#include "gtest/gtest.h"
+#include "TestAssets.h"
+
+// Patches and setlists come from the repository, generated files from the temporary folder
+int main( int argc, char **argv )
+{
+    testing::InitGoogleTest( &argc, argv );
+    ci::app::Platform::get()->addAssetDirectory( COULEURS_ASSETS );
+    ci::app::Platform::get()->addAssetDirectory( testAssetFolder() );
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
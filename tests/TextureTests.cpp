@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "TexturePacking.h"
+#include "TextureUnits.h"
+#include "cinder/Exception.h"
+
+using namespace std;
+
+static const string images =
+    "uniform sampler2D u_inputA;\n"
+    "uniform sampler2D u_inputB;\n"
+    "uniform sampler2D u_inputC;\n"
+    "uniform sampler2D u_lookup;\n"
+    "#define INPUT u_inputC\n"
+    "void main() {\n"
+    "    vec2 size = vec2( textureSize( u_inputA, 0 ) );\n"
+    "    vec4 a = texture( u_inputA, vTexCoord0 + texture(u_inputB, vTexCoord0).rg / size );\n"
+    "    vec4 b = textureLod( u_inputB, fract( vTexCoord0 * 2. ), 0. );\n"
+    "    vec4 c = texture( INPUT, vTexCoord0 ) + texelFetch( u_lookup, ivec2( gl_FragCoord.xy ) % 4, 0 );\n"
+    "    oColor = a + b + c;\n"
+    "}\n";
+
+static vector<TexturePacking::Image> sizes()
+{
+    return { { "inputA", 512, 512, 1 }, { "inputB", 512, 512, 1 }, { "inputC", 512, 512, 1 }, { "lookup", 512, 512, 1 } };
+}
+
+TEST( TexturePacking, PacksDirectlySampledImages )
+{
+    TexturePacking packing( images, sizes(), {}, 256 );
+    ASSERT_EQ( packing.arrayCount(), 1 );
+    vector<string> layers = { "inputA", "inputB", "lookup" };
+    EXPECT_EQ( packing.layers( 0 ), layers );
+    EXPECT_FALSE( packing.isPacked( "inputC" ) ); // renamed by a macro
+    EXPECT_EQ( packing.describe(), "inputA, inputB, lookup > couleurs_layers0" );
+
+    auto &source = packing.source();
+    EXPECT_EQ( source.find( "uniform sampler2D u_inputA;" ), string::npos );
+    EXPECT_LT( source.find( "uniform sampler2DArray u_couleurs_layers0;" ), source.find( "uniform sampler2D u_inputC;" ) );
+    EXPECT_NE( source.find( "textureSize( u_couleurs_layers0, 0 ).xy" ), string::npos );
+    EXPECT_NE( source.find( "texture( u_couleurs_layers0, vec3( vTexCoord0 + texture( u_couleurs_layers0, vec3( vTexCoord0, 1. )).rg / size, 0. ));" ), string::npos );
+    EXPECT_NE( source.find( "textureLod( u_couleurs_layers0, vec3( fract( vTexCoord0 * 2. ), 1. ), 0. )" ), string::npos );
+    EXPECT_NE( source.find( "texelFetch( u_couleurs_layers0, ivec3( ivec2( gl_FragCoord.xy ) % 4, 2 ), 0 )" ), string::npos );
+    EXPECT_NE( source.find( "texture( INPUT, vTexCoord0 )" ), string::npos );
+}
+
+TEST( TexturePacking, GroupsBySizeAndLimit )
+{
+    auto images = sizes();
+    images[1].width = 256;
+    EXPECT_EQ( TexturePacking( ::images, images, {}, 256 ).layers( 0 ), vector<string>( { "inputA", "lookup" } ) );
+
+    // Alone in its size, sampled by a compute pass, or over the layer limit: left as it is
+    images[3].levels = 9;
+    EXPECT_EQ( TexturePacking( ::images, images, {}, 256 ).arrayCount(), 0 );
+    EXPECT_EQ( TexturePacking( ::images, sizes(), { "inputA", "inputB" }, 256 ).arrayCount(), 0 );
+    TexturePacking limited( ::images, sizes(), {}, 2 );
+    ASSERT_EQ( limited.arrayCount(), 1 );
+    EXPECT_FALSE( limited.isPacked( "lookup" ) );
+}
+
+TEST( TexturePacking, LeavesImagesPassedToFunctions )
+{
+    EXPECT_TRUE( TexturePacking::isPackable( images, "inputB" ) );
+    EXPECT_FALSE( TexturePacking::isPackable( images, "inputC" ) );
+    EXPECT_FALSE( TexturePacking::isPackable( "uniform sampler2D u_lut;\nvec3 c = lut( u_lut, color );\n", "lut" ) );
+    EXPECT_FALSE( TexturePacking::isPackable( "uniform sampler2D u_missing;\n", "other" ) );
+    EXPECT_FALSE( TexturePacking::isPackable( images, "flow map" ) );
+}
+
+TEST( TextureUnits, KeepsUnitsAcrossPasses )
+{
+    TextureUnits units( { { "buffer0", { "u_inputA", "u_noise" } },
+                          { "buffer1", { "u_buffer0", "u_noise" } },
+                          { "main",    { "u_buffer1", "u_inputA" } } }, 16, 32 );
+    ASSERT_EQ( units.passCount(), 3 );
+    auto unitOf = [&] ( int pass, const string &name ) {
+        for ( auto &binding : units.bindings( pass ) ) {
+            if ( binding.first == name ) return binding.second;
+        }
+        return -1;
+    };
+    EXPECT_EQ( unitOf( 0, "u_noise" ), unitOf( 1, "u_noise" ) );
+    EXPECT_EQ( unitOf( 0, "u_inputA" ), unitOf( 2, "u_inputA" ) );
+    for ( int pass = 0; pass < 3; pass++ ) {
+        for ( auto &binding : units.bindings( pass ) ) {
+            EXPECT_GT( binding.second, 0 );
+        }
+    }
+    EXPECT_EQ( units.unitsUsed(), 5 );
+    EXPECT_EQ( units.rebindsPerFrame(), 0 );
+}
+
+TEST( TextureUnits, SharesUnitsOverTheLimit )
+{
+    // Five textures, three units past unit 0: distinct within a pass, the
+    // ones needed again the soonest stay bound
+    TextureUnits units( { { "buffer0", { "u_a", "u_b", "u_c" } },
+                          { "buffer1", { "u_a", "u_d" } },
+                          { "main",    { "u_a", "u_e", "u_b" } } }, 16, 4 );
+    EXPECT_EQ( units.unitsUsed(), 4 );
+    for ( int pass = 0; pass < units.passCount(); pass++ ) {
+        auto &bindings = units.bindings( pass );
+        for ( size_t i = 0; i < bindings.size(); i++ ) {
+            for ( size_t j = i + 1; j < bindings.size(); j++ ) {
+                EXPECT_NE( bindings[i].second, bindings[j].second );
+            }
+        }
+    }
+    EXPECT_GT( units.rebindsPerFrame(), 0 );
+    EXPECT_LE( units.rebindsPerFrame(), 4 );
+}
+
+TEST( TextureUnits, FailsOverThePassLimit )
+{
+    vector<string> samplers;
+    for ( int i = 0; i < 17; i++ ) {
+        samplers.push_back( "u_image" + to_string( i ) );
+    }
+    EXPECT_THROW( TextureUnits( { { "buffer2", samplers } }, 16, 80 ), ci::Exception );
+    samplers.pop_back();
+    EXPECT_NO_THROW( TextureUnits( { { "buffer2", samplers } }, 16, 80 ) );
+    EXPECT_THROW( TextureUnits( { { "buffer2", samplers } }, 16, 16 ), ci::Exception );
+    try {
+        TextureUnits( { { "main", { "u_a", "u_b" } } }, 1, 80 );
+    }
+    catch ( const ci::Exception &e ) {
+        EXPECT_EQ( string( e.what() ), "main samples 2 textures, the limit is 1: u_a, u_b" );
+    }
+}
\ No newline at end of file